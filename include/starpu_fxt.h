@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2010-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2010-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2013       Joris Pablo
  * Copyright (C) 2013       Thibaut Lambert
  * Copyright (C) 2020       Federal University of Rio Grande do Sul (UFRGS)
@@ -112,6 +112,14 @@ struct starpu_fxt_options
 	   of dumped codelets.
 	*/
 	long dumped_codelets_count;
+
+	/**
+	   Paths of the columnar binary versions of trace.rec, tasks.rec and
+	   of the transfers, NULL by default.
+	*/
+	char *states_columns_path;
+	char *tasks_columns_path;
+	char *transfers_columns_path;
 };
 
 void starpu_fxt_options_init(struct starpu_fxt_options *options);
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2010-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2010-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2020       Federal University of Rio Grande do Sul (UFRGS)
  *
  * StarPU is free software; you can redistribute it and/or modify
@@ -89,9 +89,12 @@ struct starpu_profiling_task_info
 	/** Identifier of the worker which has executed the task. */
 	int workerid;
 
-	/** Number of cycles used by the task, only available in the MoviSim */
+	/** Number of cycles used by the task, only available in the MoviSim,
+	    or on CPU workers with \ref STARPU_PERF_EVENTS */
 	uint64_t used_cycles;
-	/** Number of cycles stalled within the task, only available in the MoviSim */
+	/** Number of cycles stalled within the task, only available in the
+	    MoviSim, or on CPU workers with \ref STARPU_PERF_EVENTS (backend
+	    stalls) */
 	uint64_t stall_cycles;
 	/** Energy consumed by the task, in Joules */
 	double energy_consumed;
@@ -101,6 +104,13 @@ struct starpu_profiling_task_info
 	long long int papi_values[PAPI_MAX_HWCTRS];
 	int papi_event_set;
 #endif
+
+	/** Number of instructions executed by the task, only available on
+	    CPU workers with \ref STARPU_PERF_EVENTS */
+	uint64_t instructions;
+	/** Number of last level cache misses of the task, only available on
+	    CPU workers with \ref STARPU_PERF_EVENTS */
+	uint64_t cache_misses;
 };
 
 /**
@@ -167,6 +177,24 @@ struct starpu_profiling_worker_info
 	/* TODO: add wasted time due to failed tasks */
 
 	double flops;
+
+	/** Estimated time spent by the worker pushing tasks to the scheduler
+	 * during the profiling measurement interval, only available with \ref
+	 * STARPU_SCHED_OVERHEAD. This does not include the time of the nested
+	 * operations below, so that they can be added up. */
+	struct timespec push_time;
+	/** Estimated time spent by the worker popping tasks from the scheduler,
+	 * only available with \ref STARPU_SCHED_OVERHEAD */
+	struct timespec pop_time;
+	/** Estimated time spent by the worker resolving the dependencies of
+	 * tasks, only available with \ref STARPU_SCHED_OVERHEAD */
+	struct timespec dependencies_time;
+	/** Estimated time spent by the worker fetching the data of tasks, only
+	 * available with \ref STARPU_SCHED_OVERHEAD */
+	struct timespec fetch_time;
+	/** Estimated time spent by the worker terminating tasks, apart from
+	 * their callbacks, only available with \ref STARPU_SCHED_OVERHEAD */
+	struct timespec termination_time;
 };
 
 struct starpu_profiling_bus_info
@@ -380,6 +408,16 @@ void starpu_profiling_worker_helper_display_summary(void);
 */
 void starpu_data_display_memory_stats(void);
 
+/**
+   Dump the last events recorded by the flight recorder of each thread to
+   the file \p path, or to the file given by \ref STARPU_FLIGHT_RECORDER_FILE
+   if \p path is <c>NULL</c>. Return 0 on success, <c>-ENODEV</c> if the
+   flight recorder is disabled, or a negative error code if the file could
+   not be written.
+   See \ref FlightRecorder for more details.
+*/
+int starpu_flight_recorder_dump(const char *path);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2009-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2009-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2011       Télécom-SudParis
  * Copyright (C) 2016       Uppsala University
  *
@@ -1844,6 +1844,29 @@ void starpu_codelet_init(struct starpu_codelet *cl);
 */
 void starpu_codelet_display_stats(struct starpu_codelet *cl);
 
+/**
+   Output on \c stderr the median, 99th and 99.9th percentiles of the
+   submission-to-start latency and of the execution time of the
+   instances of the codelet \p cl, per worker and for all workers. This
+   needs the environment variable \ref STARPU_LATENCY_HISTOGRAMS to be
+   set. See \ref LatencyHistograms for more details.
+*/
+void starpu_codelet_display_latencies(struct starpu_codelet *cl);
+
+/**
+   Compute in \p latencies the \p n percentiles \p ps (between 0 and
+   100) of the latencies of the instances of the codelet \p cl executed
+   by the worker \p workerid, in microseconds. If \p cl is <c>NULL</c>,
+   all codelets are considered, and if \p workerid is -1, all workers
+   are considered. If \p execution is 0, the latencies between the
+   submission and the start of the tasks are considered, otherwise the
+   execution times of the tasks are considered. The values are upper
+   bounds with a relative error below 1/16. Return -ENODEV if the
+   environment variable \ref STARPU_LATENCY_HISTOGRAMS is not set. See
+   \ref LatencyHistograms for more details.
+*/
+int starpu_codelet_get_latency_percentiles(struct starpu_codelet *cl, int workerid, int execution, unsigned n, const double *ps, double *latencies);
+
 /**
    Return the task currently executed by the worker, or <c>NULL</c> if
    it is called either from a thread that is not a task or simply
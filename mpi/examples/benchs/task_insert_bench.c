@@ -0,0 +1,151 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Measure the task submission throughput of each node with
+ * starpu_mpi_task_insert(), on a GEMM-like task graph over a 2D block-cyclic
+ * distribution of tiles. Every node submits the whole graph, but only takes
+ * part in the tasks which execute on it or access its tiles, so that running
+ * it with various numbers of nodes shows how the submission cost of each node
+ * scales with the number of nodes.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+#ifdef STARPU_QUICK_CHECK
+#define NT_DEFAULT 8
+#else
+#define NT_DEFAULT 32
+#endif
+
+static int nt = NT_DEFAULT;
+
+void cpu_func(void *descr[], void *args)
+{
+	(void) descr;
+	(void) args;
+}
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = {cpu_func},
+	.nbuffers = 3,
+	.modes = {STARPU_RW, STARPU_R, STARPU_R},
+	.model = &starpu_perfmodel_nop,
+	.name = "task_insert_bench",
+};
+
+static void parse_args(int argc, char **argv)
+{
+	int i;
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-nt") == 0)
+		{
+			nt = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-help") == 0 || strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+		{
+			fprintf(stderr,"Usage: %s [-nt nt]\n", argv[0]);
+			fprintf(stderr,"Submits nt^3 tasks on nt x nt tiles, currently nt = %d\n", nt);
+			exit(EXIT_SUCCESS);
+		}
+		else
+		{
+			fprintf(stderr,"Unrecognized option %s\n", argv[i]);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int ret, rank, size, p, q, i, j, k;
+	int *values;
+	starpu_data_handle_t *handles;
+	double start, submit_time, total_time;
+	int nexecuted = 0;
+
+	parse_args(argc, argv);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, 1, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 1 CPU worker.\n");
+		starpu_mpi_shutdown();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	/* Most square p x q grid of nodes */
+	for (p = 1; p * p <= size; p++)
+		;
+	p--;
+	while (size % p)
+		p--;
+	q = size / p;
+
+	values = calloc(nt * nt, sizeof(*values));
+	handles = malloc(nt * nt * sizeof(*handles));
+	for (i = 0; i < nt; i++)
+		for (j = 0; j < nt; j++)
+		{
+			int owner = (i % p) * q + (j % q);
+			if (owner == rank)
+				starpu_variable_data_register(&handles[i*nt+j], STARPU_MAIN_RAM, (uintptr_t)&values[i*nt+j], sizeof(values[0]));
+			else
+				starpu_variable_data_register(&handles[i*nt+j], -1, (uintptr_t)NULL, sizeof(values[0]));
+			starpu_mpi_data_register(handles[i*nt+j], i*nt+j, owner);
+		}
+
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+
+	start = starpu_timing_now();
+	for (k = 0; k < nt; k++)
+		for (i = 0; i < nt; i++)
+			for (j = 0; j < nt; j++)
+			{
+				ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &cl,
+							     STARPU_RW, handles[i*nt+j],
+							     STARPU_R, handles[i*nt+k],
+							     STARPU_R, handles[k*nt+j],
+							     0);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+				if ((i % p) * q + (j % q) == rank)
+					nexecuted++;
+			}
+	submit_time = starpu_timing_now() - start;
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	total_time = starpu_timing_now() - start;
+
+	FPRINTF(stdout, "node %d/%d (%dx%d grid): %d insertions (%d tasks executed here) submitted in %.3f ms, %.0f insertions/s, total %.3f ms\n",
+		rank, size, p, q, nt * nt * nt, nexecuted, submit_time / 1000., nt * nt * nt / (submit_time / 1000000.), total_time / 1000.);
+
+	for (i = 0; i < nt * nt; i++)
+		starpu_data_unregister(handles[i]);
+	free(handles);
+	free(values);
+
+	starpu_mpi_shutdown();
+
+	return 0;
+}
@@ -890,6 +890,48 @@ int starpu_mpi_scatter_detached(starpu_data_handle_t *data_handles, int count, i
 */
 int starpu_mpi_gather_detached(starpu_data_handle_t *data_handles, int count, int root, MPI_Comm comm, void (*scallback)(void *), void *sarg, void (*rcallback)(void *), void *rarg);
 
+/**
+   Broadcast the data \p data_handle from the process \p root to all
+   the processes of the communicator, which must all have registered
+   it with the same size and tag. Small data are sent directly by \p
+   root when the communicator is small, otherwise a binomial tree is
+   used, see \ref STARPU_MPI_COLLECTIVE_SMALL_SIZE and \ref
+   STARPU_MPI_COLLECTIVE_FLAT_NODES. The operation is ordered with the
+   other accesses to the data through sequential consistency. Once the
+   data is available on the process, \p callback is called with the
+   argument \p arg.
+   See \ref MPICollective for more details.
+*/
+int starpu_mpi_bcast_detached(starpu_data_handle_t data_handle, int root, MPI_Comm comm, void (*callback)(void *), void *arg);
+
+/**
+   Reduce the data \p data_handle of all the processes of the
+   communicator with the reduction method set with
+   starpu_data_set_reduction_methods(), and make the result available
+   on all of them. Small data use recursive doubling, bigger data use
+   a binomial tree reduction followed by a broadcast, see \ref
+   STARPU_MPI_COLLECTIVE_SMALL_SIZE. The operation is ordered with the
+   other accesses to the data through sequential consistency. Once the
+   result is available on the process, \p callback is called with
+   the argument \p arg.
+   See \ref MPICollective for more details.
+*/
+int starpu_mpi_allreduce_detached(starpu_data_handle_t data_handle, MPI_Comm comm, void (*callback)(void *), void *arg);
+
+/**
+   Make all the data of the array \p data_handles available on all the
+   processes of the communicator, each data being initially valid on
+   its owner. All processes must have registered all the data. Small
+   data use recursive doubling when the size of the communicator is a
+   power of two, otherwise a ring is used, see \ref
+   STARPU_MPI_COLLECTIVE_SMALL_SIZE. The operation is ordered with the
+   other accesses to the data through sequential consistency. Once all
+   the data are available on the process, \p callback is called with
+   the argument \p arg.
+   See \ref MPICollective for more details.
+*/
+int starpu_mpi_allgather_detached(starpu_data_handle_t *data_handles, int count, MPI_Comm comm, void (*callback)(void *), void *arg);
+
 /** @} */
 
 /**
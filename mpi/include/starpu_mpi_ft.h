@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2013-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2013-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -106,11 +106,30 @@ int starpu_mpi_checkpoint_template_freeze(starpu_mpi_checkpoint_template_t *cp_t
  * The data internal to StarPU (aka handles given with ::STARPU_R) will be saved with their value at
  * execution time (when the task submitted before the ::starpu_mpi_checkpoint_template_submit() have been executed,
  * and before this data is modfied by the tasks submitted after the ::starpu_mpi_checkpoint_template_submit())
+ * Handles which have not been written to on their owner since the previous submission of the template are not sent
+ * again, the backup rank keeps its copy for the new checkpoint. Writes submitted without sequential consistency are not
+ * counted, handles whose sequential consistency is disabled are thus sent at each submission.
  */
 int starpu_mpi_checkpoint_template_submit(starpu_mpi_checkpoint_template_t cp_template, int prio);
 
 int starpu_mpi_checkpoint_template_print(starpu_mpi_checkpoint_template_t cp_template);
 
+/**
+ * Reload the data of \p cp_template owned by the calling node from the local
+ * disk checkpoints written by ::starpu_mpi_checkpoint_template_submit() when
+ * \ref STARPU_MPI_CHECKPOINT_DISK is set, typically when restarting the whole
+ * application. This is meant to be called by all the nodes, after the template
+ * is frozen and before submitting tasks accessing the data.
+ * The two last complete checkpoint instances are kept on disk. When \p instance
+ * is -1, the last one is reloaded, otherwise the given one. Since some nodes
+ * may have completed one more checkpoint than others, the application can
+ * agree on the minimum of the instances returned by the nodes, and call this
+ * function again with it.
+ * Return the instance which was reloaded, -ENOENT if it is not available on
+ * disk, or -ENODEV if disk checkpoints are not enabled.
+ */
+int starpu_mpi_checkpoint_template_restore(starpu_mpi_checkpoint_template_t cp_template, int instance);
+
 #else // !STARPU_USE_MPI_FT
 static inline int starpu_mpi_checkpoint_template_register(starpu_mpi_checkpoint_template_t *cp_template STARPU_ATTRIBUTE_UNUSED, int cp_id STARPU_ATTRIBUTE_UNUSED, int cp_domain STARPU_ATTRIBUTE_UNUSED, ...) { return 0; }
 static inline int starpu_mpi_checkpoint_template_create(starpu_mpi_checkpoint_template_t *cp_template STARPU_ATTRIBUTE_UNUSED, int cp_id STARPU_ATTRIBUTE_UNUSED, int cp_domain STARPU_ATTRIBUTE_UNUSED) { return 0; }
@@ -120,6 +139,7 @@ static inline int starpu_mpi_checkpoint_template_submit(starpu_mpi_checkpoint_te
 static inline int starpu_mpi_ft_turn_on(void) { return 0; }
 static inline int starpu_mpi_ft_turn_off(void) { return 0; }
 static inline int starpu_mpi_checkpoint_template_print(starpu_mpi_checkpoint_template_t cp_template STARPU_ATTRIBUTE_UNUSED) { return 0; }
+static inline int starpu_mpi_checkpoint_template_restore(starpu_mpi_checkpoint_template_t cp_template STARPU_ATTRIBUTE_UNUSED, int instance STARPU_ATTRIBUTE_UNUSED) { return -ENODEV; }
 static inline int starpu_mpi_checkpoint_init(void) { return 0; }
 static inline int starpu_mpi_checkpoint_shutdown(void) { return 0; }
 
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2016-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2016-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -31,9 +31,11 @@ struct starpu_mpi_lb_conf
 
 /**
    Initialize the load balancer's environment with the load policy provided by the
-   user
+   user, which can be overridden by the environment variable \ref STARPU_MPI_LB.
+   The \c heat policy needs the methods of \p conf, the \c work policy does not
+   need any and accepts a <c>NULL</c> \p conf. See \ref MPILoadBalancer.
 */
-void starpu_mpi_lb_init(const char *lb_policy_name, struct starpu_mpi_lb_conf *);
+void starpu_mpi_lb_init(const char *lb_policy_name, struct starpu_mpi_lb_conf *conf);
 void starpu_mpi_lb_shutdown(void);
 
 #ifdef __cplusplus
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2016-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2016-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -17,6 +17,7 @@
 #ifndef __LOAD_BALANCER_POLICY_H__
 #define __LOAD_BALANCER_POLICY_H__
 
+#include <starpu_mpi.h>
 #include <starpu_mpi_lb.h>
 
 /** @file */
@@ -37,6 +38,12 @@ struct load_balancer_policy
 	int (*deinit)();
 	void (*submitted_task_entry_point)();
 	void (*finished_task_entry_point)();
+	/** Called for each task to be executed by the local node, just before
+	 * its submission by starpu_mpi_task_insert() */
+	void (*task_to_submit_entry_point)(struct starpu_task *task);
+	/** Called by all nodes at the end of each starpu_mpi_task_insert(),
+	 * whether the task is executed locally or not */
+	void (*inserted_task_entry_point)(MPI_Comm comm);
 
 	/** Name of the load balancing policy. The selection of the load balancer is
 	 * performed through the use of the STARPU_MPI_LB=name environment
@@ -46,6 +53,7 @@ struct load_balancer_policy
 };
 
 extern struct load_balancer_policy load_heat_propagation_policy;
+extern struct load_balancer_policy load_work_diffusion_policy;
 
 #ifdef __cplusplus
 }
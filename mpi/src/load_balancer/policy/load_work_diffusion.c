@@ -0,0 +1,520 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Load balancer driven by the measured execution times.
+ *
+ * Every STARPU_MPI_LB_WORK_PERIOD tasks inserted with starpu_mpi_task_insert(),
+ * all the nodes exchange:
+ * - the time spent by their workers executing tasks since the previous
+ *   balancing step, as measured by the profiling,
+ * - the pieces of data they own on which the locally executed tasks have
+ *   spent the most time since the previous step, i.e. the data written by
+ *   these tasks, along with that time, as estimated by the performance models
+ *   of the tasks, or else from the average measured duration of the tasks.
+ *
+ * All the nodes then compute the same migrations: as long as moving one of
+ * these pieces of data from the most loaded node to the least loaded one
+ * lowers the highest of both loads by more than the time needed to transfer
+ * it, amortized over STARPU_MPI_LB_WORK_HORIZON steps, it is moved. Since all
+ * the nodes take the same decisions at the same point of the task insertion,
+ * they can all call starpu_mpi_data_migrate() on the pieces of data they have
+ * registered.
+ *
+ * The pieces of data which have been moved are migrated back to their
+ * original node when the load balancer is shut down.
+ *
+ * The pieces of data are only known by their MPI tag once their tasks are
+ * submitted, since the application may unregister them at any time. The
+ * busy time of the workers is read from running totals which are not reset by
+ * starpu_profiling_worker_get_info(), so that the application can still use
+ * it.
+ */
+
+#include <starpu_mpi.h>
+#include <mpi/starpu_mpi_tag.h>
+#include <common/uthash.h>
+#include <common/utils.h>
+#include <math.h>
+#include <starpu_mpi_private.h>
+#include <profiling/profiling.h>
+#include "load_balancer_policy.h"
+#include <common/config.h>
+
+#if defined(STARPU_USE_MPI_MPI)
+
+static starpu_mpi_tag_t TAG_WORK(int n)
+{
+	return ((starpu_mpi_tag_t) n+1) << 32;
+}
+
+struct work_candidate
+{
+	starpu_mpi_tag_t tag;
+	/** Estimated time spent by the tasks writing to the data, in us */
+	double cost;
+	/** Size of the data, in bytes */
+	double size;
+};
+
+/* What each node tells the other nodes at each balancing step */
+struct work_summary
+{
+	/** Time spent by the workers executing tasks, in us */
+	double busy;
+	/** Estimated time of all the tasks executed locally, in us */
+	double work;
+	int nworkers;
+	int ncandidates;
+	/** Sorted by decreasing cost */
+	struct work_candidate candidates[];
+};
+
+/* Time spent by the local tasks on each piece of data they write to */
+struct tag_cost_entry
+{
+	UT_hash_handle hh;
+	starpu_mpi_tag_t tag;
+	/** Size of the data, in bytes */
+	size_t size;
+	/** Whether the data was owned by the local node when the tasks were
+	 * submitted */
+	int owned;
+	/** Estimated time of the tasks which have a calibrated performance model */
+	double cost;
+	/** Number of tasks which do not */
+	unsigned long nunmodelled;
+};
+
+/* Pieces of data moved by the load balancer, along with their original node.
+ * All of these pieces of data must be migrated back at the end of the
+ * execution. */
+struct moved_data_entry
+{
+	UT_hash_handle hh;
+	starpu_mpi_tag_t tag;
+	int rank;
+};
+
+static struct tag_cost_entry *costs = NULL;
+static starpu_pthread_mutex_t costs_mutex;
+static struct moved_data_entry *mdh = NULL;
+
+/* MPI infos */
+static int my_rank;
+static int world_size;
+
+/* One summary per node */
+static struct work_summary **summaries = NULL;
+static starpu_data_handle_t *summary_handles = NULL;
+
+static unsigned long ninserted;
+static int period;
+static int ncandidates_max;
+static double horizon;
+/* In MB/s, i.e. bytes/us */
+static double bandwidth;
+/* In us */
+static double latency;
+
+/* Measured since the initialization, to estimate the time of the tasks which
+ * do not have a calibrated performance model */
+static double total_busy;
+static unsigned long total_executed;
+
+/* Running totals of the workers at the previous balancing step */
+static double *worker_busy;
+static unsigned long *worker_executed;
+
+static int saved_profiling;
+static unsigned long nmigrations;
+
+/******************************************************************************
+ *                              Balancing                                     *
+ *****************************************************************************/
+
+/* Measure the local load, and fill the summary of the local node */
+static void fill_summary(void)
+{
+	struct work_summary *summary = summaries[my_rank];
+	struct tag_cost_entry *entry, *tmp;
+	unsigned worker, nworkers = starpu_worker_get_count();
+	double busy = 0.;
+	unsigned long executed = 0;
+	int i;
+
+	for (worker = 0; worker < nworkers; worker++)
+	{
+		double worker_total_busy;
+		unsigned long worker_total_executed;
+		_starpu_profiling_worker_get_cumulated_executing(worker, &worker_total_busy, &worker_total_executed);
+		busy += worker_total_busy - worker_busy[worker];
+		executed += worker_total_executed - worker_executed[worker];
+		worker_busy[worker] = worker_total_busy;
+		worker_executed[worker] = worker_total_executed;
+	}
+	total_busy += busy;
+	total_executed += executed;
+
+	starpu_data_acquire(summary_handles[my_rank], STARPU_W);
+	summary->busy = busy;
+	summary->work = 0.;
+	summary->nworkers = nworkers;
+	summary->ncandidates = 0;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&costs_mutex);
+	HASH_ITER(hh, costs, entry, tmp)
+	{
+		double cost = entry->cost;
+		if (entry->nunmodelled && total_executed)
+			cost += entry->nunmodelled * total_busy / total_executed;
+		summary->work += cost;
+
+		HASH_DEL(costs, entry);
+		if (cost > 0. && entry->owned)
+		{
+			/* Keep the most expensive ones */
+			if (summary->ncandidates < ncandidates_max || cost > summary->candidates[ncandidates_max-1].cost)
+			{
+				i = summary->ncandidates < ncandidates_max ? summary->ncandidates++ : ncandidates_max - 1;
+				for ( ; i > 0 && summary->candidates[i-1].cost < cost; i--)
+					summary->candidates[i] = summary->candidates[i-1];
+				summary->candidates[i].tag = entry->tag;
+				summary->candidates[i].cost = cost;
+				summary->candidates[i].size = entry->size;
+			}
+		}
+		free(entry);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&costs_mutex);
+
+	starpu_data_release(summary_handles[my_rank]);
+}
+
+static void migrate(starpu_mpi_tag_t tag, int dst_rank)
+{
+	starpu_data_handle_t handle = _starpu_mpi_tag_get_data_handle_from_tag(tag);
+	struct moved_data_entry *md = NULL;
+
+	if (!handle)
+	{
+		/* The destination node has to know about the data */
+		STARPU_ASSERT_MSG(dst_rank != my_rank, "The data with tag %"PRIi64" has to be registered on all nodes to be moved by the work load balancer\n", tag);
+		/* We do not know about this data, we do not need to know where it is */
+		return;
+	}
+
+	HASH_FIND(hh, mdh, &tag, sizeof(tag), md);
+	if (!md)
+	{
+		_STARPU_MPI_MALLOC(md, sizeof(struct moved_data_entry));
+		md->tag = tag;
+		md->rank = starpu_mpi_data_get_rank(handle);
+		HASH_ADD(hh, mdh, tag, sizeof(md->tag), md);
+	}
+	else if (md->rank == dst_rank)
+	{
+		/* Back home */
+		HASH_DEL(mdh, md);
+		free(md);
+	}
+
+	_STARPU_DEBUG("[node %d] Moving data %"PRIi64" from node %d to node %d\n", my_rank, tag, starpu_mpi_data_get_rank(handle), dst_rank);
+	starpu_mpi_data_migrate(MPI_COMM_WORLD, handle, dst_rank);
+}
+
+/* Decides which data has to move where, from the summaries of all the nodes.
+ * This is computed the same way by all the nodes. */
+static void balance(void)
+{
+	double *load, *scale;
+	char *used;
+	int r, c;
+
+	_STARPU_MPI_MALLOC(load, world_size * sizeof(*load));
+	_STARPU_MPI_MALLOC(scale, world_size * sizeof(*scale));
+	_STARPU_MPI_CALLOC(used, world_size, ncandidates_max);
+
+	for (r = 0; r < world_size; r++)
+	{
+		struct work_summary *summary = summaries[r];
+		load[r] = summary->nworkers ? summary->busy / summary->nworkers : 0.;
+		/* Make the estimations of the node match its measurement */
+		scale[r] = summary->work > 0. ? summary->busy / summary->work : 0.;
+	}
+
+	while (1)
+	{
+		int most = -1, least = -1, chosen = -1;
+		double from = 0., to = 0.;
+
+		/* Nodes without workers can neither give nor take any work */
+		for (r = 0; r < world_size; r++)
+		{
+			if (!summaries[r]->nworkers)
+				continue;
+			if (most < 0 || load[r] > load[most])
+				most = r;
+			if (least < 0 || load[r] < load[least])
+				least = r;
+		}
+		if (most < 0 || load[most] <= load[least])
+			break;
+
+		/* Take the most expensive data whose move is worth it */
+		for (c = 0; c < summaries[most]->ncandidates; c++)
+		{
+			struct work_candidate *candidate = &summaries[most]->candidates[c];
+			double cost = candidate->cost * scale[most];
+			double gain, transfer;
+
+			if (used[most * ncandidates_max + c])
+				continue;
+
+			from = load[most] - cost / summaries[most]->nworkers;
+			to = load[least] + cost / summaries[least]->nworkers;
+			gain = load[most] - STARPU_MAX(from, to);
+			transfer = latency + candidate->size / bandwidth;
+			if (gain > 0. && gain * horizon > transfer)
+			{
+				chosen = c;
+				break;
+			}
+		}
+		if (chosen < 0)
+			break;
+
+		used[most * ncandidates_max + chosen] = 1;
+		load[most] = from;
+		load[least] = to;
+		migrate(summaries[most]->candidates[chosen].tag, least);
+		nmigrations++;
+	}
+
+	free(used);
+	free(scale);
+	free(load);
+}
+
+/* Core function of the load balancer, called by all the nodes at the same
+ * point of the task insertion */
+static void work_balance(void)
+{
+	int i;
+
+	fill_summary();
+
+	/* Send the local summary to all the other nodes, and receive theirs */
+	for (i = 0; i < world_size; i++)
+		starpu_mpi_get_data_on_all_nodes_detached(MPI_COMM_WORLD, summary_handles[i]);
+	for (i = 0; i < world_size; i++)
+		starpu_data_acquire(summary_handles[i], STARPU_R);
+
+	balance();
+
+	/* Clean the summaries to properly launch the next balancing step */
+	for (i = 0; i < world_size; i++)
+	{
+		starpu_data_release(summary_handles[i]);
+		starpu_mpi_cache_flush(MPI_COMM_WORLD, summary_handles[i]);
+	}
+}
+
+/******************************************************************************
+ *                      Work Load Balancer Entry Points                       *
+ *****************************************************************************/
+
+static void task_to_submit_work(struct starpu_task *task)
+{
+	starpu_data_handle_t handle = NULL;
+	struct tag_cost_entry *entry;
+	starpu_mpi_tag_t tag;
+	unsigned i, sched_ctx;
+	double length;
+
+	if (!task->cl)
+		return;
+
+	/* The task is executed here because we own the data it writes to */
+	for (i = 0; i < STARPU_TASK_GET_NBUFFERS(task); i++)
+	{
+		if (STARPU_TASK_GET_MODE(task, i) & STARPU_W)
+		{
+			handle = STARPU_TASK_GET_HANDLE(task, i);
+			break;
+		}
+	}
+	if (!handle)
+		return;
+
+	sched_ctx = task->sched_ctx < STARPU_NMAX_SCHED_CTXS ? task->sched_ctx : starpu_sched_ctx_get_context();
+	if (sched_ctx == STARPU_NMAX_SCHED_CTXS)
+		sched_ctx = 0;
+	length = starpu_task_expected_length_average(task, sched_ctx);
+	tag = starpu_mpi_data_get_tag(handle);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&costs_mutex);
+	HASH_FIND(hh, costs, &tag, sizeof(tag), entry);
+	if (!entry)
+	{
+		_STARPU_MPI_CALLOC(entry, 1, sizeof(struct tag_cost_entry));
+		entry->tag = tag;
+		entry->size = starpu_data_get_size(handle);
+		/* The data may be unregistered before the next balancing
+		 * step, keep what will be needed then */
+		entry->owned = tag != -1 && starpu_mpi_data_get_rank(handle) == my_rank;
+		HASH_ADD(hh, costs, tag, sizeof(entry->tag), entry);
+	}
+	if (isnan(length) || length <= 0.)
+		entry->nunmodelled++;
+	else
+		entry->cost += length;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&costs_mutex);
+}
+
+static void inserted_task_work(MPI_Comm comm)
+{
+	if (comm != MPI_COMM_WORLD)
+		return;
+	if (++ninserted % period == 0)
+		work_balance();
+}
+
+/******************************************************************************
+ *                  Initialization / Deinitialization                         *
+ *****************************************************************************/
+
+static int init_work(struct starpu_mpi_lb_conf *itf)
+{
+	unsigned worker;
+	int i;
+
+	/* This load balancer does not need any help from the application */
+	(void)itf;
+
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &world_size);
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &my_rank);
+
+	period = starpu_getenv_number_default("STARPU_MPI_LB_WORK_PERIOD", 1000);
+	if (period <= 0)
+		period = 1;
+	ncandidates_max = starpu_getenv_number_default("STARPU_MPI_LB_WORK_CANDIDATES", 16);
+	if (ncandidates_max <= 0)
+		ncandidates_max = 1;
+	horizon = starpu_getenv_float_default("STARPU_MPI_LB_WORK_HORIZON", 10.);
+	bandwidth = starpu_getenv_float_default("STARPU_MPI_LB_WORK_BANDWIDTH", 1000.);
+	latency = starpu_getenv_float_default("STARPU_MPI_LB_WORK_LATENCY", 10.);
+
+	/* The busy time of the workers is measured by the profiling */
+	saved_profiling = starpu_profiling_status_get();
+	if (!saved_profiling)
+		starpu_profiling_status_set(STARPU_PROFILING_ENABLE);
+	/* Only measure from now on */
+	_STARPU_MPI_MALLOC(worker_busy, starpu_worker_get_count() * sizeof(*worker_busy));
+	_STARPU_MPI_MALLOC(worker_executed, starpu_worker_get_count() * sizeof(*worker_executed));
+	for (worker = 0; worker < starpu_worker_get_count(); worker++)
+		_starpu_profiling_worker_get_cumulated_executing(worker, &worker_busy[worker], &worker_executed[worker]);
+
+	STARPU_PTHREAD_MUTEX_INIT(&costs_mutex, NULL);
+	costs = NULL;
+	mdh = NULL;
+	ninserted = 0;
+	total_busy = 0.;
+	total_executed = 0;
+	nmigrations = 0;
+
+	/* Summaries of all the nodes, registered once for all the balancing
+	 * steps */
+	_STARPU_MPI_MALLOC(summaries, world_size * sizeof(*summaries));
+	_STARPU_MPI_MALLOC(summary_handles, world_size * sizeof(*summary_handles));
+	for (i = 0; i < world_size; i++)
+	{
+		size_t size = sizeof(struct work_summary) + ncandidates_max * sizeof(struct work_candidate);
+		_STARPU_MPI_CALLOC(summaries[i], 1, size);
+		starpu_variable_data_register(&summary_handles[i], STARPU_MAIN_RAM, (uintptr_t) summaries[i], size);
+		starpu_mpi_data_register(summary_handles[i], TAG_WORK(i), i);
+	}
+
+	return 0;
+}
+
+static int deinit_work()
+{
+	struct moved_data_entry *md, *tmp;
+	struct tag_cost_entry *entry, *tmp_entry;
+	int i;
+
+	if (!summaries)
+		return 1;
+
+	_STARPU_DEBUG("Shutting down work lb policy, %lu migrations\n", nmigrations);
+
+	/* Move back all the data that has been migrated, to ensure the
+	 * consistency with the ranks of data originally registered by the
+	 * application. All the nodes have the same view of it. */
+	HASH_ITER(hh, mdh, md, tmp)
+	{
+		starpu_data_handle_t handle = _starpu_mpi_tag_get_data_handle_from_tag(md->tag);
+		/* Unless the application has already unregistered it */
+		if (handle)
+			starpu_mpi_data_migrate(MPI_COMM_WORLD, handle, md->rank);
+		HASH_DEL(mdh, md);
+		free(md);
+	}
+
+	STARPU_PTHREAD_MUTEX_LOCK(&costs_mutex);
+	HASH_ITER(hh, costs, entry, tmp_entry)
+	{
+		HASH_DEL(costs, entry);
+		free(entry);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&costs_mutex);
+	STARPU_PTHREAD_MUTEX_DESTROY(&costs_mutex);
+
+	for (i = 0; i < world_size; i++)
+	{
+		starpu_data_unregister(summary_handles[i]);
+		free(summaries[i]);
+	}
+	free(summary_handles);
+	summary_handles = NULL;
+	free(summaries);
+	summaries = NULL;
+	free(worker_busy);
+	worker_busy = NULL;
+	free(worker_executed);
+	worker_executed = NULL;
+
+	if (!saved_profiling)
+		starpu_profiling_status_set(STARPU_PROFILING_DISABLE);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                  Policy                                    *
+ *****************************************************************************/
+
+struct load_balancer_policy load_work_diffusion_policy =
+{
+	.init = init_work,
+	.deinit = deinit_work,
+	.task_to_submit_entry_point = task_to_submit_work,
+	.inserted_task_entry_point = inserted_task_work,
+	.policy_name = "work"
+};
+
+#endif
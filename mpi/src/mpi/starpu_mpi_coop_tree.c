@@ -0,0 +1,236 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdlib.h>
+#include <starpu_mpi.h>
+#include <starpu_mpi_private.h>
+#include <mpi/starpu_mpi_coop_tree.h>
+#include <mpi/starpu_mpi_mpi_backend.h>
+#include <common/uthash.h>
+
+/*
+ * Diffusion tree of the cooperative sends, following the hosts of the nodes:
+ * the sender sends the data only once to each other host, to the node with
+ * the highest priority request there, which forwards it to the other nodes of
+ * its host through shared memory.
+ *
+ * The forwarded requests are completed only when the forwarding node
+ * acknowledges that the forwarded envelopes were matched, so that the data
+ * can not be modified and sent again directly before the forwarded copy is
+ * received, which would break the ordering of the messages.
+ */
+
+#ifdef STARPU_USE_MPI_MPI
+
+struct _starpu_mpi_coop_tree_ack
+{
+	UT_hash_handle hh;
+	/** Tag and rank of the request sent to the forwarding node */
+	struct _starpu_mpi_node_tag node_tag;
+	/** Requests whose data is forwarded by that node */
+	struct _starpu_mpi_req **reqs;
+	unsigned n;
+	/** Next forward by the same node with the same tag, which it will
+	 * acknowledge after this one */
+	struct _starpu_mpi_coop_tree_ack *next;
+};
+
+/** The communicator for which we know the hosts */
+static MPI_Comm coop_tree_comm;
+/** For each rank of coop_tree_comm, an identifier of its host */
+static int *coop_tree_hosts;
+
+static starpu_pthread_mutex_t coop_tree_acks_mutex;
+static struct _starpu_mpi_coop_tree_ack *coop_tree_acks;
+static int coop_tree_acks_count;
+
+void _starpu_mpi_coop_tree_init(MPI_Comm comm)
+{
+	STARPU_PTHREAD_MUTEX_INIT(&coop_tree_acks_mutex, NULL);
+	coop_tree_acks = NULL;
+	coop_tree_acks_count = 0;
+	coop_tree_hosts = NULL;
+
+#ifdef STARPU_SIMGRID
+	/* The simulated platform does not tell about hosts */
+	(void) comm;
+#else
+	int rank, size, host, ranks_per_host, i;
+
+	coop_tree_comm = comm;
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+	_STARPU_MPI_MALLOC(coop_tree_hosts, size * sizeof(*coop_tree_hosts));
+
+	ranks_per_host = starpu_getenv_number_default("STARPU_MPI_RANKS_PER_HOST", 0);
+	if (ranks_per_host > 0)
+	{
+		/* Pretend that consecutive ranks share hosts */
+		for (i = 0; i < size; i++)
+			coop_tree_hosts[i] = i / ranks_per_host;
+		return;
+	}
+
+#if MPI_VERSION >= 3
+	/* Identify each host by the smallest rank which runs on it */
+	MPI_Comm host_comm;
+	MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &host_comm);
+	MPI_Allreduce(&rank, &host, 1, MPI_INT, MPI_MIN, host_comm);
+	MPI_Comm_free(&host_comm);
+	MPI_Allgather(&host, 1, MPI_INT, coop_tree_hosts, 1, MPI_INT, comm);
+#else
+	/* Compare the host names */
+	char *names;
+	int len;
+	_STARPU_MPI_CALLOC(names, size, MPI_MAX_PROCESSOR_NAME);
+	MPI_Get_processor_name(names + rank * MPI_MAX_PROCESSOR_NAME, &len);
+	MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, names, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, comm);
+	for (i = 0; i < size; i++)
+		for (host = 0; host <= i; host++)
+			if (!strncmp(names + i * MPI_MAX_PROCESSOR_NAME, names + host * MPI_MAX_PROCESSOR_NAME, MPI_MAX_PROCESSOR_NAME))
+			{
+				coop_tree_hosts[i] = host;
+				break;
+			}
+	free(names);
+#endif
+#endif /* STARPU_SIMGRID */
+}
+
+void _starpu_mpi_coop_tree_shutdown(void)
+{
+	STARPU_MPI_ASSERT_MSG(coop_tree_acks_count == 0, "%d cooperative sends were not acknowledged by their forwarding node", coop_tree_acks_count);
+	free(coop_tree_hosts);
+	coop_tree_hosts = NULL;
+	STARPU_PTHREAD_MUTEX_DESTROY(&coop_tree_acks_mutex);
+}
+
+void _starpu_mpi_coop_sends_build_tree(struct _starpu_mpi_coop_sends *coop_sends)
+{
+	struct _starpu_mpi_req **reqs = coop_sends->reqs_array;
+	unsigned n = coop_sends->n, i, j;
+	MPI_Comm comm = reqs[0]->node_tag.node.comm;
+	int me, myhost;
+
+	if (!coop_tree_hosts || comm != coop_tree_comm)
+		return;
+	for (i = 0; i < n; i++)
+		/* These have their own rendez-vous with the receiver */
+		if (reqs[i]->sync)
+			return;
+
+	starpu_mpi_comm_rank(comm, &me);
+	myhost = coop_tree_hosts[me];
+
+	/* The requests are sorted by priority, so the first request to each
+	 * host is the one with the highest priority, and gets to forward the
+	 * data to the others */
+	for (i = 0; i < n; i++)
+	{
+		int host = coop_tree_hosts[reqs[i]->node_tag.node.rank];
+		struct _starpu_mpi_req *leader = NULL;
+
+		if (host == myhost)
+			/* Already in our shared memory */
+			continue;
+
+		for (j = 0; j < i; j++)
+			if (!reqs[j]->backend->forwarded && coop_tree_hosts[reqs[j]->node_tag.node.rank] == host)
+			{
+				leader = reqs[j];
+				break;
+			}
+		if (!leader)
+			continue;
+
+		if (!leader->backend->forwards)
+			_STARPU_MPI_MALLOC(leader->backend->forwards, (n - i) * sizeof(*leader->backend->forwards));
+		leader->backend->forwards[leader->backend->nb_forwards].rank = reqs[i]->node_tag.node.rank;
+		leader->backend->forwards[leader->backend->nb_forwards].data_tag = reqs[i]->node_tag.data_tag;
+		leader->backend->nb_forwards++;
+		reqs[i]->backend->forwarded = 1;
+	}
+
+	/* Record which requests are waiting for each forwarding node */
+	for (i = 0; i < n; i++)
+	{
+		struct _starpu_mpi_req *leader = reqs[i];
+		struct _starpu_mpi_coop_tree_ack *ack, *old;
+		int host;
+
+		if (!leader->backend->nb_forwards)
+			continue;
+
+		_STARPU_MPI_CALLOC(ack, 1, sizeof(*ack));
+		ack->node_tag = leader->node_tag;
+		_STARPU_MPI_MALLOC(ack->reqs, leader->backend->nb_forwards * sizeof(*ack->reqs));
+		host = coop_tree_hosts[leader->node_tag.node.rank];
+		for (j = i + 1; j < n; j++)
+			if (reqs[j]->backend->forwarded && coop_tree_hosts[reqs[j]->node_tag.node.rank] == host)
+				ack->reqs[ack->n++] = reqs[j];
+		STARPU_ASSERT(ack->n == (unsigned) leader->backend->nb_forwards);
+
+		_STARPU_MPI_DEBUG(0, "cooperative sends %p: node %d forwards to %d nodes\n", coop_sends, leader->node_tag.node.rank, leader->backend->nb_forwards);
+
+		STARPU_PTHREAD_MUTEX_LOCK(&coop_tree_acks_mutex);
+		HASH_FIND(hh, coop_tree_acks, &ack->node_tag, sizeof(ack->node_tag), old);
+		if (old)
+		{
+			/* The data is sent again with the same tag before the
+			 * previous forward was acknowledged */
+			while (old->next)
+				old = old->next;
+			old->next = ack;
+		}
+		else
+			HASH_ADD(hh, coop_tree_acks, node_tag, sizeof(ack->node_tag), ack);
+		coop_tree_acks_count++;
+		STARPU_PTHREAD_MUTEX_UNLOCK(&coop_tree_acks_mutex);
+	}
+}
+
+struct _starpu_mpi_req **_starpu_mpi_coop_tree_acked(starpu_mpi_tag_t data_tag, int rank, MPI_Comm comm, unsigned *n)
+{
+	struct _starpu_mpi_node_tag node_tag;
+	struct _starpu_mpi_coop_tree_ack *ack;
+	struct _starpu_mpi_req **reqs;
+
+	memset(&node_tag, 0, sizeof(node_tag));
+	node_tag.node.comm = comm;
+	node_tag.node.rank = rank;
+	node_tag.data_tag = data_tag;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&coop_tree_acks_mutex);
+	HASH_FIND(hh, coop_tree_acks, &node_tag, sizeof(node_tag), ack);
+	STARPU_MPI_ASSERT_MSG(ack, "Node %d acknowledged forwarding data with tag %"PRIi64" which we did not ask for", rank, data_tag);
+	HASH_DEL(coop_tree_acks, ack);
+	if (ack->next)
+		HASH_ADD(hh, coop_tree_acks, node_tag, sizeof(ack->next->node_tag), ack->next);
+	coop_tree_acks_count--;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&coop_tree_acks_mutex);
+
+	reqs = ack->reqs;
+	*n = ack->n;
+	free(ack);
+	return reqs;
+}
+
+int _starpu_mpi_coop_tree_pending(void)
+{
+	return coop_tree_acks_count;
+}
+
+#endif /* STARPU_USE_MPI_MPI */
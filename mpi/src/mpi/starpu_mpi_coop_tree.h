@@ -0,0 +1,51 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __STARPU_MPI_COOP_TREE_H__
+#define __STARPU_MPI_COOP_TREE_H__
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <common/config.h>
+
+/** @file */
+
+#ifdef STARPU_USE_MPI_MPI
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Find out which ranks of comm share a host. This is collective over comm. */
+void _starpu_mpi_coop_tree_init(MPI_Comm comm);
+void _starpu_mpi_coop_tree_shutdown(void);
+
+/** Called when the node rank has acknowledged that it has forwarded the data
+ * sent with data_tag to the other nodes of its host. Returns the send
+ * requests which were waiting for it, to be freed by the caller. */
+struct _starpu_mpi_req **_starpu_mpi_coop_tree_acked(starpu_mpi_tag_t data_tag, int rank, MPI_Comm comm, unsigned *n);
+
+/** Number of forwards which have not been acknowledged yet */
+int _starpu_mpi_coop_tree_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STARPU_USE_MPI_MPI */
+#endif /* __STARPU_MPI_COOP_TREE_H__ */
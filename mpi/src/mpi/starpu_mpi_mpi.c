@@ -35,6 +35,7 @@
 #include <starpu_mpi_select_node.h>
 #include <mpi/starpu_mpi_tag.h>
 #include <mpi/starpu_mpi_comm.h>
+#include <mpi/starpu_mpi_coop_tree.h>
 #include <starpu_mpi_init.h>
 #include <common/thread.h>
 #include <datawizard/interfaces/data_interface.h>
@@ -61,9 +62,19 @@ static unsigned ndetached_send;
 /* Force allocation of early data */
 static int early_data_force_allocate;
 
+/* Maximum size of the messages aggregating small send requests, 0 to disable aggregation */
+static unsigned aggregate_size;
+
+/* Maximum time in us a small send request may be delayed to be aggregated with others */
+static unsigned aggregate_delay;
+
+/* Size in bytes of the chunks in which big data are transferred, 0 to transfer them in one message */
+static starpu_ssize_t chunk_size;
+
 static void _starpu_mpi_handle_ready_request(struct _starpu_mpi_req *req);
 static void _starpu_mpi_handle_request_termination(struct _starpu_mpi_req *req);
 static void _starpu_mpi_handle_detached_request(struct _starpu_mpi_req *req);
+static void _starpu_mpi_test_detached_requests(void);
 static void _starpu_mpi_early_data_cb(void* arg);
 
 /* The list of ready requests */
@@ -96,6 +107,21 @@ static struct starpu_driver *mpi_driver = NULL;
 static int mpi_driver_call_freq = 0;
 static int mpi_driver_task_freq = 0;
 
+/* Whether an envelope receive is currently posted */
+static int envelope_request_submitted = 0;
+
+/* Let idle CPU workers make MPI communications progress, the progression
+ * thread then only polls every worker_progress_period us, see
+ * STARPU_MPI_WORKER_PROGRESS. This is also how often it polls for the
+ * release requests of STARPU_MPI_CACHE_AUTO */
+static int worker_progress = 0;
+static int worker_progress_running = 0;
+static int worker_progress_period;
+static int worker_progress_hook = -1;
+static int worker_progress_idle_hook = -1;
+/* Held by whoever is running _starpu_mpi_progress_step, taken before progress_mutex */
+static starpu_pthread_mutex_t progress_step_mutex;
+
 #ifdef STARPU_SIMGRID
 static int wait_counter;
 static starpu_pthread_cond_t wait_counter_cond;
@@ -148,14 +174,6 @@ void _starpu_mpi_submit_ready_request_inc(struct _starpu_mpi_req *req)
 	_starpu_mpi_submit_ready_request(req);
 }
 
-#if 0
-void _starpu_mpi_coop_sends_build_tree(struct _starpu_mpi_coop_sends *coop_sends)
-{
-	(void)coop_sends;
-	/* TODO: turn them into redirects & forwards */
-}
-#endif
-
 void _starpu_mpi_submit_coop_sends(struct _starpu_mpi_coop_sends *coop_sends, int submit_control, int submit_data)
 {
 	(void)submit_control;
@@ -164,6 +182,11 @@ void _starpu_mpi_submit_coop_sends(struct _starpu_mpi_coop_sends *coop_sends, in
 	/* Note: coop_sends might disappear very very soon after last request is submitted */
 	for (i = 0; i < n; i++)
 	{
+		if (coop_sends->reqs_array[i]->backend->forwarded)
+			/* Another node of the destination host will send it, see
+			 * _starpu_mpi_coop_sends_build_tree, the request will be
+			 * completed when that node acknowledges it */
+			continue;
 		if (coop_sends->reqs_array[i]->request_type == SEND_REQ && submit_data)
 		{
 			_STARPU_MPI_DEBUG(0, "cooperative sends %p sending to %d\n", coop_sends, coop_sends->reqs_array[i]->node_tag.node.rank);
@@ -267,6 +290,8 @@ void _starpu_mpi_submit_ready_request(void *arg)
 					STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
 					/* Case: we already received the send envelope, we can proceed with the receive */
 					req->sync = 1;
+					req->backend->chunk_size = sync_req->backend->chunk_size;
+					req->backend->data_source = sync_req->backend->data_source;
 					_starpu_mpi_datatype_allocate(req->data_handle, req);
 					if (req->registered_datatype == 1)
 					{
@@ -378,6 +403,113 @@ void _starpu_mpi_simgrid_wait_req(MPI_Request *request, MPI_Status *status, star
 }
 #endif
 
+/********************************************************/
+/*                                                      */
+/*  Chunk functionalities                               */
+/*                                                      */
+/********************************************************/
+
+/* Post one MPI request for a piece of the data of req */
+static int _starpu_mpi_post_piece(struct _starpu_mpi_req *req, void *ptr, int count, MPI_Datatype datatype, int tag, MPI_Request *request)
+{
+	if (req->request_type == RECV_REQ)
+		return MPI_Irecv(ptr, count, datatype, req->backend->data_source >= 0 ? req->backend->data_source : req->node_tag.node.rank, tag, req->node_tag.node.comm, request);
+	else if (req->sync)
+		return MPI_Issend(ptr, count, datatype, req->node_tag.node.rank, tag, req->node_tag.node.comm, request);
+	else
+		return MPI_Isend(ptr, count, datatype, req->node_tag.node.rank, tag, req->node_tag.node.comm, request);
+}
+
+/* Get how the data of req is cut in slices: registered datatypes are cut
+ * according to their layout, packed data in bytes */
+static void _starpu_mpi_get_slices(struct _starpu_mpi_req *req, MPI_Datatype *datatype, size_t *slice_size, size_t *stride, size_t *nslices)
+{
+	if (req->registered_datatype == 1)
+	{
+		int ret = _starpu_mpi_datatype_get_slices(req->data_handle, req->node, datatype, slice_size, stride, nslices);
+		STARPU_MPI_ASSERT_MSG(ret == 0, "The data with tag %"PRIi64" is transferred in chunks, but its interface can not be cut", req->node_tag.data_tag);
+	}
+	else
+	{
+		*datatype = MPI_BYTE;
+		*slice_size = 1;
+		*stride = 1;
+		*nslices = req->count;
+	}
+}
+
+/* Decide whether the data of the send request req is to be sent in chunks,
+ * according to STARPU_MPI_CHUNK_SIZE. Chunks are made of whole slices, so that
+ * the receiver can cut the data in the same way. */
+static void _starpu_mpi_set_chunk_size(struct _starpu_mpi_req *req)
+{
+	MPI_Datatype datatype;
+	size_t slice_size, stride, nslices;
+
+	req->backend->chunk_size = 0;
+	if (chunk_size && req->backend->envelope->size > chunk_size)
+	{
+		if (req->registered_datatype != 1)
+			req->backend->chunk_size = chunk_size;
+		else if (_starpu_mpi_datatype_get_slices(req->data_handle, req->node, &datatype, &slice_size, &stride, &nslices) == 0)
+		{
+			if (datatype != MPI_BYTE)
+				MPI_Type_free(&datatype);
+			if (nslices > 1)
+				req->backend->chunk_size = STARPU_MAX(chunk_size / slice_size, 1) * slice_size;
+		}
+	}
+	req->backend->envelope->chunk_size = req->backend->chunk_size;
+}
+
+/* Post the MPI requests transferring the data of req, in chunks of
+ * consecutive slices when req->backend->chunk_size is set. MPI keeps the
+ * messages with the same tag ordered, so the receiver just posts its chunks
+ * in the same order. */
+static int _starpu_mpi_post_data(struct _starpu_mpi_req *req, int tag)
+{
+	MPI_Datatype datatype;
+	size_t slice_size, stride, nslices, nslices_chunk, nchunks, chunk;
+	int ret = MPI_SUCCESS;
+
+	if (!req->backend->chunk_size)
+		return _starpu_mpi_post_piece(req, req->ptr, req->count, req->datatype, tag, &req->backend->data_request);
+
+	_starpu_mpi_get_slices(req, &datatype, &slice_size, &stride, &nslices);
+	STARPU_MPI_ASSERT_MSG(req->backend->chunk_size % slice_size == 0, "Chunks of %ld bytes can not be made of slices of %lu bytes", (long) req->backend->chunk_size, (unsigned long) slice_size);
+	nslices_chunk = req->backend->chunk_size / slice_size;
+	nchunks = (nslices + nslices_chunk - 1) / nslices_chunk;
+	_STARPU_MPI_DEBUG(20, "Transferring %lu slices of %lu bytes in %lu chunks\n", (unsigned long) nslices, (unsigned long) slice_size, (unsigned long) nchunks);
+
+	if (nchunks > 1)
+	{
+		req->backend->nb_chunk_requests = nchunks - 1;
+		_STARPU_MPI_MALLOC(req->backend->chunk_requests, req->backend->nb_chunk_requests * sizeof(MPI_Request));
+	}
+	for (chunk = 0; chunk < nchunks && ret == MPI_SUCCESS; chunk++)
+	{
+		size_t first = chunk * nslices_chunk;
+		MPI_Request *request = chunk == nchunks - 1 ? &req->backend->data_request : &req->backend->chunk_requests[chunk];
+		ret = _starpu_mpi_post_piece(req, (char *) req->ptr + first * stride, STARPU_MIN(nslices_chunk, nslices - first), datatype, tag, request);
+	}
+
+	/* MPI keeps the datatype alive until the pending requests complete */
+	if (datatype != MPI_BYTE)
+		MPI_Type_free(&datatype);
+	return ret;
+}
+
+/* Test for the completion of the chunks of req but the last one */
+static int _starpu_mpi_test_chunks(struct _starpu_mpi_req *req, int *flag)
+{
+	if (!req->backend->nb_chunk_requests)
+	{
+		*flag = 1;
+		return MPI_SUCCESS;
+	}
+	return MPI_Testall(req->backend->nb_chunk_requests, req->backend->chunk_requests, flag, MPI_STATUSES_IGNORE);
+}
+
 /********************************************************/
 /*                                                      */
 /*  Send functionalities                                */
@@ -397,13 +529,13 @@ static void _starpu_mpi_isend_data_func(struct _starpu_mpi_req *req)
 	if (req->sync == 0)
 	{
 		_STARPU_MPI_COMM_TO_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
-		req->ret = MPI_Isend(req->ptr, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.node.comm, &req->backend->data_request);
+		req->ret = _starpu_mpi_post_data(req, _STARPU_MPI_TAG_DATA);
 		STARPU_MPI_ASSERT_MSG(req->ret == MPI_SUCCESS, "MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(req->ret));
 	}
 	else
 	{
 		_STARPU_MPI_COMM_TO_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_SYNC_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
-		req->ret = MPI_Issend(req->ptr, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_SYNC_DATA, req->node_tag.node.comm, &req->backend->data_request);
+		req->ret = _starpu_mpi_post_data(req, _STARPU_MPI_TAG_SYNC_DATA);
 		STARPU_MPI_ASSERT_MSG(req->ret == MPI_SUCCESS, "MPI_Issend returning %s", _starpu_mpi_get_mpi_error_code(req->ret));
 	}
 
@@ -435,6 +567,15 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 	req->backend->envelope->data_tag = req->node_tag.data_tag;
 	req->backend->envelope->sync = req->sync;
 
+	if (req->backend->nb_forwards)
+	{
+		/* Tell the receiver which nodes of its host it has to forward the data to */
+		int ret;
+		req->backend->envelope->nb_forwards = req->backend->nb_forwards;
+		ret = MPI_Isend(req->backend->forwards, req->backend->nb_forwards * sizeof(struct _starpu_mpi_forward), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_FORWARD, req->node_tag.node.comm, &req->backend->forwards_req);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending forwards, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	}
+
 	if (req->registered_datatype == 1)
 	{
 		int size, ret;
@@ -443,6 +584,7 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 
 		MPI_Type_size(req->datatype, &size);
 		req->backend->envelope->size = (starpu_ssize_t)req->count * size;
+		_starpu_mpi_set_chunk_size(req);
 		_STARPU_MPI_DEBUG(20, "Post MPI isend count (%ld) datatype_size %ld request to %d\n",req->count,starpu_data_get_size(req->data_handle), req->node_tag.node.rank);
 		_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
 		ret = MPI_Isend(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
@@ -460,6 +602,7 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 			// We already know the size of the data, let's send it to overlap with the packing of the data
 			_STARPU_MPI_DEBUG(20, "Sending size %ld (%ld %s) to node %d (first call to pack)\n", req->backend->envelope->size, sizeof(req->count), "MPI_BYTE", req->node_tag.node.rank);
 			req->count = req->backend->envelope->size;
+			_starpu_mpi_set_chunk_size(req);
 			_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
 			ret = MPI_Isend(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
 			STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending size, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
@@ -471,6 +614,7 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 		{
 			// We know the size now, let's send it
 			_STARPU_MPI_DEBUG(20, "Sending size %ld (%ld %s) to node %d (second call to pack)\n", req->backend->envelope->size, sizeof(req->count), "MPI_BYTE", req->node_tag.node.rank);
+			_starpu_mpi_set_chunk_size(req);
 			_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
 			ret = MPI_Isend(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
 			STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending size, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
@@ -495,6 +639,525 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 	}
 }
 
+/* Complete a request whose data does not have to be transferred by MPI
+ * requests of its own */
+static void _starpu_mpi_complete_request(struct _starpu_mpi_req *req)
+{
+	req->backend->size_req = MPI_REQUEST_NULL;
+	req->backend->data_request = MPI_REQUEST_NULL;
+	if (req->detached)
+	{
+		_starpu_mpi_handle_request_termination(req);
+		_starpu_mpi_request_destroy(req);
+	}
+	else
+	{
+		/* starpu_mpi_wait will terminate it */
+		STARPU_PTHREAD_MUTEX_LOCK(&req->backend->req_mutex);
+		req->submitted = 1;
+		STARPU_PTHREAD_COND_BROADCAST(&req->backend->req_cond);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&req->backend->req_mutex);
+	}
+}
+
+/********************************************************/
+/*                                                      */
+/*  Aggregation functionalities                         */
+/*                                                      */
+/********************************************************/
+
+/*
+ * Sending a data normally takes two messages: the envelope and the data
+ * itself. When STARPU_MPI_AGGREGATE_SIZE is set, the small send requests
+ * which get ready for the same destination are rather packed in a buffer,
+ * each of them preceded by its own envelope, and the buffer is sent as one
+ * data message announced by one _STARPU_MPI_ENVELOPE_AGGREGATE envelope. The
+ * receiver unpacks each of them into the matching posted receive, or into an
+ * early data.
+ *
+ * Since the data are copied, the send requests are completed as soon as they
+ * are packed. A buffer is flushed when it is full, before sending anything
+ * else to the same destination so that the envelopes stay ordered, and
+ * after STARPU_MPI_AGGREGATE_DELAY.
+ *
+ * All of this is only used by the progression thread.
+ */
+
+struct _starpu_mpi_aggregate
+{
+	UT_hash_handle hh;
+	struct _starpu_mpi_node node;
+	char *buffer;
+	size_t size;
+	int nreqs;
+	/* Date of the first request packed in the buffer */
+	double date;
+};
+
+/* A flushed buffer being sent */
+LIST_TYPE(_starpu_mpi_aggregate_send,
+	struct _starpu_mpi_envelope envelope;
+	char *buffer;
+	MPI_Request requests[2];
+);
+
+static struct _starpu_mpi_aggregate *aggregates;
+/* Number of aggregates which contain requests */
+static unsigned aggregate_npending;
+static struct _starpu_mpi_aggregate_send_list aggregate_sends;
+
+static void _starpu_mpi_aggregate_init(void)
+{
+	aggregate_size = starpu_getenv_number_default("STARPU_MPI_AGGREGATE_SIZE", 0);
+	aggregate_delay = starpu_getenv_number_default("STARPU_MPI_AGGREGATE_DELAY", 0);
+#ifdef STARPU_SIMGRID
+	/* The simulated requests are not tested the same way */
+	aggregate_size = 0;
+#endif
+	aggregates = NULL;
+	aggregate_npending = 0;
+	_starpu_mpi_aggregate_send_list_init(&aggregate_sends);
+}
+
+static void _starpu_mpi_aggregate_shutdown(void)
+{
+	struct _starpu_mpi_aggregate *aggregate, *tmp;
+
+	STARPU_MPI_ASSERT_MSG(aggregate_npending == 0, "Some aggregated requests were not sent");
+	STARPU_MPI_ASSERT_MSG(_starpu_mpi_aggregate_send_list_empty(&aggregate_sends), "Some aggregated messages were not completed");
+	HASH_ITER(hh, aggregates, aggregate, tmp)
+	{
+		HASH_DEL(aggregates, aggregate);
+		free(aggregate->buffer);
+		free(aggregate);
+	}
+}
+
+static int _starpu_mpi_aggregate_busy(void)
+{
+	return aggregate_npending || !_starpu_mpi_aggregate_send_list_empty(&aggregate_sends);
+}
+
+static void _starpu_mpi_aggregate_flush_one(struct _starpu_mpi_aggregate *aggregate)
+{
+	struct _starpu_mpi_aggregate_send *send;
+	int ret;
+
+	if (!aggregate->nreqs)
+		return;
+
+	_STARPU_MPI_DEBUG(3, "sending %d aggregated requests in %lu bytes to %d\n", aggregate->nreqs, (unsigned long) aggregate->size, aggregate->node.rank);
+
+	send = _starpu_mpi_aggregate_send_new();
+	memset(&send->envelope, 0, sizeof(send->envelope));
+	send->envelope.mode = _STARPU_MPI_ENVELOPE_AGGREGATE;
+	send->envelope.size = aggregate->size;
+	/* The tag is meaningless here, rather tell the number of requests */
+	send->envelope.data_tag = aggregate->nreqs;
+	send->buffer = aggregate->buffer;
+
+	_STARPU_MPI_COMM_TO_DEBUG(&send->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, aggregate->node.rank, _STARPU_MPI_TAG_ENVELOPE, send->envelope.data_tag, aggregate->node.comm);
+	ret = MPI_Isend(&send->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, aggregate->node.rank, _STARPU_MPI_TAG_ENVELOPE, aggregate->node.comm, &send->requests[0]);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending aggregated envelope, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	ret = MPI_Isend(send->buffer, aggregate->size, MPI_BYTE, aggregate->node.rank, _STARPU_MPI_TAG_DATA, aggregate->node.comm, &send->requests[1]);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending aggregated data, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	_starpu_mpi_aggregate_send_list_push_back(&aggregate_sends, send);
+
+	_starpu_mpi_nb_aggregated_inc(aggregate->nreqs);
+
+	_STARPU_MPI_MALLOC(aggregate->buffer, aggregate_size);
+	aggregate->size = 0;
+	aggregate->nreqs = 0;
+	aggregate_npending--;
+}
+
+/* Send the requests aggregated for the given destination, if any */
+static void _starpu_mpi_aggregate_flush_node(struct _starpu_mpi_node *node)
+{
+	struct _starpu_mpi_aggregate *aggregate;
+
+	if (!aggregate_npending)
+		return;
+
+	HASH_FIND(hh, aggregates, node, sizeof(struct _starpu_mpi_node), aggregate);
+	if (aggregate)
+		_starpu_mpi_aggregate_flush_one(aggregate);
+}
+
+/* Send the requests which have waited long enough */
+static void _starpu_mpi_aggregate_flush(void)
+{
+	struct _starpu_mpi_aggregate *aggregate, *tmp;
+	double now;
+
+	if (!aggregate_npending)
+		return;
+
+	now = starpu_timing_now();
+	HASH_ITER(hh, aggregates, aggregate, tmp)
+	{
+		if (aggregate->nreqs && now - aggregate->date >= aggregate_delay)
+			_starpu_mpi_aggregate_flush_one(aggregate);
+	}
+}
+
+/* Free the buffers which were sent */
+static void _starpu_mpi_aggregate_test_sends(void)
+{
+	struct _starpu_mpi_aggregate_send *send, *next;
+
+	for (send = _starpu_mpi_aggregate_send_list_begin(&aggregate_sends);
+	     send != _starpu_mpi_aggregate_send_list_end(&aggregate_sends);
+	     send = next)
+	{
+		int flag, ret;
+
+		next = _starpu_mpi_aggregate_send_list_next(send);
+		ret = MPI_Testall(2, send->requests, &flag, MPI_STATUSES_IGNORE);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Testall returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		if (flag)
+		{
+			_starpu_mpi_aggregate_send_list_erase(&aggregate_sends, send);
+			free(send->buffer);
+			_starpu_mpi_aggregate_send_delete(send);
+		}
+	}
+}
+
+/* Pack the ready send request in the buffer of its destination if it is small
+ * enough, and complete it. Return 0 if it has to be sent on its own. */
+static int _starpu_mpi_aggregate_push(struct _starpu_mpi_req *req)
+{
+	struct _starpu_mpi_aggregate *aggregate;
+	struct _starpu_mpi_envelope envelope;
+	struct starpu_data_interface_ops *ops;
+	starpu_ssize_t size;
+
+	if (!aggregate_size || req->request_type != SEND_REQ || req->sync || req->backend->nb_forwards || _starpu_mpi_has_cuda)
+		return 0;
+
+	/* The data of the predefined interfaces are packed and unpacked the
+	 * same way on both sides, whatever the MPI datatypes */
+	if (starpu_data_get_interface_id(req->data_handle) >= STARPU_MAX_INTERFACE_ID || starpu_node_get_kind(req->node) != STARPU_CPU_RAM)
+		return 0;
+	ops = starpu_data_get_interface_ops(req->data_handle);
+	if (!ops->pack_data || (!ops->peek_data && !ops->unpack_data))
+		return 0;
+
+	/* Not all interfaces support querying the packed size, use the data
+	 * size as a hint and check the actual packed size afterwards */
+	size = starpu_data_get_size(req->data_handle);
+	if (size <= 0 || sizeof(envelope) + size > aggregate_size)
+		return 0;
+
+	starpu_data_pack_node(req->data_handle, req->node, &req->ptr, &req->count);
+	size = req->count;
+	if (size <= 0 || sizeof(envelope) + size > aggregate_size)
+	{
+		/* Let the usual path pack it again */
+		starpu_free_on_node_flags(req->node, (uintptr_t) req->ptr, req->count, 0);
+		req->ptr = NULL;
+		req->count = 0;
+		return 0;
+	}
+
+	HASH_FIND(hh, aggregates, &req->node_tag.node, sizeof(struct _starpu_mpi_node), aggregate);
+	if (!aggregate)
+	{
+		_STARPU_MPI_CALLOC(aggregate, 1, sizeof(*aggregate));
+		aggregate->node = req->node_tag.node;
+		_STARPU_MPI_MALLOC(aggregate->buffer, aggregate_size);
+		HASH_ADD(hh, aggregates, node, sizeof(aggregate->node), aggregate);
+	}
+	else if (aggregate->size + sizeof(envelope) + size > aggregate_size)
+		/* No room left */
+		_starpu_mpi_aggregate_flush_one(aggregate);
+
+	if (!aggregate->nreqs)
+	{
+		aggregate->date = starpu_timing_now();
+		aggregate_npending++;
+	}
+
+	_STARPU_MPI_DEBUG(3, "aggregating request %p tag %"PRIi64" dst %d size %ld\n", req, req->node_tag.data_tag, req->node_tag.node.rank, (long) size);
+	_STARPU_MPI_TRACE_ISEND_SUBMIT_BEGIN(req->node_tag.node.rank, req->node_tag.data_tag, 0);
+
+	memset(&envelope, 0, sizeof(envelope));
+	envelope.mode = _STARPU_MPI_ENVELOPE_DATA;
+	envelope.size = size;
+	envelope.data_tag = req->node_tag.data_tag;
+	memcpy(aggregate->buffer + aggregate->size, &envelope, sizeof(envelope));
+	aggregate->size += sizeof(envelope);
+
+	memcpy(aggregate->buffer + aggregate->size, req->ptr, size);
+	aggregate->size += size;
+	aggregate->nreqs++;
+	_starpu_mpi_comm_amounts_inc(req->node_tag.node.comm, req->node, req->node_tag.node.rank, MPI_BYTE, size);
+
+	_STARPU_MPI_TRACE_ISEND_SUBMIT_END(_STARPU_MPI_FUT_POINT_TO_POINT_SEND, req, 0);
+
+	/* The data is not needed any more, the request can be completed, and
+	 * the packed copy freed as usual by _starpu_mpi_handle_request_termination */
+	req->registered_datatype = 0;
+	_starpu_mpi_complete_request(req);
+
+	if (aggregate->size + sizeof(envelope) >= aggregate_size)
+		/* Nothing more can fit */
+		_starpu_mpi_aggregate_flush_one(aggregate);
+
+	return 1;
+}
+
+/* Give the data of an aggregated request to the matching application request,
+ * or keep it as early data */
+static void _starpu_mpi_receive_aggregated_data(struct _starpu_mpi_envelope *envelope, void *data, int source, MPI_Comm comm)
+{
+	struct _starpu_mpi_req *early_request;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&early_data_mutex);
+	STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+	early_request = _starpu_mpi_early_request_dequeue(envelope->data_tag, source, comm);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+
+	if (early_request)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
+		_STARPU_MPI_DEBUG(3, "aggregated data with tag %"PRIi64" from %d goes to request %p\n", envelope->data_tag, source, early_request);
+
+		/* Just like a packed data received in a separate buffer, which
+		 * _starpu_mpi_handle_request_termination will unpack */
+		_STARPU_MPI_TRACE_IRECV_SUBMIT_BEGIN(source, envelope->data_tag);
+		early_request->registered_datatype = 0;
+		early_request->count = envelope->size;
+		early_request->ptr = (void *)starpu_malloc_on_node_flags(early_request->node, early_request->count, 0);
+		starpu_memory_allocate(early_request->node, early_request->count, STARPU_MEMORY_OVERFLOW);
+		memcpy(early_request->ptr, data, early_request->count);
+		early_request->backend->data_request = MPI_REQUEST_NULL;
+		_STARPU_MPI_TRACE_IRECV_SUBMIT_END(source, envelope->data_tag);
+
+		if (early_request->detached)
+		{
+			_starpu_mpi_handle_request_termination(early_request);
+			_starpu_mpi_request_destroy(early_request);
+		}
+		else
+		{
+			/* starpu_mpi_wait will terminate it */
+			STARPU_PTHREAD_MUTEX_LOCK(&early_request->backend->req_mutex);
+			early_request->submitted = 1;
+			STARPU_PTHREAD_COND_BROADCAST(&early_request->backend->req_cond);
+			STARPU_PTHREAD_MUTEX_UNLOCK(&early_request->backend->req_mutex);
+		}
+	}
+	else
+	{
+		struct _starpu_mpi_early_data_handle *early_data_handle = _starpu_mpi_early_data_create(envelope, source, comm);
+		_STARPU_MPI_DEBUG(3, "aggregated data with tag %"PRIi64" from %d is early\n", envelope->data_tag, source);
+
+		early_data_handle->buffer = (void *)starpu_malloc_on_node_flags(STARPU_MAIN_RAM, envelope->size, 0);
+		memcpy(early_data_handle->buffer, data, envelope->size);
+		early_data_handle->size = envelope->size;
+		early_data_handle->buffer_node = STARPU_MAIN_RAM;
+		starpu_variable_data_register(&early_data_handle->handle, STARPU_MAIN_RAM, (uintptr_t) early_data_handle->buffer, envelope->size);
+
+		/* The data is already there, so the internal request is
+		 * already complete, and the application request may destroy
+		 * it (to_destroy is set by _starpu_mpi_request_init) */
+		_starpu_mpi_request_init(&early_data_handle->req);
+		early_data_handle->req->request_type = RECV_REQ;
+		early_data_handle->req->detached = 1;
+		early_data_handle->req->backend->is_internal_req = 1;
+		early_data_handle->req->backend->data_request = MPI_REQUEST_NULL;
+
+		_starpu_mpi_early_data_add(early_data_handle);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
+	}
+}
+
+static void _starpu_mpi_receive_aggregate(struct _starpu_mpi_envelope *envelope, MPI_Status status, MPI_Comm comm)
+{
+	size_t size = envelope->size, offset = 0;
+	int nreqs = envelope->data_tag, n = 0;
+	char *buffer;
+	int ret;
+
+	_STARPU_MPI_DEBUG(3, "receiving %d aggregated requests in %lu bytes from %d\n", nreqs, (unsigned long) size, status.MPI_SOURCE);
+
+	/* The sender has posted it along the envelope, and the receptions for
+	 * the previous envelopes have all been posted already, so it is the
+	 * next data message from this source */
+	_STARPU_MPI_MALLOC(buffer, size);
+	_STARPU_MPI_COMM_FROM_DEBUG(buffer, size, MPI_BYTE, status.MPI_SOURCE, _STARPU_MPI_TAG_DATA, envelope->data_tag, comm);
+	ret = MPI_Recv(buffer, size, MPI_BYTE, status.MPI_SOURCE, _STARPU_MPI_TAG_DATA, comm, MPI_STATUS_IGNORE);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when receiving aggregated data, MPI_Recv returning %s", _starpu_mpi_get_mpi_error_code(ret));
+
+	while (offset < size)
+	{
+		struct _starpu_mpi_envelope data_envelope;
+
+		memcpy(&data_envelope, buffer + offset, sizeof(data_envelope));
+		offset += sizeof(data_envelope);
+		STARPU_MPI_ASSERT_MSG(data_envelope.mode == _STARPU_MPI_ENVELOPE_DATA && offset + data_envelope.size <= size, "Invalid aggregated message");
+		_starpu_mpi_receive_aggregated_data(&data_envelope, buffer + offset, status.MPI_SOURCE, comm);
+		offset += data_envelope.size;
+		n++;
+	}
+	STARPU_MPI_ASSERT_MSG(n == nreqs, "Aggregated message contains %d requests instead of %d", n, nreqs);
+
+	free(buffer);
+}
+
+/********************************************************/
+/*                                                      */
+/*  Forwarding functionalities                          */
+/*                                                      */
+/********************************************************/
+
+/*
+ * With cooperative sends, the sender may send the data only once to a node of
+ * each host, which forwards it to the other nodes of its host, see
+ * _starpu_mpi_coop_sends_build_tree. The forwarded envelopes carry the rank
+ * of the original sender, so that they are matched against the receive
+ * requests posted for it, but the data is received from the forwarding node.
+ *
+ * The forwarding node acknowledges the forward to the sender once all the
+ * envelopes are matched, only then the sender completes the forwarded
+ * requests, so that it can not send newer data with the same tag directly
+ * before the receivers know about the forwarded one.
+ */
+
+/* Number of forwards which were not acknowledged yet, only used by the
+ * progression thread */
+static unsigned nforwards;
+/* The barriers which wait for the forwards to be acknowledged, only used by
+ * the progression thread */
+static struct _starpu_mpi_req_list pending_barriers;
+/* The barriers submitted to MPI, only used by the progression thread */
+static struct _starpu_mpi_req_list running_barriers;
+
+/* The release requests of the cache to be sent, protected by progress_mutex */
+LIST_TYPE(_starpu_mpi_cache_release_msg,
+	struct _starpu_mpi_envelope envelope;
+	int rank;
+	MPI_Comm comm;
+);
+static struct _starpu_mpi_cache_release_msg_list cache_release_msgs;
+
+/* Tell the original sender that the data was forwarded */
+static void _starpu_mpi_forward_ack(void *arg)
+{
+	struct _starpu_mpi_req *fwd = arg;
+	struct _starpu_mpi_envelope envelope;
+	int ret;
+
+	memset(&envelope, 0, sizeof(envelope));
+	envelope.mode = _STARPU_MPI_ENVELOPE_FORWARD_ACK;
+	envelope.data_tag = fwd->node_tag.data_tag;
+	_STARPU_MPI_COMM_TO_DEBUG(&envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, fwd->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, envelope.data_tag, fwd->node_tag.node.comm);
+	ret = MPI_Send(&envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, fwd->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, fwd->node_tag.node.comm);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when acknowledging forward, MPI_Send returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	_STARPU_MPI_INC_POSTED_REQUESTS(-1);
+	nforwards--;
+}
+
+/* Send a copy of the data just received by req to the nodes its sender told */
+static void _starpu_mpi_forward_data(struct _starpu_mpi_req *req)
+{
+	struct _starpu_mpi_req *fwd;
+	struct _starpu_mpi_envelope *envelopes;
+	MPI_Comm comm = req->node_tag.node.comm;
+	MPI_Datatype datatype;
+	starpu_ssize_t size;
+	int nb = req->backend->nb_forwards, i, ret;
+
+	_starpu_mpi_request_init(&fwd);
+	fwd->request_type = SEND_REQ;
+	/* The acknowledgement goes to the original sender */
+	fwd->node_tag = req->node_tag;
+	fwd->node = STARPU_MAIN_RAM;
+	fwd->registered_datatype = 0;
+	fwd->detached = 1;
+	fwd->callback = _starpu_mpi_forward_ack;
+	fwd->callback_arg = fwd;
+	fwd->backend->forwarded = 1;
+	/* starpu_mpi_wait_for_all has to wait for the acknowledgement, the
+	 * original sender is waiting for it */
+	_STARPU_MPI_INC_POSTED_REQUESTS(1);
+	nforwards++;
+
+	/* Copy the data, so that req can be completed without waiting for
+	 * the forwards */
+	if (req->registered_datatype == 1)
+	{
+		int type_size, packed_size, position = 0;
+		MPI_Type_size(req->datatype, &type_size);
+		size = (starpu_ssize_t) req->count * type_size;
+		MPI_Pack_size(req->count, req->datatype, comm, &packed_size);
+		_STARPU_MPI_MALLOC(fwd->ptr, packed_size);
+		ret = MPI_Pack(req->ptr, req->count, req->datatype, fwd->ptr, packed_size, &position, comm);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Pack returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		STARPU_MPI_ASSERT_MSG(position == size, "Packing %ld bytes of data with tag %"PRIi64" takes %d bytes, it can not be forwarded", (long) size, req->node_tag.data_tag, position);
+		/* The receivers may use different datatypes with the same signature */
+		datatype = MPI_PACKED;
+	}
+	else
+	{
+		size = req->count;
+		_STARPU_MPI_MALLOC(fwd->ptr, size);
+		memcpy(fwd->ptr, req->ptr, size);
+		datatype = MPI_BYTE;
+	}
+	fwd->count = size;
+
+	/* An envelope and the data for each node, the last data goes to data_request */
+	_STARPU_MPI_CALLOC(envelopes, nb, sizeof(struct _starpu_mpi_envelope));
+	fwd->backend->envelope = envelopes;
+	fwd->backend->nb_chunk_requests = 2*nb - 1;
+	_STARPU_MPI_MALLOC(fwd->backend->chunk_requests, fwd->backend->nb_chunk_requests * sizeof(MPI_Request));
+
+	for (i = 0; i < nb; i++)
+	{
+		struct _starpu_mpi_forward *forward = &req->backend->forwards[i];
+		MPI_Request *data_request = i == nb - 1 ? &fwd->backend->data_request : &fwd->backend->chunk_requests[2*i+1];
+
+		_STARPU_MPI_DEBUG(3, "Forwarding data with tag %"PRIi64" from %d to %d with tag %"PRIi64"\n", req->node_tag.data_tag, req->node_tag.node.rank, forward->rank, forward->data_tag);
+		envelopes[i].mode = _STARPU_MPI_ENVELOPE_DATA;
+		envelopes[i].size = size;
+		envelopes[i].data_tag = forward->data_tag;
+		envelopes[i].forwarded = 1;
+		envelopes[i].origin = req->node_tag.node.rank;
+
+		/* The synchronous send completes only once the envelope is matched */
+		_STARPU_MPI_COMM_TO_DEBUG(&envelopes[i], sizeof(struct _starpu_mpi_envelope), MPI_BYTE, forward->rank, _STARPU_MPI_TAG_ENVELOPE, forward->data_tag, comm);
+		ret = MPI_Issend(&envelopes[i], sizeof(struct _starpu_mpi_envelope), MPI_BYTE, forward->rank, _STARPU_MPI_TAG_ENVELOPE, comm, &fwd->backend->chunk_requests[2*i]);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when forwarding envelope, MPI_Issend returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		_STARPU_MPI_COMM_TO_DEBUG(fwd->ptr, size, datatype, forward->rank, _STARPU_MPI_TAG_DATA, forward->data_tag, comm);
+		ret = MPI_Isend(fwd->ptr, size, datatype, forward->rank, _STARPU_MPI_TAG_DATA, comm, data_request);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when forwarding data, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		_starpu_mpi_comm_amounts_inc(comm, STARPU_MAIN_RAM, forward->rank, MPI_BYTE, size);
+	}
+
+	_starpu_mpi_handle_detached_request(fwd);
+}
+
+/* The node source has forwarded the data we sent it with data_tag, complete
+ * the requests it did for us */
+static void _starpu_mpi_receive_forward_ack(struct _starpu_mpi_envelope *envelope, int source, MPI_Comm comm)
+{
+	struct _starpu_mpi_req **reqs;
+	unsigned n, i;
+
+	reqs = _starpu_mpi_coop_tree_acked(envelope->data_tag, source, comm, &n);
+	for (i = 0; i < n; i++)
+	{
+		_STARPU_MPI_DEBUG(3, "Data with tag %"PRIi64" was forwarded by %d to %d\n", reqs[i]->node_tag.data_tag, source, reqs[i]->node_tag.node.rank);
+		_starpu_mpi_complete_request(reqs[i]);
+		/* They were never submitted */
+		_STARPU_MPI_INC_POSTED_REQUESTS(-1);
+	}
+	free(reqs);
+}
+
 /********************************************************/
 /*							*/
 /*  receive functionalities				*/
@@ -526,12 +1189,12 @@ void _starpu_mpi_irecv_size_func(struct _starpu_mpi_req *req)
 	if (req->sync)
 	{
 		_STARPU_MPI_COMM_FROM_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_SYNC_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
-		req->ret = MPI_Irecv(req->ptr, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_SYNC_DATA, req->node_tag.node.comm, &req->backend->data_request);
+		req->ret = _starpu_mpi_post_data(req, _STARPU_MPI_TAG_SYNC_DATA);
 	}
 	else
 	{
 		_STARPU_MPI_COMM_FROM_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
-		req->ret = MPI_Irecv(req->ptr, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.node.comm, &req->backend->data_request);
+		req->ret = _starpu_mpi_post_data(req, _STARPU_MPI_TAG_DATA);
 	}
 #ifdef STARPU_SIMGRID
 	_starpu_mpi_simgrid_wait_req(&req->backend->data_request, &req->status_store, &req->queue, &req->done);
@@ -565,6 +1228,11 @@ void _starpu_mpi_wait_func(struct _starpu_mpi_req *waiting_req)
 	struct _starpu_mpi_req *req = waiting_req->backend->other_request;
 
 	_STARPU_MPI_TRACE_UWAIT_BEGIN(req->node_tag.node.rank, req->node_tag.data_tag);
+	if (req->backend->nb_chunk_requests)
+	{
+		req->ret = MPI_Waitall(req->backend->nb_chunk_requests, req->backend->chunk_requests, MPI_STATUSES_IGNORE);
+		STARPU_MPI_ASSERT_MSG(req->ret == MPI_SUCCESS, "MPI_Waitall returning %s", _starpu_mpi_get_mpi_error_code(req->ret));
+	}
 	if (req->backend->data_request != MPI_REQUEST_NULL)
 	{
 		req->ret = MPI_Wait(&req->backend->data_request, waiting_req->status);
@@ -667,7 +1335,9 @@ void _starpu_mpi_test_func(struct _starpu_mpi_req *testing_req)
 
 	_STARPU_MPI_TRACE_UTESTING_BEGIN(req->node_tag.node.rank, req->node_tag.data_tag);
 
-	req->ret = MPI_Test(&req->backend->data_request, testing_req->flag, testing_req->status);
+	req->ret = _starpu_mpi_test_chunks(req, testing_req->flag);
+	if (req->ret == MPI_SUCCESS && *testing_req->flag)
+		req->ret = MPI_Test(&req->backend->data_request, testing_req->flag, testing_req->status);
 
 	STARPU_MPI_ASSERT_MSG(req->ret == MPI_SUCCESS, "MPI_Test returning %s", _starpu_mpi_get_mpi_error_code(req->ret));
 
@@ -781,13 +1451,106 @@ static void _starpu_mpi_barrier_func(struct _starpu_mpi_req *barrier_req)
 	 * That'll solve locking issue when intermixing starpu_mpi_barrier with
 	 * other communications.
 	 */
+
+	/* The senders of the data we forward may need our acknowledgement
+	 * before they can enter the barrier, let the progression go on until
+	 * they are all acknowledged, see _starpu_mpi_progress_step */
+	if (nforwards)
+	{
+		_starpu_mpi_req_list_push_back(&pending_barriers, barrier_req);
+		_STARPU_MPI_LOG_OUT();
+		return;
+	}
+
+#if MPI_VERSION >= 3 && !defined(STARPU_SIMGRID)
+	/* Other nodes may need our answers before entering the barrier, see
+	 * STARPU_MPI_CACHE_AUTO, keep making progress until it is over, see
+	 * _starpu_mpi_test_barriers */
+	barrier_req->ret = MPI_Ibarrier(barrier_req->node_tag.node.comm, &barrier_req->backend->data_request);
+	STARPU_MPI_ASSERT_MSG(barrier_req->ret == MPI_SUCCESS, "MPI_Ibarrier returning %s", _starpu_mpi_get_mpi_error_code(barrier_req->ret));
+	_starpu_mpi_req_list_push_back(&running_barriers, barrier_req);
+#else
 	barrier_req->ret = MPI_Barrier(barrier_req->node_tag.node.comm);
 	STARPU_MPI_ASSERT_MSG(barrier_req->ret == MPI_SUCCESS, "MPI_Barrier returning %s", _starpu_mpi_get_mpi_error_code(barrier_req->ret));
 
 	_starpu_mpi_handle_request_termination(barrier_req);
+#endif
 	_STARPU_MPI_LOG_OUT();
 }
 
+static void _starpu_mpi_test_barriers(void)
+{
+	struct _starpu_mpi_req *req, *next_req;
+	int flag, ret;
+
+	for (req = _starpu_mpi_req_list_begin(&running_barriers);
+	     req != _starpu_mpi_req_list_end(&running_barriers);
+	     req = next_req)
+	{
+		next_req = _starpu_mpi_req_list_next(req);
+		ret = MPI_Test(&req->backend->data_request, &flag, MPI_STATUS_IGNORE);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Test returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		if (flag)
+		{
+			_starpu_mpi_req_list_erase(&running_barriers, req);
+			_starpu_mpi_handle_request_termination(req);
+		}
+	}
+}
+
+#if MPI_VERSION >= 3 && !defined(STARPU_SIMGRID)
+/* Queue a release request of the cache, the progression thread sends it, see
+ * _starpu_mpi_send_cache_releases */
+void _starpu_mpi_cache_release(int rank, MPI_Comm comm, starpu_mpi_tag_t data_tag, unsigned long accesses)
+{
+	struct _starpu_mpi_cache_release_msg *msg = _starpu_mpi_cache_release_msg_new();
+
+	memset(&msg->envelope, 0, sizeof(msg->envelope));
+	msg->envelope.mode = _STARPU_MPI_ENVELOPE_CACHE_RELEASE;
+	msg->envelope.data_tag = data_tag;
+	msg->envelope.size = accesses;
+	msg->rank = rank;
+	msg->comm = comm;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+	_starpu_mpi_cache_release_msg_list_push_back(&cache_release_msgs, msg);
+	STARPU_PTHREAD_COND_SIGNAL(&progress_cond);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+}
+#endif
+
+/* Must be called with progress_mutex held */
+static void _starpu_mpi_send_cache_releases(void)
+{
+	while (!_starpu_mpi_cache_release_msg_list_empty(&cache_release_msgs))
+	{
+		struct _starpu_mpi_cache_release_msg *msg = _starpu_mpi_cache_release_msg_list_pop_front(&cache_release_msgs);
+		int ret;
+
+		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+		_STARPU_MPI_COMM_TO_DEBUG(&msg->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, msg->rank, _STARPU_MPI_TAG_ENVELOPE, msg->envelope.data_tag, msg->comm);
+		ret = MPI_Send(&msg->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, msg->rank, _STARPU_MPI_TAG_ENVELOPE, msg->comm);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when asking for a cache release, MPI_Send returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		_starpu_mpi_cache_release_msg_delete(msg);
+		STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+	}
+}
+
+/* Answer a release request of the cache */
+static void _starpu_mpi_receive_cache_release(struct _starpu_mpi_envelope *envelope, int source, MPI_Comm comm)
+{
+	struct _starpu_mpi_envelope answer;
+	int ret;
+
+	memset(&answer, 0, sizeof(answer));
+	answer.mode = _STARPU_MPI_ENVELOPE_CACHE_RELEASE_ANSWER;
+	answer.data_tag = envelope->data_tag;
+	answer.sync = _starpu_mpi_cache_release_request(envelope->data_tag, source, envelope->size);
+	_STARPU_MPI_COMM_TO_DEBUG(&answer, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, source, _STARPU_MPI_TAG_ENVELOPE, answer.data_tag, comm);
+	ret = MPI_Send(&answer, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, source, _STARPU_MPI_TAG_ENVELOPE, comm);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when answering a cache release, MPI_Send returning %s", _starpu_mpi_get_mpi_error_code(ret));
+}
+
 int _starpu_mpi_barrier(MPI_Comm comm)
 {
 	struct _starpu_mpi_req *barrier_req;
@@ -863,8 +1626,17 @@ static void _starpu_mpi_handle_request_termination(struct _starpu_mpi_req *req)
 	{
 		_starpu_mpi_early_data_delete(req->backend->early_data_handle);
 	}
+	else if (req->backend->forwarded)
+	{
+		/* Either another node sent the data for us, or this was the
+		 * forward of a copy of the data */
+		free(req->ptr);
+		req->ptr = NULL;
+	}
 	else
 	{
+		if (req->request_type == RECV_REQ && req->backend->nb_forwards)
+			_starpu_mpi_forward_data(req);
 		if (req->request_type == RECV_REQ || req->request_type == SEND_REQ)
 		{
 			if (req->request_type == SEND_REQ)
@@ -875,6 +1647,8 @@ static void _starpu_mpi_handle_request_termination(struct _starpu_mpi_req *req)
 				int ret;
 				ret = MPI_Wait(&req->backend->size_req, MPI_STATUS_IGNORE);
 				STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Wait returning %s", _starpu_mpi_get_mpi_error_code(ret));
+				ret = MPI_Wait(&req->backend->forwards_req, MPI_STATUS_IGNORE);
+				STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Wait returning %s", _starpu_mpi_get_mpi_error_code(ret));
 			}
 			if (req->registered_datatype == 0)
 			{
@@ -1059,7 +1833,9 @@ static void _starpu_mpi_test_detached_requests(void)
 		req->ret = _starpu_mpi_simgrid_mpi_test(&req->done, &flag);
 #else
 		STARPU_MPI_ASSERT_MSG(req->backend->data_request != MPI_REQUEST_NULL, "Cannot test completion of the request MPI_REQUEST_NULL");
-		req->ret = MPI_Test(&req->backend->data_request, &flag, MPI_STATUS_IGNORE);
+		req->ret = _starpu_mpi_test_chunks(req, &flag);
+		if (req->ret == MPI_SUCCESS && flag)
+			req->ret = MPI_Test(&req->backend->data_request, &flag, MPI_STATUS_IGNORE);
 #endif
 
 		STARPU_MPI_ASSERT_MSG(req->ret == MPI_SUCCESS, "MPI_Test returning %s", _starpu_mpi_get_mpi_error_code(req->ret));
@@ -1170,12 +1946,22 @@ static void _starpu_mpi_handle_ready_request(struct _starpu_mpi_req *req)
 	_STARPU_MPI_LOG_OUT();
 }
 
-static void _starpu_mpi_receive_early_data(struct _starpu_mpi_envelope *envelope, MPI_Status status, MPI_Comm comm)
+/* Record on the receive request req how the data announced by envelope is
+ * sent: in chunks, by which node, and to which nodes it has to be forwarded */
+static void _starpu_mpi_irecv_set_envelope(struct _starpu_mpi_req *req, struct _starpu_mpi_envelope *envelope, int data_source, struct _starpu_mpi_forward *forwards)
 {
-	_STARPU_MPI_DEBUG(20, "Request with tag %"PRIi64" and source %d not found, creating a early_data_handle to receive incoming data..\n", envelope->data_tag, status.MPI_SOURCE);
+	req->backend->chunk_size = envelope->chunk_size;
+	req->backend->data_source = data_source;
+	req->backend->forwards = forwards;
+	req->backend->nb_forwards = envelope->nb_forwards;
+}
+
+static void _starpu_mpi_receive_early_data(struct _starpu_mpi_envelope *envelope, int source, int data_source, struct _starpu_mpi_forward *forwards, MPI_Comm comm)
+{
+	_STARPU_MPI_DEBUG(20, "Request with tag %"PRIi64" and source %d not found, creating a early_data_handle to receive incoming data..\n", envelope->data_tag, source);
 	_STARPU_MPI_DEBUG(20, "Request sync %d\n", envelope->sync);
 
-	struct _starpu_mpi_early_data_handle* early_data_handle = _starpu_mpi_early_data_create(envelope, status.MPI_SOURCE, comm);
+	struct _starpu_mpi_early_data_handle* early_data_handle = _starpu_mpi_early_data_create(envelope, source, comm);
 	_starpu_mpi_early_data_add(early_data_handle);
 
 	starpu_data_handle_t data_handle;
@@ -1206,9 +1992,9 @@ static void _starpu_mpi_receive_early_data(struct _starpu_mpi_envelope *envelope
 	}
 
 	_STARPU_MPI_DEBUG(20, "Posting internal detached irecv on early_data_handle with tag %"PRIi64" from comm %ld src %d ..\n",
-			  early_data_handle->node_tag.data_tag, (long int)comm, status.MPI_SOURCE);
+			  early_data_handle->node_tag.data_tag, (long int)comm, source);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
-	early_data_handle->req = _starpu_mpi_irecv_common(early_data_handle->handle, status.MPI_SOURCE,
+	early_data_handle->req = _starpu_mpi_irecv_common(early_data_handle->handle, source,
 							  early_data_handle->node_tag.data_tag, comm, 1, 0,
 							  NULL, NULL, 1, 1, envelope->size, STARPU_DEFAULT_PRIO);
 	/* The early data handle is ready, we can let _starpu_mpi_submit_ready_request
@@ -1226,10 +2012,293 @@ static void _starpu_mpi_receive_early_data(struct _starpu_mpi_envelope *envelope
 	_starpu_mpi_req_list_erase(&ready_recv_requests, early_data_handle->req);
 	_STARPU_MPI_INC_READY_REQUESTS(-1);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+	_starpu_mpi_irecv_set_envelope(early_data_handle->req, envelope, data_source, forwards);
 	_starpu_mpi_handle_ready_request(early_data_handle->req);
 	STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
 }
 
+/* Make one pass over the requests, must be called with progress_mutex held,
+ * and by one thread at a time. Returns whether an envelope was being waited
+ * for and none has arrived */
+static int _starpu_mpi_progress_step(void)
+{
+	int idle = 0;
+
+	/* get one recv request */
+	unsigned n = 0;
+	while (!_starpu_mpi_req_list_empty(&ready_recv_requests))
+	{
+		_STARPU_MPI_TRACE_POLLING_END();
+		struct _starpu_mpi_req *req;
+
+		if (n++ == nready_process)
+			/* Already spent some time on submitting ready recv requests, poll before processing more ready recv requests */
+			break;
+
+		req = _starpu_mpi_req_list_pop_back(&ready_recv_requests);
+		_STARPU_MPI_INC_READY_REQUESTS(-1);
+
+		/* handling a request is likely to block for a while
+		 * (on a sync_data_with_mem call), we want to let the
+		 * application submit requests in the meantime, so we
+		 * release the lock. */
+		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+		_starpu_mpi_handle_ready_request(req);
+		STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+	}
+
+	/* get one send request */
+	n = 0;
+	while (!_starpu_mpi_req_prio_list_empty(&ready_send_requests) && (ndetached_send == 0 || detached_send_nrequests < ndetached_send))
+	{
+		struct _starpu_mpi_req *req;
+
+		if (n++ == nready_process)
+			/* Already spent some time on submitting ready send requests, poll before processing more ready send requests */
+			break;
+
+		req = _starpu_mpi_req_prio_list_pop_back_highest(&ready_send_requests);
+		_STARPU_MPI_INC_READY_REQUESTS(-1);
+
+		/* handling a request is likely to block for a while
+		 * (on a sync_data_with_mem call), we want to let the
+		 * application submit requests in the meantime, so we
+		 * release the lock. */
+		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+		if (!_starpu_mpi_aggregate_push(req))
+		{
+			/* Keep the envelopes in order */
+			_starpu_mpi_aggregate_flush_node(&req->node_tag.node);
+			_starpu_mpi_handle_ready_request(req);
+		}
+		STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+	}
+	_starpu_mpi_aggregate_flush();
+
+	_starpu_mpi_send_cache_releases();
+
+	_STARPU_MPI_TRACE_POLLING_BEGIN();
+
+	/* If there is no currently submitted envelope_request submitted to
+	 * catch envelopes from senders, and there is some pending
+	 * receive requests on our side, we resubmit a header request. */
+	if (((_starpu_mpi_early_request_count() > 0) || (_starpu_mpi_sync_data_count() > 0) || (_starpu_mpi_coop_tree_pending() > 0) || _starpu_mpi_cache_auto_enabled()) && (envelope_request_submitted == 0))// && (HASH_COUNT(_starpu_mpi_early_data_handle_hashmap) == 0))
+	{
+		_starpu_mpi_comm_post_recv();
+		envelope_request_submitted = 1;
+	}
+
+	/* test whether there are some terminated "detached request" */
+	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+	_starpu_mpi_test_detached_requests();
+	_starpu_mpi_aggregate_test_sends();
+	_starpu_mpi_test_barriers();
+	while (!nforwards && !_starpu_mpi_req_list_empty(&pending_barriers))
+		_starpu_mpi_barrier_func(_starpu_mpi_req_list_pop_front(&pending_barriers));
+	STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+
+	if (envelope_request_submitted == 1)
+	{
+		int flag;
+		struct _starpu_mpi_envelope *envelope;
+		MPI_Status envelope_status;
+		MPI_Comm envelope_comm;
+
+		/* test whether an envelope has arrived. */
+		flag = _starpu_mpi_comm_test_recv(&envelope_status, &envelope, &envelope_comm);
+
+		if (flag)
+		{
+			_STARPU_MPI_TRACE_POLLING_END();
+			_STARPU_MPI_COMM_FROM_DEBUG(envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, envelope_status.MPI_SOURCE, _STARPU_MPI_TAG_ENVELOPE, envelope->data_tag, envelope_comm);
+			_STARPU_MPI_DEBUG(4, "Envelope received with mode %d\n", envelope->mode);
+			if (envelope->mode == _STARPU_MPI_ENVELOPE_SYNC_READY)
+			{
+				struct _starpu_mpi_req *_sync_req = _starpu_mpi_sync_data_find(envelope->data_tag, envelope_status.MPI_SOURCE, envelope_comm);
+				_STARPU_MPI_DEBUG(20, "Sending data with tag %"PRIi64" to node %d\n", _sync_req->node_tag.data_tag, envelope_status.MPI_SOURCE);
+				STARPU_MPI_ASSERT_MSG(envelope->data_tag == _sync_req->node_tag.data_tag, "Tag mismatch (envelope %"PRIi64" != req %"PRIi64")\n",
+						      envelope->data_tag, _sync_req->node_tag.data_tag);
+				STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+				_starpu_mpi_isend_data_func(_sync_req);
+				STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+			}
+			else if (envelope->mode == _STARPU_MPI_ENVELOPE_AGGREGATE)
+			{
+				STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+				_starpu_mpi_receive_aggregate(envelope, envelope_status, envelope_comm);
+				STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+			}
+			else if (envelope->mode == _STARPU_MPI_ENVELOPE_FORWARD_ACK)
+			{
+				STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+				_starpu_mpi_receive_forward_ack(envelope, envelope_status.MPI_SOURCE, envelope_comm);
+				STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+			}
+			else if (envelope->mode == _STARPU_MPI_ENVELOPE_CACHE_RELEASE)
+			{
+				STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+				_starpu_mpi_receive_cache_release(envelope, envelope_status.MPI_SOURCE, envelope_comm);
+				STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+			}
+			else if (envelope->mode == _STARPU_MPI_ENVELOPE_CACHE_RELEASE_ANSWER)
+			{
+				STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+				_starpu_mpi_cache_release_reply(envelope->data_tag, envelope_status.MPI_SOURCE, envelope->sync);
+				STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+			}
+			else
+			{
+				/* Forwarded data is matched against the requests for the original sender */
+				int source = envelope->forwarded ? envelope->origin : envelope_status.MPI_SOURCE;
+				struct _starpu_mpi_forward *forwards = NULL;
+
+				_STARPU_MPI_DEBUG(3, "Searching for application request with tag %"PRIi64" and source %d (size %ld)\n", envelope->data_tag, source, envelope->size);
+
+				if (envelope->nb_forwards)
+				{
+					/* The sender has posted the list along the envelope */
+					_STARPU_MPI_MALLOC(forwards, envelope->nb_forwards * sizeof(struct _starpu_mpi_forward));
+					int ret = MPI_Recv(forwards, envelope->nb_forwards * sizeof(struct _starpu_mpi_forward), MPI_BYTE, envelope_status.MPI_SOURCE, _STARPU_MPI_TAG_FORWARD, envelope_comm, MPI_STATUS_IGNORE);
+					STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when receiving forwards, MPI_Recv returning %s", _starpu_mpi_get_mpi_error_code(ret));
+				}
+
+				STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+				STARPU_PTHREAD_MUTEX_LOCK(&early_data_mutex);
+				STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+				struct _starpu_mpi_req *early_request = _starpu_mpi_early_request_dequeue(envelope->data_tag, source, envelope_comm);
+
+				/* Case: a data will arrive before a matching receive is
+				 * posted by the application. Create a temporary handle to
+				 * store the incoming data, submit a starpu_mpi_irecv_detached
+				 * on this handle, and store it as an early_data
+				 */
+				if (early_request == NULL)
+				{
+					if (envelope->sync)
+					{
+						_STARPU_MPI_DEBUG(2000, "-------------------------> adding request for tag %"PRIi64"\n", envelope->data_tag);
+						struct _starpu_mpi_req *new_req;
+#ifdef STARPU_DEVEL
+#warning creating a request is not really useful.
+#endif
+						/* Initialize the request structure */
+						_starpu_mpi_request_init(&new_req);
+						new_req->request_type = RECV_REQ;
+						new_req->data_handle = NULL;
+						new_req->node_tag.node.rank = envelope_status.MPI_SOURCE;
+						new_req->node_tag.data_tag = envelope->data_tag;
+						new_req->node_tag.node.comm = envelope_comm;
+						new_req->detached = 1;
+						new_req->sync = 1;
+						new_req->callback = NULL;
+						new_req->callback_arg = NULL;
+						new_req->func = _starpu_mpi_irecv_size_func;
+						new_req->sequential_consistency = 1;
+						new_req->backend->is_internal_req = 0; // ????
+						new_req->count = envelope->size;
+						_starpu_mpi_irecv_set_envelope(new_req, envelope, envelope_status.MPI_SOURCE, forwards);
+						_starpu_mpi_sync_data_add(new_req);
+						/* We have queued our sync request, we can let _starpu_mpi_submit_ready_request find it */
+						STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
+					}
+					else
+					{
+						/* This will release early_data_mutex when appropriate */
+						_starpu_mpi_receive_early_data(envelope, source, envelope_status.MPI_SOURCE, forwards, envelope_comm);
+					}
+				}
+				/* Case: a matching application request has been found for
+				 * the incoming data, we handle the correct allocation
+				 * of the pointer associated to the data handle, then
+				 * submit the corresponding receive with
+				 * _starpu_mpi_handle_ready_request. */
+				else
+				{
+					/* Got the early request */
+					STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
+					_STARPU_MPI_DEBUG(2000, "A matching application request has been found for the incoming data with tag %"PRIi64"\n", envelope->data_tag);
+					_STARPU_MPI_DEBUG(2000, "Request sync %d\n", envelope->sync);
+
+					early_request->sync = envelope->sync;
+					_starpu_mpi_irecv_set_envelope(early_request, envelope, envelope_status.MPI_SOURCE, forwards);
+					_starpu_mpi_datatype_allocate(early_request->data_handle, early_request);
+					if (early_request->registered_datatype == 1)
+					{
+						early_request->count = 1;
+						early_request->ptr = starpu_data_handle_to_pointer(early_request->data_handle, early_request->node);
+					}
+					else
+					{
+						early_request->count = envelope->size;
+						early_request->ptr = (void *)starpu_malloc_on_node_flags(early_request->node, early_request->count, 0);
+						starpu_memory_allocate(early_request->node, early_request->count, STARPU_MEMORY_OVERFLOW);
+
+						STARPU_MPI_ASSERT_MSG(early_request->ptr, "cannot allocate message of size %ld\n", early_request->count);
+					}
+
+					_STARPU_MPI_DEBUG(3, "Handling new request... \n");
+					/* handling a request is likely to block for a while
+					 * (on a sync_data_with_mem call), we want to let the
+					 * application submit requests in the meantime, so we
+					 * release the lock. */
+					STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+					_starpu_mpi_handle_ready_request(early_request);
+					STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+				}
+			}
+			envelope_request_submitted = 0;
+			_STARPU_MPI_TRACE_POLLING_BEGIN();
+		}
+		else
+			/* Nothing received */
+			idle = 1;
+	}
+
+	return idle;
+}
+
+/* Whether there are requests to be processed or polled */
+static unsigned _starpu_mpi_progress_busy(void)
+{
+	return !_starpu_mpi_req_list_empty(&ready_recv_requests) || !_starpu_mpi_req_prio_list_empty(&ready_send_requests) || _starpu_mpi_early_request_count() || _starpu_mpi_sync_data_count() || !_starpu_mpi_req_list_empty(&detached_requests) || _starpu_mpi_aggregate_busy() || _starpu_mpi_coop_tree_pending() || !_starpu_mpi_req_list_empty(&pending_barriers) || !_starpu_mpi_req_list_empty(&running_barriers) || !_starpu_mpi_cache_release_msg_list_empty(&cache_release_msgs);
+}
+
+/* Progression hook, called by workers before blocking, possibly with their
+ * scheduling mutex held: only keep idle CPU workers awake while there is
+ * something to poll */
+static unsigned _starpu_mpi_worker_may_block(void *arg)
+{
+	(void) arg;
+	if (starpu_worker_get_type(starpu_worker_get_id()) != STARPU_CPU_WORKER)
+		return 1;
+	return !_starpu_mpi_progress_busy();
+}
+
+/* Idle hook, called by CPU workers which did not find a task to execute */
+static unsigned _starpu_mpi_worker_progress(void *arg)
+{
+	(void) arg;
+
+	if (!_starpu_mpi_progress_busy())
+		return 1;
+	if (STARPU_PTHREAD_MUTEX_TRYLOCK(&progress_step_mutex))
+		/* Somebody else is already making progress */
+		return 1;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+	if (worker_progress_running)
+	{
+		_starpu_mpi_progress_step();
+		if (!_starpu_mpi_progress_busy())
+			/* Let the progression thread notice it, e.g. for starpu_mpi_wait_for_all */
+			STARPU_PTHREAD_COND_SIGNAL(&progress_cond);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_step_mutex);
+
+	return 1;
+}
+
 static void *_starpu_mpi_progress_thread_func(void *arg)
 {
 	struct _starpu_mpi_argc_argv *argc_argv = (struct _starpu_mpi_argc_argv *) arg;
@@ -1239,19 +2308,22 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	_starpu_mpi_env_init();
 
 #ifndef STARPU_SIMGRID
-	if (_starpu_mpi_thread_cpuid < 0)
+	/* When workers make progress, the thread mostly sleeps, do not
+	 * dedicate a core to it unless explicitly requested */
+	int nobind = _starpu_mpi_nobind || (worker_progress && _starpu_mpi_thread_cpuid < 0);
+	if (_starpu_mpi_thread_cpuid < 0 && !nobind)
 	{
 		_starpu_mpi_thread_cpuid = starpu_get_next_bindid(STARPU_THREAD_ACTIVE, NULL, 0);
 	}
 
-	if (!_starpu_mpi_nobind && starpu_bind_thread_on(_starpu_mpi_thread_cpuid, STARPU_THREAD_ACTIVE, "MPI") < 0)
+	if (!nobind && starpu_bind_thread_on(_starpu_mpi_thread_cpuid, STARPU_THREAD_ACTIVE, "MPI") < 0)
 	{
 		char hostname[65];
 		gethostname(hostname, sizeof(hostname));
 		_STARPU_DISP("[%s] No core was available for the MPI thread. You should use STARPU_RESERVE_NCPU to leave one core available for MPI, or specify one core less in STARPU_NCPU\n", hostname);
 	}
 	_starpu_mpi_do_initialize(argc_argv);
-	if (!_starpu_mpi_nobind && _starpu_mpi_thread_cpuid >= 0)
+	if (!nobind && _starpu_mpi_thread_cpuid >= 0)
 		/* In case MPI changed the binding */
 		starpu_bind_thread_on(_starpu_mpi_thread_cpuid, STARPU_THREAD_ACTIVE, "MPI");
 #else
@@ -1288,8 +2360,10 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	_starpu_mpi_comm_amounts_init(argc_argv->comm);
 	_starpu_mpi_cache_init(argc_argv->comm);
 	_starpu_mpi_select_node_init();
+	_starpu_mpi_collective_init();
 	_starpu_mpi_tag_init();
 	_starpu_mpi_comm_init(argc_argv->comm);
+	_starpu_mpi_coop_tree_init(argc_argv->comm);
 
 	_starpu_mpi_early_request_init();
 	_starpu_mpi_early_data_init();
@@ -1314,18 +2388,25 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	running = 1;
 	STARPU_PTHREAD_COND_SIGNAL(&progress_cond);
 
-	int envelope_request_submitted = 0;
+	if (worker_progress)
+	{
+		worker_progress_running = 1;
+		worker_progress_hook = starpu_progression_hook_register(_starpu_mpi_worker_may_block, NULL);
+		worker_progress_idle_hook = starpu_idle_hook_register(_starpu_mpi_worker_progress, NULL);
+		STARPU_ASSERT_MSG(worker_progress_hook >= 0 && worker_progress_idle_hook >= 0, "Could not register the MPI worker progression hooks");
+	}
+
 	int mpi_driver_loop_counter = 0;
 	int mpi_driver_task_counter = 0;
 	_STARPU_MPI_TRACE_POLLING_BEGIN();
 
-	while (running || posted_requests || !(_starpu_mpi_req_list_empty(&ready_recv_requests)) || !(_starpu_mpi_req_prio_list_empty(&ready_send_requests)) || !(_starpu_mpi_req_list_empty(&detached_requests)))// || !(_starpu_mpi_early_request_count()) || !(_starpu_mpi_sync_data_count()))
+	while (running || posted_requests || !(_starpu_mpi_req_list_empty(&ready_recv_requests)) || !(_starpu_mpi_req_prio_list_empty(&ready_send_requests)) || !(_starpu_mpi_req_list_empty(&detached_requests)) || _starpu_mpi_aggregate_busy())// || !(_starpu_mpi_early_request_count()) || !(_starpu_mpi_sync_data_count()))
 	{
 #ifdef STARPU_SIMGRID
 		starpu_pthread_wait_reset(&_starpu_mpi_thread_wait);
 #endif
 		/* shall we block ? */
-		unsigned block = _starpu_mpi_req_list_empty(&ready_recv_requests) && _starpu_mpi_req_prio_list_empty(&ready_send_requests) && _starpu_mpi_early_request_count() == 0 && _starpu_mpi_sync_data_count() == 0 && _starpu_mpi_req_list_empty(&detached_requests);
+		unsigned block = !_starpu_mpi_progress_busy();
 
 		if (block)
 		{
@@ -1339,6 +2420,10 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 #ifdef STARPU_USE_MPI_FT
 		block = block && !starpu_mpi_ft_busy();
 #endif // STARPU_USE_MPI_FT
+		/* Release requests of the cache may arrive at any time, poll
+		 * for them from time to time */
+		unsigned poll_cache = block && _starpu_mpi_cache_auto_enabled();
+		block = block && !poll_cache;
 		if (block)
 		{
 			//_STARPU_MPI_DEBUG(3, "NO MORE REQUESTS TO HANDLE\n");
@@ -1348,211 +2433,50 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 
 			_STARPU_MPI_TRACE_SLEEP_END();
 		}
-
-		/* get one recv request */
-		unsigned n = 0;
-		while (!_starpu_mpi_req_list_empty(&ready_recv_requests))
+		else if (worker_progress || poll_cache)
 		{
-			_STARPU_MPI_TRACE_POLLING_END();
-			struct _starpu_mpi_req *req;
-
-			if (n++ == nready_process)
-				/* Already spent some time on submitting ready recv requests, poll before processing more ready recv requests */
-				break;
-
-			req = _starpu_mpi_req_list_pop_back(&ready_recv_requests);
-			_STARPU_MPI_INC_READY_REQUESTS(-1);
-
-			/* handling a request is likely to block for a while
-			 * (on a sync_data_with_mem call), we want to let the
-			 * application submit requests in the meantime, so we
-			 * release the lock. */
+			/* Idle workers are polling, only check from time to time */
 			STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
-			_starpu_mpi_handle_ready_request(req);
+			starpu_usleep(worker_progress_period);
 			STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
 		}
 
-		/* get one send request */
-		n = 0;
-		while (!_starpu_mpi_req_prio_list_empty(&ready_send_requests) && (ndetached_send == 0 || detached_send_nrequests < ndetached_send))
+		int idle;
+		if (worker_progress)
 		{
-			struct _starpu_mpi_req *req;
-
-			if (n++ == nready_process)
-				/* Already spent some time on submitting ready send requests, poll before processing more ready send requests */
-				break;
-
-			req = _starpu_mpi_req_prio_list_pop_back_highest(&ready_send_requests);
-			_STARPU_MPI_INC_READY_REQUESTS(-1);
-
-			/* handling a request is likely to block for a while
-			 * (on a sync_data_with_mem call), we want to let the
-			 * application submit requests in the meantime, so we
-			 * release the lock. */
 			STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
-			_starpu_mpi_handle_ready_request(req);
+			STARPU_PTHREAD_MUTEX_LOCK(&progress_step_mutex);
 			STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+			idle = _starpu_mpi_progress_step();
+			STARPU_PTHREAD_MUTEX_UNLOCK(&progress_step_mutex);
 		}
-
-		_STARPU_MPI_TRACE_POLLING_BEGIN();
-
-		/* If there is no currently submitted envelope_request submitted to
-		 * catch envelopes from senders, and there is some pending
-		 * receive requests on our side, we resubmit a header request. */
-		if (((_starpu_mpi_early_request_count() > 0) || (_starpu_mpi_sync_data_count() > 0)) && (envelope_request_submitted == 0))// && (HASH_COUNT(_starpu_mpi_early_data_handle_hashmap) == 0))
-		{
-			_starpu_mpi_comm_post_recv();
-			envelope_request_submitted = 1;
-		}
-
-		/* test whether there are some terminated "detached request" */
-		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
-		_starpu_mpi_test_detached_requests();
-		STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
-
-		if (envelope_request_submitted == 1)
+		else
+			idle = _starpu_mpi_progress_step();
+
+		/* A call is made to driver_run_once only when
+		 * the progression thread have gone through the
+		 * communication progression loop
+		 * mpi_driver_call_freq times. It is
+		 * interesting to tune the
+		 * STARPU_MPI_DRIVER_CALL_FREQUENCY
+		 * depending on whether the user wants
+		 * reactivity or computing power from the MPI
+		 * progression thread. */
+		if (idle && mpi_driver && (++mpi_driver_loop_counter == mpi_driver_call_freq))
 		{
-			int flag;
-			struct _starpu_mpi_envelope *envelope;
-			MPI_Status envelope_status;
-			MPI_Comm envelope_comm;
-
-			/* test whether an envelope has arrived. */
-			flag = _starpu_mpi_comm_test_recv(&envelope_status, &envelope, &envelope_comm);
-
-			if (flag)
+			mpi_driver_loop_counter = 0;
+			mpi_driver_task_counter = 0;
+			while (mpi_driver_task_counter++ < mpi_driver_task_freq)
 			{
-				_STARPU_MPI_TRACE_POLLING_END();
-				_STARPU_MPI_COMM_FROM_DEBUG(envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, envelope_status.MPI_SOURCE, _STARPU_MPI_TAG_ENVELOPE, envelope->data_tag, envelope_comm);
-				_STARPU_MPI_DEBUG(4, "Envelope received with mode %d\n", envelope->mode);
-				if (envelope->mode == _STARPU_MPI_ENVELOPE_SYNC_READY)
-				{
-					struct _starpu_mpi_req *_sync_req = _starpu_mpi_sync_data_find(envelope->data_tag, envelope_status.MPI_SOURCE, envelope_comm);
-					_STARPU_MPI_DEBUG(20, "Sending data with tag %"PRIi64" to node %d\n", _sync_req->node_tag.data_tag, envelope_status.MPI_SOURCE);
-					STARPU_MPI_ASSERT_MSG(envelope->data_tag == _sync_req->node_tag.data_tag, "Tag mismatch (envelope %"PRIi64" != req %"PRIi64")\n",
-							      envelope->data_tag, _sync_req->node_tag.data_tag);
-					STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
-					_starpu_mpi_isend_data_func(_sync_req);
-					STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
-				}
-				else
-				{
-					_STARPU_MPI_DEBUG(3, "Searching for application request with tag %"PRIi64" and source %d (size %ld)\n", envelope->data_tag, envelope_status.MPI_SOURCE, envelope->size);
-
-					STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
-					STARPU_PTHREAD_MUTEX_LOCK(&early_data_mutex);
-					STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
-					struct _starpu_mpi_req *early_request = _starpu_mpi_early_request_dequeue(envelope->data_tag, envelope_status.MPI_SOURCE, envelope_comm);
-
-					/* Case: a data will arrive before a matching receive is
-					 * posted by the application. Create a temporary handle to
-					 * store the incoming data, submit a starpu_mpi_irecv_detached
-					 * on this handle, and store it as an early_data
-					 */
-					if (early_request == NULL)
-					{
-						if (envelope->sync)
-						{
-							_STARPU_MPI_DEBUG(2000, "-------------------------> adding request for tag %"PRIi64"\n", envelope->data_tag);
-							struct _starpu_mpi_req *new_req;
-#ifdef STARPU_DEVEL
-#warning creating a request is not really useful.
-#endif
-							/* Initialize the request structure */
-							_starpu_mpi_request_init(&new_req);
-							new_req->request_type = RECV_REQ;
-							new_req->data_handle = NULL;
-							new_req->node_tag.node.rank = envelope_status.MPI_SOURCE;
-							new_req->node_tag.data_tag = envelope->data_tag;
-							new_req->node_tag.node.comm = envelope_comm;
-							new_req->detached = 1;
-							new_req->sync = 1;
-							new_req->callback = NULL;
-							new_req->callback_arg = NULL;
-							new_req->func = _starpu_mpi_irecv_size_func;
-							new_req->sequential_consistency = 1;
-							new_req->backend->is_internal_req = 0; // ????
-							new_req->count = envelope->size;
-							_starpu_mpi_sync_data_add(new_req);
-							/* We have queued our sync request, we can let _starpu_mpi_submit_ready_request find it */
-							STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
-						}
-						else
-						{
-							/* This will release early_data_mutex when appropriate */
-							_starpu_mpi_receive_early_data(envelope, envelope_status, envelope_comm);
-						}
-					}
-					/* Case: a matching application request has been found for
-					 * the incoming data, we handle the correct allocation
-					 * of the pointer associated to the data handle, then
-					 * submit the corresponding receive with
-					 * _starpu_mpi_handle_ready_request. */
-					else
-					{
-						/* Got the early request */
-						STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
-						_STARPU_MPI_DEBUG(2000, "A matching application request has been found for the incoming data with tag %"PRIi64"\n", envelope->data_tag);
-						_STARPU_MPI_DEBUG(2000, "Request sync %d\n", envelope->sync);
-
-						early_request->sync = envelope->sync;
-						_starpu_mpi_datatype_allocate(early_request->data_handle, early_request);
-						if (early_request->registered_datatype == 1)
-						{
-							early_request->count = 1;
-							early_request->ptr = starpu_data_handle_to_pointer(early_request->data_handle, early_request->node);
-						}
-						else
-						{
-							early_request->count = envelope->size;
-							early_request->ptr = (void *)starpu_malloc_on_node_flags(early_request->node, early_request->count, 0);
-							starpu_memory_allocate(early_request->node, early_request->count, STARPU_MEMORY_OVERFLOW);
-
-							STARPU_MPI_ASSERT_MSG(early_request->ptr, "cannot allocate message of size %ld\n", early_request->count);
-						}
-
-						_STARPU_MPI_DEBUG(3, "Handling new request... \n");
-						/* handling a request is likely to block for a while
-						 * (on a sync_data_with_mem call), we want to let the
-						 * application submit requests in the meantime, so we
-						 * release the lock. */
-						STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
-						_starpu_mpi_handle_ready_request(early_request);
-						STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
-					}
-				}
-				envelope_request_submitted = 0;
-				_STARPU_MPI_TRACE_POLLING_BEGIN();
-			}
-			else
-			{
-				/* A call is made to driver_run_once only when
-				 * the progression thread have gone through the
-				 * communication progression loop
-				 * mpi_driver_call_freq times. It is
-				 * interesting to tune the
-				 * STARPU_MPI_DRIVER_CALL_FREQUENCY
-				 * depending on whether the user wants
-				 * reactivity or computing power from the MPI
-				 * progression thread. */
-				if (mpi_driver && (++mpi_driver_loop_counter == mpi_driver_call_freq))
-				{
-					mpi_driver_loop_counter = 0;
-					mpi_driver_task_counter = 0;
-					while (mpi_driver_task_counter++ < mpi_driver_task_freq)
-					{
-						_STARPU_MPI_TRACE_DRIVER_RUN_BEGIN();
-						STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
-						_STARPU_MPI_DEBUG(4, "running once mpi driver\n");
-						starpu_driver_run_once(mpi_driver);
-						STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
-						_STARPU_MPI_TRACE_DRIVER_RUN_END();
-					}
-				}
-
-				//_STARPU_MPI_DEBUG(4, "Nothing received, continue ..\n");
+				_STARPU_MPI_TRACE_DRIVER_RUN_BEGIN();
+				STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+				_STARPU_MPI_DEBUG(4, "running once mpi driver\n");
+				starpu_driver_run_once(mpi_driver);
+				STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+				_STARPU_MPI_TRACE_DRIVER_RUN_END();
 			}
 		}
+
 #ifdef STARPU_USE_MPI_FT
 		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
 		starpu_mpi_ft_progress();
@@ -1567,6 +2491,17 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	}
 
 	_STARPU_MPI_TRACE_POLLING_END();
+	if (worker_progress)
+	{
+		/* Workers must not make progress any more */
+		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+		STARPU_PTHREAD_MUTEX_LOCK(&progress_step_mutex);
+		STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+		worker_progress_running = 0;
+		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_step_mutex);
+		starpu_idle_hook_deregister(worker_progress_idle_hook);
+		starpu_progression_hook_deregister(worker_progress_hook);
+	}
 	if (envelope_request_submitted)
 	{
 		_starpu_mpi_comm_cancel_recv();
@@ -1596,6 +2531,8 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	_starpu_mpi_early_request_check_termination();
 	_starpu_mpi_early_data_check_termination();
 	_starpu_mpi_sync_data_check_termination();
+	_starpu_mpi_aggregate_shutdown();
+	_starpu_mpi_coop_tree_shutdown();
 	_starpu_mpi_req_prio_list_deinit(&ready_send_requests);
 
 #ifdef STARPU_USE_FXT
@@ -1630,6 +2567,9 @@ int _starpu_mpi_progress_init(struct _starpu_mpi_argc_argv *argc_argv)
 
 	STARPU_PTHREAD_MUTEX_INIT(&detached_requests_mutex, NULL);
 	_starpu_mpi_req_list_init(&detached_requests);
+	_starpu_mpi_req_list_init(&pending_barriers);
+	_starpu_mpi_req_list_init(&running_barriers);
+	_starpu_mpi_cache_release_msg_list_init(&cache_release_msgs);
 
 	STARPU_PTHREAD_MUTEX_INIT(&mutex_posted_requests, NULL);
 	STARPU_PTHREAD_MUTEX_INIT(&mutex_ready_requests, NULL);
@@ -1637,6 +2577,22 @@ int _starpu_mpi_progress_init(struct _starpu_mpi_argc_argv *argc_argv)
 	nready_process = starpu_getenv_number_default("STARPU_MPI_NREADY_PROCESS", 10);
 	ndetached_send = starpu_getenv_number_default("STARPU_MPI_NDETACHED_SEND", 10);
 	early_data_force_allocate = starpu_getenv_number_default("STARPU_MPI_EARLYDATA_ALLOCATE", 0);
+	_starpu_mpi_aggregate_init();
+#ifdef STARPU_SIMGRID
+	/* The simulated requests are waited for one by one */
+	chunk_size = 0;
+	worker_progress = 0;
+#else
+	chunk_size = starpu_getenv_number_default("STARPU_MPI_CHUNK_SIZE", 0);
+	if (chunk_size < 0)
+		chunk_size = 0;
+	/* The number of slices of each chunk has to fit in an int */
+	if (chunk_size > INT_MAX)
+		chunk_size = INT_MAX;
+	worker_progress = starpu_getenv_number_default("STARPU_MPI_WORKER_PROGRESS", 0);
+#endif
+	worker_progress_period = starpu_getenv_number_default("STARPU_MPI_WORKER_PROGRESS_PERIOD", 1000);
+	STARPU_PTHREAD_MUTEX_INIT(&progress_step_mutex, NULL);
 
 #ifdef STARPU_SIMGRID
 	STARPU_PTHREAD_MUTEX_INIT(&wait_counter_mutex, NULL);
@@ -1696,6 +2652,7 @@ void _starpu_mpi_progress_shutdown(void **value)
 	STARPU_PTHREAD_MUTEX_DESTROY(&mutex_posted_requests);
 	STARPU_PTHREAD_MUTEX_DESTROY(&mutex_ready_requests);
 	STARPU_PTHREAD_MUTEX_DESTROY(&progress_mutex);
+	STARPU_PTHREAD_MUTEX_DESTROY(&progress_step_mutex);
 	STARPU_PTHREAD_MUTEX_DESTROY(&early_data_mutex);
 	STARPU_PTHREAD_COND_DESTROY(&barrier_cond);
 }
@@ -49,6 +49,10 @@ void _starpu_mpi_wake_up_progress_thread();
 void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req);
 void _starpu_mpi_irecv_size_func(struct _starpu_mpi_req *req);
 
+#if MPI_VERSION >= 3 && !defined(STARPU_SIMGRID)
+void _starpu_mpi_cache_release(int rank, MPI_Comm comm, starpu_mpi_tag_t data_tag, unsigned long accesses);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
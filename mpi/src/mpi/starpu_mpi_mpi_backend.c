@@ -52,7 +52,9 @@ void _starpu_mpi_mpi_backend_shutdown(void)
 
 int _starpu_mpi_mpi_backend_reserve_core(void)
 {
-	return (starpu_getenv_number_default("STARPU_MPI_DRIVER_CALL_FREQUENCY", 0) <= 0);
+	/* No core is needed when the progression is done by the workers or by the MPI driver */
+	return (starpu_getenv_number_default("STARPU_MPI_DRIVER_CALL_FREQUENCY", 0) <= 0
+		&& starpu_getenv_number_default("STARPU_MPI_WORKER_PROGRESS", 0) <= 0);
 }
 
 void _starpu_mpi_mpi_backend_request_init(struct _starpu_mpi_req *req)
@@ -60,6 +62,13 @@ void _starpu_mpi_mpi_backend_request_init(struct _starpu_mpi_req *req)
 	_STARPU_MPI_CALLOC(req->backend, 1, sizeof(struct _starpu_mpi_req_backend));
 
 	//req->backend->data_request = 0;
+	//req->backend->chunk_requests = NULL;
+	//req->backend->nb_chunk_requests = 0;
+	//req->backend->chunk_size = 0;
+	//req->backend->forwards = NULL;
+	//req->backend->nb_forwards = 0;
+	req->backend->forwards_req = MPI_REQUEST_NULL;
+	req->backend->data_source = -1;
 
 	STARPU_PTHREAD_MUTEX_INIT0(&req->backend->req_mutex, NULL);
 	STARPU_PTHREAD_COND_INIT0(&req->backend->req_cond, NULL);
@@ -73,6 +82,7 @@ void _starpu_mpi_mpi_backend_request_init(struct _starpu_mpi_req *req)
 	req->backend->to_destroy = 1;
 	//req->backend->early_data_handle = NULL;
 	//req->backend->envelope = NULL;
+	//req->backend->forwarded = 0;
 }
 
 void _starpu_mpi_mpi_backend_request_fill(struct _starpu_mpi_req *req, int is_internal_req)
@@ -88,6 +98,8 @@ void _starpu_mpi_mpi_backend_request_destroy(struct _starpu_mpi_req *req)
 	STARPU_PTHREAD_MUTEX_DESTROY(&req->backend->req_mutex);
 	STARPU_PTHREAD_COND_DESTROY(&req->backend->req_cond);
 	STARPU_PTHREAD_COND_DESTROY(&req->backend->posted_cond);
+	free(req->backend->chunk_requests);
+	free(req->backend->forwards);
 	free(req->backend);
 	req->backend = NULL;
 }
@@ -132,6 +144,10 @@ struct _starpu_mpi_backend _mpi_backend =
 
 	._starpu_mpi_backend_isend_size_func = _starpu_mpi_isend_size_func,
 	._starpu_mpi_backend_irecv_size_func = _starpu_mpi_irecv_size_func,
+
+#if MPI_VERSION >= 3 && !defined(STARPU_SIMGRID)
+	._starpu_mpi_backend_cache_release = _starpu_mpi_cache_release,
+#endif
 };
 
 #endif /* STARPU_USE_MPI_MPI*/
@@ -40,11 +40,33 @@ extern int _starpu_mpi_tag;
 #define _STARPU_MPI_TAG_EXT_DATA  _starpu_mpi_tag+5
 #define _STARPU_MPI_TAG_CP_INFO    _starpu_mpi_tag+6
 #endif // STARPU_USE_MPI_FT
+/** List of the nodes a cooperative send has to be forwarded to */
+#define _STARPU_MPI_TAG_FORWARD   _starpu_mpi_tag+7
 
 enum _starpu_envelope_mode
 {
 	_STARPU_MPI_ENVELOPE_DATA=0,
-	_STARPU_MPI_ENVELOPE_SYNC_READY=1
+	_STARPU_MPI_ENVELOPE_SYNC_READY=1,
+	/** The data message contains the envelope and the packed data of
+	 * several small requests, see STARPU_MPI_AGGREGATE_SIZE */
+	_STARPU_MPI_ENVELOPE_AGGREGATE=2,
+	/** The receiver has forwarded the data to the other nodes of its
+	 * host, see _starpu_mpi_coop_sends_build_tree */
+	_STARPU_MPI_ENVELOPE_FORWARD_ACK=3,
+	/** The receiver asks whether it can drop its copy of the data, the
+	 * size field holds its count of cache accesses, see
+	 * STARPU_MPI_CACHE_AUTO */
+	_STARPU_MPI_ENVELOPE_CACHE_RELEASE=4,
+	/** The answer of the owner, the sync field tells whether the copy was
+	 * dropped */
+	_STARPU_MPI_ENVELOPE_CACHE_RELEASE_ANSWER=5
+};
+
+/** A node to which received data has to be forwarded */
+struct _starpu_mpi_forward
+{
+	int rank;
+	starpu_mpi_tag_t data_tag;
 };
 
 struct _starpu_mpi_envelope
@@ -53,11 +75,33 @@ struct _starpu_mpi_envelope
 	starpu_ssize_t size;
 	starpu_mpi_tag_t data_tag;
 	unsigned sync;
+	/** Size in bytes of the chunks in which the data is sent, 0 when it
+	 * is sent in one message, see STARPU_MPI_CHUNK_SIZE */
+	starpu_ssize_t chunk_size;
+	/** Number of nodes the receiver has to forward the data to, the list
+	 * follows on _STARPU_MPI_TAG_FORWARD */
+	int nb_forwards;
+	/** The data is forwarded on behalf of node origin */
+	unsigned forwarded;
+	int origin;
 };
 
 struct _starpu_mpi_req_backend
 {
 	MPI_Request data_request;
+	/** When the data is transferred in several chunks, the requests of
+	 * all chunks but the last one, which is data_request */
+	MPI_Request *chunk_requests;
+	int nb_chunk_requests;
+	/** Size in bytes of the chunks, 0 when the data is transferred in one message */
+	starpu_ssize_t chunk_size;
+
+	/** Nodes to which the data has to be forwarded once received */
+	struct _starpu_mpi_forward *forwards;
+	int nb_forwards;
+	MPI_Request forwards_req;
+	/** Node which actually sends the data, -1 when it is the node of the request */
+	int data_source;
 
 	starpu_pthread_mutex_t req_mutex;
 	starpu_pthread_cond_t req_cond;
@@ -72,6 +116,8 @@ struct _starpu_mpi_req_backend
 
 	unsigned is_internal_req:1;
 	unsigned to_destroy:1;
+	/** The data is sent by another node of the host of the destination */
+	unsigned forwarded:1;
 	struct _starpu_mpi_req *internal_req;
 	struct _starpu_mpi_early_data_handle *early_data_handle;
 	UT_hash_handle hh;
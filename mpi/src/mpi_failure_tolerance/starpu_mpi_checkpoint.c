@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2014-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2014-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -17,9 +17,11 @@
 #include <stdlib.h>
 
 #include <common/utils.h>
+#include <datawizard/coherency.h>
 #include <mpi_failure_tolerance/starpu_mpi_checkpoint.h>
 #include <mpi_failure_tolerance/starpu_mpi_checkpoint_template.h>
 #include <mpi_failure_tolerance/starpu_mpi_checkpoint_package.h>
+#include <mpi_failure_tolerance/starpu_mpi_checkpoint_disk.h>
 #include <mpi_failure_tolerance/starpu_mpi_ft_service_comms.h>
 #include <mpi_failure_tolerance/starpu_mpi_ft_stats.h>
 #include <starpu_mpi_private.h>
@@ -114,6 +116,101 @@ void _send_cp_internal_data_cb(void* _args)
 	}
 }
 
+/* Keep a reference on the copy of the checkpoint, which the next checkpoints
+ * can use while the owner does not modify the data */
+void _keep_cp_internal_data_copy(struct _starpu_mpi_cp_ack_arg_cb* arg)
+{
+	struct _starpu_mpi_checkpoint_template_item* item = arg->item;
+	STARPU_PTHREAD_MUTEX_LOCK(&arg->cp_template->mutex);
+	if (arg->msg.checkpoint_instance > item->copy_instance)
+	{
+		if (item->copy_handle)
+			starpu_data_unregister_submit(item->copy_handle);
+		starpu_data_dup_ro(&item->copy_handle, arg->copy_handle, 1);
+		item->copy_instance = arg->msg.checkpoint_instance;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&arg->cp_template->mutex);
+}
+
+void _recv_cp_internal_data_cb(void* _args)
+{
+	struct _starpu_mpi_cp_ack_arg_cb* arg = (struct _starpu_mpi_cp_ack_arg_cb*) _args;
+	_STARPU_MPI_FT_STATS_RECV_CP_DATA(starpu_data_get_size(arg->handle));
+}
+
+void _recv_cp_changed_cb(void* _args)
+{
+	struct _starpu_mpi_cp_ack_arg_cb* arg = (struct _starpu_mpi_cp_ack_arg_cb*) _args;
+	int *changed = starpu_data_handle_to_pointer(arg->changed_handle, STARPU_MAIN_RAM);
+	_STARPU_MPI_FT_STATS_RECV_FT_SERVICE_MSG(sizeof(*changed));
+	if (*changed)
+	{
+		starpu_data_handle_t recv_handle;
+		int ret;
+		_STARPU_MPI_DEBUG(0, "Submit CP: receiving starPU data from %d (tag %d)\n", arg->rank, (int)arg->tag);
+		starpu_data_register_same(&recv_handle, arg->handle);
+		ret = starpu_mpi_irecv_detached(recv_handle, arg->rank, arg->tag, _starpu_mpi_cp_data_comm, &_recv_cp_internal_data_cb, (void*)arg);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv_detached");
+		starpu_data_dup_ro(&arg->copy_handle, recv_handle, 1);
+		starpu_data_unregister_submit(recv_handle);
+		_keep_cp_internal_data_copy(arg);
+		starpu_data_acquire_cb(arg->copy_handle, STARPU_R, _recv_internal_dup_ro_cb, arg);
+		// The callback need to store the data and post ack send.
+	}
+	else
+	{
+		// The owner did not modify the data, the copy of the previous checkpoint is also the one of this checkpoint
+		_STARPU_MPI_DEBUG(0, "Submit CP: skip recv unchanged starPU data from %d (tag %d)\n", arg->rank, (int)arg->tag);
+		STARPU_PTHREAD_MUTEX_LOCK(&arg->cp_template->mutex);
+		STARPU_ASSERT_MSG(arg->item->copy_handle, "The data with tag %ld has not changed, but it was never received from %d\n", (long)arg->tag, arg->rank);
+		starpu_data_dup_ro(&arg->copy_handle, arg->item->copy_handle, 1);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&arg->cp_template->mutex);
+		_STARPU_MPI_FT_STATS_RECV_UNCHANGED_CP_DATA(starpu_data_get_size(arg->handle));
+		_starpu_mpi_store_data_and_send_ack_cb(arg);
+	}
+	free(changed);
+	starpu_data_unregister_submit(arg->changed_handle);
+}
+
+void _send_cp_changed_cb(void* _args)
+{
+	starpu_data_handle_t changed_handle = (starpu_data_handle_t) _args;
+	_STARPU_MPI_FT_STATS_SEND_FT_SERVICE_MSG(sizeof(int));
+	free(starpu_data_handle_to_pointer(changed_handle, STARPU_MAIN_RAM));
+	starpu_data_unregister_submit(changed_handle);
+}
+
+unsigned long _cp_internal_data_write_version(starpu_data_handle_t handle)
+{
+	unsigned long write_version;
+	STARPU_PTHREAD_MUTEX_LOCK(&handle->sequential_consistency_mutex);
+	write_version = _starpu_mpi_data_get(handle)->write_version;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&handle->sequential_consistency_mutex);
+	return write_version;
+}
+
+/* Tell the backup node whether the data has been written since its previous
+ * checkpoint. The writes submitted without sequential consistency can not be
+ * counted, such data are always sent. */
+int _send_cp_internal_data_changed(struct _starpu_mpi_checkpoint_template_item* item, starpu_data_handle_t handle, int prio)
+{
+	starpu_data_handle_t changed_handle;
+	unsigned long write_version = _cp_internal_data_write_version(handle);
+	int *changed;
+	int ret;
+
+	_STARPU_MALLOC(changed, sizeof(*changed));
+	*changed = !item->checkpointed || item->write_version != write_version || !starpu_data_get_sequential_consistency_flag(handle);
+	ret = *changed;
+	item->checkpointed = 1;
+	item->write_version = write_version;
+
+	starpu_variable_data_register(&changed_handle, STARPU_MAIN_RAM, (uintptr_t)changed, sizeof(*changed));
+	starpu_mpi_isend_detached_prio(changed_handle, item->backupped_by, starpu_mpi_data_get_tag(handle), prio, _starpu_mpi_cp_version_comm,
+				       &_send_cp_changed_cb, (void*)changed_handle);
+	return ret;
+}
+
 void _send_internal_data_stats(struct _starpu_mpi_cp_ack_arg_cb* arg)
 {
 	if (arg->cache_flag)
@@ -190,7 +287,6 @@ int starpu_mpi_checkpoint_template_submit(starpu_mpi_checkpoint_template_t cp_te
 						_STARPU_MPI_FT_STATS_SEND_CACHED_CP_DATA(starpu_data_get_size(handle));
 						break; // We don't want to CP a data that is still at initial state.
 					}
-					_STARPU_MPI_DEBUG(0, "Submit CP: sending starPU data to %d (tag %d)\n", item->backupped_by, (int)starpu_mpi_data_get_tag(handle));
 					_STARPU_MALLOC(arg, sizeof(struct _starpu_mpi_cp_ack_arg_cb));
 					arg->rank = item->backupped_by;
 					arg->handle = handle;
@@ -198,10 +294,33 @@ int starpu_mpi_checkpoint_template_submit(starpu_mpi_checkpoint_template_t cp_te
 					arg->type = STARPU_R;
 					arg->count = item->count;
 					arg->checkpoint_instance_hint = current_instance;
-					_starpu_mpi_isend_cache_aware(handle, item->backupped_by, starpu_mpi_data_get_tag(handle), MPI_COMM_WORLD, 1, 0, prio,
-					                              &_send_cp_internal_data_cb, (void*)arg, 1, &arg->cache_flag);
-					// the callbacks need to post ack recv. The cache one needs to release the handle.
-					_send_internal_data_stats(arg);
+					if (starpu_mpi_cached_send(handle, item->backupped_by))
+					{
+						// The backup node already has the value of the data, it does not need to know whether it has changed
+						_STARPU_MPI_DEBUG(0, "Submit CP: sending starPU data to %d (tag %d)\n", item->backupped_by, (int)starpu_mpi_data_get_tag(handle));
+						_starpu_mpi_isend_cache_aware(handle, item->backupped_by, starpu_mpi_data_get_tag(handle), MPI_COMM_WORLD, 1, 0, prio,
+									      &_send_cp_internal_data_cb, (void*)arg, 1, &arg->cache_flag);
+						// the callbacks need to post ack recv. The cache one needs to release the handle.
+						_send_internal_data_stats(arg);
+						item->checkpointed = 1;
+						item->write_version = _cp_internal_data_write_version(handle);
+					}
+					else if (_send_cp_internal_data_changed(item, handle, prio))
+					{
+						_STARPU_MPI_DEBUG(0, "Submit CP: sending starPU data to %d (tag %d)\n", item->backupped_by, (int)starpu_mpi_data_get_tag(handle));
+						arg->cache_flag = 0;
+						starpu_mpi_isend_detached_prio(handle, item->backupped_by, starpu_mpi_data_get_tag(handle), prio, _starpu_mpi_cp_data_comm,
+									       &_send_cp_internal_data_cb, (void*)arg);
+						// the callback needs to post ack recv.
+						_send_internal_data_stats(arg);
+					}
+					else
+					{
+						// The backup node keeps the copy of the previous checkpoint, and will acknowledge it for this one
+						_STARPU_MPI_DEBUG(0, "Submit CP: skip send unchanged starPU data to %d (tag %d)\n", item->backupped_by, (int)starpu_mpi_data_get_tag(handle));
+						_STARPU_MPI_FT_STATS_SEND_UNCHANGED_CP_DATA(starpu_data_get_size(handle));
+						_starpu_mpi_push_cp_ack_recv_cb(arg);
+					}
 				}
 				else if (item->backup_of == starpu_mpi_data_get_rank(handle))
 				{
@@ -211,7 +330,6 @@ int starpu_mpi_checkpoint_template_submit(starpu_mpi_checkpoint_template_t cp_te
 						_STARPU_MPI_FT_STATS_RECV_CACHED_CP_DATA(starpu_data_get_size(handle));
 						break; // We don't want to CP a data that is still at initial state.
 					}
-					_STARPU_MPI_DEBUG(0, "Submit CP: receiving starPU data from %d (tag %d)\n", starpu_mpi_data_get_rank(handle), (int)starpu_mpi_data_get_tag(handle));
 					_STARPU_MALLOC(arg, sizeof(struct _starpu_mpi_cp_ack_arg_cb));
 					arg->rank = item->backup_of;
 					arg->handle = handle;
@@ -220,13 +338,31 @@ int starpu_mpi_checkpoint_template_submit(starpu_mpi_checkpoint_template_t cp_te
 					arg->count = item->count;
 					arg->msg.checkpoint_id = cp_template->cp_id;
 					arg->msg.checkpoint_instance = current_instance;
-					_starpu_mpi_irecv_cache_aware(handle, starpu_mpi_data_get_rank(handle), starpu_mpi_data_get_tag(handle), MPI_COMM_WORLD, 1, 0,
-								      NULL, NULL, 1, 0, 1, &arg->cache_flag);
-					// The callback needs to do nothing. The cached one must release the handle.
-					//  _recv_internal_data_stats(arg);  // Now done in data_cache_set
-					starpu_data_dup_ro(&arg->copy_handle, arg->handle, 1);
-					starpu_data_acquire_cb(arg->copy_handle, STARPU_R, _recv_internal_dup_ro_cb, arg);
-					// The callback need to store the data and post ack send.
+					arg->item = item;
+					arg->cp_template = cp_template;
+					if (starpu_mpi_cached_receive(handle))
+					{
+						_STARPU_MPI_DEBUG(0, "Submit CP: receiving starPU data from %d (tag %d)\n", starpu_mpi_data_get_rank(handle), (int)starpu_mpi_data_get_tag(handle));
+						_starpu_mpi_irecv_cache_aware(handle, starpu_mpi_data_get_rank(handle), starpu_mpi_data_get_tag(handle), MPI_COMM_WORLD, 1, 0,
+									      NULL, NULL, 1, 0, 1, &arg->cache_flag);
+						// The callback needs to do nothing. The cached one must release the handle.
+						//  _recv_internal_data_stats(arg);  // Now done in data_cache_set
+						starpu_data_dup_ro(&arg->copy_handle, arg->handle, 1);
+						_keep_cp_internal_data_copy(arg);
+						starpu_data_acquire_cb(arg->copy_handle, STARPU_R, _recv_internal_dup_ro_cb, arg);
+						// The callback need to store the data and post ack send.
+					}
+					else
+					{
+						int ret;
+						int *changed;
+						_STARPU_MALLOC(changed, sizeof(*changed));
+						starpu_variable_data_register(&arg->changed_handle, STARPU_MAIN_RAM, (uintptr_t)changed, sizeof(*changed));
+						ret = starpu_mpi_irecv_detached(arg->changed_handle, arg->rank, arg->tag, _starpu_mpi_cp_version_comm,
+										&_recv_cp_changed_cb, (void*)arg);
+						STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv_detached");
+						// The callback needs to receive the data if it has changed, and then store it and post ack send
+					}
 				}
 				break;
 		}
@@ -234,6 +370,8 @@ int starpu_mpi_checkpoint_template_submit(starpu_mpi_checkpoint_template_t cp_te
 		item = _starpu_mpi_checkpoint_template_get_next_data(cp_template, item);
 	}
 
+	_starpu_mpi_checkpoint_disk_submit(cp_template, current_instance);
+
 	return 0;
 }
 
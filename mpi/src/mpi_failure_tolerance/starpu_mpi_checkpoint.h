@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2014-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2014-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -27,6 +27,12 @@ extern "C"
 #endif
 
 extern int _my_rank;
+/** Communicators dedicated to the checkpoints of the data internal to StarPU,
+  * for the messages telling whether the data has changed, and for the data */
+extern MPI_Comm _starpu_mpi_cp_version_comm;
+extern MPI_Comm _starpu_mpi_cp_data_comm;
+
+struct _starpu_mpi_checkpoint_template_item;
 
 struct _starpu_mpi_cp_ack_msg
 {
@@ -53,6 +59,12 @@ struct _starpu_mpi_cp_ack_arg_cb
 	struct _starpu_mpi_cp_ack_msg msg;
 	int checkpoint_instance_hint;
 	int cache_flag;
+	/** For the data internal to StarPU not found in the cache, the
+	  * template item, and the handle of the flag sent by the owner to tell
+	  * whether the data has changed since the previous checkpoint */
+	struct _starpu_mpi_checkpoint_template_item *item;
+	starpu_mpi_checkpoint_template_t cp_template;
+	starpu_data_handle_t          changed_handle;
 };
 
 struct _starpu_mpi_cp_discard_arg_cb
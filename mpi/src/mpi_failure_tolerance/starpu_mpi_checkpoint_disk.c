@@ -0,0 +1,454 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <common/utils.h>
+#include <core/disk.h>
+#include <mpi_failure_tolerance/starpu_mpi_checkpoint.h>
+#include <mpi_failure_tolerance/starpu_mpi_checkpoint_template.h>
+#include <mpi_failure_tolerance/starpu_mpi_checkpoint_disk.h>
+
+/*
+ * Local disk checkpoints: the data of a checkpoint template owned by this
+ * node are packed by low-priority tasks into byte vectors whose home is a file
+ * of the disk node registered on STARPU_MPI_CHECKPOINT_DISK, and are then
+ * written to the files. Each data has two files, used in turn, so that the
+ * last complete checkpoint is kept while the next one is being written. A
+ * checkpoint submitted while the previous one is still being written goes to
+ * the same slot, its writes are ordered after the previous ones by the data
+ * dependencies, and the slot then holds the latest instance. A small file per
+ * template records which checkpoint instance each slot holds.
+ */
+
+static char *_disk_path;
+static int _disk_node = -1;
+
+struct _starpu_mpi_checkpoint_disk_arg
+{
+	starpu_mpi_checkpoint_template_t cp_template;
+	starpu_data_handle_t disk_handle;
+	/** For STARPU_VALUE data, the handle registered for the copy of the value */
+	starpu_data_handle_t value_handle;
+};
+
+static void _disk_write_cpu(void *descr[], void *_args)
+{
+	starpu_data_handle_t handle;
+	unsigned node = starpu_worker_get_local_memory_node();
+	void *ptr;
+	starpu_ssize_t count;
+
+	starpu_codelet_unpack_args(_args, &handle);
+	starpu_data_pack_node(handle, node, &ptr, &count);
+	STARPU_ASSERT((size_t) count == STARPU_VECTOR_GET_NX(descr[1]));
+	memcpy((void *) STARPU_VECTOR_GET_PTR(descr[1]), ptr, count);
+	starpu_free_on_node_flags(node, (uintptr_t) ptr, count, 0);
+}
+
+static struct starpu_codelet _disk_write_cl =
+{
+	.cpu_funcs = {_disk_write_cpu},
+	.nbuffers = 2,
+	.modes = {STARPU_R, STARPU_W},
+	.name = "starpu_mpi_checkpoint_disk_write",
+};
+
+void _starpu_mpi_checkpoint_disk_init(void)
+{
+	char *path = starpu_getenv("STARPU_MPI_CHECKPOINT_DISK");
+	int node;
+
+	if (!path || !path[0])
+		return;
+
+	node = starpu_disk_register(&starpu_disk_unistd_ops, (void *) path, -1);
+	if (node < 0)
+	{
+		_STARPU_DISP("Warning: could not use directory %s for disk checkpoints\n", path);
+		return;
+	}
+	/* This disk is not meant to hold evicted data */
+	_starpu_set_disk_flag(node, STARPU_DISK_NO_RECLAIM);
+	_disk_path = strdup(path);
+	_disk_node = node;
+}
+
+static void _disk_meta_name(char *name, size_t size, int cp_id)
+{
+	snprintf(name, size, "%s/cp%d_%d", _disk_path, cp_id, _my_rank);
+}
+
+static void _disk_meta_read(starpu_mpi_checkpoint_template_t cp_template)
+{
+	char name[PATH_MAX];
+	FILE *f;
+
+	cp_template->disk_instance[0] = -1;
+	cp_template->disk_instance[1] = -1;
+	_disk_meta_name(name, sizeof(name), cp_template->cp_id);
+	f = fopen(name, "r");
+	if (!f)
+		return;
+	if (fscanf(f, "%d %d", &cp_template->disk_instance[0], &cp_template->disk_instance[1]) != 2)
+	{
+		cp_template->disk_instance[0] = -1;
+		cp_template->disk_instance[1] = -1;
+	}
+	fclose(f);
+}
+
+/* Must be called with the template mutex held */
+static void _disk_meta_write(starpu_mpi_checkpoint_template_t cp_template)
+{
+	char name[PATH_MAX], tmp_name[PATH_MAX+4];
+	FILE *f;
+
+	_disk_meta_name(name, sizeof(name), cp_template->cp_id);
+	snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", name);
+	f = fopen(tmp_name, "w");
+	if (!f)
+	{
+		_STARPU_DISP("Warning: could not write disk checkpoint file %s: %s\n", tmp_name, strerror(errno));
+		return;
+	}
+	fprintf(f, "%d %d\n", cp_template->disk_instance[0], cp_template->disk_instance[1]);
+	fclose(f);
+	/* Make the update atomic */
+	if (rename(tmp_name, name) != 0)
+		_STARPU_DISP("Warning: could not write disk checkpoint file %s: %s\n", name, strerror(errno));
+}
+
+/* Whether this node owns the data of item, and if so its tag and packed size */
+static int _disk_item_owned(struct _starpu_mpi_checkpoint_template_item *item, starpu_mpi_tag_t *tag, size_t *size)
+{
+	starpu_data_handle_t handle;
+	starpu_ssize_t count;
+
+	if (item->backup_of != -1)
+		return 0;
+
+	if (item->type == STARPU_VALUE)
+	{
+		*tag = item->tag;
+		*size = item->count;
+		return 1;
+	}
+
+	handle = (starpu_data_handle_t) item->ptr;
+	if (starpu_mpi_data_get_rank(handle) != _my_rank)
+		return 0;
+	starpu_data_pack_node(handle, STARPU_MAIN_RAM, NULL, &count);
+	STARPU_ASSERT_MSG(count >= 0, "Disk checkpoints need data whose packed size is known in advance\n");
+	*tag = starpu_mpi_data_get_tag(handle);
+	*size = count;
+	return 1;
+}
+
+static void _disk_item_name(char *name, size_t name_size, int cp_id, starpu_mpi_tag_t tag, int slot)
+{
+	snprintf(name, name_size, "cp%d_%d_%ld_%d", cp_id, _my_rank, (long) tag, slot);
+}
+
+/* Whether the file of the data is there with the expected size */
+static int _disk_item_check(int cp_id, starpu_mpi_tag_t tag, size_t size, int slot)
+{
+	char name[64], path[PATH_MAX];
+	struct stat st;
+
+	_disk_item_name(name, sizeof(name), cp_id, tag, slot);
+	snprintf(path, sizeof(path), "%s/%s", _disk_path, name);
+	return stat(path, &st) == 0 && (size_t) st.st_size == size;
+}
+
+static starpu_data_handle_t _disk_item_open(int cp_id, struct _starpu_mpi_checkpoint_template_item *item, starpu_mpi_tag_t tag, size_t size, int slot, int create)
+{
+	char name[64];
+	void *obj;
+
+	if (item->disk_handle[slot])
+	{
+		STARPU_ASSERT_MSG(item->disk_size == size, "The size of the data with tag %ld has changed from %lu to %lu since the previous disk checkpoint\n", (long) tag, (unsigned long) item->disk_size, (unsigned long) size);
+		return item->disk_handle[slot];
+	}
+
+	_disk_item_name(name, sizeof(name), cp_id, tag, slot);
+	if (create)
+	{
+		char path[PATH_MAX];
+		int fd;
+
+		snprintf(path, sizeof(path), "%s/%s", _disk_path, name);
+		fd = open(path, O_RDWR|O_CREAT, 0600);
+		if (fd < 0)
+			return NULL;
+		close(fd);
+	}
+
+	obj = starpu_disk_open(_disk_node, name, size);
+	if (!obj)
+		return NULL;
+	item->disk_obj[slot] = obj;
+	item->disk_size = size;
+	starpu_vector_data_register(&item->disk_handle[slot], _disk_node, (uintptr_t) obj, size, 1);
+	return item->disk_handle[slot];
+}
+
+/* Drop the copies in main memory of a data which was written to the disk */
+static void _disk_evict(starpu_data_handle_t disk_handle)
+{
+	unsigned node, nnodes = starpu_memory_nodes_get_count();
+
+	for (node = 0; node < nnodes; node++)
+		if (starpu_node_get_kind(node) == STARPU_CPU_RAM)
+			starpu_data_evict_from_node(disk_handle, node);
+}
+
+static void _disk_write_done(starpu_mpi_checkpoint_template_t cp_template)
+{
+	STARPU_PTHREAD_MUTEX_LOCK(&cp_template->mutex);
+	if (--cp_template->disk_pending == 0)
+	{
+		cp_template->disk_instance[cp_template->disk_slot] = cp_template->disk_writing_instance;
+		cp_template->disk_slot = -1;
+		_disk_meta_write(cp_template);
+		_STARPU_MPI_DEBUG(0, "Disk checkpoint %d instance %d complete\n", cp_template->cp_id, cp_template->disk_writing_instance);
+		STARPU_PTHREAD_COND_BROADCAST(&cp_template->disk_cond);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&cp_template->mutex);
+}
+
+static void _disk_written_cb(void *_arg)
+{
+	struct _starpu_mpi_checkpoint_disk_arg *arg = (struct _starpu_mpi_checkpoint_disk_arg *) _arg;
+	starpu_mpi_checkpoint_template_t cp_template = arg->cp_template;
+
+	starpu_data_release_on_node(arg->disk_handle, _disk_node);
+	_disk_evict(arg->disk_handle);
+	if (arg->value_handle)
+	{
+		free((void *) starpu_data_handle_to_pointer(arg->value_handle, STARPU_MAIN_RAM));
+		starpu_data_unregister_submit(arg->value_handle);
+	}
+	free(arg);
+	_disk_write_done(cp_template);
+}
+
+void _starpu_mpi_checkpoint_disk_submit(starpu_mpi_checkpoint_template_t cp_template, int instance)
+{
+	struct _starpu_mpi_checkpoint_template_item *item;
+	int slot;
+
+	if (_disk_node < 0)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&cp_template->mutex);
+	if (cp_template->disk_slot != -1)
+		/* The previous checkpoint is still being written, supersede
+		 * it, so as to keep the complete one in the other slot */
+		slot = cp_template->disk_slot;
+	else
+	{
+		slot = cp_template->disk_instance[0] <= cp_template->disk_instance[1] ? 0 : 1;
+		cp_template->disk_instance[slot] = -1;
+		cp_template->disk_slot = slot;
+		_disk_meta_write(cp_template);
+	}
+	cp_template->disk_writing_instance = instance;
+	cp_template->disk_pending++;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&cp_template->mutex);
+
+	item = _starpu_mpi_checkpoint_template_get_first_data(cp_template);
+	while (item != _starpu_mpi_checkpoint_template_end(cp_template))
+	{
+		starpu_data_handle_t handle, disk_handle;
+		struct _starpu_mpi_checkpoint_disk_arg *arg;
+		starpu_mpi_tag_t tag;
+		size_t size;
+		int ret;
+
+		if (_disk_item_owned(item, &tag, &size))
+		{
+			disk_handle = _disk_item_open(cp_template->cp_id, item, tag, size, slot, 1);
+			if (!disk_handle)
+				STARPU_ABORT_MSG("Could not open the disk checkpoint file for the data with tag %ld in %s: %s\n", (long) tag, _disk_path, strerror(errno));
+
+			_STARPU_MALLOC(arg, sizeof(*arg));
+			arg->cp_template = cp_template;
+			arg->disk_handle = disk_handle;
+			arg->value_handle = NULL;
+			if (item->type == STARPU_VALUE)
+			{
+				/* The value is saved as it is now */
+				void *cpy_ptr;
+				_STARPU_MALLOC(cpy_ptr, item->count);
+				memcpy(cpy_ptr, item->ptr, item->count);
+				starpu_variable_data_register(&arg->value_handle, STARPU_MAIN_RAM, (uintptr_t) cpy_ptr, item->count);
+				handle = arg->value_handle;
+			}
+			else
+				handle = (starpu_data_handle_t) item->ptr;
+
+			STARPU_PTHREAD_MUTEX_LOCK(&cp_template->mutex);
+			cp_template->disk_pending++;
+			STARPU_PTHREAD_MUTEX_UNLOCK(&cp_template->mutex);
+
+			_STARPU_MPI_DEBUG(0, "Submit CP: writing data with tag %ld to disk slot %d\n", (long) tag, slot);
+			ret = starpu_task_insert(&_disk_write_cl,
+						 STARPU_R, handle,
+						 STARPU_W, disk_handle,
+						 STARPU_VALUE, &handle, sizeof(handle),
+						 STARPU_PRIORITY, STARPU_MIN_PRIO,
+						 0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+			/* This writes the packed data to the file */
+			starpu_data_acquire_on_node_cb(disk_handle, _disk_node, STARPU_R, _disk_written_cb, arg);
+		}
+		item = _starpu_mpi_checkpoint_template_get_next_data(cp_template, item);
+	}
+
+	_disk_write_done(cp_template);
+}
+
+int starpu_mpi_checkpoint_template_restore(starpu_mpi_checkpoint_template_t cp_template, int instance)
+{
+	struct _starpu_mpi_checkpoint_template_item *item;
+	int slot;
+
+	if (_disk_node < 0)
+		return -ENODEV;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&cp_template->mutex);
+	/* Let the checkpoints submitted by this run be available. This does
+	 * not delay any submission, the application is waiting for us */
+	while (cp_template->disk_slot != -1)
+		STARPU_PTHREAD_COND_WAIT(&cp_template->disk_cond, &cp_template->mutex);
+	_disk_meta_read(cp_template);
+	if (instance == -1)
+		slot = cp_template->disk_instance[0] >= cp_template->disk_instance[1] ? 0 : 1;
+	else if (cp_template->disk_instance[0] == instance)
+		slot = 0;
+	else if (cp_template->disk_instance[1] == instance)
+		slot = 1;
+	else
+		slot = -1;
+	if (slot == -1 || cp_template->disk_instance[slot] < 0)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&cp_template->mutex);
+		return -ENOENT;
+	}
+	instance = cp_template->disk_instance[slot];
+	STARPU_PTHREAD_MUTEX_UNLOCK(&cp_template->mutex);
+
+	/* Check that all the files are there before overwriting any data */
+	item = _starpu_mpi_checkpoint_template_get_first_data(cp_template);
+	while (item != _starpu_mpi_checkpoint_template_end(cp_template))
+	{
+		starpu_mpi_tag_t tag;
+		size_t size;
+
+		if (_disk_item_owned(item, &tag, &size) && (!_disk_item_check(cp_template->cp_id, tag, size, slot) || !_disk_item_open(cp_template->cp_id, item, tag, size, slot, 0)))
+		{
+			_STARPU_DISP("Warning: could not open the disk checkpoint file for the data with tag %ld in %s\n", (long) tag, _disk_path);
+			return -ENOENT;
+		}
+		item = _starpu_mpi_checkpoint_template_get_next_data(cp_template, item);
+	}
+
+	item = _starpu_mpi_checkpoint_template_get_first_data(cp_template);
+	while (item != _starpu_mpi_checkpoint_template_end(cp_template))
+	{
+		starpu_data_handle_t handle, disk_handle;
+		starpu_mpi_tag_t tag;
+		size_t size;
+		void *ptr;
+
+		if (_disk_item_owned(item, &tag, &size))
+		{
+			disk_handle = item->disk_handle[slot];
+			starpu_data_acquire_on_node(disk_handle, STARPU_MAIN_RAM, STARPU_R);
+			ptr = (void *) STARPU_VECTOR_GET_PTR(starpu_data_get_interface_on_node(disk_handle, STARPU_MAIN_RAM));
+			if (item->type == STARPU_VALUE)
+				memcpy(item->ptr, ptr, item->count);
+			else
+			{
+				handle = (starpu_data_handle_t) item->ptr;
+				starpu_data_acquire_on_node(handle, STARPU_MAIN_RAM, STARPU_W);
+				starpu_data_peek_node(handle, STARPU_MAIN_RAM, ptr, size);
+				starpu_data_release_on_node(handle, STARPU_MAIN_RAM);
+			}
+			starpu_data_release_on_node(disk_handle, STARPU_MAIN_RAM);
+			_disk_evict(disk_handle);
+		}
+
+		if (item->type == STARPU_R)
+		{
+			/* The owner and the backup both tell that the data has to
+			 * be sent again at the next checkpoint */
+			_starpu_mpi_data_get((starpu_data_handle_t) item->ptr)->modified = 1;
+		}
+		item = _starpu_mpi_checkpoint_template_get_next_data(cp_template, item);
+	}
+
+	/* Let the next checkpoints have bigger instance numbers */
+	set_current_instance_at_least(instance);
+	_STARPU_MPI_DEBUG(0, "Restored disk checkpoint %d instance %d\n", cp_template->cp_id, instance);
+	return instance;
+}
+
+void _starpu_mpi_checkpoint_disk_shutdown(void)
+{
+	int i, slot;
+
+	if (_disk_node < 0)
+		return;
+
+	for (i = 0; i < MAX_CP_TEMPLATE_NUMBER && cp_template_array[i]; i++)
+	{
+		starpu_mpi_checkpoint_template_t cp_template = cp_template_array[i];
+		struct _starpu_mpi_checkpoint_template_item *item;
+
+		/* The callbacks of the writes refer to the template */
+		STARPU_PTHREAD_MUTEX_LOCK(&cp_template->mutex);
+		while (cp_template->disk_slot != -1)
+			STARPU_PTHREAD_COND_WAIT(&cp_template->disk_cond, &cp_template->mutex);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&cp_template->mutex);
+
+		item = _starpu_mpi_checkpoint_template_get_first_data(cp_template);
+		while (item != _starpu_mpi_checkpoint_template_end(cp_template))
+		{
+			for (slot = 0; slot < 2; slot++)
+			{
+				if (item->disk_handle[slot])
+				{
+					starpu_data_unregister(item->disk_handle[slot]);
+					starpu_disk_close(_disk_node, item->disk_obj[slot], item->disk_size);
+					item->disk_handle[slot] = NULL;
+				}
+			}
+			item = _starpu_mpi_checkpoint_template_get_next_data(cp_template, item);
+		}
+	}
+
+	free(_disk_path);
+	_disk_path = NULL;
+	_disk_node = -1;
+}
@@ -0,0 +1,43 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef _STARPU_MPI_CHECKPOINT_DISK_H
+#define _STARPU_MPI_CHECKPOINT_DISK_H
+
+#include <starpu_mpi.h>
+#include <starpu_mpi_private.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Register the disk node given by STARPU_MPI_CHECKPOINT_DISK, if any */
+void _starpu_mpi_checkpoint_disk_init(void);
+/** Wait for the pending disk checkpoints, and close their files */
+void _starpu_mpi_checkpoint_disk_shutdown(void);
+
+/** Submit the tasks writing to the local disk the data of cp_template owned
+ * by this node, for the checkpoint instance. The data are written in
+ * the slot which does not hold the last complete checkpoint, which stays
+ * valid until they are all written. */
+void _starpu_mpi_checkpoint_disk_submit(starpu_mpi_checkpoint_template_t cp_template, int instance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //_STARPU_MPI_CHECKPOINT_DISK_H
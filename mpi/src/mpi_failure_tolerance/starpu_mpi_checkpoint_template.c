@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2013-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2013-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -55,6 +55,14 @@ int get_current_instance()
 	return _inst;
 }
 
+void set_current_instance_at_least(int instance)
+{
+	STARPU_PTHREAD_MUTEX_LOCK(&current_instance_mutex);
+	if (current_instance < instance)
+		current_instance = instance;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&current_instance_mutex);
+}
+
 void checkpoint_template_lib_init(void)
 {
 	STARPU_PTHREAD_MUTEX_INIT(&current_instance_mutex, NULL);
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2013-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2013-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -39,6 +39,7 @@ extern starpu_mpi_checkpoint_template_t cp_template_array[MAX_CP_TEMPLATE_NUMBER
 
 int increment_current_instance();
 int get_current_instance();
+void set_current_instance_at_least(int instance);
 
 void checkpoint_template_lib_init(void);
 
@@ -69,6 +70,18 @@ LIST_TYPE(_starpu_mpi_checkpoint_template_item,
 	int              backupped_by;
 	int              backup_of;
 	starpu_mpi_tag_t tag;
+	/** For STARPU_R data, on the owner, whether the data was already
+	  * checkpointed and its write version then. On the backup node, the
+	  * copy of the latest checkpoint, and its instance */
+	int                  checkpointed;
+	unsigned long        write_version;
+	starpu_data_handle_t copy_handle;
+	int                  copy_instance;
+	/** For the data owned by this node, the handles and the objects of the
+	  * two slots of the local disk checkpoints */
+	starpu_data_handle_t disk_handle[2];
+	void                 *disk_obj[2];
+	size_t               disk_size;
 )
 
 struct _starpu_mpi_checkpoint_template
@@ -86,7 +99,14 @@ struct _starpu_mpi_checkpoint_template
 	int                                              *backupped_by_array;
 	int                                              backupped_by_array_max_size;
 	int                                              backupped_by_array_used_size;
-
+	/** Local disk checkpoints: the instance stored in each slot (-1 if none),
+	  * the slot being written (-1 if none), the latest instance being
+	  * written there, and the number of data still to be written */
+	int                                              disk_instance[2];
+	int                                              disk_slot;
+	int                                              disk_writing_instance;
+	int                                              disk_pending;
+	starpu_pthread_cond_t                            disk_cond;
 };
 
 static inline int checkpoint_template_array_realloc(int** array, int* max_size, int growth_factor)
@@ -137,7 +157,11 @@ static inline starpu_mpi_checkpoint_template_t _starpu_mpi_checkpoint_template_n
 	_STARPU_MPI_MALLOC(_cp_template->backupped_by_array, _CHECKPOINT_TEMPLATE_BACKUPED_RANK_ARRAY_DEFAULT_SIZE);
 	_cp_template->backupped_by_array[0] = -1;
 	_cp_template->backupped_by_array_used_size = 0;
+	_cp_template->disk_instance[0] = -1;
+	_cp_template->disk_instance[1] = -1;
+	_cp_template->disk_slot = -1;
 	STARPU_PTHREAD_MUTEX_INIT(&_cp_template->mutex, NULL);
+	STARPU_PTHREAD_COND_INIT(&_cp_template->disk_cond, NULL);
 	return _cp_template;
 }
 
@@ -211,11 +235,14 @@ static inline int _starpu_checkpoint_template_free(starpu_mpi_checkpoint_templat
 	while (item != _starpu_mpi_checkpoint_template_end(cp_template))
 	{
 		next_item = _starpu_mpi_checkpoint_template_get_next_data(cp_template, item);
+		if (item->copy_handle)
+			starpu_data_unregister_submit(item->copy_handle);
 		free(item);
 		item = next_item;
 	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&cp_template->mutex);
 	STARPU_PTHREAD_MUTEX_DESTROY(&cp_template->mutex);
+	STARPU_PTHREAD_COND_DESTROY(&cp_template->disk_cond);
 	free(cp_template);
 	return 0;
 }
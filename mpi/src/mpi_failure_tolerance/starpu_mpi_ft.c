@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2013-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2013-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -17,26 +17,39 @@
 #include <starpu_mpi_private.h>
 #include <mpi_failure_tolerance/starpu_mpi_checkpoint_template.h>
 #include <mpi_failure_tolerance/starpu_mpi_checkpoint_package.h>
+#include <mpi_failure_tolerance/starpu_mpi_checkpoint_disk.h>
 #include <mpi_failure_tolerance/starpu_mpi_ft_service_comms.h>
 #include <mpi_failure_tolerance/starpu_mpi_ft_stats.h>
 
 starpu_pthread_mutex_t           ft_mutex;
 int                              _my_rank;
+MPI_Comm                         _starpu_mpi_cp_version_comm;
+MPI_Comm                         _starpu_mpi_cp_data_comm;
 
 int starpu_mpi_checkpoint_init(void)
 {
 	STARPU_PTHREAD_MUTEX_INIT(&ft_mutex, NULL);
 	starpu_mpi_comm_rank(MPI_COMM_WORLD, &_my_rank); //TODO: check compatibility with several Comms behaviour
+	/* The backup nodes post the receives of the data once they know
+	 * whether it has changed, their messages must thus not be matched with
+	 * the ones of the application. The communicators stay registered to
+	 * StarPU-MPI until its shutdown. */
+	MPI_Comm_dup(MPI_COMM_WORLD, &_starpu_mpi_cp_version_comm);
+	starpu_mpi_comm_register(_starpu_mpi_cp_version_comm);
+	MPI_Comm_dup(MPI_COMM_WORLD, &_starpu_mpi_cp_data_comm);
+	starpu_mpi_comm_register(_starpu_mpi_cp_data_comm);
 	starpu_mpi_ft_service_lib_init(_ack_msg_recv_cb, _cp_discard_message_recv_cb);
 	checkpoint_template_lib_init();
 	_starpu_mpi_checkpoint_tracker_init();
 	checkpoint_package_init();
+	_starpu_mpi_checkpoint_disk_init();
 	_STARPU_MPI_FT_STATS_INIT();
 	return 0;
 }
 
 int starpu_mpi_checkpoint_shutdown(void)
 {
+	_starpu_mpi_checkpoint_disk_shutdown();
 	checkpoint_template_lib_quit();
 	checkpoint_package_shutdown();
 	_starpu_mpi_checkpoint_tracker_shutdown();
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2013-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2013-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -30,6 +30,11 @@ size_t cp_data_msgs_received_cached_total_size;
 int cp_data_msgs_received_cp_cached_count;
 size_t cp_data_msgs_received_cp_cached_total_size;
 
+int cp_data_msgs_sent_unchanged_count;
+size_t cp_data_msgs_sent_unchanged_total_size;
+int cp_data_msgs_received_unchanged_count;
+size_t cp_data_msgs_received_unchanged_total_size;
+
 int ft_service_msgs_sent_count;
 size_t ft_service_msgs_sent_total_size;
 int ft_service_msgs_received_count;
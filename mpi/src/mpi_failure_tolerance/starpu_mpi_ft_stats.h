@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2013-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2013-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -41,6 +41,11 @@ extern size_t cp_data_msgs_received_cached_total_size;
 extern int cp_data_msgs_received_cp_cached_count;
 extern size_t cp_data_msgs_received_cp_cached_total_size;
 
+extern int cp_data_msgs_sent_unchanged_count;
+extern size_t cp_data_msgs_sent_unchanged_total_size;
+extern int cp_data_msgs_received_unchanged_count;
+extern size_t cp_data_msgs_received_unchanged_total_size;
+
 extern int ft_service_msgs_sent_count;
 extern size_t ft_service_msgs_sent_total_size;
 extern int ft_service_msgs_received_count;
@@ -58,6 +63,8 @@ static inline void _starpu_ft_stats_send_data_cached(size_t size);;
 static inline void _starpu_ft_stats_recv_data(size_t size);
 static inline void _starpu_ft_stats_recv_data_cached(size_t size);
 static inline void _starpu_ft_stats_recv_data_cp_cached(size_t size);
+static inline void _starpu_ft_stats_send_data_unchanged(size_t size);
+static inline void _starpu_ft_stats_recv_data_unchanged(size_t size);
 static inline void _starpu_ft_stats_service_msg_send(size_t size);
 static inline void _starpu_ft_stats_service_msg_recv(size_t size);
 static inline void _starpu_ft_stats_add_cp_data_in_memory(size_t size);
@@ -74,6 +81,8 @@ static inline void _starpu_ft_stats_free_cp_data_in_memory(size_t size);
 #define _STARPU_MPI_FT_STATS_CANCEL_RECV_CP_DATA(size) do{ _starpu_ft_stats_cancel_recv_data(size); }while(0)
 #define _STARPU_MPI_FT_STATS_RECV_CACHED_CP_DATA(size) do{ _starpu_ft_stats_recv_data_cached(size); }while(0)
 #define _STARPU_MPI_FT_STATS_RECV_CP_CACHED_CP_DATA(size) do{ _starpu_ft_stats_recv_data_cp_cached(size); }while(0)
+#define _STARPU_MPI_FT_STATS_SEND_UNCHANGED_CP_DATA(size) do{ _starpu_ft_stats_send_data_unchanged(size); }while(0)
+#define _STARPU_MPI_FT_STATS_RECV_UNCHANGED_CP_DATA(size) do{ _starpu_ft_stats_recv_data_unchanged(size); }while(0)
 #define _STARPU_MPI_FT_STATS_SEND_FT_SERVICE_MSG(size) do{ _starpu_ft_stats_service_msg_send(size); }while(0)
 #define _STARPU_MPI_FT_STATS_RECV_FT_SERVICE_MSG(size) do{ _starpu_ft_stats_service_msg_recv(size); }while(0)
 #define _STARPU_MPI_FT_STATS_STORE_CP_DATA(size) do{ _starpu_ft_stats_add_cp_data_in_memory(size); }while(0)
@@ -90,6 +99,8 @@ static inline void _starpu_ft_stats_free_cp_data_in_memory(size_t size);
 #define _STARPU_MPI_FT_STATS_CANCEL_RECV_CP_DATA(size) do{}while(0)
 #define _STARPU_MPI_FT_STATS_RECV_CACHED_CP_DATA(size) do{}while(0)
 #define _STARPU_MPI_FT_STATS_RECV_CP_CACHED_CP_DATA(size) do{}while(0)
+#define _STARPU_MPI_FT_STATS_SEND_UNCHANGED_CP_DATA(size) do{}while(0)
+#define _STARPU_MPI_FT_STATS_RECV_UNCHANGED_CP_DATA(size) do{}while(0)
 #define _STARPU_MPI_FT_STATS_SEND_FT_SERVICE_MSG(size) do{}while(0)
 #define _STARPU_MPI_FT_STATS_RECV_FT_SERVICE_MSG(size) do{}while(0)
 #define _STARPU_MPI_FT_STATS_STORE_CP_DATA(size) do{}while(0)
@@ -117,6 +128,11 @@ static inline void stat_init()
 	cp_data_msgs_received_cp_cached_count = 0;
 	cp_data_msgs_received_cp_cached_total_size = 0;
 
+	cp_data_msgs_sent_unchanged_count = 0;
+	cp_data_msgs_sent_unchanged_total_size = 0;
+	cp_data_msgs_received_unchanged_count = 0;
+	cp_data_msgs_received_unchanged_total_size = 0;
+
 	ft_service_msgs_sent_count = 0;
 	ft_service_msgs_sent_total_size = 0;
 	ft_service_msgs_received_count = 0;
@@ -189,6 +205,24 @@ static inline void _starpu_ft_stats_recv_data_cp_cached(size_t size)
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_ft_stats_mutex);
 }
 
+static inline void _starpu_ft_stats_send_data_unchanged(size_t size)
+{
+	STARPU_ASSERT_MSG((int)size != -1, "Cannot count a data of size -1. An error has occured.\n");
+	STARPU_PTHREAD_MUTEX_LOCK(&_ft_stats_mutex);
+	cp_data_msgs_sent_unchanged_count++;
+	cp_data_msgs_sent_unchanged_total_size+=size;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_ft_stats_mutex);
+}
+
+static inline void _starpu_ft_stats_recv_data_unchanged(size_t size)
+{
+	STARPU_ASSERT_MSG((int)size != -1, "Cannot count a data of size -1. An error has occured.\n");
+	STARPU_PTHREAD_MUTEX_LOCK(&_ft_stats_mutex);
+	cp_data_msgs_received_unchanged_count++;
+	cp_data_msgs_received_unchanged_total_size+=size;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_ft_stats_mutex);
+}
+
 static inline void _starpu_ft_stats_service_msg_send(size_t size)
 {
 	STARPU_ASSERT_MSG((int)size != -1, "Cannot count a data of size -1. An error has occured.\n");
@@ -254,12 +288,12 @@ static inline void _ft_stats_free_cp_data_in_memory_list()
 static inline void _starpu_ft_stats_write_to_fd(FILE* fd)
 {
 	// HEADER
-	fprintf(fd, "TYPE\tCP_DATA_NORMAL_COUNT\tCP_DATA_NORMAL_TOTAL_SIZE\tCP_DATA_CACHED_COUNT\tCP_DATA_CACHED_SIZE\tFT_SERVICE_MSGS_COUNT\tFT_SERVICE_MSGS_TOTAL_SIZE\n");
+	fprintf(fd, "TYPE\tCP_DATA_NORMAL_COUNT\tCP_DATA_NORMAL_TOTAL_SIZE\tCP_DATA_CACHED_COUNT\tCP_DATA_CACHED_SIZE\tCP_DATA_UNCHANGED_COUNT\tCP_DATA_UNCHANGED_SIZE\tFT_SERVICE_MSGS_COUNT\tFT_SERVICE_MSGS_TOTAL_SIZE\n");
 	// DATA
-	fprintf(fd, "SEND\t%d\t"                 "%ld\t"                    "%d\t"               "%ld\t"               "%d\t"                 "%ld\n",
-	        cp_data_msgs_sent_count, cp_data_msgs_sent_total_size, cp_data_msgs_sent_cached_count, cp_data_msgs_sent_cached_total_size, ft_service_msgs_sent_count, ft_service_msgs_sent_total_size);
-	fprintf(fd, "RECV\t%d\t"                 "%ld\t"                    "%d\t"               "%ld\t"               "%d\t"                 "%ld\n",
-	        cp_data_msgs_received_count, cp_data_msgs_received_total_size, cp_data_msgs_received_cached_count, cp_data_msgs_received_cached_total_size+cp_data_msgs_received_cp_cached_total_size, ft_service_msgs_received_count, ft_service_msgs_received_total_size);
+	fprintf(fd, "SEND\t%d\t"                 "%ld\t"                    "%d\t"               "%ld\t"               "%d\t"                  "%ld\t"                  "%d\t"                 "%ld\n",
+	        cp_data_msgs_sent_count, cp_data_msgs_sent_total_size, cp_data_msgs_sent_cached_count, cp_data_msgs_sent_cached_total_size, cp_data_msgs_sent_unchanged_count, cp_data_msgs_sent_unchanged_total_size, ft_service_msgs_sent_count, ft_service_msgs_sent_total_size);
+	fprintf(fd, "RECV\t%d\t"                 "%ld\t"                    "%d\t"               "%ld\t"               "%d\t"                  "%ld\t"                  "%d\t"                 "%ld\n",
+	        cp_data_msgs_received_count, cp_data_msgs_received_total_size, cp_data_msgs_received_cached_count, cp_data_msgs_received_cached_total_size+cp_data_msgs_received_cp_cached_total_size, cp_data_msgs_received_unchanged_count, cp_data_msgs_received_unchanged_total_size, ft_service_msgs_received_count, ft_service_msgs_received_total_size);
 	fprintf(fd, "\n");
 	fprintf(fd, "IN_MEM_CP_DATA_TOTAL:%lu\n", cp_data_in_memory_size_total);
 	fprintf(fd, "\n");
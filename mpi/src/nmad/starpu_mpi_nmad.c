@@ -601,6 +601,7 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	_starpu_mpi_comm_amounts_init(argc_argv->comm);
 	_starpu_mpi_cache_init(argc_argv->comm);
 	_starpu_mpi_select_node_init();
+	_starpu_mpi_collective_init();
 	_starpu_mpi_datatype_init();
 
 #ifdef STARPU_USE_FXT
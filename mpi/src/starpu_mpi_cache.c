@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2011-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2011-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -16,6 +16,7 @@
 
 #include <starpu.h>
 #include <common/uthash.h>
+#include <common/list.h>
 #include <datawizard/coherency.h>
 
 #include <starpu_mpi_cache.h>
@@ -28,15 +29,79 @@ struct _starpu_data_entry
 {
 	UT_hash_handle hh;
 	starpu_data_handle_t data_handle;
+	/** With STARPU_MPI_CACHE_AUTO, the entries are also hashed by tag, to
+	 * find the data the other nodes ask us about */
+	UT_hash_handle hh_tag;
+	starpu_mpi_tag_t data_tag;
+	unsigned tag_hashed;
 };
 
+/* When STARPU_MPI_CACHE_MAX_SIZE is set, the copies received from each node,
+ * and the copies sent to each node, are kept in LRU lists, whose total size
+ * is limited. The sender and the receiver of the copies see the same
+ * sequence of cache accesses for them, in the same order, and thus take the
+ * same eviction decisions without having to exchange messages: the receiver
+ * drops its copy once the tasks already submitted on it are over, and the
+ * sender will send the data again when it is needed again. */
+LIST_TYPE(_starpu_mpi_cache_lru,
+	starpu_data_handle_t data_handle;
+	/** The node which sent us the data, or to which we sent it */
+	int peer;
+	size_t size;
+);
+
 static starpu_pthread_mutex_t _cache_mutex;
 static struct _starpu_data_entry *_cache_data = NULL;
 int _starpu_cache_enabled=1;
 static MPI_Comm _starpu_cache_comm;
 static int _starpu_cache_comm_size;
 
+/* Maximum size of the copies exchanged with each node, 0 for no limit */
+static size_t _cache_max_size;
+/* LRU lists and their total sizes, for each node */
+static struct _starpu_mpi_cache_lru_list *_cache_lru_received;
+static size_t *_cache_lru_received_size;
+static struct _starpu_mpi_cache_lru_list *_cache_lru_sent;
+static size_t *_cache_lru_sent_size;
+
+/* When STARPU_MPI_CACHE_AUTO is set, the copies received from a node are
+ * dropped once the tasks which read them are over, if the owner agrees. The
+ * receiver and the owner count the cache accesses for the data they exchange,
+ * the receiver tells the count along its request, and the owner agrees only
+ * if it has not accessed the cache for the receiver since then, i.e. if it
+ * would still send the data again on the next access. The receiver does not
+ * access the cache for the data of the owner until the owner has answered, so
+ * that both drop the copy at the same point of their sequence of accesses,
+ * which keeps the LRU lists of STARPU_MPI_CACHE_MAX_SIZE consistent too. */
+LIST_TYPE(_starpu_mpi_cache_release,
+	/* NULL once the data is unregistered */
+	starpu_data_handle_t data_handle;
+	starpu_mpi_tag_t data_tag;
+	int owner;
+);
+
+struct _starpu_mpi_cache_readers
+{
+	void (*epilogue_callback_func)(void *);
+	void *epilogue_callback_arg;
+	unsigned epilogue_callback_arg_free;
+	unsigned n;
+	starpu_data_handle_t data_handles[];
+};
+
+static int _cache_auto;
+static struct _starpu_data_entry *_cache_data_tags = NULL;
+/* Number of cache accesses for the data received from, or sent to, each node */
+static unsigned long *_cache_received_accesses;
+static unsigned long *_cache_sent_accesses;
+/* Release requests waiting for an answer, and their number for each node */
+static struct _starpu_mpi_cache_release_list _cache_releases;
+static unsigned *_cache_releasing;
+static starpu_pthread_cond_t _cache_releasing_cond;
+
 static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle);
+static void _starpu_mpi_cache_data_remove_nolock(starpu_data_handle_t data_handle);
+static void _starpu_mpi_cache_data_entry_delete_nolock(struct _starpu_data_entry *entry);
 
 int starpu_mpi_cache_is_enabled()
 {
@@ -80,6 +145,51 @@ void _starpu_mpi_cache_init(MPI_Comm comm)
 	starpu_mpi_comm_size(comm, &_starpu_cache_comm_size);
 	_starpu_mpi_cache_stats_init();
 	STARPU_PTHREAD_MUTEX_INIT(&_cache_mutex, NULL);
+
+	_cache_max_size = (size_t) starpu_getenv_number_default("STARPU_MPI_CACHE_MAX_SIZE", 0) * 1024 * 1024;
+	if (_cache_max_size)
+	{
+		int i;
+		_STARPU_MPI_MALLOC(_cache_lru_received, _starpu_cache_comm_size * sizeof(*_cache_lru_received));
+		_STARPU_MPI_CALLOC(_cache_lru_received_size, _starpu_cache_comm_size, sizeof(*_cache_lru_received_size));
+		_STARPU_MPI_MALLOC(_cache_lru_sent, _starpu_cache_comm_size * sizeof(*_cache_lru_sent));
+		_STARPU_MPI_CALLOC(_cache_lru_sent_size, _starpu_cache_comm_size, sizeof(*_cache_lru_sent_size));
+		for (i = 0; i < _starpu_cache_comm_size; i++)
+		{
+			_starpu_mpi_cache_lru_list_init(&_cache_lru_received[i]);
+			_starpu_mpi_cache_lru_list_init(&_cache_lru_sent[i]);
+		}
+	}
+
+	_cache_auto = starpu_getenv_number_default("STARPU_MPI_CACHE_AUTO", 0);
+	if (_cache_auto && !_mpi_backend._starpu_mpi_backend_cache_release)
+	{
+		_STARPU_DISP("Warning: STARPU_MPI_CACHE_AUTO is not supported by this MPI backend, it is ignored\n");
+		_cache_auto = 0;
+	}
+	if (_cache_auto)
+	{
+		_STARPU_MPI_CALLOC(_cache_received_accesses, _starpu_cache_comm_size, sizeof(*_cache_received_accesses));
+		_STARPU_MPI_CALLOC(_cache_sent_accesses, _starpu_cache_comm_size, sizeof(*_cache_sent_accesses));
+		_STARPU_MPI_CALLOC(_cache_releasing, _starpu_cache_comm_size, sizeof(*_cache_releasing));
+		_starpu_mpi_cache_release_list_init(&_cache_releases);
+		STARPU_PTHREAD_COND_INIT(&_cache_releasing_cond, NULL);
+	}
+}
+
+int _starpu_mpi_cache_auto_enabled(void)
+{
+	return _starpu_cache_enabled == 1 && _cache_auto;
+}
+
+static void _starpu_mpi_cache_lru_shutdown(struct _starpu_mpi_cache_lru_list *lru)
+{
+	int i;
+
+	for (i = 0; i < _starpu_cache_comm_size; i++)
+		while (!_starpu_mpi_cache_lru_list_empty(&lru[i]))
+			_starpu_mpi_cache_lru_delete(_starpu_mpi_cache_lru_list_pop_front(&lru[i]));
+	free(lru);
 }
 
 void _starpu_mpi_cache_shutdown()
@@ -92,14 +202,130 @@ void _starpu_mpi_cache_shutdown()
 	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
 	HASH_ITER(hh, _cache_data, entry, tmp)
 	{
-		HASH_DEL(_cache_data, entry);
-		free(entry);
+		_starpu_mpi_cache_data_entry_delete_nolock(entry);
+	}
+	if (_cache_auto)
+	{
+		STARPU_ASSERT(_starpu_mpi_cache_release_list_empty(&_cache_releases));
+		free(_cache_received_accesses);
+		free(_cache_sent_accesses);
+		free(_cache_releasing);
+		STARPU_PTHREAD_COND_DESTROY(&_cache_releasing_cond);
+		_cache_auto = 0;
+	}
+	if (_cache_max_size)
+	{
+		_starpu_mpi_cache_lru_shutdown(_cache_lru_received);
+		_starpu_mpi_cache_lru_shutdown(_cache_lru_sent);
+		free(_cache_lru_received_size);
+		free(_cache_lru_sent_size);
+		_cache_lru_received = NULL;
+		_cache_lru_sent = NULL;
+		_cache_max_size = 0;
 	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	STARPU_PTHREAD_MUTEX_DESTROY(&_cache_mutex);
 	_starpu_mpi_cache_stats_shutdown();
 }
 
+/* Note an access to the copy tracked by *entry, exchanged with the node
+ * peer, and return whether the cache size is now over the limit */
+static int _starpu_mpi_cache_lru_access(struct _starpu_mpi_cache_lru_list *lru, size_t *lru_size, struct _starpu_mpi_cache_lru **entry, starpu_data_handle_t data_handle, int peer)
+{
+	if (*entry)
+	{
+		/* Most recently used */
+		_starpu_mpi_cache_lru_list_erase(&lru[(*entry)->peer], *entry);
+		_starpu_mpi_cache_lru_list_push_front(&lru[(*entry)->peer], *entry);
+		return 0;
+	}
+
+	*entry = _starpu_mpi_cache_lru_new();
+	(*entry)->data_handle = data_handle;
+	(*entry)->peer = peer;
+	(*entry)->size = starpu_data_get_size(data_handle);
+	_starpu_mpi_cache_lru_list_push_front(&lru[peer], *entry);
+	lru_size[peer] += (*entry)->size;
+	return lru_size[peer] > _cache_max_size;
+}
+
+static void _starpu_mpi_cache_lru_remove(struct _starpu_mpi_cache_lru_list *lru, size_t *lru_size, struct _starpu_mpi_cache_lru **entry)
+{
+	if (!*entry)
+		return;
+	_starpu_mpi_cache_lru_list_erase(&lru[(*entry)->peer], *entry);
+	lru_size[(*entry)->peer] -= (*entry)->size;
+	_starpu_mpi_cache_lru_delete(*entry);
+	*entry = NULL;
+}
+
+/* Drop the copy of the data received from peer */
+static void _starpu_mpi_cache_received_drop_nolock(starpu_data_handle_t data_handle, int peer)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+
+	_STARPU_MPI_DEBUG(2, "Evicting data %p received from %d from the cache\n", data_handle, peer);
+	if (_cache_max_size)
+		_starpu_mpi_cache_lru_remove(_cache_lru_received, _cache_lru_received_size, &mpi_data->cache_received_lru);
+	mpi_data->cache_received = 0;
+	mpi_data->ft_induced_cache_received = 0;
+	mpi_data->ft_induced_cache_received_count = 0;
+	/* This is ordered after the tasks already submitted which read the data */
+	starpu_data_invalidate_submit(data_handle);
+	if (!mpi_data->nb_cache_sent)
+		_starpu_mpi_cache_data_remove_nolock(data_handle);
+	_starpu_mpi_cache_stats_dec(peer, data_handle);
+	_starpu_mpi_cache_stats_evict(0, data_handle);
+}
+
+/* Forget about the copy of the data sent to peer, just like peer drops it */
+static void _starpu_mpi_cache_sent_drop_nolock(starpu_data_handle_t data_handle, int peer)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+
+	_STARPU_MPI_DEBUG(2, "Evicting data %p sent to %d from the cache\n", data_handle, peer);
+	if (_cache_max_size)
+		_starpu_mpi_cache_lru_remove(_cache_lru_sent, _cache_lru_sent_size, &mpi_data->cache_sent_lru[peer]);
+	mpi_data->cache_sent[peer] = 0;
+	mpi_data->nb_cache_sent--;
+	if (!mpi_data->nb_cache_sent && !mpi_data->cache_received)
+		_starpu_mpi_cache_data_remove_nolock(data_handle);
+	_starpu_mpi_cache_stats_evict(1, data_handle);
+}
+
+/* Drop the least recently used copies received from peer, but the one which
+ * was just received, until the size is below the limit. */
+static void _starpu_mpi_cache_received_evict_nolock(int peer)
+{
+	struct _starpu_mpi_cache_lru_list *lru = &_cache_lru_received[peer];
+
+	while (_cache_lru_received_size[peer] > _cache_max_size && _starpu_mpi_cache_lru_list_back(lru) != _starpu_mpi_cache_lru_list_front(lru))
+		_starpu_mpi_cache_received_drop_nolock(_starpu_mpi_cache_lru_list_back(lru)->data_handle, peer);
+}
+
+/* Forget about the least recently used copies sent to peer, just like peer
+ * drops them */
+static void _starpu_mpi_cache_sent_evict_nolock(int peer)
+{
+	struct _starpu_mpi_cache_lru_list *lru = &_cache_lru_sent[peer];
+
+	while (_cache_lru_sent_size[peer] > _cache_max_size && _starpu_mpi_cache_lru_list_back(lru) != _starpu_mpi_cache_lru_list_front(lru))
+		_starpu_mpi_cache_sent_drop_nolock(_starpu_mpi_cache_lru_list_back(lru)->data_handle, peer);
+}
+
+/* The data is being unregistered while the owner was asked whether its copy
+ * can be dropped, the answer will only concern the owner */
+static void _starpu_mpi_cache_release_forget_nolock(starpu_data_handle_t data_handle)
+{
+	struct _starpu_mpi_cache_release *release;
+
+	for (release = _starpu_mpi_cache_release_list_begin(&_cache_releases);
+	     release != _starpu_mpi_cache_release_list_end(&_cache_releases);
+	     release = _starpu_mpi_cache_release_list_next(release))
+		if (release->data_handle == data_handle)
+			release->data_handle = NULL;
+}
+
 void _starpu_mpi_cache_data_clear(starpu_data_handle_t data_handle)
 {
 	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
@@ -108,17 +334,19 @@ void _starpu_mpi_cache_data_clear(starpu_data_handle_t data_handle)
 	{
 		struct _starpu_data_entry *entry;
 		STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+		if (mpi_data->cache_releasing)
+			_starpu_mpi_cache_release_forget_nolock(data_handle);
 		_starpu_mpi_cache_flush_nolock(data_handle);
 		HASH_FIND_PTR(_cache_data, &data_handle, entry);
 		if (entry != NULL)
 		{
-			HASH_DEL(_cache_data, entry);
-			free(entry);
+			_starpu_mpi_cache_data_entry_delete_nolock(entry);
 		}
 		STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	}
 
 	free(mpi_data->cache_sent);
+	free(mpi_data->cache_sent_lru);
 }
 
 void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle)
@@ -133,11 +361,17 @@ void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle)
 	mpi_data->cache_received = 0;
 	mpi_data->ft_induced_cache_received = 0;
 	mpi_data->ft_induced_cache_received_count = 0;
+	mpi_data->nb_cache_sent = 0;
+	mpi_data->cache_readers = 0;
+	mpi_data->cache_pinned = 0;
+	mpi_data->cache_releasing = 0;
 	_STARPU_MALLOC(mpi_data->cache_sent, _starpu_cache_comm_size*sizeof(mpi_data->cache_sent[0]));
 	for(i=0 ; i<_starpu_cache_comm_size ; i++)
 	{
 		mpi_data->cache_sent[i] = 0;
 	}
+	if (_cache_max_size)
+		_STARPU_CALLOC(mpi_data->cache_sent_lru, _starpu_cache_comm_size, sizeof(mpi_data->cache_sent_lru[0]));
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 }
 
@@ -154,9 +388,30 @@ static void _starpu_mpi_cache_data_add_nolock(starpu_data_handle_t data_handle)
 		_STARPU_MPI_MALLOC(entry, sizeof(*entry));
 		entry->data_handle = data_handle;
 		HASH_ADD_PTR(_cache_data, data_handle, entry);
+
+		entry->data_tag = starpu_mpi_data_get_tag(data_handle);
+		entry->tag_hashed = 0;
+		if (_cache_auto && entry->data_tag != -1)
+		{
+			struct _starpu_data_entry *old;
+			HASH_FIND(hh_tag, _cache_data_tags, &entry->data_tag, sizeof(entry->data_tag), old);
+			if (!old)
+			{
+				HASH_ADD(hh_tag, _cache_data_tags, data_tag, sizeof(entry->data_tag), entry);
+				entry->tag_hashed = 1;
+			}
+		}
 	}
 }
 
+static void _starpu_mpi_cache_data_entry_delete_nolock(struct _starpu_data_entry *entry)
+{
+	HASH_DEL(_cache_data, entry);
+	if (entry->tag_hashed)
+		HASH_DELETE(hh_tag, _cache_data_tags, entry);
+	free(entry);
+}
+
 static void _starpu_mpi_cache_data_remove_nolock(starpu_data_handle_t data_handle)
 {
 	struct _starpu_data_entry *entry;
@@ -167,8 +422,7 @@ static void _starpu_mpi_cache_data_remove_nolock(starpu_data_handle_t data_handl
 	HASH_FIND_PTR(_cache_data, &data_handle, entry);
 	if (entry)
 	{
-		HASH_DEL(_cache_data, entry);
-		free(entry);
+		_starpu_mpi_cache_data_entry_delete_nolock(entry);
 	}
 }
 
@@ -196,6 +450,8 @@ void starpu_mpi_cached_receive_clear(starpu_data_handle_t data_handle)
 		mpi_data->cache_received = 0;
 		mpi_data->ft_induced_cache_received = 0;
 		mpi_data->ft_induced_cache_received_count = 0;
+		if (_cache_max_size)
+			_starpu_mpi_cache_lru_remove(_cache_lru_received, _cache_lru_received_size, &mpi_data->cache_received_lru);
 		starpu_data_invalidate_submit(data_handle);
 		_starpu_mpi_cache_data_remove_nolock(data_handle);
 		_starpu_mpi_cache_stats_dec(mpi_rank, data_handle);
@@ -203,8 +459,30 @@ void starpu_mpi_cached_receive_clear(starpu_data_handle_t data_handle)
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 }
 
+/* With STARPU_MPI_CACHE_AUTO, wait for the owner to answer our release
+ * requests before accessing the cache for the data it owns */
+static void _starpu_mpi_cache_auto_wait_nolock(int mpi_rank)
+{
+	while (_cache_releasing[mpi_rank])
+		STARPU_PTHREAD_COND_WAIT(&_cache_releasing_cond, &_cache_mutex);
+}
 
-int starpu_mpi_cached_receive_set(starpu_data_handle_t data_handle)
+/* With STARPU_MPI_CACHE_AUTO, note an access to the received copy, by a task
+ * which will call _starpu_mpi_cache_reader_done() if reader is set, or
+ * outside tasks otherwise, in which case the copy is never released
+ * automatically */
+static void _starpu_mpi_cache_auto_received_nolock(struct _starpu_mpi_data *mpi_data, int already_received, int mpi_rank, int reader)
+{
+	_cache_received_accesses[mpi_rank]++;
+	if (!already_received)
+		mpi_data->cache_pinned = 0;
+	if (reader)
+		mpi_data->cache_readers++;
+	else
+		mpi_data->cache_pinned = 1;
+}
+
+static int _starpu_mpi_cached_receive_set(starpu_data_handle_t data_handle, int reader)
 {
 	int mpi_rank = starpu_mpi_data_get_rank(data_handle);
 	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
@@ -215,6 +493,8 @@ int starpu_mpi_cached_receive_set(starpu_data_handle_t data_handle)
 	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
 	STARPU_ASSERT(mpi_data->magic == 42);
 	STARPU_MPI_ASSERT_MSG(mpi_rank < _starpu_cache_comm_size, "Node %d invalid. Max node is %d\n", mpi_rank, _starpu_cache_comm_size);
+	if (_cache_auto)
+		_starpu_mpi_cache_auto_wait_nolock(mpi_rank);
 
 	int already_received = mpi_data->cache_received;
 	if (already_received == 0)
@@ -236,10 +516,25 @@ int starpu_mpi_cached_receive_set(starpu_data_handle_t data_handle)
 #endif //STARPU_USE_MPI_FT_STATS
 		_STARPU_MPI_DEBUG(2, "Do not receive data %p from node %d as it is already available\n", data_handle, mpi_rank);
 	}
+	_starpu_mpi_cache_stats_access(0, already_received);
+	if (_cache_auto)
+		_starpu_mpi_cache_auto_received_nolock(mpi_data, already_received, mpi_rank, reader);
+	if (_cache_max_size && _starpu_mpi_cache_lru_access(_cache_lru_received, _cache_lru_received_size, &mpi_data->cache_received_lru, data_handle, mpi_rank))
+		_starpu_mpi_cache_received_evict_nolock(mpi_rank);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	return already_received;
 }
 
+int starpu_mpi_cached_receive_set(starpu_data_handle_t data_handle)
+{
+	return _starpu_mpi_cached_receive_set(data_handle, 0);
+}
+
+int _starpu_mpi_cached_receive_set_reader(starpu_data_handle_t data_handle)
+{
+	return _starpu_mpi_cached_receive_set(data_handle, 1);
+}
+
 int starpu_mpi_cached_cp_receive_set(starpu_data_handle_t data_handle)
 {
 	int mpi_rank = starpu_mpi_data_get_rank(data_handle);
@@ -251,6 +546,8 @@ int starpu_mpi_cached_cp_receive_set(starpu_data_handle_t data_handle)
 	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
 	STARPU_ASSERT(mpi_data->magic == 42);
 	STARPU_MPI_ASSERT_MSG(mpi_rank < _starpu_cache_comm_size, "Node %d invalid. Max node is %d\n", mpi_rank, _starpu_cache_comm_size);
+	if (_cache_auto)
+		_starpu_mpi_cache_auto_wait_nolock(mpi_rank);
 
 	int already_received = mpi_data->cache_received;
 	if (already_received == 0)
@@ -274,6 +571,11 @@ int starpu_mpi_cached_cp_receive_set(starpu_data_handle_t data_handle)
 #endif
 		_STARPU_MPI_DEBUG(2, "Do not receive data %p from node %d as it is already available\n", data_handle, mpi_rank);
 	}
+	_starpu_mpi_cache_stats_access(0, already_received);
+	if (_cache_auto)
+		_starpu_mpi_cache_auto_received_nolock(mpi_data, already_received, mpi_rank, 0);
+	if (_cache_max_size && _starpu_mpi_cache_lru_access(_cache_lru_received, _cache_lru_received_size, &mpi_data->cache_received_lru, data_handle, mpi_rank))
+		_starpu_mpi_cache_received_evict_nolock(mpi_rank);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	return already_received;
 }
@@ -305,15 +607,21 @@ void starpu_mpi_cached_send_clear(starpu_data_handle_t data_handle)
 		return;
 
 	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
-	starpu_mpi_comm_size(mpi_data->node_tag.node.comm, &size);
-	for(n=0 ; n<size ; n++)
+	if (mpi_data->nb_cache_sent)
 	{
-		if (mpi_data->cache_sent[n] == 1)
+		starpu_mpi_comm_size(mpi_data->node_tag.node.comm, &size);
+		for(n=0 ; n<size ; n++)
 		{
-			_STARPU_MPI_DEBUG(2, "Clearing send cache for data %p\n", data_handle);
-			mpi_data->cache_sent[n] = 0;
-			_starpu_mpi_cache_data_remove_nolock(data_handle);
+			if (mpi_data->cache_sent[n] == 1)
+			{
+				_STARPU_MPI_DEBUG(2, "Clearing send cache for data %p\n", data_handle);
+				mpi_data->cache_sent[n] = 0;
+				if (_cache_max_size)
+					_starpu_mpi_cache_lru_remove(_cache_lru_sent, _cache_lru_sent_size, &mpi_data->cache_sent_lru[n]);
+				_starpu_mpi_cache_data_remove_nolock(data_handle);
+			}
 		}
+		mpi_data->nb_cache_sent = 0;
 	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 }
@@ -332,6 +640,7 @@ int starpu_mpi_cached_send_set(starpu_data_handle_t data_handle, int dest)
 	if (mpi_data->cache_sent[dest] == 0)
 	{
 		mpi_data->cache_sent[dest] = 1;
+		mpi_data->nb_cache_sent++;
 		_starpu_mpi_cache_data_add_nolock(data_handle);
 		_STARPU_MPI_DEBUG(2, "Noting that data %p has already been sent to %d\n", data_handle, dest);
 	}
@@ -339,6 +648,11 @@ int starpu_mpi_cached_send_set(starpu_data_handle_t data_handle, int dest)
 	{
 		_STARPU_MPI_DEBUG(2, "Do not send data %p to node %d as it has already been sent\n", data_handle, dest);
 	}
+	_starpu_mpi_cache_stats_access(1, already_sent);
+	if (_cache_auto)
+		_cache_sent_accesses[dest]++;
+	if (_cache_max_size && _starpu_mpi_cache_lru_access(_cache_lru_sent, _cache_lru_sent_size, &mpi_data->cache_sent_lru[dest], data_handle, dest))
+		_starpu_mpi_cache_sent_evict_nolock(dest);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	return already_sent;
 }
@@ -366,15 +680,21 @@ static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle)
 	if (_starpu_cache_enabled == 0)
 		return;
 
-	starpu_mpi_comm_size(mpi_data->node_tag.node.comm, &nb_nodes);
-	for(i=0 ; i<nb_nodes ; i++)
+	if (mpi_data->nb_cache_sent)
 	{
-		if (mpi_data->cache_sent[i] == 1)
+		starpu_mpi_comm_size(mpi_data->node_tag.node.comm, &nb_nodes);
+		for(i=0 ; i<nb_nodes ; i++)
 		{
-			_STARPU_MPI_DEBUG(2, "Clearing send cache for data %p\n", data_handle);
-			mpi_data->cache_sent[i] = 0;
-			_starpu_mpi_cache_stats_dec(i, data_handle);
+			if (mpi_data->cache_sent[i] == 1)
+			{
+				_STARPU_MPI_DEBUG(2, "Clearing send cache for data %p\n", data_handle);
+				mpi_data->cache_sent[i] = 0;
+				if (_cache_max_size)
+					_starpu_mpi_cache_lru_remove(_cache_lru_sent, _cache_lru_sent_size, &mpi_data->cache_sent_lru[i]);
+				_starpu_mpi_cache_stats_dec(i, data_handle);
+			}
 		}
+		mpi_data->nb_cache_sent = 0;
 	}
 
 	if (mpi_data->cache_received == 1)
@@ -384,6 +704,8 @@ static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle)
 		mpi_data->cache_received = 0;
 		mpi_data->ft_induced_cache_received = 0;
 		mpi_data->ft_induced_cache_received_count = 0;
+		if (_cache_max_size)
+			_starpu_mpi_cache_lru_remove(_cache_lru_received, _cache_lru_received_size, &mpi_data->cache_received_lru);
 		_starpu_mpi_cache_stats_dec(mpi_rank, data_handle);
 	}
 }
@@ -425,8 +747,132 @@ void starpu_mpi_cache_flush_all_data(MPI_Comm comm)
 	HASH_ITER(hh, _cache_data, entry, tmp)
 	{
 		_starpu_mpi_cache_flush_and_invalidate_nolock(comm, entry->data_handle);
-		HASH_DEL(_cache_data, entry);
-		free(entry);
+		_starpu_mpi_cache_data_entry_delete_nolock(entry);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+}
+
+/**************************************
+ * Automatic release of the received copies
+ **************************************/
+static void _starpu_mpi_cache_readers_epilogue(void *arg)
+{
+	struct _starpu_mpi_cache_readers *readers = arg;
+	unsigned i;
+
+	if (readers->epilogue_callback_func)
+		readers->epilogue_callback_func(readers->epilogue_callback_arg);
+	if (readers->epilogue_callback_arg_free)
+		free(readers->epilogue_callback_arg);
+
+	for (i = 0; i < readers->n; i++)
+		_starpu_mpi_cache_reader_done(readers->data_handles[i]);
+}
+
+void _starpu_mpi_cache_readers_attach(struct starpu_task *task, starpu_data_handle_t *data_handles, unsigned n)
+{
+	struct _starpu_mpi_cache_readers *readers;
+
+	_STARPU_MPI_MALLOC(readers, sizeof(*readers) + n * sizeof(readers->data_handles[0]));
+	readers->epilogue_callback_func = task->epilogue_callback_func;
+	readers->epilogue_callback_arg = task->epilogue_callback_arg;
+	readers->epilogue_callback_arg_free = task->epilogue_callback_arg_free;
+	readers->n = n;
+	memcpy(readers->data_handles, data_handles, n * sizeof(readers->data_handles[0]));
+
+	task->epilogue_callback_func = _starpu_mpi_cache_readers_epilogue;
+	task->epilogue_callback_arg = readers;
+	task->epilogue_callback_arg_free = 1;
+}
+
+void _starpu_mpi_cache_reader_done(starpu_data_handle_t data_handle)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	struct _starpu_mpi_cache_release *release;
+	starpu_mpi_tag_t data_tag;
+	unsigned long accesses;
+	int mpi_rank;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	STARPU_ASSERT(mpi_data->cache_readers > 0);
+	mpi_data->cache_readers--;
+	if (mpi_data->cache_readers || !mpi_data->cache_received || mpi_data->cache_pinned || mpi_data->cache_releasing)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+		return;
+	}
+
+	/* That was the last reader, ask the owner whether we can drop the copy */
+	mpi_rank = starpu_mpi_data_get_rank(data_handle);
+	release = _starpu_mpi_cache_release_new();
+	release->data_handle = data_handle;
+	data_tag = starpu_mpi_data_get_tag(data_handle);
+	release->data_tag = data_tag;
+	release->owner = mpi_rank;
+	_starpu_mpi_cache_release_list_push_back(&_cache_releases, release);
+	mpi_data->cache_releasing = 1;
+	_cache_releasing[mpi_rank]++;
+	accesses = _cache_received_accesses[mpi_rank];
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+
+	_STARPU_MPI_DEBUG(2, "Asking node %d whether data %p can be dropped after %lu accesses\n", mpi_rank, data_handle, accesses);
+	_mpi_backend._starpu_mpi_backend_cache_release(mpi_rank, mpi_data->node_tag.node.comm, data_tag, accesses);
+}
+
+int _starpu_mpi_cache_release_request(starpu_mpi_tag_t data_tag, int source, unsigned long accesses)
+{
+	struct _starpu_data_entry *entry;
+	int dropped = 0;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	HASH_FIND(hh_tag, _cache_data_tags, &data_tag, sizeof(data_tag), entry);
+	/* If we have accessed the cache for source since it asked, it is
+	 * going to access the data again, or it has already been flushed */
+	if (entry && _cache_sent_accesses[source] == accesses && ((struct _starpu_mpi_data *) entry->data_handle->mpi_data)->cache_sent[source])
+	{
+		_starpu_mpi_cache_sent_drop_nolock(entry->data_handle, source);
+		dropped = 1;
 	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+	_STARPU_MPI_DEBUG(2, "Node %d asked whether data with tag %"PRIi64" can be dropped after %lu accesses: %s\n", source, data_tag, accesses, dropped ? "yes" : "no");
+	return dropped;
+}
+
+void _starpu_mpi_cache_release_reply(starpu_mpi_tag_t data_tag, int source, int dropped)
+{
+	struct _starpu_mpi_cache_release *release;
+	struct _starpu_mpi_data *mpi_data;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	for (release = _starpu_mpi_cache_release_list_begin(&_cache_releases);
+	     release != _starpu_mpi_cache_release_list_end(&_cache_releases);
+	     release = _starpu_mpi_cache_release_list_next(release))
+		if (release->data_tag == data_tag && release->owner == source)
+			break;
+	STARPU_MPI_ASSERT_MSG(release != _starpu_mpi_cache_release_list_end(&_cache_releases), "Node %d answered about data with tag %"PRIi64" which we did not ask for", source, data_tag);
+	_starpu_mpi_cache_release_list_erase(&_cache_releases, release);
+
+	_cache_releasing[source]--;
+	if (release->data_handle)
+	{
+		mpi_data = release->data_handle->mpi_data;
+		mpi_data->cache_releasing = 0;
+		/* The copy may have been flushed in the meanwhile */
+		if (dropped && mpi_data->cache_received)
+			_starpu_mpi_cache_received_drop_nolock(release->data_handle, source);
+	}
+	_starpu_mpi_cache_release_delete(release);
+	STARPU_PTHREAD_COND_BROADCAST(&_cache_releasing_cond);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+}
+
+void _starpu_mpi_cache_auto_wait(void)
+{
+	if (!_starpu_mpi_cache_auto_enabled())
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	while (!_starpu_mpi_cache_release_list_empty(&_cache_releases))
+		STARPU_PTHREAD_COND_WAIT(&_cache_releasing_cond, &_cache_mutex);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 }
@@ -20,6 +20,7 @@
 #include <starpu.h>
 #include <stdlib.h>
 #include <mpi.h>
+#include <starpu_mpi.h>
 
 /** @file */
 
@@ -34,6 +35,22 @@ void _starpu_mpi_cache_shutdown();
 void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle);
 void _starpu_mpi_cache_data_clear(starpu_data_handle_t data_handle);
 
+/** Whether STARPU_MPI_CACHE_AUTO is in effect */
+int _starpu_mpi_cache_auto_enabled(void);
+/** Like starpu_mpi_cached_receive_set(), for data read by a task which
+ * will be given to _starpu_mpi_cache_readers_attach() */
+int _starpu_mpi_cached_receive_set_reader(starpu_data_handle_t data_handle);
+/** Make the task release the copies it reads when it is over */
+void _starpu_mpi_cache_readers_attach(struct starpu_task *task, starpu_data_handle_t *data_handles, unsigned n);
+void _starpu_mpi_cache_reader_done(starpu_data_handle_t data_handle);
+/** Called on the owner when node source asks whether it can drop its copy
+ * of the data, returns whether it can */
+int _starpu_mpi_cache_release_request(starpu_mpi_tag_t data_tag, int source, unsigned long accesses);
+/** Called on the receiver with the answer of the owner */
+void _starpu_mpi_cache_release_reply(starpu_mpi_tag_t data_tag, int source, int dropped);
+/** Wait for the owners to answer all the release requests */
+void _starpu_mpi_cache_auto_wait(void);
+
 #ifdef __cplusplus
 }
 #endif
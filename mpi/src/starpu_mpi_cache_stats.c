@@ -21,6 +21,13 @@
 
 static int stats_enabled=0;
 
+/* Indexed by 0 for the received cache and 1 for the sent cache. They are
+ * updated with the cache mutex held. */
+static unsigned long stats_hits[2];
+static unsigned long stats_misses[2];
+static unsigned long stats_evictions[2];
+static size_t stats_evicted_size[2];
+
 void _starpu_mpi_cache_stats_init()
 {
 	stats_enabled = starpu_getenv_number("STARPU_MPI_CACHE_STATS");
@@ -37,8 +44,21 @@ void _starpu_mpi_cache_stats_init()
 
 void _starpu_mpi_cache_stats_shutdown()
 {
+	int sent;
+
 	if (stats_enabled == 0)
 		return;
+
+	for (sent = 0; sent < 2; sent++)
+	{
+		_STARPU_MPI_MSG("[communication cache] %s data: %lu hits, %lu misses, %lu evictions (%ld bytes)\n",
+				sent ? "sent" : "received",
+				stats_hits[sent], stats_misses[sent], stats_evictions[sent], (long)stats_evicted_size[sent]);
+		stats_hits[sent] = 0;
+		stats_misses[sent] = 0;
+		stats_evictions[sent] = 0;
+		stats_evicted_size[sent] = 0;
+	}
 }
 
 void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_handle, int count)
@@ -59,3 +79,23 @@ void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_hand
 		_STARPU_MPI_MSG("[communication cache] - %10ld from %u\n", (long)size, dst);
 	}
 }
+
+void _starpu_mpi_cache_stats_access(int sent, int hit)
+{
+	if (stats_enabled == 0)
+		return;
+
+	if (hit)
+		stats_hits[sent]++;
+	else
+		stats_misses[sent]++;
+}
+
+void _starpu_mpi_cache_stats_evict(int sent, starpu_data_handle_t data_handle)
+{
+	if (stats_enabled == 0)
+		return;
+
+	stats_evictions[sent]++;
+	stats_evicted_size[sent] += starpu_data_get_size(data_handle);
+}
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2014-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2014-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -36,6 +36,12 @@ void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_hand
 #define _starpu_mpi_cache_stats_inc(dst, data_handle) _starpu_mpi_cache_stats_update(dst, data_handle, +1)
 #define _starpu_mpi_cache_stats_dec(dst, data_handle) _starpu_mpi_cache_stats_update(dst, data_handle, -1)
 
+/** Count an access to the received cache (sent=0) or to the sent cache
+ * (sent=1), and whether the data was already there */
+void _starpu_mpi_cache_stats_access(int sent, int hit);
+/** Count the eviction of a copy from the received or sent cache */
+void _starpu_mpi_cache_stats_evict(int sent, starpu_data_handle_t data_handle);
+
 #ifdef __cplusplus
 }
 #endif
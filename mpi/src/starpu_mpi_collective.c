@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2011-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2011-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2013       Thibaut Lambert
  *
  * StarPU is free software; you can redistribute it and/or modify
@@ -19,6 +19,12 @@
 #include <starpu.h>
 #include <starpu_mpi.h>
 #include <starpu_mpi_private.h>
+#include <datawizard/coherency.h>
+
+/* Below this size in bytes, the data is small enough for latency-bound algorithms */
+static int _collective_small_size;
+/* Up to this number of nodes, small data is broadcast directly by the root */
+static int _collective_flat_nodes;
 
 struct _callback_arg
 {
@@ -167,3 +173,360 @@ int starpu_mpi_gather_detached(starpu_data_handle_t *data_handles, int count, in
 	}
 	return 0;
 }
+
+/*
+ * Collectives on handles which are registered on all the processes of the
+ * communicator. They are only made of detached point-to-point requests and
+ * tasks, so they are ordered with the other accesses to the handles through
+ * sequential consistency.
+ *
+ * All processes must take the same algorithm decision, which is based on the
+ * size of the communicator and of the data, so the handles must have the same
+ * size on all processes.
+ */
+
+static struct starpu_codelet _starpu_mpi_collective_done_cl =
+{
+	.where = STARPU_NOWHERE,
+	.nbuffers = STARPU_VARIABLE_NBUFFERS,
+	.name = "mpi_collective_done",
+};
+
+/* Call callback once all the previous accesses to the handles are over */
+static int _starpu_mpi_collective_callback(starpu_data_handle_t *data_handles, int count, void (*callback)(void *), void *arg)
+{
+	struct starpu_data_descr descrs[count];
+	int x, n = 0;
+
+	if (!callback)
+		return 0;
+
+	for(x = 0; x < count ; x++)
+	{
+		if (data_handles[x])
+		{
+			descrs[n].handle = data_handles[x];
+			descrs[n].mode = STARPU_R;
+			n++;
+		}
+	}
+
+	if (!n)
+	{
+		callback(arg);
+		return 0;
+	}
+
+	return starpu_task_insert(&_starpu_mpi_collective_done_cl,
+				  STARPU_DATA_MODE_ARRAY, descrs, n,
+				  STARPU_CALLBACK, callback,
+				  STARPU_CALLBACK_ARG_NFREE, arg,
+				  0);
+}
+
+void _starpu_mpi_collective_init(void)
+{
+	_collective_small_size = starpu_getenv_number_default("STARPU_MPI_COLLECTIVE_SMALL_SIZE", 16384);
+	_collective_flat_nodes = starpu_getenv_number_default("STARPU_MPI_COLLECTIVE_FLAT_NODES", 8);
+}
+
+/* Whether the data is small enough for latency-bound algorithms */
+static int _starpu_mpi_collective_small(size_t size)
+{
+	return size < (size_t) _collective_small_size;
+}
+
+static starpu_mpi_tag_t _starpu_mpi_collective_tag(starpu_data_handle_t data_handle)
+{
+	starpu_mpi_tag_t data_tag = starpu_mpi_data_get_tag(data_handle);
+	STARPU_ASSERT_MSG(data_tag >= 0, "StarPU needs to be told the MPI tag of this data, using starpu_mpi_data_register\n");
+	return data_tag;
+}
+
+/* Receive the data of node into a temporary handle, and reduce it into data_handle */
+static int _starpu_mpi_collective_recv_reduce(starpu_data_handle_t data_handle, int node, starpu_mpi_tag_t data_tag, MPI_Comm comm)
+{
+	starpu_data_handle_t new_handle;
+	int ret;
+
+	starpu_data_register_same(&new_handle, data_handle);
+	ret = starpu_mpi_irecv_detached(new_handle, node, data_tag, comm, NULL, NULL);
+	if (ret)
+		return ret;
+	ret = starpu_task_insert(data_handle->redux_cl,
+				 STARPU_RW|STARPU_COMMUTE, data_handle,
+				 STARPU_R, new_handle,
+				 STARPU_NAME, "mpi_allreduce_redux_cl",
+				 0);
+	if (ret)
+		return ret;
+	starpu_data_unregister_submit(new_handle);
+	return 0;
+}
+
+/* Binomial tree broadcast, relative to root */
+static int _starpu_mpi_bcast_tree(starpu_data_handle_t data_handle, starpu_mpi_tag_t data_tag, int root, int me, int nb_nodes, MPI_Comm comm)
+{
+	int vme = (me - root + nb_nodes) % nb_nodes;
+	int mask = 1;
+	int ret;
+
+	while (mask < nb_nodes)
+	{
+		if (vme & mask)
+		{
+			ret = starpu_mpi_irecv_detached(data_handle, (vme - mask + root) % nb_nodes, data_tag, comm, NULL, NULL);
+			if (ret)
+				return ret;
+			break;
+		}
+		mask <<= 1;
+	}
+
+	for (mask >>= 1; mask > 0; mask >>= 1)
+	{
+		if (vme + mask < nb_nodes)
+		{
+			ret = starpu_mpi_isend_detached(data_handle, (vme + mask + root) % nb_nodes, data_tag, comm, NULL, NULL);
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+int starpu_mpi_bcast_detached(starpu_data_handle_t data_handle, int root, MPI_Comm comm, void (*callback)(void *), void *arg)
+{
+	int me, nb_nodes, ret;
+	starpu_mpi_tag_t data_tag = _starpu_mpi_collective_tag(data_handle);
+
+	starpu_mpi_comm_rank(comm, &me);
+	starpu_mpi_comm_size(comm, &nb_nodes);
+
+	if (nb_nodes <= _collective_flat_nodes && _starpu_mpi_collective_small(starpu_data_get_size(data_handle)))
+	{
+		/* Only one latency */
+		_STARPU_MPI_DEBUG(5, "flat broadcast of %p from %d\n", data_handle, root);
+		if (me == root)
+		{
+			int node;
+			for (node = 0; node < nb_nodes; node++)
+			{
+				if (node == root)
+					continue;
+				ret = starpu_mpi_isend_detached(data_handle, node, data_tag, comm, NULL, NULL);
+				if (ret)
+					return ret;
+			}
+		}
+		else
+		{
+			ret = starpu_mpi_irecv_detached(data_handle, root, data_tag, comm, NULL, NULL);
+			if (ret)
+				return ret;
+		}
+	}
+	else
+	{
+		/* Only log(nb_nodes) copies */
+		_STARPU_MPI_DEBUG(5, "tree broadcast of %p from %d\n", data_handle, root);
+		ret = _starpu_mpi_bcast_tree(data_handle, data_tag, root, me, nb_nodes, comm);
+		if (ret)
+			return ret;
+	}
+
+	return _starpu_mpi_collective_callback(&data_handle, 1, callback, arg);
+}
+
+int starpu_mpi_allreduce_detached(starpu_data_handle_t data_handle, MPI_Comm comm, void (*callback)(void *), void *arg)
+{
+	int me, nb_nodes, ret;
+	starpu_mpi_tag_t data_tag = _starpu_mpi_collective_tag(data_handle);
+
+	STARPU_ASSERT_MSG(data_handle->redux_cl, "starpu_mpi_allreduce_detached needs the reduction methods of the data, set with starpu_data_set_reduction_methods\n");
+
+	starpu_mpi_comm_rank(comm, &me);
+	starpu_mpi_comm_size(comm, &nb_nodes);
+
+	if (nb_nodes > 1 && _starpu_mpi_collective_small(starpu_data_get_size(data_handle)))
+	{
+		/* Recursive doubling: log(nb_nodes) steps, but each node
+		 * sends the whole data at each step. The nodes beyond the
+		 * biggest power of two first fold their data into their
+		 * neighbour, and get the result back at the end. */
+		int pof2 = 1, rem, newme, mask;
+
+		while (pof2 * 2 <= nb_nodes)
+			pof2 *= 2;
+		rem = nb_nodes - pof2;
+
+		_STARPU_MPI_DEBUG(5, "recursive doubling allreduce of %p\n", data_handle);
+		if (me < 2*rem)
+		{
+			if (me % 2 == 0)
+			{
+				ret = starpu_mpi_isend_detached(data_handle, me + 1, data_tag, comm, NULL, NULL);
+				if (ret)
+					return ret;
+				newme = -1;
+			}
+			else
+			{
+				ret = _starpu_mpi_collective_recv_reduce(data_handle, me - 1, data_tag, comm);
+				if (ret)
+					return ret;
+				newme = me / 2;
+			}
+		}
+		else
+			newme = me - rem;
+
+		if (newme != -1)
+		{
+			for (mask = 1; mask < pof2; mask <<= 1)
+			{
+				int newpartner = newme ^ mask;
+				int partner = newpartner < rem ? newpartner*2 + 1 : newpartner + rem;
+
+				ret = starpu_mpi_isend_detached(data_handle, partner, data_tag, comm, NULL, NULL);
+				if (ret)
+					return ret;
+				ret = _starpu_mpi_collective_recv_reduce(data_handle, partner, data_tag, comm);
+				if (ret)
+					return ret;
+			}
+		}
+
+		if (me < 2*rem)
+		{
+			if (me % 2 == 0)
+				ret = starpu_mpi_irecv_detached(data_handle, me + 1, data_tag, comm, NULL, NULL);
+			else
+				ret = starpu_mpi_isend_detached(data_handle, me - 1, data_tag, comm, NULL, NULL);
+			if (ret)
+				return ret;
+		}
+	}
+	else if (nb_nodes > 1)
+	{
+		/* Binomial tree reduction onto node 0, then broadcast: twice
+		 * as many steps, but each node sends the data only once in
+		 * each phase, which saves bandwidth for big data */
+		int mask;
+
+		_STARPU_MPI_DEBUG(5, "reduce-broadcast allreduce of %p\n", data_handle);
+		for (mask = 1; mask < nb_nodes; mask <<= 1)
+		{
+			if (me & mask)
+			{
+				ret = starpu_mpi_isend_detached(data_handle, me - mask, data_tag, comm, NULL, NULL);
+				if (ret)
+					return ret;
+				break;
+			}
+			else if (me + mask < nb_nodes)
+			{
+				ret = _starpu_mpi_collective_recv_reduce(data_handle, me + mask, data_tag, comm);
+				if (ret)
+					return ret;
+			}
+		}
+
+		ret = _starpu_mpi_bcast_tree(data_handle, data_tag, 0, me, nb_nodes, comm);
+		if (ret)
+			return ret;
+	}
+
+	return _starpu_mpi_collective_callback(&data_handle, 1, callback, arg);
+}
+
+/* Exchange with node the handles owned by the nodes of [send_first,
+ * send_first+nsend) and [recv_first, recv_first+nrecv), modulo nb_nodes */
+static int _starpu_mpi_allgather_exchange(starpu_data_handle_t *data_handles, int count, int node, int send_first, int nsend, int recv_first, int nrecv, int nb_nodes, MPI_Comm comm)
+{
+	int x, ret;
+
+	for(x = 0; x < count ; x++)
+	{
+		if (!data_handles[x])
+			continue;
+
+		int owner = starpu_mpi_data_get_rank(data_handles[x]);
+		starpu_mpi_tag_t data_tag = _starpu_mpi_collective_tag(data_handles[x]);
+
+		if ((owner - send_first + nb_nodes) % nb_nodes < nsend)
+		{
+			ret = starpu_mpi_isend_detached(data_handles[x], node, data_tag, comm, NULL, NULL);
+			if (ret)
+				return ret;
+		}
+		else if ((owner - recv_first + nb_nodes) % nb_nodes < nrecv)
+		{
+			ret = starpu_mpi_irecv_detached(data_handles[x], node, data_tag, comm, NULL, NULL);
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+int starpu_mpi_allgather_detached(starpu_data_handle_t *data_handles, int count, MPI_Comm comm, void (*callback)(void *), void *arg)
+{
+	int me, nb_nodes, x, ret;
+	size_t size = 0;
+
+	starpu_mpi_comm_rank(comm, &me);
+	starpu_mpi_comm_size(comm, &nb_nodes);
+
+	for(x = 0; x < count ; x++)
+	{
+		STARPU_ASSERT_MSG(data_handles[x], "starpu_mpi_allgather_detached needs all the data to be registered on all nodes\n");
+		size += starpu_data_get_size(data_handles[x]);
+	}
+
+	if (!(nb_nodes & (nb_nodes - 1)) && _starpu_mpi_collective_small(size))
+	{
+		/* Recursive doubling: log(nb_nodes) steps, exchanging twice
+		 * as many handles at each step */
+		int mask;
+
+		_STARPU_MPI_DEBUG(5, "recursive doubling allgather of %d data\n", count);
+		for (mask = 1; mask < nb_nodes; mask <<= 1)
+		{
+			int partner = me ^ mask;
+			ret = _starpu_mpi_allgather_exchange(data_handles, count, partner,
+							     me & ~(mask - 1), mask,
+							     partner & ~(mask - 1), mask,
+							     nb_nodes, comm);
+			if (ret)
+				return ret;
+		}
+	}
+	else
+	{
+		/* Ring: nb_nodes-1 steps, each node only talks with its
+		 * neighbours, and each handle crosses each link only once */
+		int step;
+		int next = (me + 1) % nb_nodes;
+		int prev = (me - 1 + nb_nodes) % nb_nodes;
+
+		_STARPU_MPI_DEBUG(5, "ring allgather of %d data\n", count);
+		for (step = 0; step < nb_nodes - 1; step++)
+		{
+			ret = _starpu_mpi_allgather_exchange(data_handles, count, next,
+							     (me - step + nb_nodes) % nb_nodes, 1,
+							     -1, 0,
+							     nb_nodes, comm);
+			if (ret)
+				return ret;
+			ret = _starpu_mpi_allgather_exchange(data_handles, count, prev,
+							     -1, 0,
+							     (me - step - 1 + nb_nodes) % nb_nodes, 1,
+							     nb_nodes, comm);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return _starpu_mpi_collective_callback(data_handles, count, callback, arg);
+}
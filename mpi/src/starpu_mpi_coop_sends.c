@@ -116,10 +116,8 @@ static void _starpu_mpi_coop_sends_optimize(struct _starpu_mpi_coop_sends *coop_
 		/* Sort them */
 		qsort(reqs, n, sizeof(*reqs), _starpu_mpi_reqs_prio_compare);
 
-#if 0
 		/* And build the diffusion tree */
 		_starpu_mpi_coop_sends_build_tree(coop_sends);
-#endif
 	}
 	_starpu_spin_unlock(&coop_sends->lock);
 }
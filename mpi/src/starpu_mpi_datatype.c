@@ -403,6 +403,156 @@ void _starpu_mpi_datatype_free(starpu_data_handle_t data_handle, MPI_Datatype *d
 	/* else the datatype is not predefined by StarPU */
 }
 
+/*
+ *	Slices
+ */
+
+static void datatype_resize_slice(MPI_Datatype *slice, size_t stride, MPI_Datatype *datatype)
+{
+	int ret;
+
+	ret = MPI_Type_create_resized(*slice, 0, stride, datatype);
+	STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_create_resized failed");
+
+	ret = MPI_Type_commit(datatype);
+	STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_commit failed");
+
+	ret = MPI_Type_free(slice);
+	STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_free failed");
+}
+
+int _starpu_mpi_datatype_get_slices(starpu_data_handle_t data_handle, unsigned node, MPI_Datatype *datatype, size_t *slice_size, size_t *stride, size_t *nslices)
+{
+	enum starpu_data_interface_id id = starpu_data_get_interface_id(data_handle);
+	void *data_interface = starpu_data_get_interface_on_node(data_handle, node);
+	MPI_Datatype slice, layer;
+	int ret;
+
+	switch (id)
+	{
+#ifndef DYNAMIC_MATRICES
+	case STARPU_MATRIX_INTERFACE_ID:
+	{
+		/* One slice per column */
+		struct starpu_matrix_interface *matrix_interface = data_interface;
+		size_t elemsize = STARPU_MATRIX_GET_ELEMSIZE(matrix_interface);
+
+		ret = MPI_Type_contiguous(STARPU_MATRIX_GET_NX(matrix_interface)*elemsize, MPI_BYTE, &slice);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_contiguous failed");
+
+		*slice_size = STARPU_MATRIX_GET_NX(matrix_interface)*elemsize;
+		*stride = STARPU_MATRIX_GET_LD(matrix_interface)*elemsize;
+		*nslices = STARPU_MATRIX_GET_NY(matrix_interface);
+		break;
+	}
+#endif
+	case STARPU_BLOCK_INTERFACE_ID:
+	{
+		/* One slice per 2D layer */
+		struct starpu_block_interface *block_interface = data_interface;
+		unsigned nx = STARPU_BLOCK_GET_NX(block_interface);
+		unsigned ny = STARPU_BLOCK_GET_NY(block_interface);
+		size_t elemsize = STARPU_BLOCK_GET_ELEMSIZE(block_interface);
+
+		ret = MPI_Type_vector(ny, nx*elemsize, STARPU_BLOCK_GET_LDY(block_interface)*elemsize, MPI_BYTE, &slice);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_vector failed");
+
+		*slice_size = (size_t) nx*ny*elemsize;
+		*stride = STARPU_BLOCK_GET_LDZ(block_interface)*elemsize;
+		*nslices = STARPU_BLOCK_GET_NZ(block_interface);
+		break;
+	}
+	case STARPU_TENSOR_INTERFACE_ID:
+	{
+		/* One slice per 3D layer */
+		struct starpu_tensor_interface *tensor_interface = data_interface;
+		unsigned nx = STARPU_TENSOR_GET_NX(tensor_interface);
+		unsigned ny = STARPU_TENSOR_GET_NY(tensor_interface);
+		unsigned nz = STARPU_TENSOR_GET_NZ(tensor_interface);
+		size_t elemsize = STARPU_TENSOR_GET_ELEMSIZE(tensor_interface);
+
+		ret = MPI_Type_vector(ny, nx*elemsize, STARPU_TENSOR_GET_LDY(tensor_interface)*elemsize, MPI_BYTE, &layer);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_vector failed");
+
+		ret = MPI_Type_create_hvector(nz, 1, STARPU_TENSOR_GET_LDZ(tensor_interface)*elemsize, layer, &slice);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_hvector failed");
+
+		ret = MPI_Type_free(&layer);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_free failed");
+
+		*slice_size = (size_t) nx*ny*nz*elemsize;
+		*stride = STARPU_TENSOR_GET_LDT(tensor_interface)*elemsize;
+		*nslices = STARPU_TENSOR_GET_NT(tensor_interface);
+		break;
+	}
+	case STARPU_NDIM_INTERFACE_ID:
+	{
+		/* One slice per (ndim-1)D layer */
+		struct starpu_ndim_interface *ndim_interface = data_interface;
+		unsigned *nn = STARPU_NDIM_GET_NN(ndim_interface);
+		unsigned *ldn = STARPU_NDIM_GET_LDN(ndim_interface);
+		size_t ndim = STARPU_NDIM_GET_NDIM(ndim_interface);
+		size_t elemsize = STARPU_NDIM_GET_ELEMSIZE(ndim_interface);
+		unsigned i;
+
+		if (ndim <= 1)
+		{
+			*datatype = MPI_BYTE;
+			*slice_size = 1;
+			*stride = 1;
+			*nslices = ndim ? nn[0]*elemsize : 0;
+			return 0;
+		}
+
+		ret = MPI_Type_contiguous(nn[0]*elemsize, MPI_BYTE, &slice);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_contiguous failed");
+		*slice_size = nn[0]*elemsize;
+
+		for (i = 1; i < ndim-1; i++)
+		{
+			layer = slice;
+			ret = MPI_Type_create_hvector(nn[i], 1, ldn[i]*elemsize, layer, &slice);
+			STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_hvector failed");
+
+			ret = MPI_Type_free(&layer);
+			STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_free failed");
+
+			*slice_size *= nn[i];
+		}
+
+		*stride = ldn[ndim-1]*elemsize;
+		*nslices = nn[ndim-1];
+		break;
+	}
+	case STARPU_VECTOR_INTERFACE_ID:
+	{
+		struct starpu_vector_interface *vector_interface = data_interface;
+
+		*datatype = MPI_BYTE;
+		*slice_size = 1;
+		*stride = 1;
+		*nslices = STARPU_VECTOR_GET_NX(vector_interface)*STARPU_VECTOR_GET_ELEMSIZE(vector_interface);
+		return 0;
+	}
+	case STARPU_VARIABLE_INTERFACE_ID:
+	{
+		struct starpu_variable_interface *variable_interface = data_interface;
+
+		*datatype = MPI_BYTE;
+		*slice_size = 1;
+		*stride = 1;
+		*nslices = STARPU_VARIABLE_GET_ELEMSIZE(variable_interface);
+		return 0;
+	}
+	default:
+		/* Void data, or user-defined datatypes which we can not cut */
+		return -1;
+	}
+
+	datatype_resize_slice(&slice, *stride, datatype);
+	return 0;
+}
+
 int _starpu_mpi_interface_datatype_register(enum starpu_data_interface_id id, starpu_mpi_datatype_node_allocate_func_t allocate_datatype_node_func, starpu_mpi_datatype_allocate_func_t allocate_datatype_func, starpu_mpi_datatype_free_func_t free_datatype_func)
 {
 	struct _starpu_mpi_datatype_funcs *table;
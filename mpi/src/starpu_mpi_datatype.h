@@ -35,6 +35,13 @@ void _starpu_mpi_datatype_free(starpu_data_handle_t data_handle, MPI_Datatype *d
 
 MPI_Datatype _starpu_mpi_datatype_get_user_defined_datatype(starpu_data_handle_t data_handle, unsigned node);
 
+/** Describe the data of the handle as nslices slices of slice_size bytes,
+ * slice i starting at offset i*stride from the data pointer, so that it can
+ * be transferred in several chunks of consecutive slices. The datatype of a
+ * slice is to be freed with MPI_Type_free() unless it is MPI_BYTE. Returns -1
+ * if the data can not be cut. */
+int _starpu_mpi_datatype_get_slices(starpu_data_handle_t data_handle, unsigned node, MPI_Datatype *datatype, size_t *slice_size, size_t *stride, size_t *nslices);
+
 #ifdef __cplusplus
 }
 #endif
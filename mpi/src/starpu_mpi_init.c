@@ -172,6 +172,16 @@ void _starpu_mpi_backend_check()
 	STARPU_ASSERT(_mpi_backend._starpu_mpi_backend_irecv_size_func != NULL);
 }
 
+/* Called with the sequential consistency mutex of the data held, when a write
+ * to it was just submitted */
+static void _starpu_mpi_data_written(starpu_data_handle_t data_handle)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	if (mpi_data)
+		mpi_data->write_version++;
+	_starpu_mpi_data_flush(data_handle);
+}
+
 static
 int _starpu_mpi_initialize(int *argc, char ***argv, int initialize_mpi, MPI_Comm comm)
 {
@@ -181,7 +191,7 @@ int _starpu_mpi_initialize(int *argc, char ***argv, int initialize_mpi, MPI_Comm
 	argc_argv->argc = argc;
 	argc_argv->argv = argv;
 	argc_argv->comm = comm;
-	_starpu_implicit_data_deps_write_hook(_starpu_mpi_data_flush);
+	_starpu_implicit_data_deps_write_hook(_starpu_mpi_data_written);
 
 	_starpu_mpi_backend_check();
 
@@ -339,6 +349,14 @@ int starpu_mpi_shutdown_comm(MPI_Comm comm)
 	 * before shutting down MPI */
 	starpu_mpi_wait_for_all(comm);
 
+	/* The owners have to answer our last release requests of the cache,
+	 * and we have to answer theirs, before stopping the progression */
+	if (_starpu_mpi_cache_auto_enabled())
+	{
+		_starpu_mpi_cache_auto_wait();
+		starpu_mpi_barrier(comm);
+	}
+
 	/* We need to get the rank before calling MPI_Finalize to pass to _starpu_mpi_comm_amounts_display() */
 	starpu_mpi_comm_rank(comm, &rank);
 	starpu_mpi_comm_size(comm, &world_size);
@@ -74,6 +74,7 @@ extern int _starpu_mpi_recv_wait_finalize;
 extern int _starpu_mpi_has_cuda;
 extern int _starpu_mpi_cuda_devid;
 void _starpu_mpi_env_init(void);
+void _starpu_mpi_collective_init(void);
 
 #ifdef STARPU_NO_ASSERT
 #  define STARPU_MPI_ASSERT_MSG(x, msg, ...) do { if (0) { (void) (x); }} while(0)
@@ -209,16 +210,36 @@ struct _starpu_mpi_coop_sends
 	long pre_sync_jobid;
 };
 
+struct _starpu_mpi_cache_lru;
+
 /** Initialized in starpu_mpi_data_register_comm */
 struct _starpu_mpi_data
 {
 	int magic;
 	struct _starpu_mpi_node_tag node_tag;
 	char *cache_sent;
+	/** Number of nodes set in cache_sent, to avoid walking it when empty */
+	unsigned int nb_cache_sent;
 	unsigned int cache_received;
 	unsigned int ft_induced_cache_received:1;
 	unsigned int ft_induced_cache_received_count:1;
 	unsigned int modified:1; // Whether the data has been modified since the registration.
+	/** Number of accesses in write mode submitted on this node, to tell
+	  * whether the data has changed since the previous checkpoint */
+	unsigned long write_version;
+	/** When the size of the cache is limited, position of the data in
+	  * the LRU lists of the cache, for the received copy and for each
+	  * node it was sent to */
+	struct _starpu_mpi_cache_lru *cache_received_lru;
+	struct _starpu_mpi_cache_lru **cache_sent_lru;
+	/** With STARPU_MPI_CACHE_AUTO, number of the submitted tasks which
+	  * read the received copy and are not over yet */
+	unsigned cache_readers;
+	/** The received copy is also used outside tasks, e.g. by
+	  * starpu_mpi_get_data_on_node(), it is not released automatically */
+	unsigned cache_pinned;
+	/** The owner was asked whether the received copy can be dropped */
+	unsigned cache_releasing;
 
 	/** Array used to store the contributing nodes to this data
 	  * when it is accessed in (MPI_)REDUX mode. */
@@ -306,10 +327,9 @@ void _starpu_mpi_release_req_data(struct _starpu_mpi_req *req);
 
 void _starpu_mpi_isend_irecv_common(struct _starpu_mpi_req *req, enum starpu_data_access_mode mode, int sequential_consistency);
 
-#if 0
-/** Build a communication tree. Called before _starpu_mpi_coop_send is ever called. coop_sends->lock is held. */
+/** Build a communication tree. Called once the requests of coop_sends are
+ * sorted by priority, before submitting them. coop_sends->lock is held. */
 void _starpu_mpi_coop_sends_build_tree(struct _starpu_mpi_coop_sends *coop_sends);
-#endif
 /** Try to merge with send request with other send requests */
 void _starpu_mpi_coop_send(starpu_data_handle_t data_handle, struct _starpu_mpi_req *req, enum starpu_data_access_mode mode, int sequential_consistency);
 
@@ -390,6 +410,11 @@ struct _starpu_mpi_backend
 
 	void (*_starpu_mpi_backend_isend_size_func)(struct _starpu_mpi_req *req);
 	void (*_starpu_mpi_backend_irecv_size_func)(struct _starpu_mpi_req *req);
+
+	/** Ask node rank whether the copy of the data with tag data_tag it
+	  * sent can be dropped, see STARPU_MPI_CACHE_AUTO. NULL when the
+	  * backend does not support it */
+	void (*_starpu_mpi_backend_cache_release)(int rank, MPI_Comm comm, starpu_mpi_tag_t data_tag, unsigned long accesses);
 };
 
 extern struct _starpu_mpi_backend _mpi_backend;
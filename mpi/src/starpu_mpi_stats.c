@@ -30,6 +30,8 @@ static int* nb_nodes_per_coop;
 static double time_init;
 static MPI_Comm comm_init;
 static int nb_sends = 0;
+static int nb_aggregated_msgs = 0;
+static int nb_aggregated_reqs = 0;
 static size_t max_sent_size = 0;
 #ifdef STARPU_USE_MPI_NMAD
 static struct _starpu_spinlock stats_lock;
@@ -148,6 +150,16 @@ void _starpu_mpi_nb_coop_inc(int nb_nodes_in_coop)
 #endif
 }
 
+void _starpu_mpi_nb_aggregated_inc(int nb_reqs)
+{
+	if (stats_enabled == 0)
+		return;
+
+	/* Only called from the MPI progression thread */
+	nb_aggregated_msgs++;
+	nb_aggregated_reqs += nb_reqs;
+}
+
 void starpu_mpi_comm_stats_retrieve(size_t *comm_stats)
 {
 	if (comm_amount)
@@ -174,6 +186,8 @@ void _starpu_mpi_comm_amounts_display(FILE *stream, int node)
 	fprintf(stream, "[starpu_comm_stats][%d] nb_sends: %d\n", node, nb_sends);
 	fprintf(stream, "[starpu_comm_stats][%d] max_sent_size: %ld\n", node, max_sent_size);
 	fprintf(stream, "[starpu_comm_stats][%d] average sent size: %ld\n", node, nb_sends ? sum / nb_sends : 0);
+	if (nb_aggregated_msgs)
+		fprintf(stream, "[starpu_comm_stats][%d] NB_AGGREGATED: %d requests in %d messages\n", node, nb_aggregated_reqs, nb_aggregated_msgs);
 
 	for (dst = 0; dst < world_size; dst++)
 	{
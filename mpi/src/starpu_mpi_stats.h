@@ -34,6 +34,7 @@ void _starpu_mpi_comm_stats_enable(void);
 void _starpu_mpi_comm_amounts_shutdown(void);
 void _starpu_mpi_comm_amounts_inc(MPI_Comm comm, unsigned memnode, unsigned dst, MPI_Datatype datatype, int count);
 void _starpu_mpi_nb_coop_inc(int nb_nodes_in_coop);
+void _starpu_mpi_nb_aggregated_inc(int nb_reqs);
 void _starpu_mpi_comm_amounts_display(FILE *stream, int node);
 
 #ifdef __cplusplus
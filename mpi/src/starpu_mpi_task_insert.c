@@ -43,6 +43,10 @@
 
 static void (*pre_submit_hook)(struct starpu_task *task) = NULL;
 
+/* load balancer hooks */
+static void (*lb_task_to_submit_hook)(struct starpu_task *task) = NULL;
+static void (*lb_inserted_task_hook)(MPI_Comm comm) = NULL;
+
 /* reduction wrap-up */
 // entry in the table
 struct _starpu_redux_data_entry
@@ -68,6 +72,12 @@ int starpu_mpi_pre_submit_hook_unregister()
 	return 0;
 }
 
+void _starpu_mpi_lb_hooks_register(void (*task_to_submit)(struct starpu_task *task), void (*inserted_task)(MPI_Comm comm))
+{
+	lb_task_to_submit_hook = task_to_submit;
+	lb_inserted_task_hook = inserted_task;
+}
+
 int _starpu_mpi_find_executee_node(starpu_data_handle_t data, enum starpu_data_access_mode mode, int me, int *do_execute, int *inconsistent_execute, int *xrank)
 {
 	if (mode & STARPU_W || mode & STARPU_REDUX)
@@ -108,7 +118,9 @@ int _starpu_mpi_find_executee_node(starpu_data_handle_t data, enum starpu_data_a
 	return 0;
 }
 
-int _starpu_mpi_exchange_data_before_execution(starpu_data_handle_t data, enum starpu_data_access_mode mode, int me, int xrank, int do_execute, int prio, MPI_Comm comm)
+/* When reader is not NULL, *reader is set to 1 if the data is received in
+ * the cache for a task which will release it, see STARPU_MPI_CACHE_AUTO */
+static int __starpu_mpi_exchange_data_before_execution(starpu_data_handle_t data, enum starpu_data_access_mode mode, int me, int xrank, int do_execute, int prio, MPI_Comm comm, int *reader)
 {
 	if (data && xrank == STARPU_MPI_PER_NODE)
 	{
@@ -126,7 +138,14 @@ int _starpu_mpi_exchange_data_before_execution(starpu_data_handle_t data, enum s
 		if (do_execute && mpi_rank != STARPU_MPI_PER_NODE && mpi_rank != me)
 		{
 			/* The node is going to execute the codelet, but it does not own the data, it needs to receive the data from the owner node */
-			int already_received = starpu_mpi_cached_receive_set(data);
+			int already_received;
+			if (reader && _starpu_mpi_cache_auto_enabled())
+			{
+				already_received = _starpu_mpi_cached_receive_set_reader(data);
+				*reader = 1;
+			}
+			else
+				already_received = starpu_mpi_cached_receive_set(data);
 			if (already_received == 0)
 			{
 				if (data_tag == -1)
@@ -156,6 +175,11 @@ int _starpu_mpi_exchange_data_before_execution(starpu_data_handle_t data, enum s
 	return 0;
 }
 
+int _starpu_mpi_exchange_data_before_execution(starpu_data_handle_t data, enum starpu_data_access_mode mode, int me, int xrank, int do_execute, int prio, MPI_Comm comm)
+{
+	return __starpu_mpi_exchange_data_before_execution(data, mode, me, xrank, do_execute, prio, comm, NULL);
+}
+
 static
 int _starpu_mpi_exchange_data_after_execution(starpu_data_handle_t data, enum starpu_data_access_mode mode, int me, int xrank, int do_execute, int prio, MPI_Comm comm)
 {
@@ -226,8 +250,112 @@ void _starpu_mpi_clear_data_after_execution(starpu_data_handle_t data, enum star
 	}
 }
 
+/* Whether the node has anything to do with the data when it does not execute
+ * the task accessing it: send it or receive it back, drop a cached copy, or
+ * take part in a reduction. This only looks at the distribution recorded in
+ * the MPI data of the handle, i.e. its owner and cache state, without taking
+ * any lock. */
+int _starpu_mpi_data_involves_node(int me, starpu_data_handle_t data, enum starpu_data_access_mode mode)
+{
+	if (!data)
+		/* Let the usual path complain or skip it */
+		return 1;
+
+	struct _starpu_mpi_data *mpi_data = data->mpi_data;
+	if (!mpi_data)
+		return 1;
+	if (mode & STARPU_REDUX || mode & STARPU_MPI_REDUX || mpi_data->redux_map)
+		return 1;
+
+	int mpi_rank = mpi_data->node_tag.node.rank;
+	if (mpi_rank == me || mpi_rank == STARPU_MPI_PER_NODE || mpi_rank == -1)
+		return 1;
+	if (_starpu_cache_enabled && (mpi_data->cache_received || mpi_data->nb_cache_sent))
+		return 1;
+	return 0;
+}
+
+/* Whether the node has anything to do for a task it does not execute, so
+ * that for large distributions the nodes which are not involved in a task
+ * skip it without any communication or cache bookkeeping. */
+static int _starpu_mpi_task_involves_node(int me, struct starpu_data_descr *descrs, int nb_data)
+{
+	int i;
+	for(i=0 ; i<nb_data ; i++)
+		if (_starpu_mpi_data_involves_node(me, descrs[i].handle, descrs[i].mode))
+			return 1;
+	return 0;
+}
+
+/* Once the arguments of a task have been walked, find out the node which
+ * executes it, from the explicit selection if any, and otherwise from the
+ * owners of the data. Only the first nb_data_unselected data, accessed before
+ * an explicit selection, are checked, -1 meaning all of them. When
+ * involved_p is not NULL, it tells whether the node has anything to do for
+ * the data of the task, and when it has not, and another node executes the
+ * task, the selection is skipped altogether. It is then set to whether the
+ * node has anything to do for the task. */
+int _starpu_mpi_task_decode_select_node(int me, int nb_nodes, int node_selected, int nb_data_unselected, int inconsistent_execute, int *involved_p, int select_node_policy, struct starpu_data_descr *descrs, int nb_data, int *xrank, int *do_execute)
+{
+	int i;
+
+	/* The data accessed before any explicit selection still have to be
+	 * checked. When there was no such selection, their owners give the
+	 * executing node */
+	if (nb_data_unselected == -1)
+		nb_data_unselected = nb_data;
+	for (i = 0; i < nb_data_unselected; i++)
+	{
+		int ret;
+		if (node_selected)
+		{
+			int unused_execute = -1, unused_inconsistent = 0, unused_xrank = -1;
+			if (involved_p && !*involved_p)
+				/* Not involved at all, we know enough */
+				break;
+			ret = _starpu_mpi_find_executee_node(descrs[i].handle, descrs[i].mode, me, &unused_execute, &unused_inconsistent, &unused_xrank);
+		}
+		else
+			ret = _starpu_mpi_find_executee_node(descrs[i].handle, descrs[i].mode, me, do_execute, &inconsistent_execute, xrank);
+		if (ret == -EINVAL)
+			return ret;
+	}
+
+	if (involved_p && !*involved_p && *xrank != -1 && !inconsistent_execute && *xrank != me && *xrank != STARPU_MPI_PER_NODE)
+	{
+		/* Another node executes the task, and we have nothing to send it,
+		 * no need to go through the node selection */
+		*do_execute = 0;
+		return 0;
+	}
+
+	if (inconsistent_execute == 1 || *xrank == -1)
+	{
+		// We need to find out which node is going to execute the codelet.
+		_STARPU_MPI_DEBUG(100, "Different nodes are owning W data. The node to execute the codelet is going to be selected with the current selection node policy. See starpu_mpi_node_selection_set_current_policy() to change the policy, or use STARPU_EXECUTE_ON_NODE or STARPU_EXECUTE_ON_DATA to specify the node\n");
+		*xrank = _starpu_mpi_select_node(me, nb_nodes, descrs, nb_data, select_node_policy);
+		*do_execute = *xrank == STARPU_MPI_PER_NODE || (me == *xrank);
+	}
+	else
+	{
+		_STARPU_MPI_DEBUG(100, "Inconsistent=%d - xrank=%d\n", inconsistent_execute, *xrank);
+		*do_execute = *xrank == STARPU_MPI_PER_NODE || (me == *xrank);
+	}
+	_STARPU_MPI_DEBUG(100, "do_execute=%d\n", *do_execute);
+
+	if (involved_p)
+		*involved_p = *do_execute || *involved_p;
+	return 0;
+}
+
+/* Walk the arguments of the task to find its data and the node which executes
+ * it. When involved_p is not NULL, the distribution of the data is consulted
+ * along the way, and it is set to whether the node has anything to do for the
+ * task. When it has not, and the executing node was explicitly selected, or
+ * is the owner of all written data, the selection of the executing node is
+ * skipped altogether. */
 static
-int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nodes, int *xrank, int *do_execute, struct starpu_data_descr **descrs_p, int *nb_data_p, int *prio_p, va_list varg_list)
+int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nodes, int *xrank, int *do_execute, int *involved_p, struct starpu_data_descr **descrs_p, int *nb_data_p, int *prio_p, va_list varg_list)
 {
 	/* XXX: _fstarpu_mpi_task_decode_v needs to be updated at the same time */
 	va_list varg_list_copy;
@@ -237,8 +365,13 @@ int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nod
 	int nb_allocated_data = 16;
 	struct starpu_data_descr *descrs;
 	int nb_data;
+	/* Number of data accessed before the executing node was explicitly selected */
+	int nb_data_unselected = -1;
+	int involved = 0;
 	int prio = 0;
 	int select_node_policy = STARPU_MPI_NODE_SELECTION_CURRENT_POLICY;
+	int i;
+	int ret;
 
 	_STARPU_TRACE_TASK_MPI_DECODE_START();
 
@@ -262,6 +395,7 @@ int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nod
 					_STARPU_MPI_DEBUG(100, "Executing on node %d\n", *xrank);
 					*do_execute = 1;
 					node_selected = 1;
+					nb_data_unselected = nb_data;
 					inconsistent_execute = 0;
 				}
 			}
@@ -277,6 +411,7 @@ int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nod
 				STARPU_ASSERT_MSG(*xrank <= nb_nodes, "Node %d to execute codelet is not a valid node (%d)", *xrank, nb_nodes);
 				*do_execute = 1;
 				node_selected = 1;
+				nb_data_unselected = nb_data;
 				inconsistent_execute = 0;
 			}
 		}
@@ -284,17 +419,8 @@ int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nod
 		{
 			starpu_data_handle_t data = va_arg(varg_list_copy, starpu_data_handle_t);
 			enum starpu_data_access_mode mode = (enum starpu_data_access_mode) arg_type;
-			if (node_selected == 0)
-			{
-				int ret = _starpu_mpi_find_executee_node(data, mode, me, do_execute, &inconsistent_execute, xrank);
-				if (ret == -EINVAL)
-				{
-					free(descrs);
-					va_end(varg_list_copy);
-					_STARPU_TRACE_TASK_MPI_DECODE_END();
-					return ret;
-				}
-			}
+			if (involved_p && !involved)
+				involved = _starpu_mpi_data_involves_node(me, data, mode);
 			if (nb_data >= nb_allocated_data)
 			{
 				nb_allocated_data *= 2;
@@ -308,23 +434,13 @@ int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nod
 		{
 			starpu_data_handle_t *datas = va_arg(varg_list_copy, starpu_data_handle_t *);
 			int nb_handles = va_arg(varg_list_copy, int);
-			int i;
 
 			for(i=0 ; i<nb_handles ; i++)
 			{
 				STARPU_ASSERT_MSG(codelet->nbuffers == STARPU_VARIABLE_NBUFFERS || nb_data < codelet->nbuffers, "Too many data passed to starpu_mpi_task_insert");
 				enum starpu_data_access_mode mode = STARPU_CODELET_GET_MODE(codelet, nb_data);
-				if (node_selected == 0)
-				{
-					int ret = _starpu_mpi_find_executee_node(datas[i], mode, me, do_execute, &inconsistent_execute, xrank);
-					if (ret == -EINVAL)
-					{
-						free(descrs);
-						va_end(varg_list_copy);
-						_STARPU_TRACE_TASK_MPI_DECODE_END();
-						return ret;
-					}
-				}
+				if (involved_p && !involved)
+					involved = _starpu_mpi_data_involves_node(me, datas[i], mode);
 				if (nb_data >= nb_allocated_data)
 				{
 					nb_allocated_data *= 2;
@@ -339,22 +455,12 @@ int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nod
 		{
 			struct starpu_data_descr *_descrs = va_arg(varg_list_copy, struct starpu_data_descr*);
 			int nb_handles = va_arg(varg_list_copy, int);
-			int i;
 
 			for(i=0 ; i<nb_handles ; i++)
 			{
 				enum starpu_data_access_mode mode = _descrs[i].mode;
-				if (node_selected == 0)
-				{
-					int ret = _starpu_mpi_find_executee_node(_descrs[i].handle, mode, me, do_execute, &inconsistent_execute, xrank);
-					if (ret == -EINVAL)
-					{
-						free(descrs);
-						va_end(varg_list_copy);
-						_STARPU_TRACE_TASK_MPI_DECODE_END();
-						return ret;
-					}
-				}
+				if (involved_p && !involved)
+					involved = _starpu_mpi_data_involves_node(me, _descrs[i].handle, mode);
 				if (nb_data >= nb_allocated_data)
 				{
 					nb_allocated_data *= 2;
@@ -578,20 +684,16 @@ int _starpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nod
 	}
 	va_end(varg_list_copy);
 
-	if (inconsistent_execute == 1 || *xrank == -1)
-	{
-		// We need to find out which node is going to execute the codelet.
-		_STARPU_MPI_DEBUG(100, "Different nodes are owning W data. The node to execute the codelet is going to be selected with the current selection node policy. See starpu_mpi_node_selection_set_current_policy() to change the policy, or use STARPU_EXECUTE_ON_NODE or STARPU_EXECUTE_ON_DATA to specify the node\n");
-		*xrank = _starpu_mpi_select_node(me, nb_nodes, descrs, nb_data, select_node_policy);
-		*do_execute = *xrank == STARPU_MPI_PER_NODE || (me == *xrank);
-	}
-	else
+	ret = _starpu_mpi_task_decode_select_node(me, nb_nodes, node_selected, nb_data_unselected, inconsistent_execute, involved_p ? &involved : NULL, select_node_policy, descrs, nb_data, xrank, do_execute);
+	if (ret == -EINVAL)
 	{
-		_STARPU_MPI_DEBUG(100, "Inconsistent=%d - xrank=%d\n", inconsistent_execute, *xrank);
-		*do_execute = *xrank == STARPU_MPI_PER_NODE || (me == *xrank);
+		free(descrs);
+		_STARPU_TRACE_TASK_MPI_DECODE_END();
+		return ret;
 	}
-	_STARPU_MPI_DEBUG(100, "do_execute=%d\n", *do_execute);
 
+	if (involved_p)
+		*involved_p = involved;
 	*descrs_p = descrs;
 	*nb_data_p = nb_data;
 	*prio_p = prio;
@@ -609,6 +711,9 @@ int _starpu_mpi_task_build_v(MPI_Comm comm, struct starpu_codelet *codelet, stru
 	struct starpu_data_descr *descrs = NULL;
 	int nb_data;
 	int prio;
+	int involved;
+	starpu_data_handle_t *readers = NULL;
+	unsigned nreaders = 0;
 
 	_STARPU_MPI_LOG_IN();
 
@@ -616,14 +721,18 @@ int _starpu_mpi_task_build_v(MPI_Comm comm, struct starpu_codelet *codelet, stru
 	starpu_mpi_comm_size(comm, &nb_nodes);
 
 	/* Find out whether we are to execute the data because we own the data to be written to. */
-	ret = _starpu_mpi_task_decode_v(codelet, me, nb_nodes, &xrank, &do_execute, &descrs, &nb_data, &prio, varg_list);
+	ret = _starpu_mpi_task_decode_v(codelet, me, nb_nodes, &xrank, &do_execute, &involved, &descrs, &nb_data, &prio, varg_list);
 	if (ret < 0)
 		return ret;
 
 	_STARPU_TRACE_TASK_MPI_PRE_START();
+	if (do_execute == 1 && _starpu_mpi_cache_auto_enabled())
+		_STARPU_MPI_MALLOC(readers, nb_data * sizeof(*readers));
 	/* Send and receive data as requested */
-	for(i=0 ; i<nb_data ; i++)
+	for(i=0 ; involved && i<nb_data ; i++)
 	{
+		int reader = 0;
+
                 if (descrs[i].handle && descrs[i].handle->mpi_data)
 		{
 			char* redux_map = starpu_mpi_data_get_redux_map(descrs[i].handle);
@@ -632,7 +741,9 @@ int _starpu_mpi_task_build_v(MPI_Comm comm, struct starpu_codelet *codelet, stru
 				_starpu_mpi_redux_wrapup_data(descrs[i].handle);
 			}
 		}
-		_starpu_mpi_exchange_data_before_execution(descrs[i].handle, descrs[i].mode, me, xrank, do_execute, prio, comm);
+		__starpu_mpi_exchange_data_before_execution(descrs[i].handle, descrs[i].mode, me, xrank, do_execute, prio, comm, readers ? &reader : NULL);
+		if (reader)
+			readers[nreaders++] = descrs[i].handle;
 	}
 
 	if (xrank_p)
@@ -662,6 +773,11 @@ int _starpu_mpi_task_build_v(MPI_Comm comm, struct starpu_codelet *codelet, stru
 		_starpu_task_insert_create(codelet, *task, varg_list_copy);
 		va_end(varg_list_copy);
 
+		if (nreaders)
+			/* Release the received copies after the task */
+			_starpu_mpi_cache_readers_attach(*task, readers, nreaders);
+		free(readers);
+
 		if ((*task)->cl)
 		{
 			/* we suppose the current context is not going to change between now and the execution of the task */
@@ -696,6 +812,17 @@ int _starpu_mpi_task_postbuild_v(MPI_Comm comm, int xrank, int do_execute, struc
 	_STARPU_TRACE_TASK_MPI_POST_START();
 	starpu_mpi_comm_rank(comm, &me);
 
+	if (!do_execute && !_starpu_mpi_task_involves_node(me, descrs, nb_data))
+	{
+		/* Fast path, we only need to record the modification */
+		for(i=0 ; i<nb_data ; i++)
+			if (descrs[i].mode & STARPU_W && !(descrs[i].mode & STARPU_MPI_REDUX))
+				_starpu_mpi_data_get(descrs[i].handle)->modified = 1;
+		_STARPU_TRACE_TASK_MPI_POST_END();
+		_STARPU_MPI_LOG_OUT();
+		return 0;
+	}
+
 	for(i=0 ; i<nb_data ; i++)
 	{
 		if ((descrs[i].mode & STARPU_REDUX || descrs[i].mode & STARPU_MPI_REDUX) && descrs[i].handle)
@@ -760,6 +887,8 @@ int _starpu_mpi_task_insert_v(MPI_Comm comm, struct starpu_codelet *codelet, va_
 	if (ret == 1)
 	{
 		do_execute = 1;
+		if (lb_task_to_submit_hook)
+			lb_task_to_submit_hook(task);
 		ret = starpu_task_submit(task);
 
 		if (STARPU_UNLIKELY(ret == -ENODEV))
@@ -783,6 +912,10 @@ int _starpu_mpi_task_insert_v(MPI_Comm comm, struct starpu_codelet *codelet, va_
 	if (ret == 1 && pre_submit_hook)
 		pre_submit_hook(task);
 
+	/* All nodes get here, in the same order of task insertions */
+	if (lb_inserted_task_hook)
+		lb_inserted_task_hook(comm);
+
 	return val;
 }
 
@@ -846,7 +979,7 @@ int starpu_mpi_task_post_build(MPI_Comm comm, struct starpu_codelet *codelet, ..
 
 	va_start(varg_list, codelet);
 	/* Find out whether we are to execute the data because we own the data to be written to. */
-	ret = _starpu_mpi_task_decode_v(codelet, me, nb_nodes, &xrank, &do_execute, &descrs, &nb_data, &prio, varg_list);
+	ret = _starpu_mpi_task_decode_v(codelet, me, nb_nodes, &xrank, &do_execute, NULL, &descrs, &nb_data, &prio, varg_list);
 	va_end(varg_list);
 	if (ret < 0)
 		return ret;
@@ -868,7 +1001,7 @@ int starpu_mpi_task_post_build_v(MPI_Comm comm, struct starpu_codelet *codelet,
 	starpu_mpi_comm_size(comm, &nb_nodes);
 
 	/* Find out whether we are to execute the data because we own the data to be written to. */
-	ret = _starpu_mpi_task_decode_v(codelet, me, nb_nodes, &xrank, &do_execute, &descrs, &nb_data, &prio, varg_list);
+	ret = _starpu_mpi_task_decode_v(codelet, me, nb_nodes, &xrank, &do_execute, NULL, &descrs, &nb_data, &prio, varg_list);
 	if (ret < 0)
 		return ret;
 
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2013-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2013-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -26,9 +26,20 @@ extern "C"
 
 int _starpu_mpi_find_executee_node(starpu_data_handle_t data, enum starpu_data_access_mode mode, int me, int *do_execute, int *inconsistent_execute, int *xrank);
 int _starpu_mpi_exchange_data_before_execution(starpu_data_handle_t data, enum starpu_data_access_mode mode, int me, int xrank, int do_execute, int prio, MPI_Comm comm);
+/** Whether the node has anything to do with \p data for a task it does not
+ * execute, from the distribution recorded in the MPI data of the handle */
+int _starpu_mpi_data_involves_node(int me, starpu_data_handle_t data, enum starpu_data_access_mode mode);
+/** Find out the node which executes a task once its arguments have been
+ * walked, shared by the C and Fortran decoders of the task arguments */
+int _starpu_mpi_task_decode_select_node(int me, int nb_nodes, int node_selected, int nb_data_unselected, int inconsistent_execute, int *involved_p, int select_node_policy, struct starpu_data_descr *descrs, int nb_data, int *xrank, int *do_execute);
 int _starpu_mpi_task_postbuild_v(MPI_Comm comm, int xrank, int do_execute, struct starpu_data_descr *descrs, int nb_data, int prio);
 void _starpu_mpi_redux_wrapup_datas();
 
+/** Register the hooks of the load balancer: \p task_to_submit is called for
+ * each task to be executed locally, just before its submission, and \p
+ * inserted_task is called by all nodes at the end of each task insertion */
+void _starpu_mpi_lb_hooks_register(void (*task_to_submit)(struct starpu_task *task), void (*inserted_task)(MPI_Comm comm));
+
 #ifdef __cplusplus
 }
 #endif
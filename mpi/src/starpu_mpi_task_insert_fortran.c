@@ -23,8 +23,9 @@
 #include <util/starpu_task_insert_utils.h>
 
 #ifdef HAVE_MPI_COMM_F2C
+/* Same as _starpu_mpi_task_decode_v, for the arguments given by Fortran */
 static
-int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nodes, int *xrank, int *do_execute, struct starpu_data_descr **descrs_p, int *nb_data_p, int *prio_p, void **arglist)
+int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_nodes, int *xrank, int *do_execute, int *involved_p, struct starpu_data_descr **descrs_p, int *nb_data_p, int *prio_p, void **arglist)
 {
 	int arg_i = 0;
 	int inconsistent_execute = 0;
@@ -32,8 +33,12 @@ int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_no
 	int nb_allocated_data = 16;
 	struct starpu_data_descr *descrs;
 	int nb_data;
+	/* Number of data accessed before the executing node was explicitly selected */
+	int nb_data_unselected = -1;
+	int involved = 0;
 	int prio = 0;
 	int select_node_policy = STARPU_MPI_NODE_SELECTION_CURRENT_POLICY;
+	int ret;
 
 	_STARPU_TRACE_TASK_MPI_DECODE_START();
 
@@ -59,6 +64,7 @@ int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_no
 					_STARPU_MPI_DEBUG(100, "Executing on node %d\n", *xrank);
 					*do_execute = 1;
 					node_selected = 1;
+					nb_data_unselected = nb_data;
 					inconsistent_execute = 0;
 				}
 			}
@@ -75,6 +81,7 @@ int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_no
 				STARPU_ASSERT_MSG(*xrank <= nb_nodes, "Node %d to execute codelet is not a valid node (%d)", *xrank, nb_nodes);
 				*do_execute = 1;
 				node_selected = 1;
+				nb_data_unselected = nb_data;
 				inconsistent_execute = 0;
 			}
 		}
@@ -83,16 +90,8 @@ int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_no
 			arg_i++;
 			starpu_data_handle_t data = arglist[arg_i];
 			enum starpu_data_access_mode mode = (enum starpu_data_access_mode) arg_type;
-			if (node_selected == 0)
-			{
-				int ret = _starpu_mpi_find_executee_node(data, mode, me, do_execute, &inconsistent_execute, xrank);
-				if (ret == -EINVAL)
-				{
-					free(descrs);
-					_STARPU_TRACE_TASK_MPI_DECODE_END();
-					return ret;
-				}
-			}
+			if (involved_p && !involved)
+				involved = _starpu_mpi_data_involves_node(me, data, mode);
 			if (nb_data >= nb_allocated_data)
 			{
 				nb_allocated_data *= 2;
@@ -114,16 +113,8 @@ int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_no
 			{
 				STARPU_ASSERT_MSG(codelet->nbuffers == STARPU_VARIABLE_NBUFFERS || nb_data < codelet->nbuffers, "Too many data passed to starpu_mpi_task_insert");
 				enum starpu_data_access_mode mode = STARPU_CODELET_GET_MODE(codelet, nb_data);
-				if (node_selected == 0)
-				{
-					int ret = _starpu_mpi_find_executee_node(datas[i], mode, me, do_execute, &inconsistent_execute, xrank);
-					if (ret == -EINVAL)
-					{
-						free(descrs);
-						_STARPU_TRACE_TASK_MPI_DECODE_END();
-						return ret;
-					}
-				}
+				if (involved_p && !involved)
+					involved = _starpu_mpi_data_involves_node(me, datas[i], mode);
 				if (nb_data >= nb_allocated_data)
 				{
 					nb_allocated_data *= 2;
@@ -145,16 +136,8 @@ int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_no
 			for(i=0 ; i<nb_handles ; i++)
 			{
 				enum starpu_data_access_mode mode = _descrs[i].mode;
-				if (node_selected == 0)
-				{
-					int ret = _starpu_mpi_find_executee_node(_descrs[i].handle, mode, me, do_execute, &inconsistent_execute, xrank);
-					if (ret == -EINVAL)
-					{
-						free(descrs);
-						_STARPU_TRACE_TASK_MPI_DECODE_END();
-						return ret;
-					}
-				}
+				if (involved_p && !involved)
+					involved = _starpu_mpi_data_involves_node(me, _descrs[i].handle, mode);
 				if (nb_data >= nb_allocated_data)
 				{
 					nb_allocated_data *= 2;
@@ -423,20 +406,16 @@ int _fstarpu_mpi_task_decode_v(struct starpu_codelet *codelet, int me, int nb_no
 		arg_i++;
 	}
 
-	if (inconsistent_execute == 1 || *xrank == -1)
-	{
-		// We need to find out which node is going to execute the codelet.
-		_STARPU_MPI_DISP("Different nodes are owning W data. The node to execute the codelet is going to be selected with the current selection node policy. See starpu_mpi_node_selection_set_current_policy() to change the policy, or use STARPU_EXECUTE_ON_NODE or STARPU_EXECUTE_ON_DATA to specify the node\n");
-		*xrank = _starpu_mpi_select_node(me, nb_nodes, descrs, nb_data, select_node_policy);
-		*do_execute = *xrank == STARPU_MPI_PER_NODE || (me == *xrank);
-	}
-	else
+	ret = _starpu_mpi_task_decode_select_node(me, nb_nodes, node_selected, nb_data_unselected, inconsistent_execute, involved_p ? &involved : NULL, select_node_policy, descrs, nb_data, xrank, do_execute);
+	if (ret == -EINVAL)
 	{
-		_STARPU_MPI_DEBUG(100, "Inconsistent=%d - xrank=%d\n", inconsistent_execute, *xrank);
-		*do_execute = *xrank == STARPU_MPI_PER_NODE || (me == *xrank);
+		free(descrs);
+		_STARPU_TRACE_TASK_MPI_DECODE_END();
+		return ret;
 	}
-	_STARPU_MPI_DEBUG(100, "do_execute=%d\n", *do_execute);
 
+	if (involved_p)
+		*involved_p = involved;
 	*descrs_p = descrs;
 	*nb_data_p = nb_data;
 	*prio_p = prio;
@@ -454,6 +433,7 @@ int _fstarpu_mpi_task_build_v(MPI_Comm comm, struct starpu_codelet *codelet, str
 	struct starpu_data_descr *descrs;
 	int nb_data;
 	int prio;
+	int involved;
 
 	_STARPU_MPI_LOG_IN();
 
@@ -461,13 +441,13 @@ int _fstarpu_mpi_task_build_v(MPI_Comm comm, struct starpu_codelet *codelet, str
 	starpu_mpi_comm_size(comm, &nb_nodes);
 
 	/* Find out whether we are to execute the data because we own the data to be written to. */
-	ret = _fstarpu_mpi_task_decode_v(codelet, me, nb_nodes, &xrank, &do_execute, &descrs, &nb_data, &prio, arglist);
+	ret = _fstarpu_mpi_task_decode_v(codelet, me, nb_nodes, &xrank, &do_execute, &involved, &descrs, &nb_data, &prio, arglist);
 	if (ret < 0)
 		return ret;
 
 	_STARPU_TRACE_TASK_MPI_PRE_START();
 	/* Send and receive data as requested */
-	for(i=0 ; i<nb_data ; i++)
+	for(i=0 ; involved && i<nb_data ; i++)
 	{
 		_starpu_mpi_exchange_data_before_execution(descrs[i].handle, descrs[i].mode, me, xrank, do_execute, prio, comm);
 	}
@@ -591,7 +571,7 @@ void fstarpu_mpi_task_post_build(void **arglist)
 	starpu_mpi_comm_size(MPI_Comm_f2c(comm), &nb_nodes);
 
 	/* Find out whether we are to execute the data because we own the data to be written to. */
-	ret = _fstarpu_mpi_task_decode_v(codelet, me, nb_nodes, &xrank, &do_execute, &descrs, &nb_data, &prio, arglist+2);
+	ret = _fstarpu_mpi_task_decode_v(codelet, me, nb_nodes, &xrank, &do_execute, NULL, &descrs, &nb_data, &prio, arglist+2);
 	STARPU_ASSERT(ret >= 0);
 
 	ret = _starpu_mpi_task_postbuild_v(MPI_Comm_f2c(comm), xrank, do_execute, descrs, nb_data, prio);
@@ -0,0 +1,221 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Node 1 reads several times vectors owned by node 0, with
+ * STARPU_MPI_CACHE_AUTO set. Once the tasks are over, both nodes have to
+ * drop the copies, which are thus sent again at the next round, even the
+ * ones which node 0 did not modify.
+ */
+
+#define NDATA 4
+#define NREADERS 3
+#define NX 1024
+#define NROUNDS 3
+/* In ms */
+#define TIMEOUT 10000
+
+void accumulate_cpu(void *descr[], void *_args)
+{
+	long *v = (long *)STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned nx = STARPU_VECTOR_GET_NX(descr[0]);
+	long *sum = (long *)STARPU_VARIABLE_GET_PTR(descr[1]);
+	unsigned i;
+	(void)_args;
+
+	for (i = 0; i < nx; i++)
+		*sum += v[i];
+}
+
+struct starpu_codelet accumulate_cl =
+{
+	.cpu_funcs = {accumulate_cpu},
+	.nbuffers = 2,
+	.modes = {STARPU_R, STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+void increment_cpu(void *descr[], void *_args)
+{
+	long *v = (long *)STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned nx = STARPU_VECTOR_GET_NX(descr[0]);
+	unsigned i;
+	(void)_args;
+
+	for (i = 0; i < nx; i++)
+		v[i]++;
+}
+
+struct starpu_codelet increment_cl =
+{
+	.cpu_funcs = {increment_cpu},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+#if !defined(STARPU_HAVE_SETENV) || !defined(STARPU_USE_MPI_MPI) || defined(STARPU_SIMGRID) || MPI_VERSION < 3
+#warning setenv is not defined or the automatic release of the cache is not supported. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+/* Wait for the copies of the vectors to be dropped on our side, return
+ * whether they were */
+static int wait_dropped(int rank, starpu_data_handle_t *handles)
+{
+	int i, cached, waited = 0;
+
+	do
+	{
+		cached = 0;
+		for (i = 0; i < NDATA; i++)
+			cached += rank == 0 ? starpu_mpi_cached_send(handles[i], 1) : starpu_mpi_cached_receive(handles[i]);
+		if (!cached)
+			return 1;
+		starpu_usleep(1000);
+	}
+	while (++waited < TIMEOUT);
+
+	FPRINTF_MPI(stderr, "%d copies were not dropped\n", cached);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ret, rank, size, mpi_init;
+	static long vectors[NDATA][NX];
+	long sums[NDATA];
+	starpu_data_handle_t vector_handles[NDATA], sum_handles[NDATA];
+	size_t *comm_amount;
+	int i, j, round, err = 0;
+
+	setenv("STARPU_MPI_CACHE_AUTO", "1", 1);
+	setenv("STARPU_MPI_STATS", "1", 1);
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2 || !starpu_mpi_cache_is_enabled() || starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes, the cache and a CPU worker.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	for (i = 0; i < NDATA; i++)
+	{
+		if (rank == 0)
+		{
+			for (j = 0; j < NX; j++)
+				vectors[i][j] = i;
+			starpu_vector_data_register(&vector_handles[i], STARPU_MAIN_RAM, (uintptr_t)vectors[i], NX, sizeof(long));
+		}
+		else
+			starpu_vector_data_register(&vector_handles[i], -1, (uintptr_t)NULL, NX, sizeof(long));
+		starpu_mpi_data_register(vector_handles[i], i, 0);
+
+		sums[i] = 0;
+		if (rank == 1)
+			starpu_variable_data_register(&sum_handles[i], STARPU_MAIN_RAM, (uintptr_t)&sums[i], sizeof(long));
+		else
+			starpu_variable_data_register(&sum_handles[i], -1, (uintptr_t)NULL, sizeof(long));
+		starpu_mpi_data_register(sum_handles[i], NDATA+i, 1);
+	}
+
+	for (round = 0; round < NROUNDS; round++)
+	{
+		for (i = 0; i < NDATA; i++)
+			for (j = 0; j < NREADERS; j++)
+			{
+				ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &accumulate_cl, STARPU_R, vector_handles[i], STARPU_RW, sum_handles[i], 0);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+			}
+
+		starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+		/* The readers are over, the copies are dropped without any
+		 * other task submission */
+		if (rank <= 1 && !wait_dropped(rank, vector_handles))
+			err = 1;
+
+		for (i = 0; i < NDATA; i += 2)
+		{
+			ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &increment_cl, STARPU_RW, vector_handles[i], 0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+		}
+	}
+
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+	for (i = 0; i < NDATA; i++)
+	{
+		starpu_data_unregister(vector_handles[i]);
+		starpu_data_unregister(sum_handles[i]);
+	}
+
+	if (rank == 1)
+	{
+		for (i = 0; i < NDATA; i++)
+		{
+			long expected = 0;
+			for (round = 0; round < NROUNDS; round++)
+				/* The even vectors are incremented after each round */
+				expected += NREADERS * (i + (i % 2 ? 0 : round)) * (long) NX;
+			if (sums[i] != expected)
+			{
+				FPRINTF_MPI(stderr, "incorrect sum %ld for vector %d, expected %ld\n", sums[i], i, expected);
+				err = 1;
+			}
+		}
+	}
+
+	comm_amount = malloc(size * sizeof(size_t));
+	starpu_mpi_comm_stats_retrieve(comm_amount);
+	if (rank == 0)
+	{
+		/* All the vectors are sent at each round. They may be sent
+		 * more often, when the readers of a round are over before
+		 * the next ones are submitted */
+		size_t expected = NROUNDS * NDATA * NX * sizeof(long);
+		if (comm_amount[1] < expected)
+		{
+			FPRINTF_MPI(stderr, "sent %ld bytes to node 1 instead of at least %ld\n", (long) comm_amount[1], (long) expected);
+			err = 1;
+		}
+	}
+	free(comm_amount);
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return err;
+}
+#endif
@@ -0,0 +1,207 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Node 1 repeatedly reads vectors owned by node 0, with STARPU_MPI_CACHE_MAX_SIZE
+ * limiting the cache to 4 of them. One vector is read all the time and stays
+ * in the cache, the other ones are read in turn and have to be evicted and
+ * sent again. Node 0 modifies half of them between the rounds.
+ */
+
+#define NDATA 8
+#define NX (256*1024/sizeof(long))
+#define NROUNDS 3
+
+void accumulate_cpu(void *descr[], void *_args)
+{
+	long *v = (long *)STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned nx = STARPU_VECTOR_GET_NX(descr[0]);
+	long *sum = (long *)STARPU_VARIABLE_GET_PTR(descr[1]);
+	unsigned i;
+	(void)_args;
+
+	for (i = 0; i < nx; i++)
+		*sum += v[i];
+}
+
+struct starpu_codelet accumulate_cl =
+{
+	.cpu_funcs = {accumulate_cpu},
+	.nbuffers = 2,
+	.modes = {STARPU_R, STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+void increment_cpu(void *descr[], void *_args)
+{
+	long *v = (long *)STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned nx = STARPU_VECTOR_GET_NX(descr[0]);
+	unsigned i;
+	(void)_args;
+
+	for (i = 0; i < nx; i++)
+		v[i]++;
+}
+
+struct starpu_codelet increment_cl =
+{
+	.cpu_funcs = {increment_cpu},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+int main(int argc, char **argv)
+{
+	int ret, rank, size, mpi_init;
+	/* The last vector is the one read all the time */
+	static long vectors[NDATA+1][NX];
+	long sums[NDATA+1];
+	starpu_data_handle_t vector_handles[NDATA+1], sum_handles[NDATA+1];
+	size_t *comm_amount;
+	int i, j, round, err = 0;
+
+	setenv("STARPU_MPI_CACHE_MAX_SIZE", "1", 1);
+	setenv("STARPU_MPI_STATS", "1", 1);
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2 || !starpu_mpi_cache_is_enabled() || starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes, the cache and a CPU worker.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	for (i = 0; i <= NDATA; i++)
+	{
+		if (rank == 0)
+		{
+			for (j = 0; j < (int) NX; j++)
+				vectors[i][j] = i;
+			starpu_vector_data_register(&vector_handles[i], STARPU_MAIN_RAM, (uintptr_t)vectors[i], NX, sizeof(long));
+		}
+		else
+			starpu_vector_data_register(&vector_handles[i], -1, (uintptr_t)NULL, NX, sizeof(long));
+		starpu_mpi_data_register(vector_handles[i], i, 0);
+
+		sums[i] = 0;
+		if (rank == 1)
+			starpu_variable_data_register(&sum_handles[i], STARPU_MAIN_RAM, (uintptr_t)&sums[i], sizeof(long));
+		else
+			starpu_variable_data_register(&sum_handles[i], -1, (uintptr_t)NULL, sizeof(long));
+		starpu_mpi_data_register(sum_handles[i], NDATA+1+i, 1);
+	}
+
+	for (round = 0; round < NROUNDS; round++)
+	{
+		for (i = 0; i < NDATA; i++)
+		{
+			ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &accumulate_cl, STARPU_R, vector_handles[NDATA], STARPU_RW, sum_handles[NDATA], 0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+			ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &accumulate_cl, STARPU_R, vector_handles[i], STARPU_RW, sum_handles[i], 0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+		}
+		for (i = 0; i < NDATA; i += 2)
+		{
+			ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &increment_cl, STARPU_RW, vector_handles[i], 0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+		}
+	}
+
+	starpu_task_wait_for_all();
+
+	if (rank == 1)
+	{
+		/* The evicted copies were dropped */
+		int allocated = 0;
+		for (i = 0; i <= NDATA; i++)
+			allocated += starpu_data_test_if_allocated_on_node(vector_handles[i], STARPU_MAIN_RAM);
+		if (allocated > 4)
+		{
+			FPRINTF_MPI(stderr, "%d vectors are still allocated\n", allocated);
+			err = 1;
+		}
+	}
+
+	for (i = 0; i <= NDATA; i++)
+	{
+		starpu_data_unregister(vector_handles[i]);
+		starpu_data_unregister(sum_handles[i]);
+	}
+
+	if (rank == 1)
+	{
+		for (i = 0; i <= NDATA; i++)
+		{
+			long expected = 0;
+			for (round = 0; round < NROUNDS; round++)
+			{
+				if (i == NDATA)
+					expected += NDATA * NDATA * (long) NX;
+				else
+					/* The even vectors are incremented after each round */
+					expected += (i + (i % 2 ? 0 : round)) * (long) NX;
+			}
+			if (sums[i] != expected)
+			{
+				FPRINTF_MPI(stderr, "incorrect sum %ld for vector %d, expected %ld\n", sums[i], i, expected);
+				err = 1;
+			}
+		}
+	}
+
+	comm_amount = malloc(size * sizeof(size_t));
+	starpu_mpi_comm_stats_retrieve(comm_amount);
+	if (rank == 0)
+	{
+		/* The vector read all the time is sent once, the others at each round */
+		size_t expected = (NROUNDS * NDATA + 1) * NX * sizeof(long);
+		if (comm_amount[1] != expected)
+		{
+			FPRINTF_MPI(stderr, "sent %ld bytes to node 1 instead of %ld\n", (long) comm_amount[1], (long) expected);
+			err = 1;
+		}
+	}
+	free(comm_amount);
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return err;
+}
+#endif
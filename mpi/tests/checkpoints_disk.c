@@ -0,0 +1,278 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <dirent.h>
+#include <unistd.h>
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Checkpoint some data and the round number to the local disk of each node
+ * after each round, and modify them once more. Restoring the last checkpoint
+ * has to bring back their values. At most one older checkpoint is still
+ * available, since a checkpoint submitted while the previous one is being
+ * written supersedes it. Restoring a checkpoint which misses a file has to
+ * fail without modifying any data.
+ */
+
+#define NDATA 4
+#define NROUNDS 3
+#define ROUND_TAG 100
+
+void increment_cpu(void *descr[], void *_args)
+{
+	int *val = (int *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	(void)_args;
+	(*val)++;
+}
+
+struct starpu_codelet increment_cl =
+{
+	.cpu_funcs = {increment_cpu},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+static int comm_size;
+
+static int backup_of(int rank)
+{
+	return (rank+1) % comm_size;
+}
+
+static int check(starpu_data_handle_t *handles, int *values, int round, int expected_round, int rank)
+{
+	int i, err = 0;
+
+	if (round != expected_round)
+	{
+		FPRINTF_MPI(stderr, "restored round %d instead of %d\n", round, expected_round);
+		err = 1;
+	}
+	for (i = 0; i < NDATA; i++)
+	{
+		if (starpu_mpi_data_get_rank(handles[i]) != rank)
+			continue;
+		starpu_data_acquire(handles[i], STARPU_R);
+		if (values[i] != i + expected_round + 1)
+		{
+			FPRINTF_MPI(stderr, "restored value %d for data %d instead of %d\n", values[i], i, i + expected_round + 1);
+			err = 1;
+		}
+		starpu_data_release(handles[i]);
+	}
+	return err;
+}
+
+/* Remove the file of the round number for the slot holding the given instance */
+static int remove_round_file(const char *path, int rank, int instance)
+{
+	char name[PATH_MAX];
+	int slot_instance[2];
+	int slot;
+	FILE *f;
+
+	snprintf(name, sizeof(name), "%s/cp42_%d", path, rank);
+	f = fopen(name, "r");
+	if (!f)
+		return -1;
+	if (fscanf(f, "%d %d", &slot_instance[0], &slot_instance[1]) != 2)
+	{
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+
+	for (slot = 0; slot < 2; slot++)
+		if (slot_instance[slot] == instance)
+		{
+			snprintf(name, sizeof(name), "%s/cp42_%d_%d_%d", path, rank, ROUND_TAG, slot);
+			return unlink(name);
+		}
+	return -1;
+}
+
+static void cleanup(const char *path)
+{
+	DIR *dir = opendir(path);
+	struct dirent *entry;
+	char name[PATH_MAX];
+
+	if (!dir)
+		return;
+	while ((entry = readdir(dir)))
+	{
+		if (entry->d_name[0] == '.')
+			continue;
+		snprintf(name, sizeof(name), "%s/%s", path, entry->d_name);
+		unlink(name);
+	}
+	closedir(dir);
+	rmdir(path);
+}
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+int main(int argc, char **argv)
+{
+	int ret, rank, mpi_init;
+	int values[NDATA];
+	starpu_data_handle_t handles[NDATA];
+	starpu_mpi_checkpoint_template_t cp_template;
+	char path[] = "/tmp/starpu_mpi_checkpoints_disk_XXXXXX";
+	int i, round, instance, available = 0, err = 0;
+
+	if (!_starpu_mkdtemp(path))
+		return STARPU_TEST_SKIPPED;
+	setenv("STARPU_MPI_CHECKPOINT_DISK", path, 1);
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &comm_size);
+
+	if (comm_size < 2 || starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes and a CPU worker.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		cleanup(path);
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	ret = starpu_mpi_checkpoint_init();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_checkpoint_init");
+
+	starpu_mpi_checkpoint_template_create(&cp_template, 42, 0);
+	for (i = 0; i < NDATA; i++)
+	{
+		int owner = i % comm_size;
+		values[i] = i;
+		if (owner == rank)
+			starpu_variable_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t)&values[i], sizeof(values[i]));
+		else
+			starpu_variable_data_register(&handles[i], -1, (uintptr_t)NULL, sizeof(values[i]));
+		starpu_mpi_data_register(handles[i], i, owner);
+		starpu_mpi_checkpoint_template_add_entry(&cp_template, STARPU_R, handles[i], backup_of(owner), 0);
+	}
+	starpu_mpi_checkpoint_template_add_entry(&cp_template, STARPU_VALUE, &round, sizeof(round), (starpu_mpi_tag_t) ROUND_TAG, backup_of, 0);
+	starpu_mpi_checkpoint_template_freeze(&cp_template);
+
+	for (round = 0; round < NROUNDS; round++)
+	{
+		for (i = 0; i < NDATA; i++)
+		{
+			ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &increment_cl, STARPU_RW, handles[i], 0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+		}
+		ret = starpu_mpi_checkpoint_template_submit(cp_template, 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_checkpoint_template_submit");
+	}
+
+	/* These are not checkpointed */
+	for (i = 0; i < NDATA; i++)
+	{
+		ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &increment_cl, STARPU_RW, handles[i], 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+	}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+	/* Which older instance is still there depends on how fast the
+	 * writes went */
+	for (instance = 1; instance < NROUNDS; instance++)
+	{
+		ret = starpu_mpi_checkpoint_template_restore(cp_template, instance);
+		if (ret == -ENODEV)
+		{
+			FPRINTF_MPI(stderr, "Could not use %s for disk checkpoints\n", path);
+			err = STARPU_TEST_SKIPPED;
+			goto out;
+		}
+		if (ret == -ENOENT)
+			continue;
+		if (ret != instance)
+		{
+			FPRINTF_MPI(stderr, "restored instance %d instead of %d\n", ret, instance);
+			err = 1;
+		}
+		err |= check(handles, values, round, instance-1, rank);
+		available++;
+	}
+	if (available > 1)
+	{
+		FPRINTF_MPI(stderr, "%d older instances are available\n", available);
+		err = 1;
+	}
+
+	ret = starpu_mpi_checkpoint_template_restore(cp_template, -1);
+	if (ret != NROUNDS)
+	{
+		FPRINTF_MPI(stderr, "restored instance %d instead of %d\n", ret, NROUNDS);
+		err = 1;
+	}
+	err |= check(handles, values, round, NROUNDS-1, rank);
+
+	/* The round number comes last in the template, the data would all
+	 * have been overwritten if the files were not checked first */
+	for (i = 0; i < NDATA; i++)
+	{
+		ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &increment_cl, STARPU_RW, handles[i], 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+	}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	round = NROUNDS;
+	if (remove_round_file(path, rank, NROUNDS))
+	{
+		FPRINTF_MPI(stderr, "could not remove the file of the round number\n");
+		err = 1;
+	}
+	ret = starpu_mpi_checkpoint_template_restore(cp_template, NROUNDS);
+	if (ret != -ENOENT)
+	{
+		FPRINTF_MPI(stderr, "restored incomplete instance %d\n", NROUNDS);
+		err = 1;
+	}
+	err |= check(handles, values, round, NROUNDS, rank);
+
+out:
+	/* Let the acknowledgments and discards of the checkpoints go through */
+	starpu_sleep(1);
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+	starpu_mpi_checkpoint_shutdown();
+	for (i = 0; i < NDATA; i++)
+		starpu_data_unregister(handles[i]);
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	cleanup(path);
+
+	return err;
+}
+#endif
@@ -0,0 +1,160 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Node 0 modifies some of its data between the checkpoints, which node 1
+ * backs up. Only the data modified since the previous checkpoint must be
+ * sent, whether they were modified by starpu_mpi_task_insert(),
+ * starpu_task_insert() or starpu_data_acquire(). For each data, node 0 also
+ * tells node 1 whether it has changed.
+ */
+
+#define NDATA 4
+#define NX 256
+
+void increment_cpu(void *descr[], void *_args)
+{
+	int *val = (int *)STARPU_VECTOR_GET_PTR(descr[0]);
+	unsigned n = STARPU_VECTOR_GET_NX(descr[0]);
+	unsigned i;
+	(void)_args;
+	for (i = 0; i < n; i++)
+		val[i]++;
+}
+
+struct starpu_codelet increment_cl =
+{
+	.cpu_funcs = {increment_cpu},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+int main(int argc, char **argv)
+{
+	int ret, rank, size, mpi_init;
+	int values[NDATA][NX];
+	starpu_data_handle_t handles[NDATA];
+	starpu_mpi_checkpoint_template_t cp_template;
+	size_t *comm_amount, expected;
+	int i, j, err = 0;
+
+	setenv("STARPU_MPI_CACHE", "0", 1);
+	setenv("STARPU_MPI_STATS", "1", 1);
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size != 2 || starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need 2 processes and a CPU worker.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	ret = starpu_mpi_checkpoint_init();
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_checkpoint_init");
+
+	starpu_mpi_checkpoint_template_create(&cp_template, 42, 0);
+	for (i = 0; i < NDATA; i++)
+	{
+		for (j = 0; j < NX; j++)
+			values[i][j] = rank == 0 ? i : -1;
+		starpu_vector_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t)values[i], NX, sizeof(values[i][0]));
+		starpu_mpi_data_register(handles[i], i, 0);
+		starpu_mpi_checkpoint_template_add_entry(&cp_template, STARPU_R, handles[i], 1, 0);
+	}
+	starpu_mpi_checkpoint_template_freeze(&cp_template);
+
+	/* The first checkpoint sends all the data */
+	for (i = 0; i < NDATA; i++)
+	{
+		ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &increment_cl, STARPU_RW, handles[i], 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+	}
+	ret = starpu_mpi_checkpoint_template_submit(cp_template, 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_checkpoint_template_submit");
+
+	/* The second one only the data 1, modified by a task not known to StarPU-MPI */
+	if (rank == 0)
+	{
+		ret = starpu_task_insert(&increment_cl, STARPU_RW, handles[1], 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	ret = starpu_mpi_checkpoint_template_submit(cp_template, 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_checkpoint_template_submit");
+
+	/* The third one only the data 2, modified by the application */
+	if (rank == 0)
+	{
+		ret = starpu_data_acquire(handles[2], STARPU_W);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		values[2][0] = 42;
+		starpu_data_release(handles[2]);
+	}
+	ret = starpu_mpi_checkpoint_template_submit(cp_template, 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_checkpoint_template_submit");
+
+	/* And the last one none */
+	ret = starpu_mpi_checkpoint_template_submit(cp_template, 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_checkpoint_template_submit");
+
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	/* Let the acknowledgments and discards of the checkpoints go through */
+	starpu_sleep(1);
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+
+	comm_amount = malloc(size * sizeof(size_t));
+	starpu_mpi_comm_stats_retrieve(comm_amount);
+	/* The data sent, and whether each data has changed at each checkpoint */
+	expected = (NDATA + 2) * sizeof(values[0]) + 4 * NDATA * sizeof(int);
+	if (rank == 0 && comm_amount[1] != expected)
+	{
+		FPRINTF_MPI(stderr, "sent %ld bytes to node 1 instead of %ld\n", (long) comm_amount[1], (long) expected);
+		err = 1;
+	}
+	free(comm_amount);
+
+	starpu_mpi_checkpoint_shutdown();
+	for (i = 0; i < NDATA; i++)
+		starpu_data_unregister(handles[i]);
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return err;
+}
+#endif
@@ -0,0 +1,236 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Node 0 broadcasts a variable, a matrix and a CSR data with cooperative
+ * sends, several times with the same tags, with STARPU_MPI_RANKS_PER_HOST
+ * making consecutive pairs of nodes pretend to share a host, so that the data
+ * is sent once to each pair, and forwarded to the other node of the pair.
+ * The matrices are padded differently on each node. The odd rounds let the
+ * data arrive before some receives are posted. The communication statistics
+ * then tell whether exactly one copy crossed each host.
+ */
+
+#define NX 20
+#define NY 10
+#define NROWS 10
+#define NNZ_ROW 3
+#define NROUNDS 4
+
+struct data
+{
+	int variable;
+	int matrix[(NX+3)*NY];
+	int nzval[NROWS*NNZ_ROW];
+	uint32_t colind[NROWS*NNZ_ROW];
+	uint32_t rowptr[NROWS+1];
+	starpu_data_handle_t handles[3];
+};
+
+static unsigned ld(int rank)
+{
+	return NX + rank % 3;
+}
+
+static void data_fill(struct data *data, int rank, int round)
+{
+	int value = rank == 0 ? round * 1000 : -1;
+	unsigned i, j;
+
+	data->variable = value;
+	for (j = 0; j < NY; j++)
+		for (i = 0; i < NX; i++)
+			data->matrix[j*ld(rank)+i] = value + j*NX+i;
+	for (i = 0; i < NROWS*NNZ_ROW; i++)
+	{
+		data->nzval[i] = value + i;
+		data->colind[i] = i % NNZ_ROW;
+	}
+	for (i = 0; i <= NROWS; i++)
+		data->rowptr[i] = i * NNZ_ROW;
+}
+
+/* The pretended host of a node */
+static int host(int rank)
+{
+	return rank / 2;
+}
+
+static int data_check(struct data *data, int rank, int round)
+{
+	int value = round * 1000;
+	unsigned i, j;
+
+	if (data->variable != value)
+	{
+		FPRINTF_MPI(stderr, "round %d: incorrect value %d for variable\n", round, data->variable);
+		return 1;
+	}
+	for (j = 0; j < NY; j++)
+		for (i = 0; i < NX; i++)
+			if (data->matrix[j*ld(rank)+i] != value + (int) (j*NX+i))
+			{
+				FPRINTF_MPI(stderr, "round %d: incorrect value %d for matrix element %u,%u\n", round, data->matrix[j*ld(rank)+i], i, j);
+				return 1;
+			}
+	for (i = 0; i < NROWS*NNZ_ROW; i++)
+		if (data->nzval[i] != value + (int) i || data->colind[i] != i % NNZ_ROW)
+		{
+			FPRINTF_MPI(stderr, "round %d: incorrect value %d for csr element %u\n", round, data->nzval[i], i);
+			return 1;
+		}
+	return 0;
+}
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+int main(int argc, char **argv)
+{
+	int ret, rank, size, mpi_init;
+	static struct data data;
+	starpu_mpi_req reqs[3];
+	size_t *comm_amount;
+	int i, n, round, err = 0;
+
+	setenv("STARPU_MPI_RANKS_PER_HOST", "2", 1);
+	setenv("STARPU_MPI_STATS", "1", 1);
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 4 || !starpu_mpi_coop_sends_get_use())
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 4 processes and cooperative sends.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	data_fill(&data, rank, 0);
+	starpu_variable_data_register(&data.handles[0], STARPU_MAIN_RAM, (uintptr_t)&data.variable, sizeof(data.variable));
+	starpu_matrix_data_register(&data.handles[1], STARPU_MAIN_RAM, (uintptr_t)data.matrix, ld(rank), NX, NY, sizeof(int));
+	starpu_csr_data_register(&data.handles[2], STARPU_MAIN_RAM, NROWS*NNZ_ROW, NROWS, (uintptr_t)data.nzval, data.colind, data.rowptr, 0, sizeof(int));
+
+	for (round = 0; round < NROUNDS; round++)
+	{
+		if (rank == 0)
+		{
+			if (round)
+			{
+				/* This waits for the previous sends */
+				for (i = 0; i < 3; i++)
+					starpu_data_acquire(data.handles[i], STARPU_W);
+				data_fill(&data, rank, round);
+				for (i = 0; i < 3; i++)
+					starpu_data_release(data.handles[i]);
+			}
+
+			for (i = 0; i < 3; i++)
+			{
+				starpu_mpi_coop_sends_data_handle_nb_sends(data.handles[i], size-1);
+				/* The priorities decide which node of each pair forwards */
+				for (n = 1; n < size; n++)
+				{
+					ret = starpu_mpi_isend_detached_prio(data.handles[i], n, i, size-n, MPI_COMM_WORLD, NULL, NULL);
+					STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_isend_detached_prio");
+				}
+			}
+		}
+		else
+		{
+			if (round % 2 && rank % 2 == 0)
+				/* Let the data arrive first */
+				starpu_sleep(0.1);
+			for (i = 0; i < 3; i++)
+			{
+				ret = starpu_mpi_irecv(data.handles[i], &reqs[i], 0, i, MPI_COMM_WORLD);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv");
+			}
+			for (i = 0; i < 3; i++)
+			{
+				ret = starpu_mpi_wait(&reqs[i], MPI_STATUS_IGNORE);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_wait");
+			}
+
+			for (i = 0; i < 3; i++)
+				starpu_data_acquire(data.handles[i], STARPU_R);
+			err |= data_check(&data, rank, round);
+			for (i = 0; i < 3; i++)
+				starpu_data_release(data.handles[i]);
+		}
+	}
+
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+	comm_amount = malloc(size * sizeof(size_t));
+	starpu_mpi_comm_stats_retrieve(comm_amount);
+	if (rank == 0)
+	{
+		/* The other node of our host gets its copy directly, each other
+		 * host gets the same amount of data */
+		size_t host_amount = 0;
+		for (n = 2; n < size; n++)
+		{
+			host_amount += comm_amount[n];
+			if (n == size-1 || host(n+1) != host(n))
+			{
+				if (host_amount != comm_amount[1] || !host_amount)
+				{
+					FPRINTF_MPI(stderr, "sent %ld bytes to host %d instead of %ld\n", (long) host_amount, host(n), (long) comm_amount[1]);
+					err = 1;
+				}
+				host_amount = 0;
+			}
+		}
+	}
+	else
+	{
+		/* The data is only forwarded inside the host */
+		for (n = 0; n < size; n++)
+			if (host(n) != host(rank) && comm_amount[n])
+			{
+				FPRINTF_MPI(stderr, "sent %ld bytes to node %d on another host\n", (long) comm_amount[n], n);
+				err = 1;
+			}
+	}
+	free(comm_amount);
+
+	for (i = 0; i < 3; i++)
+		starpu_data_unregister(data.handles[i]);
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return err;
+}
+#endif
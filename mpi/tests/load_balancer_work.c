@@ -0,0 +1,139 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include <starpu_mpi_lb.h>
+#include "helper.h"
+
+/*
+ * All the data is initially owned by node 0, the work load balancer has to
+ * move some of it to the other nodes, and bring it back at shutdown.
+ */
+
+#if !defined(STARPU_HAVE_SETENV) || !defined(STARPU_HAVE_UNSETENV) || !defined(STARPU_USE_MPI_MPI) || defined(STARPU_SIMGRID)
+
+#warning setenv or unsetenv are not defined. Skipping test
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NDATA 16
+#ifdef STARPU_QUICK_CHECK
+#define NITER 4
+#else
+#define NITER 8
+#endif
+
+void func_cpu(void *descr[], void *_args)
+{
+	unsigned *x = (unsigned *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	(void)_args;
+
+	(*x)++;
+	starpu_usleep(2000);
+}
+
+/* No performance model, the load balancer uses the measured durations */
+struct starpu_codelet mycodelet =
+{
+	.cpu_funcs = {func_cpu},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+};
+
+int main(int argc, char **argv)
+{
+	int ret, rank, size, i, iter, nmoved = 0;
+	unsigned values[NDATA];
+	starpu_data_handle_t handles[NDATA];
+	char period[16];
+	int mpi_init;
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2 || starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes and 1 CPU worker.\n");
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	/* Balance after each iteration */
+	snprintf(period, sizeof(period), "%d", NDATA);
+	setenv("STARPU_MPI_LB_WORK_PERIOD", period, 1);
+	unsetenv("STARPU_MPI_LB");
+	starpu_mpi_lb_init("work", NULL);
+
+	/* The data has to be registered on all nodes to be moved anywhere */
+	for (i = 0; i < NDATA; i++)
+	{
+		values[i] = 0;
+		if (rank == 0)
+			starpu_variable_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t)&values[i], sizeof(values[i]));
+		else
+			starpu_variable_data_register(&handles[i], -1, (uintptr_t)NULL, sizeof(values[i]));
+		starpu_mpi_data_register(handles[i], i, 0);
+	}
+
+	for (iter = 0; iter < NITER; iter++)
+	{
+		for (i = 0; i < NDATA; i++)
+		{
+			ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &mycodelet, STARPU_RW, handles[i], 0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+		}
+		starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	}
+
+	for (i = 0; i < NDATA; i++)
+		if (starpu_mpi_data_get_rank(handles[i]) != 0)
+			nmoved++;
+	FPRINTF_MPI(stderr, "%d pieces of data were moved out of node 0\n", nmoved);
+	STARPU_ASSERT_MSG(nmoved > 0, "No data was moved out of node 0\n");
+
+	/* Brings the data back to node 0 */
+	starpu_mpi_lb_shutdown();
+
+	for (i = 0; i < NDATA; i++)
+	{
+		STARPU_ASSERT(starpu_mpi_data_get_rank(handles[i]) == 0);
+		starpu_data_unregister(handles[i]);
+	}
+
+	starpu_mpi_shutdown();
+
+	if (rank == 0)
+	{
+		for (i = 0; i < NDATA; i++)
+			STARPU_ASSERT_MSG(values[i] == NITER, "Data %d has value %u instead of %d\n", i, values[i], NITER);
+	}
+
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return 0;
+}
+
+#endif
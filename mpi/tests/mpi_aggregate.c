@@ -0,0 +1,157 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Send many small pieces of data interleaved with a big one with
+ * STARPU_MPI_AGGREGATE_SIZE enabled, the receiver posting the receives of
+ * the first half before the data arrives, and the others once it has arrived.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NVARS 32
+#else
+#define NVARS 256
+#endif
+#define NX (64*1024)
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+int main(int argc, char **argv)
+{
+	int ret, rank, size, mpi_init;
+	int values[NVARS];
+	int *vector;
+	starpu_data_handle_t handles[NVARS];
+	starpu_data_handle_t vector_handle;
+	starpu_mpi_req reqs[NVARS];
+	int i, other, ok = 1;
+
+	setenv("STARPU_MPI_AGGREGATE_SIZE", "4096", 1);
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size % 2)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need a even number of processes.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	other = rank % 2 == 0 ? rank + 1 : rank - 1;
+
+	for (i = 0; i < NVARS; i++)
+	{
+		values[i] = rank % 2 == 0 ? i : -1;
+		starpu_variable_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t)&values[i], sizeof(values[i]));
+	}
+	starpu_malloc((void **)&vector, NX * sizeof(int));
+	for (i = 0; i < NX; i++)
+		vector[i] = rank % 2 == 0 ? i : -1;
+	starpu_vector_data_register(&vector_handle, STARPU_MAIN_RAM, (uintptr_t)vector, NX, sizeof(int));
+
+	if (rank % 2 == 0)
+	{
+		for (i = 0; i < NVARS; i++)
+		{
+			ret = starpu_mpi_isend_detached(handles[i], other, i, MPI_COMM_WORLD, NULL, NULL);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_isend_detached");
+			if (i == NVARS / 2)
+			{
+				ret = starpu_mpi_isend_detached(vector_handle, other, NVARS, MPI_COMM_WORLD, NULL, NULL);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_isend_detached");
+			}
+		}
+	}
+	else
+	{
+		/* These are posted before the data arrives */
+		for (i = 0; i < NVARS / 2; i++)
+		{
+			ret = starpu_mpi_irecv(handles[i], &reqs[i], other, i, MPI_COMM_WORLD);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv");
+		}
+		ret = starpu_mpi_recv(vector_handle, other, NVARS, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_recv");
+		for (i = 0; i < NVARS / 2; i++)
+		{
+			ret = starpu_mpi_wait(&reqs[i], MPI_STATUS_IGNORE);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_wait");
+		}
+
+		/* These have most probably arrived already */
+		starpu_sleep(0.1);
+		for (i = NVARS / 2; i < NVARS; i++)
+		{
+			ret = starpu_mpi_irecv(handles[i], &reqs[i], other, i, MPI_COMM_WORLD);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv");
+		}
+		for (i = NVARS / 2; i < NVARS; i++)
+		{
+			ret = starpu_mpi_wait(&reqs[i], MPI_STATUS_IGNORE);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_wait");
+		}
+	}
+
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+	for (i = 0; i < NVARS; i++)
+		starpu_data_unregister(handles[i]);
+	starpu_data_unregister(vector_handle);
+
+	for (i = 0; i < NVARS; i++)
+	{
+		if (values[i] != i)
+		{
+			FPRINTF_MPI(stderr, "incorrect value %d for variable %d\n", values[i], i);
+			ok = 0;
+		}
+	}
+	for (i = 0; i < NX; i++)
+	{
+		if (vector[i] != i)
+		{
+			FPRINTF_MPI(stderr, "incorrect value %d for vector element %d\n", vector[i], i);
+			ok = 0;
+			break;
+		}
+	}
+	starpu_free_noflag(vector, NX * sizeof(int));
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return ok ? 0 : 1;
+}
+#endif
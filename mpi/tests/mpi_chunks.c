@@ -0,0 +1,212 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Send matrices, blocks and vectors with padding which differs between the
+ * sender and the receiver, as well as packed CSR data, with
+ * STARPU_MPI_CHUNK_SIZE set so that they are transferred in many chunks.
+ * Each round uses a different way: receive posted before the data arrives,
+ * synchronous send, and data arriving before the receive is posted.
+ */
+
+#define NX 50
+#define NY 40
+#define NZ 10
+#define NVECTOR 10000
+#define NROWS 100
+#define NNZ_ROW 10
+#define NROUNDS 3
+
+struct data
+{
+	int matrix[(NX+7)*NY];
+	int block[(NX+7)*(NY+3)*NZ];
+	int vector[NVECTOR];
+	int nzval[NROWS*NNZ_ROW];
+	uint32_t colind[NROWS*NNZ_ROW];
+	uint32_t rowptr[NROWS+1];
+	starpu_data_handle_t handles[4];
+};
+
+static void data_register(struct data *data, int rank, int round)
+{
+	/* The padding differs between the sender and the receiver */
+	unsigned ld = NX + (rank % 2 ? 7 : 3);
+	unsigned ldz = ld * (NY + (rank % 2 ? 3 : 1));
+	int value = rank % 2 == 0 ? round * 1000000 : -1;
+	unsigned i, j, k;
+
+	for (j = 0; j < NY; j++)
+		for (i = 0; i < NX; i++)
+			data->matrix[j*ld+i] = value + j*NX+i;
+	for (k = 0; k < NZ; k++)
+		for (j = 0; j < NY; j++)
+			for (i = 0; i < NX; i++)
+				data->block[k*ldz+j*ld+i] = value + (k*NY+j)*NX+i;
+	for (i = 0; i < NVECTOR; i++)
+		data->vector[i] = value + i;
+	for (i = 0; i < NROWS*NNZ_ROW; i++)
+	{
+		data->nzval[i] = value + i;
+		data->colind[i] = i % NNZ_ROW;
+	}
+	for (i = 0; i <= NROWS; i++)
+		data->rowptr[i] = i * NNZ_ROW;
+
+	starpu_matrix_data_register(&data->handles[0], STARPU_MAIN_RAM, (uintptr_t)data->matrix, ld, NX, NY, sizeof(int));
+	starpu_block_data_register(&data->handles[1], STARPU_MAIN_RAM, (uintptr_t)data->block, ld, ldz, NX, NY, NZ, sizeof(int));
+	starpu_vector_data_register(&data->handles[2], STARPU_MAIN_RAM, (uintptr_t)data->vector, NVECTOR, sizeof(int));
+	starpu_csr_data_register(&data->handles[3], STARPU_MAIN_RAM, NROWS*NNZ_ROW, NROWS, (uintptr_t)data->nzval, data->colind, data->rowptr, 0, sizeof(int));
+}
+
+static int data_check(struct data *data, int round)
+{
+	unsigned ld = NX + 7;
+	unsigned ldz = ld * (NY + 3);
+	int value = round * 1000000;
+	unsigned i, j, k;
+
+	for (i = 0; i < 4; i++)
+		starpu_data_unregister(data->handles[i]);
+
+	for (j = 0; j < NY; j++)
+		for (i = 0; i < NX; i++)
+			if (data->matrix[j*ld+i] != value + (int) (j*NX+i))
+			{
+				FPRINTF_MPI(stderr, "round %d: incorrect value %d for matrix element %u,%u\n", round, data->matrix[j*ld+i], i, j);
+				return 1;
+			}
+	for (k = 0; k < NZ; k++)
+		for (j = 0; j < NY; j++)
+			for (i = 0; i < NX; i++)
+				if (data->block[k*ldz+j*ld+i] != value + (int) ((k*NY+j)*NX+i))
+				{
+					FPRINTF_MPI(stderr, "round %d: incorrect value %d for block element %u,%u,%u\n", round, data->block[k*ldz+j*ld+i], i, j, k);
+					return 1;
+				}
+	for (i = 0; i < NVECTOR; i++)
+		if (data->vector[i] != value + (int) i)
+		{
+			FPRINTF_MPI(stderr, "round %d: incorrect value %d for vector element %u\n", round, data->vector[i], i);
+			return 1;
+		}
+	for (i = 0; i < NROWS*NNZ_ROW; i++)
+		if (data->nzval[i] != value + (int) i || data->colind[i] != i % NNZ_ROW)
+		{
+			FPRINTF_MPI(stderr, "round %d: incorrect value %d for csr element %u\n", round, data->nzval[i], i);
+			return 1;
+		}
+	return 0;
+}
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+int main(int argc, char **argv)
+{
+	int ret, rank, size, mpi_init;
+	static struct data data[NROUNDS];
+	starpu_mpi_req reqs[4];
+	int i, round, other, err = 0;
+
+	setenv("STARPU_MPI_CHUNK_SIZE", "1000", 1);
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size % 2)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need a even number of processes.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	other = rank % 2 == 0 ? rank + 1 : rank - 1;
+
+	for (round = 0; round < NROUNDS; round++)
+		data_register(&data[round], rank, round);
+	if (rank % 2)
+		/* The early matrix and block will be received in data of the same
+		 * shape, and the early vector and CSR in raw buffers */
+		for (i = 0; i < 2; i++)
+			starpu_mpi_data_register(data[2].handles[i], 2*4+i, other);
+
+	if (rank % 2 == 0)
+	{
+		for (round = 0; round < NROUNDS; round++)
+			for (i = 0; i < 4; i++)
+			{
+				if (round == 1)
+					ret = starpu_mpi_issend_detached(data[round].handles[i], other, round*4+i, MPI_COMM_WORLD, NULL, NULL);
+				else
+					ret = starpu_mpi_isend_detached(data[round].handles[i], other, round*4+i, MPI_COMM_WORLD, NULL, NULL);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_isend_detached");
+			}
+	}
+	else
+	{
+		for (round = 0; round < NROUNDS; round++)
+		{
+			if (round == 2)
+				/* Let the data arrive first */
+				starpu_sleep(0.1);
+			for (i = 0; i < 4; i++)
+			{
+				ret = starpu_mpi_irecv(data[round].handles[i], &reqs[i], other, round*4+i, MPI_COMM_WORLD);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv");
+			}
+			for (i = 0; i < 4; i++)
+			{
+				ret = starpu_mpi_wait(&reqs[i], MPI_STATUS_IGNORE);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_wait");
+			}
+		}
+	}
+
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+	for (round = 0; round < NROUNDS; round++)
+	{
+		if (rank % 2)
+			err |= data_check(&data[round], round);
+		else
+			for (i = 0; i < 4; i++)
+				starpu_data_unregister(data[round].handles[i]);
+	}
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return err;
+}
+#endif
@@ -0,0 +1,211 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Check starpu_mpi_bcast_detached, starpu_mpi_allreduce_detached and
+ * starpu_mpi_allgather_detached with both small and big data, so that both
+ * algorithms of each collective are used.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NLOOPS 2
+#else
+#define NLOOPS 10
+#endif
+
+void redux_cpu_func(void *descr[], void *_args)
+{
+	(void)_args;
+	int *dst = (int *)STARPU_VECTOR_GET_PTR(descr[0]);
+	int *src = (int *)STARPU_VECTOR_GET_PTR(descr[1]);
+	unsigned nx = STARPU_VECTOR_GET_NX(descr[0]);
+	unsigned i;
+
+	for (i = 0; i < nx; i++)
+		dst[i] += src[i];
+}
+
+static struct starpu_codelet redux_cl =
+{
+	.cpu_funcs = {redux_cpu_func},
+	.nbuffers = 2,
+	.modes = {STARPU_RW|STARPU_COMMUTE, STARPU_R},
+	.name = "redux",
+#ifdef STARPU_SIMGRID
+	.model = &starpu_perfmodel_nop,
+#endif
+};
+
+static int done;
+
+void callback(void *arg)
+{
+	(void)arg;
+	STARPU_ATOMIC_ADD(&done, 1);
+}
+
+static int check(const char *name, int *vector, unsigned nx, int expected)
+{
+	unsigned i;
+	for (i = 0; i < nx; i++)
+	{
+		if (vector[i] != expected + (int) i)
+		{
+			FPRINTF_MPI(stderr, "%s: incorrect value %d for element %u instead of %d\n", name, vector[i], i, expected + (int) i);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int test(unsigned nx, int rank, int nodes, starpu_mpi_tag_t *tag)
+{
+	starpu_data_handle_t handle;
+	starpu_data_handle_t handles[nodes];
+	int *vectors[nodes];
+	int *vector;
+	unsigned i;
+	int node, loop, err, ret = 0;
+	double start, bcast_time, allreduce_time, allgather_time;
+
+	starpu_malloc((void **)&vector, nx * sizeof(int));
+	starpu_vector_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t)vector, nx, sizeof(int));
+	starpu_mpi_data_register(handle, (*tag)++, 0);
+	starpu_data_set_reduction_methods(handle, &redux_cl, NULL);
+
+	/* Broadcast */
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	start = starpu_timing_now();
+	for (loop = 0; loop < NLOOPS; loop++)
+	{
+		int root = loop % nodes;
+		starpu_data_acquire(handle, STARPU_W);
+		for (i = 0; i < nx; i++)
+			vector[i] = rank == root ? root + (int) i : -1;
+		starpu_data_release(handle);
+
+		err = starpu_mpi_bcast_detached(handle, root, MPI_COMM_WORLD, callback, NULL);
+		STARPU_CHECK_RETURN_VALUE(err, "starpu_mpi_bcast_detached");
+
+		starpu_data_acquire(handle, STARPU_R);
+		ret |= check("bcast", vector, nx, root);
+		starpu_data_release(handle);
+	}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	bcast_time = (starpu_timing_now() - start) / NLOOPS;
+
+	/* Allreduce */
+	start = starpu_timing_now();
+	for (loop = 0; loop < NLOOPS; loop++)
+	{
+		starpu_data_acquire(handle, STARPU_W);
+		for (i = 0; i < nx; i++)
+			vector[i] = rank + (int) i * (rank == 0);
+		starpu_data_release(handle);
+
+		err = starpu_mpi_allreduce_detached(handle, MPI_COMM_WORLD, callback, NULL);
+		STARPU_CHECK_RETURN_VALUE(err, "starpu_mpi_allreduce_detached");
+
+		starpu_data_acquire(handle, STARPU_R);
+		ret |= check("allreduce", vector, nx, nodes * (nodes - 1) / 2);
+		starpu_data_release(handle);
+	}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	allreduce_time = (starpu_timing_now() - start) / NLOOPS;
+
+	starpu_data_unregister(handle);
+	starpu_free_noflag(vector, nx * sizeof(int));
+
+	/* Allgather, each node owning one vector */
+	for (node = 0; node < nodes; node++)
+	{
+		starpu_malloc((void **)&vectors[node], nx * sizeof(int));
+		starpu_vector_data_register(&handles[node], STARPU_MAIN_RAM, (uintptr_t)vectors[node], nx, sizeof(int));
+		starpu_mpi_data_register(handles[node], (*tag)++, node);
+	}
+
+	start = starpu_timing_now();
+	for (loop = 0; loop < NLOOPS; loop++)
+	{
+		for (node = 0; node < nodes; node++)
+		{
+			starpu_data_acquire(handles[node], STARPU_W);
+			for (i = 0; i < nx; i++)
+				vectors[node][i] = node == rank ? loop + node + (int) i : -1;
+			starpu_data_release(handles[node]);
+		}
+
+		err = starpu_mpi_allgather_detached(handles, nodes, MPI_COMM_WORLD, callback, NULL);
+		STARPU_CHECK_RETURN_VALUE(err, "starpu_mpi_allgather_detached");
+
+		for (node = 0; node < nodes; node++)
+		{
+			starpu_data_acquire(handles[node], STARPU_R);
+			ret |= check("allgather", vectors[node], nx, loop + node);
+			starpu_data_release(handles[node]);
+		}
+	}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	allgather_time = (starpu_timing_now() - start) / NLOOPS;
+
+	for (node = 0; node < nodes; node++)
+	{
+		starpu_data_unregister(handles[node]);
+		starpu_free_noflag(vectors[node], nx * sizeof(int));
+	}
+
+	if (rank == 0)
+		FPRINTF_MPI(stderr, "%u bytes on %d nodes: bcast %.1f us, allreduce %.1f us, allgather %.1f us\n",
+			    (unsigned) (nx * sizeof(int)), nodes, bcast_time, allreduce_time, allgather_time);
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int rank, nodes, ret;
+	starpu_mpi_tag_t tag = 0;
+
+	ret = starpu_mpi_init_conf(&argc, &argv, 1, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &nodes);
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 1 CPU worker.\n");
+		starpu_mpi_shutdown();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	/* Latency-bound algorithms */
+	ret = test(4, rank, nodes, &tag);
+	/* Bandwidth-bound algorithms */
+	ret |= test(64*1024, rank, nodes, &tag);
+
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	if (done != 2 * (3 * NLOOPS))
+	{
+		FPRINTF_MPI(stderr, "%d callbacks called instead of %d\n", done, 2 * (3 * NLOOPS));
+		ret = 1;
+	}
+
+	starpu_mpi_shutdown();
+	return ret;
+}
@@ -0,0 +1,162 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Ping-pong with STARPU_MPI_WORKER_PROGRESS enabled. The progression thread
+ * only polls every PERIOD us, so the requests complete faster than that only
+ * when idle CPU workers make them progress: compare the latency while the
+ * workers are idle, and while they are all kept busy by a task.
+ */
+
+#if !defined(STARPU_HAVE_SETENV) || !defined(STARPU_USE_MPI_MPI) || defined(STARPU_SIMGRID)
+
+#warning setenv is not defined or not using the MPI backend. Skipping test
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#ifdef STARPU_QUICK_CHECK
+#define NITER 10
+#else
+#define NITER 50
+#endif
+
+/* 100ms */
+#define PERIOD 100000
+#define NITER_BUSY 4
+
+static volatile int busy;
+static unsigned nstarted;
+
+static void busy_func(void *buffers[], void *args)
+{
+	(void) buffers;
+	(void) args;
+	STARPU_ATOMIC_ADD(&nstarted, 1);
+	while (busy)
+		starpu_usleep(1000);
+}
+
+static struct starpu_codelet busy_cl =
+{
+	.cpu_funcs = {busy_func},
+	.nbuffers = 0,
+};
+
+/* Ping-pong niter times between ranks 0 and 1, and return the average one-way
+ * latency */
+static double pingpong(int rank, starpu_data_handle_t handle, int *value, int niter)
+{
+	double start;
+	int loop, ret;
+	int other_rank = 1 - rank;
+
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+	if (rank > 1)
+		return 0.;
+
+	start = starpu_timing_now();
+	for (loop = 0; loop < niter; loop++)
+	{
+		if ((loop % 2) == rank)
+		{
+			(*value)++;
+			ret = starpu_mpi_send(handle, other_rank, loop, MPI_COMM_WORLD);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_send");
+		}
+		else
+		{
+			MPI_Status status;
+			int expected = *value + 1;
+			ret = starpu_mpi_recv(handle, other_rank, loop, MPI_COMM_WORLD, &status);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_recv");
+			STARPU_ASSERT_MSG(*value == expected, "Received %d instead of %d\n", *value, expected);
+		}
+	}
+	return (starpu_timing_now() - start) / niter;
+}
+
+int main(int argc, char **argv)
+{
+	int ret, rank, size;
+	int mpi_init;
+	int value = 0;
+	unsigned ncpus, worker;
+	char period[16];
+	starpu_data_handle_t handle;
+	double idle_latency, busy_latency;
+
+	setenv("STARPU_MPI_WORKER_PROGRESS", "1", 1);
+	snprintf(period, sizeof(period), "%d", PERIOD);
+	setenv("STARPU_MPI_WORKER_PROGRESS_PERIOD", period, 1);
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	ncpus = starpu_cpu_worker_get_count();
+	if (size < 2 || ncpus == 0 || ncpus != starpu_worker_get_count())
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes, and only CPU workers.\n");
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	starpu_variable_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t)&value, sizeof(value));
+
+	idle_latency = pingpong(rank, handle, &value, NITER);
+
+	/* Keep all workers busy, only the progression thread is left */
+	busy = 1;
+	for (worker = 0; worker < ncpus; worker++)
+	{
+		ret = starpu_task_insert(&busy_cl, STARPU_EXECUTE_ON_WORKER, worker, 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	while (STARPU_ATOMIC_ADD(&nstarted, 0) < ncpus)
+		starpu_usleep(1000);
+
+	busy_latency = pingpong(rank, handle, &value, NITER_BUSY);
+
+	busy = 0;
+	starpu_task_wait_for_all();
+	starpu_data_unregister(handle);
+
+	if (rank <= 1)
+	{
+		FPRINTF_MPI(stderr, "one-way latency %f us with idle workers, %f us with busy workers, the progression thread polls every %d us\n", idle_latency, busy_latency, PERIOD);
+		STARPU_ASSERT_MSG(idle_latency < PERIOD / 2, "The idle workers did not make the communications progress\n");
+		STARPU_ASSERT_MSG(busy_latency > idle_latency, "The idle workers did not make any difference\n");
+	}
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return 0;
+}
+
+#endif
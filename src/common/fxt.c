@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2008-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2008-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -373,6 +373,12 @@ int _starpu_generate_paje_trace_read_option(const char *option, struct starpu_fx
 	{
 		options->number_events_path = strdup("number_events.data");
 	}
+	else if (strcmp(option, "-columnar") == 0)
+	{
+		options->states_columns_path = strdup("trace.col");
+		options->tasks_columns_path = strdup("tasks.col");
+		options->transfers_columns_path = strdup("transfers.col");
+	}
 	else
 	{
 		return 1;
@@ -39,6 +39,12 @@ static struct perf_counter_array per_codelet_counters	= { .size = 0, .array = NU
 
 static struct starpu_perf_counter_sample global_sample	= { .scope = starpu_perf_counter_scope_global, .listener = NULL, .value_array = NULL };
 
+/* Codelets which have a per-codelet listener */
+static struct starpu_codelet **monitored_codelets;
+static int nmonitored_codelets;
+static int monitored_codelets_size;
+static starpu_pthread_mutex_t monitored_codelets_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+
 /* - */
 
 void _starpu_perf_counter_sample_init(struct starpu_perf_counter_sample *sample, enum starpu_perf_counter_scope scope)
@@ -83,6 +89,10 @@ void _starpu_perf_counter_init(struct _starpu_machine_config *pconfig)
 
 	/* call counter registration routines in each modules */
 	_starpu__task_c__register_counters();
+	_starpu__copy_driver_c__register_counters();
+	_starpu__latency_c__register_counters();
+	_starpu__perf_event_c__register_counters();
+	_starpu__memory_timeline_c__register_counters();
 }
 
 void _starpu_perf_counter_exit(void)
@@ -91,6 +101,11 @@ void _starpu_perf_counter_exit(void)
 
 	_starpu_perf_counter_unregister_all_scopes();
 	_starpu_perf_counter_sample_exit(&global_sample);
+
+	free(monitored_codelets);
+	monitored_codelets = NULL;
+	nmonitored_codelets = 0;
+	monitored_codelets_size = 0;
 }
 
 /* - */
@@ -376,7 +391,7 @@ void starpu_perf_counter_listener_exit(struct starpu_perf_counter_listener *list
 
 /* - */
 
-static void set_listener(struct starpu_perf_counter_sample *sample, struct starpu_perf_counter_listener *listener)
+void _starpu_perf_counter_sample_set_listener(struct starpu_perf_counter_sample *sample, struct starpu_perf_counter_listener *listener)
 {
 	_starpu_spin_lock(&sample->lock);
 	STARPU_ASSERT(sample->listener == NULL);
@@ -395,13 +410,13 @@ static void set_listener(struct starpu_perf_counter_sample *sample, struct starp
 
 void starpu_perf_counter_set_global_listener(struct starpu_perf_counter_listener *listener)
 {
-	set_listener(&global_sample, listener);
+	_starpu_perf_counter_sample_set_listener(&global_sample, listener);
 }
 
 void starpu_perf_counter_set_per_worker_listener(unsigned workerid, struct starpu_perf_counter_listener *listener)
 {
 	struct _starpu_worker *worker = _starpu_get_worker_struct(workerid);
-	set_listener(&worker->perf_counter_sample, listener);
+	_starpu_perf_counter_sample_set_listener(&worker->perf_counter_sample, listener);
 }
 
 void starpu_perf_counter_set_all_per_worker_listeners(struct starpu_perf_counter_listener *listener)
@@ -422,12 +437,21 @@ void starpu_perf_counter_set_per_codelet_listener(struct starpu_codelet *cl, str
 	STARPU_ASSERT(cl->perf_counter_sample == NULL);
 	_STARPU_MALLOC(cl->perf_counter_sample, sizeof(*cl->perf_counter_sample));
 	_starpu_perf_counter_sample_init(cl->perf_counter_sample, starpu_perf_counter_scope_per_codelet);
-	set_listener(cl->perf_counter_sample, listener);
+	_starpu_perf_counter_sample_set_listener(cl->perf_counter_sample, listener);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&monitored_codelets_mutex);
+	if (nmonitored_codelets == monitored_codelets_size)
+	{
+		monitored_codelets_size = monitored_codelets_size ? 2 * monitored_codelets_size : 16;
+		_STARPU_REALLOC(monitored_codelets, monitored_codelets_size * sizeof(*monitored_codelets));
+	}
+	monitored_codelets[nmonitored_codelets++] = cl;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&monitored_codelets_mutex);
 }
 
 /* - */
 
-static void unset_listener(struct starpu_perf_counter_sample *sample)
+void _starpu_perf_counter_sample_unset_listener(struct starpu_perf_counter_sample *sample)
 {
 	_starpu_spin_lock(&sample->lock);
 	STARPU_ASSERT(sample->listener != NULL);
@@ -441,13 +465,13 @@ static void unset_listener(struct starpu_perf_counter_sample *sample)
 
 void starpu_perf_counter_unset_global_listener()
 {
-	unset_listener(&global_sample);
+	_starpu_perf_counter_sample_unset_listener(&global_sample);
 }
 
 void starpu_perf_counter_unset_per_worker_listener(unsigned workerid)
 {
 	struct _starpu_worker *worker = _starpu_get_worker_struct(workerid);
-	unset_listener(&worker->perf_counter_sample);
+	_starpu_perf_counter_sample_unset_listener(&worker->perf_counter_sample);
 }
 
 void starpu_perf_counter_unset_all_per_worker_listeners(void)
@@ -463,7 +487,20 @@ void starpu_perf_counter_unset_all_per_worker_listeners(void)
 void starpu_perf_counter_unset_per_codelet_listener(struct starpu_codelet *cl)
 {
 	STARPU_ASSERT(cl->perf_counter_sample != NULL);
-	unset_listener(cl->perf_counter_sample);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&monitored_codelets_mutex);
+	int i;
+	for (i = 0; i < nmonitored_codelets; i++)
+	{
+		if (monitored_codelets[i] == cl)
+		{
+			monitored_codelets[i] = monitored_codelets[--nmonitored_codelets];
+			break;
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&monitored_codelets_mutex);
+
+	_starpu_perf_counter_sample_unset_listener(cl->perf_counter_sample);
 	_starpu_perf_counter_sample_exit(cl->perf_counter_sample);
 	free(cl->perf_counter_sample);
 	cl->perf_counter_sample = NULL;
@@ -486,7 +523,7 @@ void _starpu_perf_counter_register_updater(enum starpu_perf_counter_scope scope,
 
 /* - */
 
-static void update_sample(struct starpu_perf_counter_sample *sample, void *context)
+static void update_sample(struct starpu_perf_counter_sample *sample, void *context, int notify)
 {
 	if (sample->listener == NULL)
 		return;
@@ -505,7 +542,7 @@ static void update_sample(struct starpu_perf_counter_sample *sample, void *conte
 				counters->updater_array[upd_id](sample, context);
 			}
 
-			if (sample->listener != NULL)
+			if (notify && sample->listener != NULL)
 			{
 				sample->listener->callback(sample->listener, sample, context);
 			}
@@ -514,20 +551,34 @@ static void update_sample(struct starpu_perf_counter_sample *sample, void *conte
 	_starpu_spin_unlock(&sample->lock);
 }
 
+void _starpu_perf_counter_sample_fetch(struct starpu_perf_counter_sample *sample, void *context)
+{
+	update_sample(sample, context, 0);
+}
+
+void _starpu_perf_counter_foreach_codelet(void (*func)(struct starpu_codelet *cl, void *arg), void *arg)
+{
+	int i;
+	STARPU_PTHREAD_MUTEX_LOCK(&monitored_codelets_mutex);
+	for (i = 0; i < nmonitored_codelets; i++)
+		func(monitored_codelets[i], arg);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&monitored_codelets_mutex);
+}
+
 void _starpu_perf_counter_update_global_sample(void)
 {
-	update_sample(&global_sample, NULL);
+	update_sample(&global_sample, NULL, 1);
 }
 
 void _starpu_perf_counter_update_per_worker_sample(unsigned workerid)
 {
 	struct _starpu_worker *worker = _starpu_get_worker_struct(workerid);
-	update_sample(&worker->perf_counter_sample, worker);
+	update_sample(&worker->perf_counter_sample, worker, 1);
 }
 
 void _starpu_perf_counter_update_per_codelet_sample(struct starpu_codelet *cl)
 {
-	update_sample(cl->perf_counter_sample, cl);
+	update_sample(cl->perf_counter_sample, cl, 1);
 }
 
 #define STARPU_PERF_COUNTER_SAMPLE_GET_TYPED_VALUE(STRING, TYPE) \
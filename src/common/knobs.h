@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2019-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2019-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -178,6 +178,10 @@ struct starpu_perf_counter_sample_cl_values
 		int64_t current_ready;
 		int64_t total_executed;
 		double cumul_execution_time;
+		int64_t cumul_cycles;
+		int64_t cumul_instructions;
+		int64_t cumul_cache_misses;
+		int64_t cumul_stalled_cycles;
 	} task;
 };
 
@@ -217,6 +221,17 @@ void _starpu_perf_counter_update_global_sample(void);
 void _starpu_perf_counter_update_per_worker_sample(unsigned workerid);
 void _starpu_perf_counter_update_per_codelet_sample(struct starpu_codelet *cl);
 
+void _starpu_perf_counter_sample_set_listener(struct starpu_perf_counter_sample *sample, struct starpu_perf_counter_listener *listener);
+void _starpu_perf_counter_sample_unset_listener(struct starpu_perf_counter_sample *sample);
+
+/** Fill the sample with the current values of the counters of its scope,
+ * without calling its listener */
+void _starpu_perf_counter_sample_fetch(struct starpu_perf_counter_sample *sample, void *context);
+
+/** Call func on each codelet which has a per-codelet listener. The codelets
+ * cannot get their listener unset meanwhile. */
+void _starpu_perf_counter_foreach_codelet(void (*func)(struct starpu_codelet *cl, void *arg), void *arg);
+
 #define __STARPU_PERF_COUNTER_SAMPLE_SET_TYPED_VALUE(STRING, TYPE) \
 static inline void _starpu_perf_counter_sample_set_##STRING##_value(struct starpu_perf_counter_sample *sample, const int counter_id, const TYPE value) \
 { \
@@ -255,9 +270,14 @@ extern int64_t _starpu_task__g_peak_submitted__value;
 extern int64_t _starpu_task__g_current_submitted__value;
 extern int64_t _starpu_task__g_peak_ready__value;
 extern int64_t _starpu_task__g_current_ready__value;
+extern int64_t _starpu_data__g_total_transferred__value;
 
 /* performance counter registration routines per modules */
 void _starpu__task_c__register_counters(void);	/* module: task.c */
+void _starpu__copy_driver_c__register_counters(void);	/* module: copy_driver.c */
+void _starpu__latency_c__register_counters(void);	/* module: latency.c */
+void _starpu__perf_event_c__register_counters(void);	/* module: perf_event.c */
+void _starpu__memory_timeline_c__register_counters(void);	/* module: memory_timeline.c */
 
 
 /* -------------------------------------------------------------------- */
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2010-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2010-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -21,6 +21,7 @@
 #include <core/task.h>
 #include <core/dependencies/cg.h>
 #include <core/dependencies/tags.h>
+#include <profiling/critical_path.h>
 
 void _starpu_cg_list_init0(struct _starpu_cg_list *list)
 {
@@ -169,9 +170,11 @@ int _starpu_list_tag_successors_in_cg_list(struct _starpu_cg_list *successors, u
 	return n;
 }
 
-void _starpu_notify_cg(void *pred STARPU_ATTRIBUTE_UNUSED, struct _starpu_cg *cg)
+void _starpu_notify_cg(void *pred, struct _starpu_cg *cg)
 {
 	STARPU_ASSERT(cg);
+	if (STARPU_UNLIKELY(_starpu_critical_path_enabled))
+		_starpu_critical_path_notify(pred, cg);
 	unsigned remaining = STARPU_ATOMIC_ADD(&cg->remaining, -1);
 	ANNOTATE_HAPPENS_BEFORE(&cg->remaining);
 
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2008-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2008-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -64,6 +64,10 @@ struct _starpu_tag
 
 	unsigned is_assigned;
 	unsigned is_submitted;
+
+	/** Critical path analysis, see struct _starpu_job */
+	uint64_t cp_ready;
+	uint64_t cp_end;
 };
 
 void _starpu_init_tags(void);
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2013-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2013-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2013       Corentin Salingue
  *
  * StarPU is free software; you can redistribute it and/or modify
@@ -57,7 +57,7 @@ void starpu_disk_free_request(struct _starpu_async_channel *async_channel);
 int _starpu_disk_can_copy(unsigned node1, unsigned node2);
 
 /** change disk flag */
-void _starpu_set_disk_flag(unsigned node, int flag);
+void _starpu_set_disk_flag(unsigned node, int flag) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 int _starpu_get_disk_flag(unsigned node);
 
 /** unregister disk */
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2008-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2008-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2011       Télécom-SudParis
  * Copyright (C) 2013       Thibaut Lambert
  *
@@ -27,6 +27,8 @@
 #include <datawizard/memory_nodes.h>
 #include <profiling/profiling.h>
 #include <profiling/bound.h>
+#include <profiling/sched_overhead.h>
+#include <profiling/critical_path.h>
 #include <core/debug.h>
 #include <limits.h>
 #include <core/workers.h>
@@ -340,7 +342,7 @@ void starpu_task_end_dep_add(struct starpu_task *t, int nb_deps)
 	STARPU_PTHREAD_MUTEX_UNLOCK(&j->sync_mutex);
 }
 
-void _starpu_handle_job_termination(struct _starpu_job *j)
+static void __starpu_handle_job_termination(struct _starpu_job *j)
 {
 	if (j->task->nb_termination_call_required != 0)
 	{
@@ -392,7 +394,9 @@ void _starpu_handle_job_termination(struct _starpu_job *j)
 			_starpu_set_current_task(task);
 
 			_STARPU_TRACE_START_CALLBACK(j);
+			_STARPU_SCHED_OVERHEAD_START(_STARPU_SCHED_OVERHEAD_CALLBACK);
 			epilogue_callback(task->epilogue_callback_arg);
+			_STARPU_SCHED_OVERHEAD_END(_STARPU_SCHED_OVERHEAD_CALLBACK);
 			_STARPU_TRACE_END_CALLBACK(j);
 
 			_starpu_set_current_task(current_task);
@@ -539,6 +543,8 @@ void _starpu_handle_job_termination(struct _starpu_job *j)
 		/* in case there are dependencies, wake up the proper tasks */
 		if (end_rdep)
 			starpu_task_end_dep_release(end_rdep);
+		if (STARPU_UNLIKELY(_starpu_critical_path_enabled))
+			_starpu_critical_path_job_terminated(j);
 		_starpu_notify_dependencies(j);
 
 		/* If this is a continuation, we do not execute the callback
@@ -570,7 +576,9 @@ void _starpu_handle_job_termination(struct _starpu_job *j)
 			_starpu_set_current_task(task);
 
 			_STARPU_TRACE_START_CALLBACK(j);
+			_STARPU_SCHED_OVERHEAD_START(_STARPU_SCHED_OVERHEAD_CALLBACK);
 			callback(task->callback_arg);
+			_STARPU_SCHED_OVERHEAD_END(_STARPU_SCHED_OVERHEAD_CALLBACK);
 			_STARPU_TRACE_END_CALLBACK(j);
 
 			_starpu_set_current_task(current_task);
@@ -682,6 +690,13 @@ void _starpu_handle_job_termination(struct _starpu_job *j)
 	}
 }
 
+void _starpu_handle_job_termination(struct _starpu_job *j)
+{
+	_STARPU_SCHED_OVERHEAD_START(_STARPU_SCHED_OVERHEAD_TERMINATION);
+	__starpu_handle_job_termination(j);
+	_STARPU_SCHED_OVERHEAD_END(_STARPU_SCHED_OVERHEAD_TERMINATION);
+}
+
 /* This function is called when a new task is submitted to StarPU
  * it returns 1 if the tag deps are not fulfilled, 0 otherwise */
 static unsigned _starpu_not_all_tag_deps_are_fulfilled(struct _starpu_job *j)
@@ -884,7 +899,7 @@ void _starpu_bubble_execute(struct _starpu_job *j)
  *	The job mutex has to be taken for atomicity with task submission, and
  *	is released here.
  */
-unsigned _starpu_enforce_deps_and_schedule(struct _starpu_job *j)
+static unsigned __starpu_enforce_deps_and_schedule(struct _starpu_job *j)
 {
 	unsigned ret;
 	_STARPU_LOG_IN();
@@ -949,6 +964,15 @@ unsigned _starpu_enforce_deps_and_schedule(struct _starpu_job *j)
 	return ret;
 }
 
+unsigned _starpu_enforce_deps_and_schedule(struct _starpu_job *j)
+{
+	unsigned ret;
+	_STARPU_SCHED_OVERHEAD_START(_STARPU_SCHED_OVERHEAD_DEPS);
+	ret = __starpu_enforce_deps_and_schedule(j);
+	_STARPU_SCHED_OVERHEAD_END(_STARPU_SCHED_OVERHEAD_DEPS);
+	return ret;
+}
+
 /* Tag deps are already fulfilled */
 unsigned _starpu_enforce_deps_starting_from_task(struct _starpu_job *j)
 {
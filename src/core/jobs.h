@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2008-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2008-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2011	    Télécom-SudParis
  * Copyright (C) 2013	    Thibaut Lambert
  *
@@ -159,6 +159,19 @@ struct _starpu_job
 	double cumulated_energy_consumed;
 #endif
 
+	/** Date of submission of the job, only recorded when
+	 * STARPU_LATENCY_HISTOGRAMS is set */
+	double submit_date;
+
+	/** Critical path analysis, only recorded when STARPU_CRITICAL_PATH is
+	 * set: date of the start of the execution, cumulated execution time,
+	 * and dates at which the job could have started and ended with an
+	 * unbounded number of workers, in ns */
+	double cp_start_date;
+	uint64_t cp_duration;
+	uint64_t cp_ready;
+	uint64_t cp_end;
+
 	/** The value of the footprint that identifies the job may be stored in
 	 * this structure. */
 	uint32_t footprint;
@@ -22,6 +22,8 @@
 #include <common/utils.h>
 #include <core/sched_policy.h>
 #include <profiling/profiling.h>
+#include <profiling/flight_recorder.h>
+#include <profiling/sched_overhead.h>
 #include <datawizard/memory_nodes.h>
 #include <common/barrier.h>
 #include <core/debug.h>
@@ -79,7 +81,9 @@ static struct starpu_sched_policy *predefined_policies[] =
 	&_starpu_sched_modular_heteroprio_heft_policy,
 	&_starpu_sched_modular_parallel_heft_policy,
 	&_starpu_sched_eager_policy,
+	&_starpu_sched_leager_policy,
 	&_starpu_sched_prio_policy,
+	&_starpu_sched_multiqueue_policy,
 	&_starpu_sched_random_policy,
 	&_starpu_sched_lws_policy,
 	&_starpu_sched_ws_policy,
@@ -512,6 +516,8 @@ static int _starpu_push_task_on_specific_worker(struct starpu_task *task, int wo
 
 int _starpu_push_task(struct _starpu_job *j)
 {
+	int ret;
+	_STARPU_SCHED_OVERHEAD_START(_STARPU_SCHED_OVERHEAD_PUSH);
 #ifdef STARPU_SIMGRID
 	if (_starpu_simgrid_task_push_cost())
 		starpu_sleep(0.000001);
@@ -541,7 +547,9 @@ int _starpu_push_task(struct _starpu_job *j)
 		_starpu_spin_unlock(&p_trs->lock);
 	}
 
-	return _starpu_repush_task(j);
+	ret = _starpu_repush_task(j);
+	_STARPU_SCHED_OVERHEAD_END(_STARPU_SCHED_OVERHEAD_PUSH);
+	return ret;
 }
 
 int _starpu_repush_task(struct _starpu_job *j)
@@ -659,6 +667,7 @@ int _starpu_push_task_to_workers(struct starpu_task *task)
 	struct _starpu_sched_ctx *sched_ctx = _starpu_get_sched_ctx_struct(task->sched_ctx);
 
 	_STARPU_TRACE_JOB_PUSH(task, task->priority);
+	_STARPU_RECORD_TASK(_STARPU_RECORDER_TASK_PUSH, starpu_worker_get_id(), task);
 
 	/* if the contexts still does not have workers put the task back to its place in
 	   the empty ctx list */
@@ -817,6 +826,7 @@ int _starpu_pop_task_end(struct starpu_task *task)
 	if (!task)
 		return 0;
 	_STARPU_TRACE_JOB_POP(task, task->priority);
+	_STARPU_RECORD_TASK(_STARPU_RECORDER_TASK_POP, starpu_worker_get_id(), task);
 	return 0;
 }
 
@@ -949,7 +959,7 @@ struct _starpu_sched_ctx* _get_next_sched_ctx_to_pop_into(struct _starpu_worker
 	return _starpu_get_sched_ctx_struct(e->sched_ctx);
 }
 
-struct starpu_task *_starpu_pop_task(struct _starpu_worker *worker)
+static struct starpu_task *__starpu_pop_task(struct _starpu_worker *worker)
 {
 	struct starpu_task *task;
 	int worker_id;
@@ -1166,6 +1176,15 @@ profiling:
 	return task;
 }
 
+struct starpu_task *_starpu_pop_task(struct _starpu_worker *worker)
+{
+	struct starpu_task *task;
+	_STARPU_SCHED_OVERHEAD_START(_STARPU_SCHED_OVERHEAD_POP);
+	task = __starpu_pop_task(worker);
+	_STARPU_SCHED_OVERHEAD_END(_STARPU_SCHED_OVERHEAD_POP);
+	return task;
+}
+
 void _starpu_sched_pre_exec_hook(struct starpu_task *task)
 {
 	unsigned sched_ctx_id = starpu_sched_ctx_get_ctx_for_task(task);
@@ -33,6 +33,7 @@
 #include <datawizard/memory_nodes.h>
 #include <profiling/profiling.h>
 #include <profiling/bound.h>
+#include <profiling/latency.h>
 #include <math.h>
 #include <string.h>
 #include <core/debug.h>
@@ -48,6 +49,8 @@
 static int __g_total_submitted;
 static int __g_peak_submitted;
 static int __g_peak_ready;
+static int __g_current_submitted;
+static int __g_current_ready;
 
 /* global counter variables */
 int64_t _starpu_task__g_total_submitted__value;
@@ -89,6 +92,8 @@ static void global_sample_updater(struct starpu_perf_counter_sample *sample, voi
 	_starpu_perf_counter_sample_set_int64_value(sample, __g_total_submitted, _starpu_task__g_total_submitted__value);
 	_starpu_perf_counter_sample_set_int64_value(sample, __g_peak_submitted, _starpu_task__g_peak_submitted__value);
 	_starpu_perf_counter_sample_set_int64_value(sample, __g_peak_ready, _starpu_task__g_peak_ready__value);
+	_starpu_perf_counter_sample_set_int64_value(sample, __g_current_submitted, _starpu_task__g_current_submitted__value);
+	_starpu_perf_counter_sample_set_int64_value(sample, __g_current_ready, _starpu_task__g_current_ready__value);
 }
 
 static void per_worker_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
@@ -122,6 +127,8 @@ void _starpu__task_c__register_counters(void)
 		__STARPU_PERF_COUNTER_REG("starpu.task", scope, g_total_submitted, int64, "number of tasks submitted globally (since StarPU initialization)");
 		__STARPU_PERF_COUNTER_REG("starpu.task", scope, g_peak_submitted, int64, "maximum simultaneous number of tasks submitted and not yet ready, globally (since StarPU initialization)");
 		__STARPU_PERF_COUNTER_REG("starpu.task", scope, g_peak_ready, int64, "maximum simultaneous number of tasks ready and not yet executing, globally (since StarPU initialization)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, g_current_submitted, int64, "number of tasks submitted and not yet ready, globally");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, g_current_ready, int64, "number of tasks ready and not yet executing, globally");
 
 		_starpu_perf_counter_register_updater(scope, global_sample_updater);
 	}
@@ -1098,6 +1105,8 @@ int _starpu_task_submit(struct starpu_task *task, int nodeps)
 
 	if (STARPU_UNLIKELY(profiling))
 		_starpu_clock_gettime(&info->submit_time);
+	if (STARPU_UNLIKELY(_starpu_latency_enabled))
+		_starpu_latency_task_submit(j);
 
 	ret = _starpu_submit_job(j, nodeps);
 #ifdef STARPU_SIMGRID
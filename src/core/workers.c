@@ -37,10 +37,18 @@
 #include <datawizard/malloc.h>
 #include <profiling/profiling.h>
 #include <profiling/callbacks.h>
+#include <profiling/rapl.h>
+#include <profiling/flight_recorder.h>
+#include <profiling/perf_exporter.h>
+#include <profiling/latency.h>
+#include <profiling/perf_event.h>
+#include <profiling/sched_overhead.h>
+#include <profiling/critical_path.h>
 #include <drivers/max/driver_max_fpga.h>
 #include <profiling/bound.h>
 #include <sched_policies/sched_component.h>
 #include <datawizard/memory_nodes.h>
+#include <datawizard/memory_timeline.h>
 #include <common/knobs.h>
 #include <drivers/mp_common/sink_common.h>
 #include <drivers/mp_common/source_common.h>
@@ -80,6 +88,7 @@ static int asynchronous_copy_disabled[STARPU_MAX_RAM+1];
 /* global knobs */
 static int __g_calibrate_knob;
 static int __g_enable_catch_signal_knob;
+static int __g_sched_overhead_knob;
 
 /* per-worker knobs */
 static int __w_bind_to_pu_knob;
@@ -102,6 +111,10 @@ static void global_knobs__set(const struct starpu_perf_knob * const knob, void *
 	{
 		_starpu_set_catch_signals(!!value->val_int32_t);
 	}
+	else if (knob->id == __g_sched_overhead_knob)
+	{
+		_starpu_sched_overhead_enabled = !!value->val_int32_t;
+	}
 	else
 	{
 		STARPU_ASSERT(0);
@@ -122,6 +135,10 @@ static void global_knobs__get(const struct starpu_perf_knob * const knob, void *
 	{
 		value->val_int32_t = _starpu_get_catch_signals();
 	}
+	else if (knob->id == __g_sched_overhead_knob)
+	{
+		value->val_int32_t = _starpu_sched_overhead_enabled;
+	}
 	else
 	{
 		STARPU_ASSERT(0);
@@ -174,6 +191,7 @@ void _starpu__workers_c__register_knobs(void)
 		__kg_starpu_global = _starpu_perf_knob_group_register(scope, global_knobs__set, global_knobs__get);
 		__STARPU_PERF_KNOB_REG("starpu.global", __kg_starpu_global, g_calibrate_knob, int32, "enable or disable performance models calibration (override STARPU_CALIBRATE env var)");
 		__STARPU_PERF_KNOB_REG("starpu.global", __kg_starpu_global, g_enable_catch_signal_knob, int32, "enable or disable signal catching (override STARPU_CATCH_SIGNALS env var)");
+		__STARPU_PERF_KNOB_REG("starpu.global", __kg_starpu_global, g_sched_overhead_knob, int32, "enable or disable the measurement of the runtime overhead (override STARPU_SCHED_OVERHEAD env var)");
 	}
 
 	{
@@ -1795,6 +1813,7 @@ int starpu_initialize(struct starpu_conf *user_conf, int *argc, char ***argv)
 
 	_starpu_sched_init();
 	_starpu_job_init();
+	_starpu_recorder_init();
 	_starpu_graph_init();
 
 	_starpu_init_all_sched_ctxs(&_starpu_config);
@@ -1853,6 +1872,11 @@ int starpu_initialize(struct starpu_conf *user_conf, int *argc, char ***argv)
 	}
 
 	_starpu_profiling_init();
+	_starpu_rapl_init(&_starpu_config);
+	_starpu_latency_init();
+	_starpu_perf_event_init();
+	_starpu_sched_overhead_init();
+	_starpu_critical_path_init();
 
 	_starpu_task_init();
 
@@ -1900,6 +1924,7 @@ int starpu_initialize(struct starpu_conf *user_conf, int *argc, char ***argv)
 	}
 
 	_starpu_watchdog_init();
+	_starpu_perf_exporter_init();
 
 	_starpu_profiling_start();
 
@@ -2177,6 +2202,7 @@ void starpu_shutdown(void)
 	_starpu_deinitialize_registered_performance_models();
 
 	_starpu_watchdog_shutdown();
+	_starpu_perf_exporter_shutdown();
 
 	/* wait for their termination */
 	_starpu_terminate_workers(&_starpu_config);
@@ -2199,6 +2225,11 @@ void starpu_shutdown(void)
 	_starpu_prof_tool_unload();
 
 	_starpu_profiling_terminate();
+	_starpu_rapl_deinit();
+	_starpu_latency_shutdown();
+	_starpu_sched_overhead_shutdown();
+	_starpu_critical_path_shutdown();
+	_starpu_memory_timeline_shutdown();
 
 	_starpu_disk_unregister();
 #ifdef STARPU_HAVE_HWLOC
@@ -2214,6 +2245,7 @@ void starpu_shutdown(void)
 	_starpu_data_interface_shutdown();
 
 	_starpu_job_fini();
+	_starpu_recorder_shutdown();
 
 	/* Drop all remaining tags */
 	_starpu_tag_clear();
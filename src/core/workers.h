@@ -287,6 +287,11 @@ LIST_TYPE(_starpu_worker,
 	struct starpu_profiling_worker_info profiling_info;
 	/* TODO: rather use rwlock? */
 	starpu_pthread_mutex_t profiling_info_mutex;
+	/** Time spent executing tasks, in us, and number of these tasks, while
+	 * the profiling was enabled. Contrary to profiling_info, these are
+	 * never reset. Protected by profiling_info_mutex. */
+	double cumulated_executing_time;
+	unsigned long cumulated_executed_tasks;
 
 	/* In case the worker is still sleeping when the user request profiling info,
 	 * we need to account for the time elasped while sleeping. */
@@ -26,6 +26,7 @@
 #include <core/dependencies/data_concurrency.h>
 #include <core/disk.h>
 #include <profiling/profiling.h>
+#include <profiling/sched_overhead.h>
 #include <core/task.h>
 #include <starpu_scheduler.h>
 #include <core/workers.h>
@@ -1139,7 +1140,7 @@ static void _starpu_fetch_task_input_cb(void *arg)
  * or to improve overlapping, it can call _starpu_fetch_task_input with
  * async==1, then wait for transfers to complete, then call
  * _starpu_fetch_task_input_tail to complete the fetch.	 */
-int _starpu_fetch_task_input(struct starpu_task *task, struct _starpu_job *j, int async)
+static int __starpu_fetch_task_input(struct starpu_task *task, struct _starpu_job *j, int async)
 {
 	struct _starpu_worker *worker = _starpu_get_local_worker_key();
 	int workerid = worker->workerid;
@@ -1258,6 +1259,15 @@ enomem:
 	return -1;
 }
 
+int _starpu_fetch_task_input(struct starpu_task *task, struct _starpu_job *j, int async)
+{
+	int ret;
+	_STARPU_SCHED_OVERHEAD_START(_STARPU_SCHED_OVERHEAD_FETCH);
+	ret = __starpu_fetch_task_input(task, j, async);
+	_STARPU_SCHED_OVERHEAD_END(_STARPU_SCHED_OVERHEAD_FETCH);
+	return ret;
+}
+
 /* Now that we have taken the data locks in locking order, fill the codelet interfaces in function order.  */
 void _starpu_fetch_task_input_tail(struct starpu_task *task, struct _starpu_job *j, struct _starpu_worker *worker)
 {
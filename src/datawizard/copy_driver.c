@@ -19,6 +19,7 @@
 #include <common/config.h>
 #include <common/utils.h>
 #include <core/sched_policy.h>
+#include <common/knobs.h>
 #include <datawizard/datastats.h>
 #include <datawizard/memory_nodes.h>
 #include <drivers/disk/driver_disk.h>
@@ -32,11 +33,36 @@
 #include <datawizard/copy_driver.h>
 #include <datawizard/memalloc.h>
 #include <profiling/profiling.h>
+#include <profiling/flight_recorder.h>
 
 #ifdef STARPU_SIMGRID
 #include <core/simgrid.h>
 #endif
 
+/* global counters */
+static int __g_total_transferred;
+
+/* global counter variables */
+int64_t _starpu_data__g_total_transferred__value;
+
+static void global_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
+{
+	STARPU_ASSERT(context == NULL); /* no context for the global updater */
+	(void)context;
+
+	_starpu_perf_counter_sample_set_int64_value(sample, __g_total_transferred, _starpu_data__g_total_transferred__value);
+}
+
+void _starpu__copy_driver_c__register_counters(void)
+{
+	{
+		const enum starpu_perf_counter_scope scope = starpu_perf_counter_scope_global;
+		__STARPU_PERF_COUNTER_REG("starpu.data", scope, g_total_transferred, int64, "number of bytes of data transfers started between memory nodes, globally (since StarPU initialization)");
+
+		_starpu_perf_counter_register_updater(scope, global_sample_updater);
+	}
+}
+
 void _starpu_wake_all_blocked_workers_on_node(unsigned nodeid)
 {
 	/* wake up all workers on that memory node */
@@ -346,6 +372,8 @@ int STARPU_ATTRIBUTE_WARN_UNUSED_RESULT _starpu_driver_copy_data_1_to_1(starpu_d
 		unsigned long STARPU_ATTRIBUTE_UNUSED com_id = 0;
 		size_t size = _starpu_data_get_size(handle);
 		_starpu_bus_update_profiling_info((int)src_node, (int)dst_node, size);
+		if (!_starpu_perf_counter_paused())
+			(void) STARPU_ATOMIC_ADD64(&_starpu_data__g_total_transferred__value, size);
 
 #ifdef STARPU_USE_FXT
 		if (fut_active)
@@ -360,10 +388,16 @@ int STARPU_ATTRIBUTE_WARN_UNUSED_RESULT _starpu_driver_copy_data_1_to_1(starpu_d
 		dst_replicate->initialized = 1;
 
 		_STARPU_TRACE_START_DRIVER_COPY(src_node, dst_node, size, com_id, prefetch, handle);
+		_STARPU_RECORD_TRANSFER(_STARPU_RECORDER_TRANSFER_START, src_node, dst_node, size, handle);
+		if (req)
+			req->recorded = _starpu_recorder_enabled;
 		int ret_copy = copy_data_1_to_1_generic(handle, src_replicate, dst_replicate, req);
 		if (!req)
+		{
 			/* Synchronous, this is already finished */
 			_STARPU_TRACE_END_DRIVER_COPY(src_node, dst_node, size, com_id, prefetch);
+			_STARPU_RECORD_TRANSFER(_STARPU_RECORDER_TRANSFER_END, src_node, dst_node, size, handle);
+		}
 
 		return ret_copy;
 	}
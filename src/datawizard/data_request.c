@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2008-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2008-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2013       Thibaut Lambert
  * Copyright (C) 2018,2021  Federal University of Rio Grande do Sul (UFRGS)
  *
@@ -23,6 +23,7 @@
 #include <datawizard/memory_nodes.h>
 #include <core/disk.h>
 #include <core/simgrid.h>
+#include <profiling/flight_recorder.h>
 
 void _starpu_init_data_request_lists(void)
 {
@@ -201,6 +202,7 @@ struct _starpu_data_request *_starpu_create_data_request(starpu_data_handle_t ha
 	r->next_req_count = 0;
 	r->callbacks = NULL;
 	r->com_id = 0;
+	r->recorded = 0;
 
 	_starpu_spin_lock(&r->lock);
 
@@ -446,6 +448,8 @@ static void starpu_handle_data_request_completion(struct _starpu_data_request *r
 		_STARPU_TRACE_END_DRIVER_COPY(src_node, dst_node, size, r->com_id, r->prefetch);
 	}
 #endif
+	if (r->recorded && r->canceled < 2)
+		_STARPU_RECORD_TRANSFER(_STARPU_RECORDER_TRANSFER_END, src_replicate->memory_node, dst_replicate->memory_node, _starpu_data_get_size(handle), handle);
 
 	/* Once the request has been fulfilled, we may submit the requests that
 	 * were chained to that request. */
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2008-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2008-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2021       Federal University of Rio Grande do Sul (UFRGS)
  *
  * StarPU is free software; you can redistribute it and/or modify
@@ -93,6 +93,9 @@ LIST_TYPE(_starpu_data_request,
 	/** Whether we have already added our reference to the dst replicate. */
 	unsigned added_ref:1;
 
+	/** Whether the flight recorder has recorded the start of the transfer. */
+	unsigned recorded:1;
+
 	/** Whether the request was canceled before being handled (because the transfer already happened another way). */
 	unsigned canceled:2;
 
@@ -27,6 +27,7 @@
 #include <datawizard/memory_manager.h>
 #include <datawizard/memory_nodes.h>
 #include <datawizard/malloc.h>
+#include <datawizard/memory_timeline.h>
 #include <core/simgrid.h>
 #include <core/task.h>
 
@@ -187,6 +188,7 @@ int _starpu_malloc_willpin_on_node(unsigned dst_node)
 int _starpu_malloc_flags_on_node(unsigned dst_node, void **A, size_t dim, int flags)
 {
 	int ret=0;
+	int pinned=0;
 
 	STARPU_ASSERT_MSG(A, "starpu_malloc needs to be passed the address of the pointer to be filled");
 	if (!starpu_is_initialized())
@@ -231,6 +233,7 @@ int _starpu_malloc_flags_on_node(unsigned dst_node, void **A, size_t dim, int fl
 	{
 		if (_starpu_can_submit_cuda_task())
 		{
+			pinned = 1;
 #ifdef STARPU_SIMGRID
 		/* FIXME: CUDA seems to be taking 650µs every 1MiB.
 		 * Ideally we would simulate this batching in 1MiB requests
@@ -295,6 +298,7 @@ int _starpu_malloc_flags_on_node(unsigned dst_node, void **A, size_t dim, int fl
 		}
 		if (_starpu_can_submit_hip_task())
 		{
+			pinned = 1;
 #ifdef STARPU_USE_HIP
 			hipError_t hipres = hipErrorMemoryAllocation;
 
@@ -521,6 +525,8 @@ end:
 	if (ret == 0)
 	{
 		STARPU_ASSERT_MSG(*A, "Failed to allocated memory of size %lu b\n", (unsigned long)dim);
+		if (pinned)
+			_starpu_memory_timeline_pinned(dst_node, dim);
 	}
 	else if (flags & STARPU_MALLOC_COUNT)
 	{
@@ -595,6 +601,8 @@ int _starpu_free_flags_on_node(unsigned dst_node, void *A, size_t dim, int flags
 
 	if (_starpu_malloc_should_pin(flags) && STARPU_RUNNING_ON_VALGRIND == 0)
 	{
+		if (_starpu_can_submit_cuda_task() || _starpu_can_submit_hip_task())
+			_starpu_memory_timeline_pinned(dst_node, -(starpu_ssize_t) dim);
 		if (_starpu_can_submit_cuda_task())
 		{
 #ifdef STARPU_SIMGRID
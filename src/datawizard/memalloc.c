@@ -18,6 +18,7 @@
 #include <datawizard/memory_manager.h>
 #include <datawizard/memory_nodes.h>
 #include <datawizard/memalloc.h>
+#include <datawizard/memory_timeline.h>
 #include <datawizard/footprint.h>
 #include <core/disk.h>
 #include <core/topology.h>
@@ -709,6 +710,8 @@ static size_t try_to_throw_mem_chunk(struct _starpu_mem_chunk *mc, unsigned node
 	    /* unlock the tree */
 	    unlock_all_subtree(handle);
 	}
+	if (freed)
+		_starpu_memory_timeline_evicted(node, _starpu_data_get_alloc_size(handle));
 	return freed;
 }
 
@@ -1378,6 +1381,8 @@ static void register_mem_chunk(starpu_data_handle_t handle, struct _starpu_data_
 
 	_starpu_spin_lock(&node_struct->mc_lock);
 	MC_LIST_PUSH_BACK(node_struct, mc);
+	if (_starpu_memory_timeline_enabled)
+		_starpu_memory_timeline_snapshot(dst_node);
 	_starpu_spin_unlock(&node_struct->mc_lock);
 }
 
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2012-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2012-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -20,6 +20,7 @@
 #include <common/fxt.h>
 #include <datawizard/memory_manager.h>
 #include <datawizard/memory_nodes.h>
+#include <datawizard/memory_timeline.h>
 #include <core/workers.h>
 #include <starpu_stdlib.h>
 
@@ -40,6 +41,7 @@ int _starpu_memory_manager_init()
 		STARPU_PTHREAD_MUTEX_INIT(&node->lock_nodes, NULL);
 		STARPU_PTHREAD_COND_INIT(&node->cond_nodes, NULL);
 	}
+	_starpu_memory_timeline_init();
 	return 0;
 }
 
@@ -102,6 +104,7 @@ int starpu_memory_allocate(unsigned node, size_t size, int flags)
 		/* And take it */
 		node_struct->used_size += size;
 		_STARPU_TRACE_USED_MEM(node, node_struct->used_size);
+		_starpu_memory_timeline_used(node, node_struct->used_size);
 		ret = 0;
 	}
 	else if (flags & STARPU_MEMORY_OVERFLOW
@@ -110,6 +113,7 @@ int starpu_memory_allocate(unsigned node, size_t size, int flags)
 	{
 		node_struct->used_size += size;
 		_STARPU_TRACE_USED_MEM(node, node_struct->used_size);
+		_starpu_memory_timeline_used(node, node_struct->used_size);
 		ret = 0;
 	}
 	else
@@ -127,6 +131,7 @@ void starpu_memory_deallocate(unsigned node, size_t size)
 
 	node_struct->used_size -= size;
 	_STARPU_TRACE_USED_MEM(node, node_struct->used_size);
+	_starpu_memory_timeline_used(node, node_struct->used_size);
 
 	/* If there's now room for waiters, wake them */
 	if (node_struct->waiting_size &&
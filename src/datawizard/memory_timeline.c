@@ -0,0 +1,414 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Timeline of the memory usage of each memory node.
+ *
+ * The high-water mark of the allocated memory, and the amounts of pinned and
+ * evicted memory are always counted, for the performance counters.
+ *
+ * When STARPU_MEMORY_TIMELINE is set, the allocated, cached, pinned and
+ * evicted amounts are also sampled, at most once every
+ * STARPU_MEMORY_TIMELINE_PERIOD milliseconds, when they change. Whenever the
+ * high-water mark of a node has grown by more than 1/16th since the previous
+ * record, the largest pieces of data allocated on the node are recorded as
+ * well, the next time a piece of data gets allocated there. Everything is
+ * written to STARPU_MEMORY_TIMELINE_FILE at shutdown.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <common/starpu_spinlock.h>
+#include <core/workers.h>
+#include <common/knobs.h>
+#include <datawizard/memalloc.h>
+#include <datawizard/memory_timeline.h>
+
+struct _starpu_memory_timeline_sample
+{
+	double date;
+	size_t allocated;
+	size_t cached;
+	int64_t pinned;
+	uint64_t evicted;
+};
+
+struct _starpu_memory_timeline_data
+{
+	starpu_data_handle_t handle;
+	const char *interface;
+	size_t size;
+};
+
+struct _starpu_memory_timeline_snapshot
+{
+	struct _starpu_memory_timeline_snapshot *next;
+	double date;
+	size_t high_water_mark;
+	unsigned ndata;
+	struct _starpu_memory_timeline_data data[];
+};
+
+struct _starpu_memory_timeline_node
+{
+	size_t high_water_mark;
+	int64_t pinned;
+	uint64_t evicted;
+
+	/** Protects the records below */
+	struct _starpu_spinlock lock;
+	double last_sample_date;
+	struct _starpu_memory_timeline_sample *samples;
+	unsigned nsamples;
+	unsigned allocated_samples;
+	/** High-water mark at the last snapshot */
+	size_t snapshot_mark;
+	int snapshot_pending;
+	struct _starpu_memory_timeline_snapshot *snapshots;
+	struct _starpu_memory_timeline_snapshot **last_snapshot;
+};
+
+int _starpu_memory_timeline_enabled;
+static struct _starpu_memory_timeline_node timeline_nodes[STARPU_MAXNODES];
+static double period;
+static unsigned top;
+static double start_date;
+
+/* global counters */
+static int __g_pinned_bytes;
+static int __g_evicted_bytes;
+
+/* per-worker counters, for the memory node of the worker */
+static int __w_node_allocated_bytes;
+static int __w_node_cached_bytes;
+static int __w_node_evicted_bytes;
+static int __w_node_high_water_mark;
+
+void _starpu_memory_timeline_init(void)
+{
+	unsigned node;
+
+	memset(timeline_nodes, 0, sizeof(timeline_nodes));
+	for (node = 0; node < STARPU_MAXNODES; node++)
+	{
+		_starpu_spin_init(&timeline_nodes[node].lock);
+		timeline_nodes[node].last_snapshot = &timeline_nodes[node].snapshots;
+		/* This is accessed for statistics outside the lock, don't care
+		 * about that */
+		STARPU_HG_DISABLE_CHECKING(timeline_nodes[node].high_water_mark);
+	}
+	period = starpu_getenv_number_default("STARPU_MEMORY_TIMELINE_PERIOD", 10) * 1000.;
+	top = starpu_getenv_number_default("STARPU_MEMORY_TIMELINE_TOP", 8);
+	start_date = starpu_timing_now();
+	_starpu_memory_timeline_enabled = starpu_getenv_number_default("STARPU_MEMORY_TIMELINE", 0) > 0;
+}
+
+static void record_sample(unsigned node)
+{
+	struct _starpu_memory_timeline_node *timeline_node = &timeline_nodes[node];
+	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
+	struct _starpu_memory_timeline_sample *sample;
+	double now = starpu_timing_now();
+
+	if (now - timeline_node->last_sample_date < period)
+		return;
+
+	_starpu_spin_lock(&timeline_node->lock);
+	if (!_starpu_memory_timeline_enabled || now - timeline_node->last_sample_date < period)
+	{
+		_starpu_spin_unlock(&timeline_node->lock);
+		return;
+	}
+	if (timeline_node->nsamples)
+	{
+		/* Only record changes */
+		sample = &timeline_node->samples[timeline_node->nsamples - 1];
+		if (sample->allocated == node_struct->used_size
+			&& sample->cached == (size_t) node_struct->mc_cache_size
+			&& sample->pinned == timeline_node->pinned
+			&& sample->evicted == timeline_node->evicted)
+		{
+			_starpu_spin_unlock(&timeline_node->lock);
+			return;
+		}
+	}
+	if (timeline_node->nsamples == timeline_node->allocated_samples)
+	{
+		timeline_node->allocated_samples = timeline_node->allocated_samples ? 2 * timeline_node->allocated_samples : 256;
+		_STARPU_REALLOC(timeline_node->samples, timeline_node->allocated_samples * sizeof(*timeline_node->samples));
+	}
+	sample = &timeline_node->samples[timeline_node->nsamples++];
+	sample->date = now - start_date;
+	sample->allocated = node_struct->used_size;
+	sample->cached = node_struct->mc_cache_size;
+	sample->pinned = timeline_node->pinned;
+	sample->evicted = timeline_node->evicted;
+	timeline_node->last_sample_date = now;
+	_starpu_spin_unlock(&timeline_node->lock);
+}
+
+void _starpu_memory_timeline_used(unsigned node, size_t used)
+{
+	struct _starpu_memory_timeline_node *timeline_node = &timeline_nodes[node];
+
+	if (used > timeline_node->high_water_mark)
+	{
+		timeline_node->high_water_mark = used;
+		if (_starpu_memory_timeline_enabled && top
+			&& used > timeline_node->snapshot_mark + timeline_node->snapshot_mark / 16)
+			timeline_node->snapshot_pending = 1;
+	}
+	if (_starpu_memory_timeline_enabled)
+		record_sample(node);
+}
+
+void _starpu_memory_timeline_pinned(unsigned node, starpu_ssize_t size)
+{
+	(void)STARPU_ATOMIC_ADD64(&timeline_nodes[node].pinned, size);
+	if (_starpu_memory_timeline_enabled)
+		record_sample(node);
+}
+
+void _starpu_memory_timeline_evicted(unsigned node, size_t size)
+{
+	(void)STARPU_ATOMIC_ADD64(&timeline_nodes[node].evicted, size);
+	if (_starpu_memory_timeline_enabled)
+		record_sample(node);
+}
+
+void _starpu_memory_timeline_snapshot(unsigned node)
+{
+	struct _starpu_memory_timeline_node *timeline_node = &timeline_nodes[node];
+	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
+	struct _starpu_memory_timeline_snapshot *snapshot;
+	struct _starpu_mem_chunk *mc;
+	unsigned i;
+
+	if (!timeline_node->snapshot_pending)
+		return;
+
+	_STARPU_CALLOC(snapshot, 1, sizeof(*snapshot) + top * sizeof(snapshot->data[0]));
+	snapshot->date = starpu_timing_now() - start_date;
+	snapshot->high_water_mark = timeline_node->high_water_mark;
+
+	/* Keep the largest ones, sorted by decreasing size */
+	for (mc = _starpu_mem_chunk_list_begin(&node_struct->mc_list);
+	     mc != _starpu_mem_chunk_list_end(&node_struct->mc_list);
+	     mc = _starpu_mem_chunk_list_next(mc))
+	{
+		size_t size;
+
+		if (!mc->automatically_allocated || !mc->data)
+			continue;
+		size = _starpu_data_get_alloc_size(mc->data);
+		if (snapshot->ndata == top && size <= snapshot->data[top-1].size)
+			continue;
+
+		i = snapshot->ndata < top ? snapshot->ndata++ : top - 1;
+		for ( ; i > 0 && snapshot->data[i-1].size < size; i--)
+			snapshot->data[i] = snapshot->data[i-1];
+		snapshot->data[i].handle = mc->data;
+		snapshot->data[i].interface = mc->ops->name;
+		snapshot->data[i].size = size;
+	}
+
+	_starpu_spin_lock(&timeline_node->lock);
+	if (!_starpu_memory_timeline_enabled)
+	{
+		_starpu_spin_unlock(&timeline_node->lock);
+		free(snapshot);
+		return;
+	}
+	timeline_node->snapshot_pending = 0;
+	timeline_node->snapshot_mark = snapshot->high_water_mark;
+	*timeline_node->last_snapshot = snapshot;
+	timeline_node->last_snapshot = &snapshot->next;
+	_starpu_spin_unlock(&timeline_node->lock);
+}
+
+static void write_timeline(const char *path)
+{
+	unsigned node, nnodes = starpu_memory_nodes_get_count(), i, n;
+	FILE *f = fopen(path, "w");
+
+	if (!f)
+	{
+		_STARPU_DISP("Could not open memory timeline file %s: %s\n", path, strerror(errno));
+		return;
+	}
+
+	fprintf(f, "# StarPU memory timeline, dates in ms, sizes in bytes\n");
+	fprintf(f, "# N <node> <name> <limit, -1 if none> <high-water mark>\n");
+	fprintf(f, "# S <node> <date> <allocated> <cached> <pinned> <evicted>\n");
+	fprintf(f, "# H <node> <date> <high-water mark> [<handle> <interface> <size>]...\n");
+	for (node = 0; node < nnodes; node++)
+	{
+		char name[32], *c;
+		starpu_memory_node_get_name(node, name, sizeof(name));
+		/* Keep one field per name */
+		for (c = name; *c; c++)
+			if (*c == ' ')
+				*c = '_';
+		fprintf(f, "N %u %s %ld %lu\n", node, name, (long) starpu_memory_get_total(node), (unsigned long) timeline_nodes[node].high_water_mark);
+	}
+	for (node = 0; node < nnodes; node++)
+	{
+		struct _starpu_memory_timeline_node *timeline_node = &timeline_nodes[node];
+		struct _starpu_memory_timeline_snapshot *snapshot = timeline_node->snapshots;
+
+		/* Interleave the snapshots with the samples */
+		for (i = 0; i <= timeline_node->nsamples; i++)
+		{
+			struct _starpu_memory_timeline_sample *sample = i < timeline_node->nsamples ? &timeline_node->samples[i] : NULL;
+
+			for ( ; snapshot && (!sample || snapshot->date <= sample->date); snapshot = snapshot->next)
+			{
+				fprintf(f, "H %u %.3f %lu", node, snapshot->date / 1000., (unsigned long) snapshot->high_water_mark);
+				for (n = 0; n < snapshot->ndata; n++)
+					fprintf(f, " %p %s %lu", snapshot->data[n].handle, snapshot->data[n].interface ? snapshot->data[n].interface : "unknown", (unsigned long) snapshot->data[n].size);
+				fprintf(f, "\n");
+			}
+			if (sample)
+				fprintf(f, "S %u %.3f %lu %lu %ld %lu\n", node, sample->date / 1000.,
+					(unsigned long) sample->allocated, (unsigned long) sample->cached,
+					(long) sample->pinned, (unsigned long) sample->evicted);
+		}
+	}
+	fclose(f);
+}
+
+static void display_high_water_marks(FILE *f)
+{
+	unsigned node, nnodes = starpu_memory_nodes_get_count(), n;
+
+	fprintf(f, "\n#---------------------\n");
+	fprintf(f, "Memory high-water marks:\n");
+	for (node = 0; node < nnodes; node++)
+	{
+		struct _starpu_memory_timeline_node *timeline_node = &timeline_nodes[node];
+		struct _starpu_memory_timeline_snapshot *snapshot, *last = NULL;
+		starpu_ssize_t limit = starpu_memory_get_total(node);
+		char name[32];
+
+		starpu_memory_node_get_name(node, name, sizeof(name));
+		fprintf(f, "%-20s %10.2f MiB", name, timeline_node->high_water_mark / 1048576.);
+		if (limit >= 0)
+			fprintf(f, " (limit %.2f MiB)", limit / 1048576.);
+		fprintf(f, ", evicted %.2f MiB", timeline_node->evicted / 1048576.);
+		if (timeline_node->pinned)
+			fprintf(f, ", pinned %.2f MiB", timeline_node->pinned / 1048576.);
+		fprintf(f, "\n");
+
+		for (snapshot = timeline_node->snapshots; snapshot; snapshot = snapshot->next)
+			last = snapshot;
+		if (last && last->ndata)
+		{
+			fprintf(f, "\tlargest data at %.2f MiB:", last->high_water_mark / 1048576.);
+			for (n = 0; n < last->ndata; n++)
+				fprintf(f, " %p (%.2f MiB)", last->data[n].handle, last->data[n].size / 1048576.);
+			fprintf(f, "\n");
+		}
+	}
+	fprintf(f, "#---------------------\n");
+}
+
+void _starpu_memory_timeline_shutdown(void)
+{
+	unsigned node;
+	const char *path;
+
+	if (_starpu_memory_timeline_enabled)
+	{
+		for (node = 0; node < STARPU_MAXNODES; node++)
+			_starpu_spin_lock(&timeline_nodes[node].lock);
+		_starpu_memory_timeline_enabled = 0;
+		for (node = 0; node < STARPU_MAXNODES; node++)
+			_starpu_spin_unlock(&timeline_nodes[node].lock);
+
+		display_high_water_marks(stderr);
+		path = starpu_getenv("STARPU_MEMORY_TIMELINE_FILE");
+		write_timeline(path ? path : "starpu_memory_timeline.txt");
+	}
+
+	for (node = 0; node < STARPU_MAXNODES; node++)
+	{
+		struct _starpu_memory_timeline_node *timeline_node = &timeline_nodes[node];
+		struct _starpu_memory_timeline_snapshot *snapshot, *next;
+
+		for (snapshot = timeline_node->snapshots; snapshot; snapshot = next)
+		{
+			next = snapshot->next;
+			free(snapshot);
+		}
+		timeline_node->snapshots = NULL;
+		timeline_node->last_snapshot = &timeline_node->snapshots;
+		free(timeline_node->samples);
+		timeline_node->samples = NULL;
+		timeline_node->nsamples = 0;
+		timeline_node->allocated_samples = 0;
+	}
+}
+
+static void global_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
+{
+	STARPU_ASSERT(context == NULL); /* no context for the global updater */
+	(void)context;
+	int64_t pinned = 0, evicted = 0;
+	unsigned node;
+
+	for (node = 0; node < STARPU_MAXNODES; node++)
+	{
+		pinned += timeline_nodes[node].pinned;
+		evicted += timeline_nodes[node].evicted;
+	}
+	_starpu_perf_counter_sample_set_int64_value(sample, __g_pinned_bytes, pinned);
+	_starpu_perf_counter_sample_set_int64_value(sample, __g_evicted_bytes, evicted);
+}
+
+static void per_worker_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
+{
+	STARPU_ASSERT(context != NULL);
+	struct _starpu_worker *worker = context;
+	unsigned node = worker->memory_node;
+	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
+
+	_starpu_perf_counter_sample_set_int64_value(sample, __w_node_allocated_bytes, node_struct->used_size);
+	_starpu_perf_counter_sample_set_int64_value(sample, __w_node_cached_bytes, node_struct->mc_cache_size);
+	_starpu_perf_counter_sample_set_int64_value(sample, __w_node_evicted_bytes, timeline_nodes[node].evicted);
+	_starpu_perf_counter_sample_set_int64_value(sample, __w_node_high_water_mark, timeline_nodes[node].high_water_mark);
+}
+
+void _starpu__memory_timeline_c__register_counters(void)
+{
+	{
+		const enum starpu_perf_counter_scope scope = starpu_perf_counter_scope_global;
+		__STARPU_PERF_COUNTER_REG("starpu.data", scope, g_pinned_bytes, int64, "number of bytes of pinned memory currently allocated with starpu_malloc_flags(), globally");
+		__STARPU_PERF_COUNTER_REG("starpu.data", scope, g_evicted_bytes, int64, "number of bytes of data evicted from memory nodes to make room, globally (since StarPU initialization)");
+
+		_starpu_perf_counter_register_updater(scope, global_sample_updater);
+	}
+
+	{
+		const enum starpu_perf_counter_scope scope = starpu_perf_counter_scope_per_worker;
+		__STARPU_PERF_COUNTER_REG("starpu.data", scope, w_node_allocated_bytes, int64, "number of bytes currently allocated by StarPU on the memory node of this worker");
+		__STARPU_PERF_COUNTER_REG("starpu.data", scope, w_node_cached_bytes, int64, "number of bytes currently kept in the allocation cache of the memory node of this worker");
+		__STARPU_PERF_COUNTER_REG("starpu.data", scope, w_node_evicted_bytes, int64, "number of bytes of data evicted from the memory node of this worker to make room (since StarPU initialization)");
+		__STARPU_PERF_COUNTER_REG("starpu.data", scope, w_node_high_water_mark, int64, "largest number of bytes allocated by StarPU on the memory node of this worker (since StarPU initialization)");
+
+		_starpu_perf_counter_register_updater(scope, per_worker_sample_updater);
+	}
+}
@@ -0,0 +1,50 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __MEMORY_TIMELINE_H__
+#define __MEMORY_TIMELINE_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+/** Whether the timeline of the memory usage is being recorded, see
+ * STARPU_MEMORY_TIMELINE */
+extern int _starpu_memory_timeline_enabled;
+
+void _starpu_memory_timeline_init(void);
+/** Write the recorded timeline and display the high-water marks, if
+ * enabled, and free the records */
+void _starpu_memory_timeline_shutdown(void);
+
+/** The number of bytes allocated on the node has changed to \p used. This is
+ * to be called with the lock_nodes mutex of the node held. */
+void _starpu_memory_timeline_used(unsigned node, size_t used);
+/** \p size bytes were pinned, or unpinned if negative, on the node */
+void _starpu_memory_timeline_pinned(unsigned node, starpu_ssize_t size);
+/** A piece of data of \p size bytes was evicted from the node */
+void _starpu_memory_timeline_evicted(unsigned node, size_t size);
+/** Record the largest pieces of data allocated on the node, if a new
+ * high-water mark was reached since the previous call. This is to be
+ * called with the mc_lock of the node held. */
+void _starpu_memory_timeline_snapshot(unsigned node);
+
+#pragma GCC visibility pop
+
+#endif // __MEMORY_TIMELINE_H__
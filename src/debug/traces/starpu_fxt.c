@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2009-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2009-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2013       Joris Pablo
  * Copyright (C) 2013       Thibaut Lambert
  * Copyright (C) 2017-2021  Federal University of Rio Grande do Sul (UFRGS)
@@ -75,6 +75,9 @@ static FILE *trace_file;
 static FILE *comms_file;
 static FILE *sched_tasks_file;
 static FILE *number_events_file;
+static struct _starpu_fxt_columns *states_columns;
+static struct _starpu_fxt_columns *tasks_columns;
+static struct _starpu_fxt_columns *transfers_columns;
 
 struct data_parameter_info
 {
@@ -218,6 +221,25 @@ void _starpu_convert_numa_nodes_bitmap_to_str(long bitmap, char* str)
 	}
 }
 
+static void task_dump_columns(struct task_info *task)
+{
+	_starpu_fxt_columns_add_int(tasks_columns, task->mpi_rank);
+	_starpu_fxt_columns_add_int(tasks_columns, task->job_id);
+	_starpu_fxt_columns_add_int(tasks_columns, task->submit_order);
+	_starpu_fxt_columns_add_string(tasks_columns, task->name);
+	_starpu_fxt_columns_add_string(tasks_columns, task->model_name);
+	_starpu_fxt_columns_add_int(tasks_columns, task->priority);
+	_starpu_fxt_columns_add_int(tasks_columns, task->workerid);
+	_starpu_fxt_columns_add_int(tasks_columns, task->node);
+	_starpu_fxt_columns_add_double(tasks_columns, task->submit_time);
+	_starpu_fxt_columns_add_double(tasks_columns, task->start_time);
+	_starpu_fxt_columns_add_double(tasks_columns, task->end_time);
+	_starpu_fxt_columns_add_int(tasks_columns, task->footprint);
+	_starpu_fxt_columns_add_double(tasks_columns, ((double) task->kflops) / 1000000);
+	_starpu_fxt_columns_add_int(tasks_columns, task->tag);
+	_starpu_fxt_columns_end_row(tasks_columns);
+}
+
 static void task_dump(struct task_info *task, struct starpu_fxt_options *options)
 {
 	char *prefix = options->file_prefix;
@@ -225,6 +247,8 @@ static void task_dump(struct task_info *task, struct starpu_fxt_options *options
 
 	if (task->exclude_from_dag)
 		goto out;
+	if (tasks_columns)
+		task_dump_columns(task);
 	if (!tasks_file)
 		goto out;
 
@@ -1153,6 +1177,20 @@ static void mpicommthread_pop_state(double time, const char *prefix)
 
 static void recfmt_dump_state(double time, const char *event, int workerid, long int threadid, const char *name, const char *type)
 {
+	if (states_columns)
+	{
+		_starpu_fxt_columns_add_string(states_columns, event);
+		_starpu_fxt_columns_add_string(states_columns, name);
+		_starpu_fxt_columns_add_string(states_columns, type);
+		_starpu_fxt_columns_add_int(states_columns, workerid);
+		_starpu_fxt_columns_add_int(states_columns, threadid);
+		_starpu_fxt_columns_add_double(states_columns, time);
+		_starpu_fxt_columns_end_row(states_columns);
+	}
+
+	if (!trace_file)
+		return;
+
 	fprintf(trace_file, "E: %s\n", event);
 	if (name)
 		fprintf(trace_file, "N: %s\n", name);
@@ -1254,7 +1292,7 @@ static void do_worker_set_state(double time, const char *prefix, int workerid, c
 {
 	if (out_paje_file)
 		worker_set_state(time, prefix, workerid, name);
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_worker_set_state(time, workerid, name, type);
 }
 
@@ -1262,7 +1300,7 @@ static void do_thread_set_state(double time, const char *prefix, long unsigned i
 {
 	if (out_paje_file)
 		thread_set_state(time, prefix, threadid, name);
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_thread_set_state(time, prefixTOnodeid(prefix), threadid, name, type);
 }
 
@@ -1270,7 +1308,7 @@ static void do_thread_push_state(double time, const char *prefix, long unsigned
 {
 	if (out_paje_file)
 		thread_push_state(time, prefix, threadid, name);
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_thread_push_state(time, prefixTOnodeid(prefix), threadid, name, type);
 }
 
@@ -1278,7 +1316,7 @@ static void do_thread_pop_state(double time, const char *prefix, long unsigned i
 {
 	if (out_paje_file)
 		thread_pop_state(time, prefix, threadid);
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_thread_pop_state(time, prefixTOnodeid(prefix), threadid);
 }
 
@@ -1286,7 +1324,7 @@ static void do_mpicommthread_set_state(double time, const char *prefix, const ch
 {
 	if (out_paje_file)
 		mpicommthread_set_state(time, prefix, name);
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_mpicommthread_set_state(time, name);
 }
 
@@ -1294,7 +1332,7 @@ static void do_mpicommthread_push_state(double time, const char *prefix, const c
 {
 	if (out_paje_file)
 		mpicommthread_push_state(time, prefix, name);
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_mpicommthread_push_state(time, name);
 }
 
@@ -1302,7 +1340,7 @@ static void do_mpicommthread_pop_state(double time, const char *prefix)
 {
 	if (out_paje_file)
 		mpicommthread_pop_state(time, prefix);
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_mpicommthread_pop_state(time);
 }
 
@@ -1310,7 +1348,7 @@ static void do_user_thread_push_state(double time, const char *prefix, long unsi
 {
 	if (out_paje_file)
 		user_thread_push_state(time, prefix, threadid, name);
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_user_thread_push_state(time, threadid, name, type);
 }
 
@@ -1318,7 +1356,7 @@ static void do_user_thread_pop_state(double time, const char *prefix, long unsig
 {
 	if (out_paje_file)
 		user_thread_pop_state(time, prefix, threadid);
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_user_thread_pop_state(time, threadid);
 }
 
@@ -1556,7 +1594,7 @@ static void handle_worker_deinit_end(struct fxt_ev_64 *ev, struct starpu_fxt_opt
 			get_event_time_stamp(ev, options), prefix, ev->param[1]);
 #endif
 	}
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_thread_set_state(get_event_time_stamp(ev, options), prefixTOnodeid(prefix), ev->param[1], "End", NULL);
 }
 
@@ -2539,6 +2577,20 @@ static void handle_end_driver_copy(struct fxt_ev_64 *ev, struct starpu_fxt_optio
 
 				_starpu_communication_list_push_back(&communication_list, com);
 
+				if (transfers_columns)
+				{
+					_starpu_fxt_columns_add_int(transfers_columns, options->file_rank);
+					_starpu_fxt_columns_add_int(transfers_columns, comid);
+					_starpu_fxt_columns_add_int(transfers_columns, itor->src_node);
+					_starpu_fxt_columns_add_int(transfers_columns, itor->dst_node);
+					_starpu_fxt_columns_add_int(transfers_columns, size);
+					_starpu_fxt_columns_add_string(transfers_columns, link_type);
+					_starpu_fxt_columns_add_int(transfers_columns, handle);
+					_starpu_fxt_columns_add_double(transfers_columns, itor->comm_start);
+					_starpu_fxt_columns_add_double(transfers_columns, comm_end);
+					_starpu_fxt_columns_end_row(transfers_columns);
+				}
+
 				break;
 			}
 		}
@@ -3482,7 +3534,7 @@ static void handle_string_event(struct fxt_ev_64 *ev, const char *event, struct
 #endif
 	}
 
-	if (trace_file)
+	if (trace_file || states_columns)
 		recfmt_dump_state(get_event_time_stamp(ev, options), "ProgEvent", -1, 0, event, "Program");
 }
 
@@ -4553,6 +4605,9 @@ void _starpu_fxt_options_set_dir(struct starpu_fxt_options *options)
 	_set_dir(options->dir, &options->distrib_time_path);
 	_set_dir(options->dir, &options->activity_path);
 	_set_dir(options->dir, &options->sched_tasks_path);
+	_set_dir(options->dir, &options->states_columns_path);
+	_set_dir(options->dir, &options->tasks_columns_path);
+	_set_dir(options->dir, &options->transfers_columns_path);
 }
 
 void starpu_fxt_options_shutdown(struct starpu_fxt_options *options)
@@ -4569,6 +4624,9 @@ void starpu_fxt_options_shutdown(struct starpu_fxt_options *options)
 	free(options->distrib_time_path);
 	free(options->activity_path);
 	free(options->sched_tasks_path);
+	free(options->states_columns_path);
+	free(options->tasks_columns_path);
+	free(options->transfers_columns_path);
 }
 
 static
@@ -4682,6 +4740,33 @@ void _starpu_fxt_comms_file_init(struct starpu_fxt_options *options)
 		comms_file = NULL;
 }
 
+static
+void _starpu_fxt_columns_files_init(struct starpu_fxt_options *options)
+{
+	states_columns = NULL;
+	tasks_columns = NULL;
+	transfers_columns = NULL;
+
+	if (options->states_columns_path)
+	{
+		static const char * const names[] = { "Event", "Name", "Category", "WorkerId", "ThreadId", "Time" };
+		static const enum _starpu_fxt_column_type types[] = { _STARPU_FXT_COLUMN_STRING, _STARPU_FXT_COLUMN_STRING, _STARPU_FXT_COLUMN_STRING, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_DOUBLE };
+		states_columns = _starpu_fxt_columns_open(options->states_columns_path, "states", sizeof(names)/sizeof(names[0]), names, types);
+	}
+	if (options->tasks_columns_path)
+	{
+		static const char * const names[] = { "MPIRank", "JobId", "SubmitOrder", "Name", "Model", "Priority", "WorkerId", "MemoryNode", "SubmitTime", "StartTime", "EndTime", "Footprint", "GFlop", "Tag" };
+		static const enum _starpu_fxt_column_type types[] = { _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_STRING, _STARPU_FXT_COLUMN_STRING, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_DOUBLE, _STARPU_FXT_COLUMN_DOUBLE, _STARPU_FXT_COLUMN_DOUBLE, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_DOUBLE, _STARPU_FXT_COLUMN_INT64 };
+		tasks_columns = _starpu_fxt_columns_open(options->tasks_columns_path, "tasks", sizeof(names)/sizeof(names[0]), names, types);
+	}
+	if (options->transfers_columns_path)
+	{
+		static const char * const names[] = { "MPIRank", "ComId", "Src", "Dst", "Size", "Type", "Handle", "StartTime", "EndTime" };
+		static const enum _starpu_fxt_column_type types[] = { _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_STRING, _STARPU_FXT_COLUMN_INT64, _STARPU_FXT_COLUMN_DOUBLE, _STARPU_FXT_COLUMN_DOUBLE };
+		transfers_columns = _starpu_fxt_columns_open(options->transfers_columns_path, "transfers", sizeof(names)/sizeof(names[0]), names, types);
+	}
+}
+
 static
 void _starpu_fxt_number_events_file_init(struct starpu_fxt_options *options)
 {
@@ -4784,6 +4869,14 @@ void _starpu_fxt_comms_file_close(void)
 		fclose(comms_file);
 }
 
+static
+void _starpu_fxt_columns_files_close(void)
+{
+	_starpu_fxt_columns_close(states_columns);
+	_starpu_fxt_columns_close(tasks_columns);
+	_starpu_fxt_columns_close(transfers_columns);
+}
+
 static
 void _starpu_fxt_number_events_file_close(void)
 {
@@ -4901,7 +4994,8 @@ uint64_t _starpu_fxt_find_start_time(char *filename_in)
 		STARPU_ABORT_MSG("Failed to open '%s' (err %s)", filename_in, strerror(errno));
 	}
 
-	static fxt_t fut;
+	/* Not static: the trace files are scanned in parallel */
+	fxt_t fut;
 	fut = fxt_fdopen(fd_in);
 	if (!fut)
 	{
@@ -4934,6 +5028,64 @@ uint64_t _starpu_fxt_find_start_time(char *filename_in)
 	return (ev.time);
 }
 
+/* Pre-scan of the trace files, looking for their start time and
+ * synchronization points. Finding the latter usually means decoding the whole
+ * file, so this is done by several threads, each of them taking the next file
+ * to be scanned. */
+struct _starpu_fxt_scan
+{
+	struct starpu_fxt_options *options;
+	unsigned next;
+	uint64_t *start_k;
+	struct starpu_fxt_mpi_offset *sync_barriers;
+	int *unique_keys;
+	int *rank_k;
+};
+
+static void *_starpu_fxt_scan_files(void *arg)
+{
+	struct _starpu_fxt_scan *scan = arg;
+	unsigned inputfile;
+
+	while ((inputfile = STARPU_ATOMIC_ADD(&scan->next, 1) - 1) < scan->options->ninputfiles)
+	{
+		char *filename = scan->options->filenames[inputfile];
+		scan->start_k[inputfile] = _starpu_fxt_find_start_time(filename);
+		scan->sync_barriers[inputfile] = _starpu_fxt_mpi_find_sync_points(filename,
+										  &scan->unique_keys[inputfile],
+										  &scan->rank_k[inputfile]);
+	}
+	return NULL;
+}
+
+/* With simgrid, starpu_pthread functions are not usable outside the
+ * simulation, the files are then scanned by the current thread only. */
+static void _starpu_fxt_scan_all_files(struct _starpu_fxt_scan *scan)
+{
+	scan->next = 0;
+#ifndef STARPU_SIMGRID
+	unsigned nthreads = 1, i;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus > 1)
+		nthreads = ncpus;
+#endif
+	if (nthreads > scan->options->ninputfiles)
+		nthreads = scan->options->ninputfiles;
+
+	starpu_pthread_t threads[nthreads];
+	/* The current thread takes its share of the files too */
+	for (i = 1; i < nthreads; i++)
+		STARPU_PTHREAD_CREATE(&threads[i], NULL, _starpu_fxt_scan_files, scan);
+	_starpu_fxt_scan_files(scan);
+	for (i = 1; i < nthreads; i++)
+		STARPU_PTHREAD_JOIN(threads[i], NULL);
+#else
+	_starpu_fxt_scan_files(scan);
+#endif
+}
+
 void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 {
 	starpu_drivers_preinit();
@@ -4949,6 +5101,7 @@ void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 	_starpu_fxt_comms_file_init(options);
 	_starpu_fxt_number_events_file_init(options);
 	_starpu_fxt_trace_file_init(options);
+	_starpu_fxt_columns_files_init(options);
 
 	_starpu_fxt_paje_file_init(options);
 
@@ -4994,19 +5147,19 @@ void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 		int key = -1;
 		unsigned display_mpi = 0;
 
-		/* Get all trace starts */
-		for (inputfile = 0; inputfile < options->ninputfiles; inputfile++)
+		/* Get all trace starts and look for all synchronization points, if they exist */
+		struct _starpu_fxt_scan scan =
 		{
-			uint64_t file_start = _starpu_fxt_find_start_time(options->filenames[inputfile]);
-			start_k[inputfile] = file_start;
-		}
+			.options = options,
+			.start_k = start_k,
+			.sync_barriers = sync_barriers,
+			.unique_keys = unique_keys,
+			.rank_k = rank_k,
+		};
+		_starpu_fxt_scan_all_files(&scan);
 
-		/* Look for all synchronization points, if they exist */
 		for (inputfile = 0; inputfile < options->ninputfiles; inputfile++)
 		{
-			sync_barriers[inputfile] = _starpu_fxt_mpi_find_sync_points(options->filenames[inputfile],
-										   &unique_keys[inputfile],
-										   &rank_k[inputfile]);
 			if (sync_barriers[inputfile].nb_barriers > 0)
 			{
 				/* Let's start by making sure all trace files come from the same execution: */
@@ -5109,6 +5262,7 @@ void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 	_starpu_fxt_comms_file_close();
 	_starpu_fxt_number_events_file_close();
 	_starpu_fxt_trace_file_close();
+	_starpu_fxt_columns_files_close();
 
 	_starpu_fxt_dag_terminate();
 
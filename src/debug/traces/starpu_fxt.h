@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2009-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2009-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2018-2020  Federal University of Rio Grande do Sul (UFRGS)
  *
  * StarPU is free software; you can redistribute it and/or modify
@@ -90,6 +90,25 @@ extern int _starpu_poti_MemoryEvent;
 extern int _starpu_poti_CommLinkStart;
 extern int _starpu_poti_MpiLinkStart;
 
+/*
+ * Columnar output
+ */
+enum _starpu_fxt_column_type
+{
+	_STARPU_FXT_COLUMN_INT64 = 0,
+	_STARPU_FXT_COLUMN_DOUBLE = 1,
+	_STARPU_FXT_COLUMN_STRING = 2,
+};
+
+struct _starpu_fxt_columns;
+struct _starpu_fxt_columns *_starpu_fxt_columns_open(const char *path, const char *table, unsigned ncolumns, const char * const *names, const enum _starpu_fxt_column_type *types);
+/* The values of a row have to be added in the order of the columns */
+void _starpu_fxt_columns_add_int(struct _starpu_fxt_columns *columns, int64_t value);
+void _starpu_fxt_columns_add_double(struct _starpu_fxt_columns *columns, double value);
+void _starpu_fxt_columns_add_string(struct _starpu_fxt_columns *columns, const char *value);
+void _starpu_fxt_columns_end_row(struct _starpu_fxt_columns *columns);
+void _starpu_fxt_columns_close(struct _starpu_fxt_columns *columns);
+
 /*
  * Animation
  */
@@ -0,0 +1,273 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <common/config.h>
+
+#ifdef STARPU_USE_FXT
+
+#include <common/utils.h>
+#include <common/uthash.h>
+#include "starpu_fxt.h"
+
+/*
+ * Minimal columnar writer, so that analysis tools can load the columns of the
+ * trace directly into arrays instead of parsing text.
+ *
+ * All numbers are written in the host byte order, which the reader can detect
+ * from the endianness mark. The file is made of:
+ * - a header: the "STPUCOL1" magic, the uint32 endianness mark 0x01020304,
+ *   the table name, the uint32 number of columns, and for each column its
+ *   uint32 type (enum _starpu_fxt_column_type) and its name,
+ * - row groups, each of them starting with its uint32 number of rows, followed
+ *   by each column chunk: nrows int64 or double values, or for the string
+ *   columns the uint32 number of strings added to the dictionary of the column
+ *   by this row group, these strings, and nrows uint32 indexes in the
+ *   dictionary,
+ * - a uint32 0 end mark.
+ * Strings are written as their uint32 length followed by their characters.
+ *
+ * Only one row group is kept in memory.
+ */
+
+#define ROW_GROUP_SIZE 65536
+
+struct column_string
+{
+	UT_hash_handle hh;
+	char *string;
+	uint32_t index;
+};
+
+struct column
+{
+	enum _starpu_fxt_column_type type;
+	union
+	{
+		int64_t *i;
+		double *d;
+		uint32_t *s;
+	} values;
+	/* Dictionary of the string columns */
+	struct column_string *strings;
+	uint32_t nstrings;
+	/* Strings of the dictionary not written yet */
+	uint32_t nwritten;
+	char **new_strings;
+	uint32_t new_strings_size;
+};
+
+struct _starpu_fxt_columns
+{
+	FILE *file;
+	char *path;
+	unsigned ncolumns;
+	struct column *columns;
+	/* Number of rows in the current row group */
+	unsigned nrows;
+	/* Next column to be filled in the current row */
+	unsigned next;
+};
+
+static void write_u32(struct _starpu_fxt_columns *columns, uint32_t value)
+{
+	if (fwrite(&value, sizeof(value), 1, columns->file) != 1)
+		STARPU_ABORT_MSG("Failed to write '%s' (err %s)", columns->path, strerror(errno));
+}
+
+static void write_string(struct _starpu_fxt_columns *columns, const char *string)
+{
+	uint32_t len = strlen(string);
+	write_u32(columns, len);
+	if (len && fwrite(string, len, 1, columns->file) != 1)
+		STARPU_ABORT_MSG("Failed to write '%s' (err %s)", columns->path, strerror(errno));
+}
+
+struct _starpu_fxt_columns *_starpu_fxt_columns_open(const char *path, const char *table, unsigned ncolumns, const char * const *names, const enum _starpu_fxt_column_type *types)
+{
+	struct _starpu_fxt_columns *columns;
+	unsigned i;
+
+	_STARPU_CALLOC(columns, 1, sizeof(*columns));
+	columns->file = fopen(path, "w+");
+	if (columns->file == NULL)
+		STARPU_ABORT_MSG("Failed to open '%s' (err %s)", path, strerror(errno));
+	columns->path = strdup(path);
+	columns->ncolumns = ncolumns;
+	_STARPU_CALLOC(columns->columns, ncolumns, sizeof(*columns->columns));
+
+	if (fwrite("STPUCOL1", 8, 1, columns->file) != 1)
+		STARPU_ABORT_MSG("Failed to write '%s' (err %s)", path, strerror(errno));
+	write_u32(columns, 0x01020304);
+	write_string(columns, table);
+	write_u32(columns, ncolumns);
+
+	for (i = 0; i < ncolumns; i++)
+	{
+		struct column *column = &columns->columns[i];
+		column->type = types[i];
+		switch (column->type)
+		{
+			case _STARPU_FXT_COLUMN_INT64:
+				_STARPU_MALLOC(column->values.i, ROW_GROUP_SIZE * sizeof(*column->values.i));
+				break;
+			case _STARPU_FXT_COLUMN_DOUBLE:
+				_STARPU_MALLOC(column->values.d, ROW_GROUP_SIZE * sizeof(*column->values.d));
+				break;
+			case _STARPU_FXT_COLUMN_STRING:
+				_STARPU_MALLOC(column->values.s, ROW_GROUP_SIZE * sizeof(*column->values.s));
+				break;
+			default:
+				STARPU_ABORT();
+		}
+		write_u32(columns, column->type);
+		write_string(columns, names[i]);
+	}
+
+	return columns;
+}
+
+static struct column *next_column(struct _starpu_fxt_columns *columns, enum _starpu_fxt_column_type type)
+{
+	STARPU_ASSERT(columns->next < columns->ncolumns);
+	struct column *column = &columns->columns[columns->next++];
+	STARPU_ASSERT(column->type == type);
+	return column;
+}
+
+void _starpu_fxt_columns_add_int(struct _starpu_fxt_columns *columns, int64_t value)
+{
+	struct column *column = next_column(columns, _STARPU_FXT_COLUMN_INT64);
+	column->values.i[columns->nrows] = value;
+}
+
+void _starpu_fxt_columns_add_double(struct _starpu_fxt_columns *columns, double value)
+{
+	struct column *column = next_column(columns, _STARPU_FXT_COLUMN_DOUBLE);
+	column->values.d[columns->nrows] = value;
+}
+
+void _starpu_fxt_columns_add_string(struct _starpu_fxt_columns *columns, const char *value)
+{
+	struct column *column = next_column(columns, _STARPU_FXT_COLUMN_STRING);
+	struct column_string *string;
+
+	if (!value)
+		value = "";
+
+	HASH_FIND_STR(column->strings, value, string);
+	if (!string)
+	{
+		_STARPU_MALLOC(string, sizeof(*string));
+		string->string = strdup(value);
+		string->index = column->nstrings++;
+		HASH_ADD_KEYPTR(hh, column->strings, string->string, strlen(string->string), string);
+
+		uint32_t nnew = column->nstrings - column->nwritten;
+		if (nnew > column->new_strings_size)
+		{
+			column->new_strings_size = column->new_strings_size ? 2 * column->new_strings_size : 16;
+			_STARPU_REALLOC(column->new_strings, column->new_strings_size * sizeof(*column->new_strings));
+		}
+		column->new_strings[nnew - 1] = string->string;
+	}
+	column->values.s[columns->nrows] = string->index;
+}
+
+static void flush_row_group(struct _starpu_fxt_columns *columns)
+{
+	unsigned i, nrows = columns->nrows;
+	size_t size = 0;
+	void *values = NULL;
+
+	if (!nrows)
+		return;
+
+	write_u32(columns, nrows);
+	for (i = 0; i < columns->ncolumns; i++)
+	{
+		struct column *column = &columns->columns[i];
+		switch (column->type)
+		{
+			case _STARPU_FXT_COLUMN_INT64:
+				values = column->values.i;
+				size = sizeof(*column->values.i);
+				break;
+			case _STARPU_FXT_COLUMN_DOUBLE:
+				values = column->values.d;
+				size = sizeof(*column->values.d);
+				break;
+			case _STARPU_FXT_COLUMN_STRING:
+			{
+				uint32_t j, nnew = column->nstrings - column->nwritten;
+				write_u32(columns, nnew);
+				for (j = 0; j < nnew; j++)
+					write_string(columns, column->new_strings[j]);
+				column->nwritten = column->nstrings;
+				values = column->values.s;
+				size = sizeof(*column->values.s);
+				break;
+			}
+		}
+		if (fwrite(values, size, nrows, columns->file) != nrows)
+			STARPU_ABORT_MSG("Failed to write '%s' (err %s)", columns->path, strerror(errno));
+	}
+	columns->nrows = 0;
+}
+
+void _starpu_fxt_columns_end_row(struct _starpu_fxt_columns *columns)
+{
+	STARPU_ASSERT(columns->next == columns->ncolumns);
+	columns->next = 0;
+	if (++columns->nrows == ROW_GROUP_SIZE)
+		flush_row_group(columns);
+}
+
+void _starpu_fxt_columns_close(struct _starpu_fxt_columns *columns)
+{
+	unsigned i;
+
+	if (!columns)
+		return;
+
+	STARPU_ASSERT(columns->next == 0);
+	flush_row_group(columns);
+	write_u32(columns, 0);
+	fclose(columns->file);
+
+	for (i = 0; i < columns->ncolumns; i++)
+	{
+		struct column *column = &columns->columns[i];
+		struct column_string *string, *tmp;
+		HASH_ITER(hh, column->strings, string, tmp)
+		{
+			HASH_DEL(column->strings, string);
+			free(string->string);
+			free(string);
+		}
+		free(column->new_strings);
+		/* All the union members are the same pointer */
+		free(column->values.i);
+	}
+	free(columns->columns);
+	free(columns->path);
+	free(columns);
+}
+
+#endif // STARPU_USE_FXT
@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2010-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2010-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2017-2020  Federal University of Rio Grande do Sul (UFRGS)
  *
  * StarPU is free software; you can redistribute it and/or modify
@@ -58,7 +58,8 @@ struct starpu_fxt_mpi_offset _starpu_fxt_mpi_find_sync_points(char *filename_in,
 		_exit(EXIT_FAILURE);
 	}
 
-	static fxt_t fut;
+	/* Not static: the trace files are scanned in parallel */
+	fxt_t fut;
 	fut = fxt_fdopen(fd_in);
 	if (!fut)
 	{
@@ -103,12 +104,20 @@ struct starpu_fxt_mpi_offset _starpu_fxt_mpi_find_sync_points(char *filename_in,
 		}
 	}
 
+#ifdef HAVE_FXT_BLOCKEV_LEAVE
+	fxt_blockev_leave(block);
+#endif
+
 	/* Close the trace file */
+#ifdef HAVE_FXT_CLOSE
+	fxt_close(fut);
+#else
 	if (close(fd_in))
 	{
 		perror("close failed :");
 		_exit(EXIT_FAILURE);
 	}
+#endif
 
 	return offset;
 }
@@ -46,6 +46,7 @@
 #include <core/disk.h>
 #include <common/knobs.h>
 #include <profiling/callbacks.h>
+#include <profiling/perf_event.h>
 
 #ifdef STARPU_HAVE_HWLOC
 #include <hwloc.h>
@@ -179,6 +180,9 @@ int _starpu_cpu_driver_init(struct _starpu_worker *cpu_worker)
 	snprintf(cpu_worker->short_name, sizeof(cpu_worker->short_name), "CPU %d", devid);
 	starpu_pthread_setname(cpu_worker->short_name);
 
+	if (_starpu_perf_event_enabled)
+		_starpu_perf_event_worker_init(cpu_worker->workerid);
+
 	_STARPU_TRACE_WORKER_INIT_END(cpu_worker->workerid);
 
 	STARPU_PTHREAD_MUTEX_LOCK_SCHED(&cpu_worker->sched_mutex);
@@ -210,6 +214,9 @@ int _starpu_cpu_driver_deinit(struct _starpu_worker *cpu_worker)
 	 * coherency is not maintained anymore at that point ! */
 	_starpu_free_all_automatically_allocated_buffers(memnode);
 
+	if (_starpu_perf_event_enabled)
+		_starpu_perf_event_worker_deinit(cpu_worker->workerid);
+
 	cpu_worker->worker_is_initialized = 0;
 	_STARPU_TRACE_WORKER_DEINIT_END(STARPU_CPU_WORKER);
 
@@ -391,7 +398,11 @@ static int execute_job_on_cpu(struct _starpu_job *j, struct starpu_task *worker_
 			if (rank == 0)
 				_starpu_profiling_papi_task_start_counters(task);
 #endif
+			if (rank == 0 && _starpu_perf_event_enabled)
+				_starpu_perf_event_task_start(cpu_args->workerid);
 			func(_STARPU_TASK_GET_INTERFACES(task), task->cl_arg);
+			if (rank == 0 && _starpu_perf_event_enabled)
+				_starpu_perf_event_task_stop(cpu_args->workerid, task);
 #ifdef STARPU_PAPI
 			if (rank == 0)
 				_starpu_profiling_papi_task_stop_counters(task);
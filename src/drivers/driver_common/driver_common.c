@@ -20,6 +20,10 @@
 #include <starpu.h>
 #include <starpu_profiling.h>
 #include <profiling/profiling.h>
+#include <profiling/rapl.h>
+#include <profiling/flight_recorder.h>
+#include <profiling/latency.h>
+#include <profiling/critical_path.h>
 #include <common/utils.h>
 #include <core/debug.h>
 #include <core/sched_ctx.h>
@@ -113,6 +117,13 @@ void _starpu_driver_start_job(struct _starpu_worker *worker, struct _starpu_job
 		}
 
 		_starpu_job_notify_start(j, perf_arch);
+
+		if (_starpu_rapl_enabled)
+			_starpu_rapl_task_start(workerid);
+		if (_starpu_latency_enabled)
+			_starpu_latency_task_start(workerid, j);
+		if (_starpu_critical_path_enabled)
+			_starpu_critical_path_task_start(workerid, j);
 	}
 
 	// Find out if the worker is the master of a parallel context
@@ -149,6 +160,7 @@ void _starpu_driver_start_job(struct _starpu_worker *worker, struct _starpu_job
 		_STARPU_TRACE_TASK_NAME_LINE_COLOR(j);
 		_STARPU_TRACE_START_CODELET_BODY(j, j->nimpl, perf_arch, workerid);
 	}
+	_STARPU_RECORD_TASK(_STARPU_RECORDER_TASK_START, workerid, task);
 	_starpu_sched_ctx_unlock_read(sched_ctx->id);
 	_STARPU_TASK_BREAK_ON(task, exec);
 }
@@ -175,6 +187,7 @@ void _starpu_driver_end_job(struct _starpu_worker *worker, struct _starpu_job *j
 		_starpu_perfmodel_create_comb_if_needed(perf_arch);
 		_STARPU_TRACE_END_CODELET_BODY(j, j->nimpl, perf_arch, workerid);
 	}
+	_STARPU_RECORD_TASK(_STARPU_RECORDER_TASK_END, workerid, task);
 
 	if (cl && cl->model && cl->model->benchmarking)
 		calibrate_model = 1;
@@ -189,6 +202,12 @@ void _starpu_driver_end_job(struct _starpu_worker *worker, struct _starpu_job *j
 	{
 		if ((profiling && profiling_info) || calibrate_model || !_starpu_perf_counter_paused())
 			worker->cl_end = end;
+		if (_starpu_rapl_enabled)
+			_starpu_rapl_task_end(workerid);
+		if (_starpu_latency_enabled)
+			_starpu_latency_task_end(workerid);
+		if (_starpu_critical_path_enabled)
+			_starpu_critical_path_task_end(workerid, j);
 		STARPU_AYU_POSTRUNTASK(j->job_id);
 	}
 
@@ -224,9 +243,18 @@ void _starpu_driver_update_job_feedback(struct _starpu_job *j, struct _starpu_wo
 	struct starpu_codelet *cl = j->task->cl;
 	int calibrate_model = 0;
 	int updated = 0;
+	double rapl_energy = 0.;
 
 	_starpu_perfmodel_create_comb_if_needed(perf_arch);
 
+	if (_starpu_rapl_enabled)
+	{
+		/* Share of the energy consumed by the socket of this CPU worker */
+		rapl_energy = _starpu_rapl_worker_get_task_energy(workerid);
+		if (profiling_info && !profiling_info->energy_consumed)
+			profiling_info->energy_consumed = rapl_energy;
+	}
+
 #ifndef STARPU_SIMGRID
 	if (cl->model && cl->model->benchmarking)
 		calibrate_model = 1;
@@ -260,7 +288,7 @@ void _starpu_driver_update_job_feedback(struct _starpu_job *j, struct _starpu_wo
 
 			profiling_info->workerid = workerid;
 
-			_starpu_worker_update_profiling_info_executing(workerid, 1,
+			_starpu_worker_update_profiling_info_executing(workerid, 1, measured,
 								       profiling_info->used_cycles,
 								       profiling_info->stall_cycles,
 								       profiling_info->energy_consumed,
@@ -309,12 +337,13 @@ void _starpu_driver_update_job_feedback(struct _starpu_job *j, struct _starpu_wo
 	}
 
 	if (!updated)
-		_starpu_worker_update_profiling_info_executing(workerid, 1, 0, 0, 0, 0);
+		_starpu_worker_update_profiling_info_executing(workerid, 1, 0., 0, 0, 0, 0);
 
-	if (profiling_info && profiling_info->energy_consumed && cl->energy_model && cl->energy_model->benchmarking)
+	/* With RAPL measurements, keep refining the energy models online */
+	if (((profiling_info && profiling_info->energy_consumed) || rapl_energy) && cl->energy_model && (cl->energy_model->benchmarking || rapl_energy))
 	{
 #ifdef STARPU_OPENMP
-		double energy_consumed = profiling_info->energy_consumed;
+		double energy_consumed = profiling_info ? profiling_info->energy_consumed : rapl_energy;
 		unsigned do_update_energy_model;
 		if (j->continuation)
 		{
@@ -330,7 +359,7 @@ void _starpu_driver_update_job_feedback(struct _starpu_job *j, struct _starpu_wo
 			do_update_energy_model = 1;
 		}
 #else
-		const double energy_consumed = profiling_info->energy_consumed;
+		const double energy_consumed = profiling_info ? profiling_info->energy_consumed : rapl_energy;
 		unsigned do_update_energy_model = 1;
 #endif
 
@@ -0,0 +1,428 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Online critical path analysis: instead of recording the task graph, each
+ * job computes, when it terminates, the date at which it would have ended
+ * with an unbounded number of workers, i.e. the latest such date of its
+ * predecessors plus its own measured execution time, and propagates it to its
+ * successors while their dependencies are released. The maximum of these
+ * dates is the length of the critical path.
+ *
+ * The workers also accumulate the execution time of each codelet, which
+ * gives the area bound: the time needed to execute all the tasks without
+ * dependencies. When several architectures were used, it is obtained by
+ * distributing the tasks of each codelet among the architectures on which
+ * they were measured, which is a small linear program solved at shutdown.
+ *
+ * Only task and tag dependencies are followed, which include the implicit
+ * data dependencies.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <common/uthash.h>
+#include <core/jobs.h>
+#include <core/workers.h>
+#include <core/dependencies/cg.h>
+#include <core/dependencies/tags.h>
+#include <profiling/critical_path.h>
+#include <math.h>
+
+/* Beyond this number of codelets, the linear program is not solved, and a
+ * weaker bound is given */
+#define MAX_LP_CODELETS 256
+
+#define EPSILON 1e-9
+
+/* The critical path of the jobs terminated by non-worker threads */
+#define OTHER_THREADS STARPU_NMAXWORKERS
+
+struct _starpu_critical_path_codelet
+{
+	UT_hash_handle hh;
+	struct starpu_codelet *cl;
+	unsigned long ntasks[STARPU_NARCH];
+	/** Cumulated execution time, in µs */
+	double time[STARPU_NARCH];
+};
+
+struct _starpu_critical_path_worker
+{
+	/** Codelets executed by the worker, only the worker accesses it */
+	struct _starpu_critical_path_codelet *codelets;
+	double first_start;
+	double last_end;
+};
+
+int _starpu_critical_path_enabled;
+static struct _starpu_critical_path_worker critical_path_workers[STARPU_NMAXWORKERS];
+/** Longest critical path of the jobs terminated by each thread, in ns */
+static uint64_t critical_path_length[STARPU_NMAXWORKERS + 1];
+
+static void update_max(uint64_t *ptr, uint64_t value)
+{
+	uint64_t old;
+
+	do
+	{
+		old = *ptr;
+		if (old >= value)
+			return;
+	}
+	while (!STARPU_BOOL_COMPARE_AND_SWAP64(ptr, old, value));
+}
+
+void _starpu_critical_path_init(void)
+{
+	memset(critical_path_workers, 0, sizeof(critical_path_workers));
+	memset(critical_path_length, 0, sizeof(critical_path_length));
+	_starpu_critical_path_enabled = starpu_getenv_number_default("STARPU_CRITICAL_PATH", 0) > 0;
+}
+
+void _starpu_critical_path_task_start(int workerid, struct _starpu_job *j)
+{
+	struct _starpu_critical_path_worker *worker = &critical_path_workers[workerid];
+
+	j->cp_start_date = starpu_timing_now();
+	if (!worker->first_start)
+		worker->first_start = j->cp_start_date;
+}
+
+void _starpu_critical_path_task_end(int workerid, struct _starpu_job *j)
+{
+	struct _starpu_critical_path_worker *worker = &critical_path_workers[workerid];
+	struct starpu_codelet *cl = j->task->cl;
+	struct _starpu_critical_path_codelet *codelet;
+	enum starpu_worker_archtype arch = starpu_worker_get_type(workerid);
+	double now = starpu_timing_now();
+	double duration = now - j->cp_start_date;
+
+	/* Tasks may be executed in several pieces */
+	j->cp_duration += duration * 1000.;
+	worker->last_end = now;
+
+	HASH_FIND_PTR(worker->codelets, &cl, codelet);
+	if (STARPU_UNLIKELY(codelet == NULL))
+	{
+		_STARPU_CALLOC(codelet, 1, sizeof(*codelet));
+		codelet->cl = cl;
+		HASH_ADD_PTR(worker->codelets, cl, codelet);
+	}
+	codelet->ntasks[arch]++;
+	/* Parallel tasks occupy all the workers of the combined worker */
+	codelet->time[arch] += duration * j->task_size;
+}
+
+void _starpu_critical_path_job_terminated(struct _starpu_job *j)
+{
+	uint64_t ready = j->cp_ready;
+	int workerid = starpu_worker_get_id();
+
+	if (j->task->use_tag && j->tag)
+	{
+		if (j->tag->cp_ready > ready)
+			ready = j->tag->cp_ready;
+		j->tag->cp_ready = 0;
+	}
+
+	j->cp_end = ready + j->cp_duration;
+	/* Regenerated tasks start over */
+	j->cp_ready = 0;
+	j->cp_duration = 0;
+
+	if (j->task->use_tag && j->tag)
+		j->tag->cp_end = j->cp_end;
+
+	update_max(&critical_path_length[workerid >= 0 ? workerid : OTHER_THREADS], j->cp_end);
+}
+
+void _starpu_critical_path_notify(void *pred, struct _starpu_cg *cg)
+{
+	switch (cg->cg_type)
+	{
+		case STARPU_CG_TASK:
+			/* Only jobs have task successors */
+			update_max(&cg->succ.job->cp_ready, ((struct _starpu_job *) pred)->cp_end);
+			break;
+		case STARPU_CG_TAG:
+			/* Only tags have tag successors */
+			update_max(&cg->succ.tag->cp_ready, ((struct _starpu_tag *) pred)->cp_end);
+			break;
+		default:
+			break;
+	}
+}
+
+/*
+ * Area bound on heterogeneous architectures: if the tasks of codelet c take
+ * t(c,a) on architecture a, which has n(a) workers, and there are N(c) such
+ * tasks, then with y(c,a) the share of the tasks of c executed on a, divided
+ * by the execution time T, we maximize 1/T such that
+ *
+ *   for each a: sum_c N(c) t(c,a) y(c,a) <= n(a)
+ *   for each c: 1/T - sum_a y(c,a) <= 0
+ *
+ * Since the origin is feasible, this is solved with a single-phase tableau
+ * simplex, using Bland's rule to avoid cycling on the degenerate constraints.
+ */
+static double area_bound_lp(struct _starpu_critical_path_codelet **codelets, unsigned ncodelets, unsigned nworkers[STARPU_NARCH], double scale)
+{
+	unsigned nvars = 1, nrows = ncodelets, ncols;
+	unsigned arch, c, i, j, iter;
+	unsigned *basis;
+	double *tab, result;
+
+	for (arch = 0; arch < STARPU_NARCH; arch++)
+		if (nworkers[arch])
+			nrows++;
+	for (c = 0; c < ncodelets; c++)
+		for (arch = 0; arch < STARPU_NARCH; arch++)
+			if (nworkers[arch] && codelets[c]->ntasks[arch])
+				nvars++;
+	ncols = nvars + nrows;
+
+#define TAB(i, j) tab[(i) * (ncols + 1) + (j)]
+	_STARPU_CALLOC(tab, (nrows + 1) * (ncols + 1), sizeof(*tab));
+	_STARPU_MALLOC(basis, nrows * sizeof(*basis));
+
+	/* Variable 0 is 1/T, the objective */
+	TAB(nrows, 0) = 1.;
+	j = 1;
+	for (c = 0; c < ncodelets; c++)
+	{
+		unsigned long ntasks = 0;
+		for (arch = 0; arch < STARPU_NARCH; arch++)
+			ntasks += codelets[c]->ntasks[arch];
+
+		TAB(c, 0) = 1.;
+		i = ncodelets;
+		for (arch = 0; arch < STARPU_NARCH; arch++)
+		{
+			if (!nworkers[arch])
+				continue;
+			if (codelets[c]->ntasks[arch])
+			{
+				/* Total time of the tasks of the codelet, if they were all executed on arch */
+				TAB(i, j) = codelets[c]->time[arch] / codelets[c]->ntasks[arch] * ntasks / scale;
+				TAB(c, j) = -1.;
+				j++;
+			}
+			i++;
+		}
+	}
+	i = ncodelets;
+	for (arch = 0; arch < STARPU_NARCH; arch++)
+		if (nworkers[arch])
+			TAB(i++, ncols) = nworkers[arch];
+	/* Slack variables */
+	for (i = 0; i < nrows; i++)
+	{
+		TAB(i, nvars + i) = 1.;
+		basis[i] = nvars + i;
+	}
+
+	result = NAN;
+	for (iter = 0; iter < 100 * (nrows + ncols); iter++)
+	{
+		unsigned row = nrows, col;
+		double best = 0.;
+
+		/* Bland's rule: enter the first improving column */
+		for (col = 0; col < ncols; col++)
+			if (TAB(nrows, col) > EPSILON)
+				break;
+		if (col == ncols)
+		{
+			/* Optimal */
+			result = -TAB(nrows, ncols);
+			break;
+		}
+
+		/* and leave the row with the smallest ratio, then the smallest basic variable */
+		for (i = 0; i < nrows; i++)
+			if (TAB(i, col) > EPSILON)
+			{
+				double ratio = TAB(i, ncols) / TAB(i, col);
+				if (row == nrows || ratio < best - EPSILON || (ratio <= best + EPSILON && basis[i] < basis[row]))
+				{
+					row = i;
+					best = ratio;
+				}
+			}
+		/* Unbounded, not supposed to happen since each codelet has an architecture */
+		if (row == nrows)
+			break;
+
+		double pivot = TAB(row, col);
+		for (j = 0; j <= ncols; j++)
+			TAB(row, j) /= pivot;
+		for (i = 0; i <= nrows; i++)
+		{
+			double factor = TAB(i, col);
+			if (i == row || factor == 0.)
+				continue;
+			for (j = 0; j <= ncols; j++)
+				TAB(i, j) -= factor * TAB(row, j);
+		}
+		basis[row] = col;
+	}
+#undef TAB
+
+	free(basis);
+	free(tab);
+
+	if (isnan(result) || result <= 0.)
+		return NAN;
+	return scale / result;
+}
+
+static int compare_cl(const void *a, const void *b)
+{
+	const struct _starpu_critical_path_codelet * const *ca = a, * const *cb = b;
+	uintptr_t pa = (uintptr_t) (*ca)->cl, pb = (uintptr_t) (*cb)->cl;
+	return pa < pb ? -1 : pa > pb;
+}
+
+void _starpu_critical_path_shutdown(void)
+{
+	struct _starpu_critical_path_codelet *merged = NULL, *codelet, *tmp, **codelets;
+	unsigned nworkers[STARPU_NARCH] = { 0 };
+	double work[STARPU_NARCH] = { 0. };
+	double first_start = 0., last_end = 0., total_work = 0., min_work = 0.;
+	double critical_path = 0., makespan, area = 0., bound;
+	unsigned long ntasks = 0;
+	unsigned worker, nworkers_total = starpu_worker_get_count(), ncodelets, narchs = 0, arch, c;
+	int was_enabled = _starpu_critical_path_enabled;
+
+	_starpu_critical_path_enabled = 0;
+
+	/* Merge the codelets of all workers */
+	for (worker = 0; worker < STARPU_NMAXWORKERS; worker++)
+	{
+		struct _starpu_critical_path_worker *w = &critical_path_workers[worker];
+
+		HASH_ITER(hh, w->codelets, codelet, tmp)
+		{
+			struct _starpu_critical_path_codelet *m;
+
+			HASH_FIND_PTR(merged, &codelet->cl, m);
+			if (!m)
+			{
+				_STARPU_CALLOC(m, 1, sizeof(*m));
+				m->cl = codelet->cl;
+				HASH_ADD_PTR(merged, cl, m);
+			}
+			for (arch = 0; arch < STARPU_NARCH; arch++)
+			{
+				m->ntasks[arch] += codelet->ntasks[arch];
+				m->time[arch] += codelet->time[arch];
+			}
+			HASH_DEL(w->codelets, codelet);
+			free(codelet);
+		}
+
+		if (w->first_start && (!first_start || w->first_start < first_start))
+			first_start = w->first_start;
+		if (w->last_end > last_end)
+			last_end = w->last_end;
+	}
+
+	for (worker = 0; worker <= OTHER_THREADS; worker++)
+		if (critical_path_length[worker] / 1000. > critical_path)
+			critical_path = critical_path_length[worker] / 1000.;
+
+	ncodelets = HASH_COUNT(merged);
+	if (!was_enabled || !ncodelets)
+		goto out;
+
+	for (worker = 0; worker < nworkers_total; worker++)
+		nworkers[starpu_worker_get_type(worker)]++;
+
+	_STARPU_MALLOC(codelets, ncodelets * sizeof(*codelets));
+	c = 0;
+	HASH_ITER(hh, merged, codelet, tmp)
+		codelets[c++] = codelet;
+	/* Make the linear program deterministic */
+	qsort(codelets, ncodelets, sizeof(*codelets), compare_cl);
+
+	for (c = 0; c < ncodelets; c++)
+	{
+		double fastest = INFINITY;
+		for (arch = 0; arch < STARPU_NARCH; arch++)
+		{
+			if (!codelets[c]->ntasks[arch])
+				continue;
+			ntasks += codelets[c]->ntasks[arch];
+			work[arch] += codelets[c]->time[arch];
+			if (codelets[c]->time[arch] / codelets[c]->ntasks[arch] < fastest)
+				fastest = codelets[c]->time[arch] / codelets[c]->ntasks[arch];
+		}
+		for (arch = 0; arch < STARPU_NARCH; arch++)
+			min_work += codelets[c]->ntasks[arch] * fastest;
+	}
+	for (arch = 0; arch < STARPU_NARCH; arch++)
+	{
+		total_work += work[arch];
+		if (work[arch])
+			narchs++;
+	}
+
+	if (narchs == 1)
+	{
+		/* Homogeneous case: the work is evenly spread among the workers */
+		for (arch = 0; arch < STARPU_NARCH; arch++)
+			if (work[arch])
+				area = work[arch] / nworkers[arch];
+	}
+	else
+	{
+		area = NAN;
+		if (ncodelets <= MAX_LP_CODELETS)
+			area = area_bound_lp(codelets, ncodelets, nworkers, total_work / nworkers_total);
+		if (isnan(area))
+			/* Weaker bound: each task at its fastest speed on any worker */
+			area = min_work / nworkers_total;
+	}
+	free(codelets);
+
+	makespan = last_end - first_start;
+	bound = STARPU_MAX(critical_path, area);
+
+	fprintf(stderr, "\n#---------------------\n");
+	fprintf(stderr, "Critical path analysis of %lu tasks:\n", ntasks);
+	fprintf(stderr, "\tmakespan: %.2f ms\n", makespan / 1000.);
+	fprintf(stderr, "\ttotal work: %.2f ms", total_work / 1000.);
+	for (arch = 0; arch < STARPU_NARCH; arch++)
+		if (work[arch])
+			fprintf(stderr, ", %s: %.2f ms on %u workers", starpu_worker_get_type_as_string(arch), work[arch] / 1000., nworkers[arch]);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "\tcritical path: %.2f ms\n", critical_path / 1000.);
+	if (critical_path)
+		fprintf(stderr, "\taverage parallelism: %.2f\n", total_work / critical_path);
+	fprintf(stderr, "\tarea bound: %.2f ms\n", area / 1000.);
+	if (makespan > 0.)
+		fprintf(stderr, "\tefficiency: %.2f%% (bound %.2f ms)\n", 100. * bound / makespan, bound / 1000.);
+	fprintf(stderr, "#---------------------\n");
+
+out:
+	HASH_ITER(hh, merged, codelet, tmp)
+	{
+		HASH_DEL(merged, codelet);
+		free(codelet);
+	}
+}
@@ -0,0 +1,52 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __CRITICAL_PATH_H__
+#define __CRITICAL_PATH_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+struct _starpu_job;
+struct _starpu_cg;
+
+/** Whether the critical path analysis is enabled, see STARPU_CRITICAL_PATH */
+extern int _starpu_critical_path_enabled;
+
+void _starpu_critical_path_init(void);
+/** Display the analysis of the executed tasks, and free the per-worker
+ * records. This is to be called once the workers are terminated. */
+void _starpu_critical_path_shutdown(void);
+
+/** Measure the execution of the job by the worker */
+void _starpu_critical_path_task_start(int workerid, struct _starpu_job *j);
+void _starpu_critical_path_task_end(int workerid, struct _starpu_job *j);
+
+/** Compute the date at which the job would have ended with an unbounded
+ * number of workers. This is to be called before notifying its successors. */
+void _starpu_critical_path_job_terminated(struct _starpu_job *j);
+
+/** Propagate the end date of \p pred, a job or a tag depending on the type
+ * of \p cg, to the successor of \p cg */
+void _starpu_critical_path_notify(void *pred, struct _starpu_cg *cg);
+
+#pragma GCC visibility pop
+
+#endif // __CRITICAL_PATH_H__
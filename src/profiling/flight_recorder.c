@@ -0,0 +1,314 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Flight recorder: each thread records its last events in its own ring
+ * buffer, overwriting the oldest ones, so that what happened just before a
+ * crash or a hang can be dumped without having enabled FxT.
+ *
+ * Only the owner thread writes to its buffer, so recording an event does not
+ * need any lock. The buffers are chained in a list, which is only locked to
+ * add buffers: the dump walks it without locking, so that it can be done from
+ * a signal handler. The events being recorded during the dump may thus be
+ * inconsistent.
+ *
+ * The dump is made of a header:
+ * - the "STPUFLR1" magic,
+ * - the uint32 endianness mark 0x01020304,
+ * - the uint32 size of the events,
+ * - the double date of the dump,
+ * then for each thread:
+ * - its uint64 thread id,
+ * - the uint64 number of events it has recorded since the beginning,
+ * - the uint64 number of events which follow, from the oldest to the newest,
+ * and a last record with 0 events. The events are struct _starpu_recorder_event.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <core/jobs.h>
+#include <core/workers.h>
+#include <profiling/flight_recorder.h>
+#include <signal.h>
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+struct _starpu_recorder_event
+{
+	/** As returned by starpu_timing_now() */
+	double date;
+	uint32_t code;
+	int32_t workerid;
+	uint64_t params[3];
+};
+
+struct _starpu_recorder_buffer
+{
+	struct _starpu_recorder_buffer *next;
+	uint64_t threadid;
+	/** Number of events recorded so far, the last ones are in the ring */
+	uint64_t nevents;
+	/** Number of events of the ring, a power of two */
+	unsigned size;
+	/** The owner thread has exited, a new thread can take the buffer */
+	int exited;
+	struct _starpu_recorder_event events[];
+};
+
+struct _starpu_recorder_header
+{
+	char magic[8];
+	uint32_t mark;
+	uint32_t event_size;
+	double date;
+};
+
+struct _starpu_recorder_thread_header
+{
+	uint64_t threadid;
+	uint64_t nevents;
+	uint64_t count;
+};
+
+int _starpu_recorder_enabled;
+static unsigned recorder_size;
+static starpu_pthread_key_t recorder_key;
+static struct _starpu_recorder_buffer *recorder_buffers;
+static starpu_pthread_mutex_t recorder_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+static char recorder_path[256];
+static int recorder_signal;
+static void (*recorder_old_handler)(int);
+
+static void _starpu_recorder_thread_exit(void *arg)
+{
+	struct _starpu_recorder_buffer *buffer = arg;
+	buffer->exited = 1;
+}
+
+static struct _starpu_recorder_buffer *_starpu_recorder_get_buffer(void)
+{
+	struct _starpu_recorder_buffer *buffer = STARPU_PTHREAD_GETSPECIFIC(recorder_key);
+	if (STARPU_LIKELY(buffer != NULL))
+		return buffer;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&recorder_mutex);
+	/* Take the buffer of a thread which has exited, if any, to avoid
+	 * accumulating buffers when threads are created over and over */
+	for (buffer = recorder_buffers; buffer; buffer = buffer->next)
+		if (buffer->exited)
+			break;
+	if (buffer)
+	{
+		buffer->nevents = 0;
+		buffer->threadid = (long) starpu_pthread_self();
+		buffer->exited = 0;
+	}
+	else
+	{
+		_STARPU_MALLOC(buffer, sizeof(*buffer) + recorder_size * sizeof(buffer->events[0]));
+		buffer->nevents = 0;
+		buffer->threadid = (long) starpu_pthread_self();
+		buffer->size = recorder_size;
+		buffer->exited = 0;
+		buffer->next = recorder_buffers;
+		/* Make the buffer complete before a dump can see it */
+		STARPU_WMB();
+		recorder_buffers = buffer;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&recorder_mutex);
+
+	STARPU_PTHREAD_SETSPECIFIC(recorder_key, buffer);
+	return buffer;
+}
+
+void __starpu_recorder_record(uint32_t code, int workerid, uint64_t param0, uint64_t param1, uint64_t param2)
+{
+	struct _starpu_recorder_buffer *buffer = _starpu_recorder_get_buffer();
+	struct _starpu_recorder_event *event = &buffer->events[buffer->nevents & (buffer->size - 1)];
+
+	event->date = starpu_timing_now();
+	event->code = code;
+	event->workerid = workerid;
+	event->params[0] = param0;
+	event->params[1] = param1;
+	event->params[2] = param2;
+	/* Make the event complete before a dump can see it */
+	STARPU_WMB();
+	buffer->nevents++;
+}
+
+void __starpu_recorder_record_task(uint32_t code, int workerid, struct starpu_task *task)
+{
+	struct _starpu_job *j = task->starpu_private;
+	const char *name = starpu_task_get_name(task);
+	uint64_t shortname = 0;
+
+	/* The job ids are only allocated when really needed, do not force it */
+	if (name)
+		memcpy(&shortname, name, strnlen(name, sizeof(shortname)));
+	__starpu_recorder_record(code, workerid, (uintptr_t) task, j ? j->job_id : 0, shortname);
+}
+
+/* Only uses async-signal-safe functions, to be usable from a signal handler */
+static int _starpu_recorder_write(int fd, const void *buf, size_t size)
+{
+	const char *ptr = buf;
+	while (size)
+	{
+		ssize_t ret = write(fd, ptr, size);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		ptr += ret;
+		size -= ret;
+	}
+	return 0;
+}
+
+int starpu_flight_recorder_dump(const char *path)
+{
+	struct _starpu_recorder_header header;
+	struct _starpu_recorder_thread_header thread_header;
+	struct _starpu_recorder_buffer *buffer;
+	int fd, ret;
+
+	if (!_starpu_recorder_enabled)
+		return -ENODEV;
+	if (!path)
+		path = recorder_path;
+
+	fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if (fd < 0)
+		return -errno;
+
+	memcpy(header.magic, "STPUFLR1", sizeof(header.magic));
+	header.mark = 0x01020304;
+	header.event_size = sizeof(struct _starpu_recorder_event);
+	header.date = starpu_timing_now();
+	ret = _starpu_recorder_write(fd, &header, sizeof(header));
+
+	buffer = recorder_buffers;
+	STARPU_RMB();
+	for ( ; buffer && !ret; buffer = buffer->next)
+	{
+		uint64_t nevents = buffer->nevents;
+		uint64_t count = nevents < buffer->size ? nevents : buffer->size;
+		unsigned first = (nevents - count) & (buffer->size - 1);
+		unsigned n1 = count < buffer->size - first ? count : buffer->size - first;
+
+		if (!count)
+			continue;
+		STARPU_RMB();
+
+		thread_header.threadid = buffer->threadid;
+		thread_header.nevents = nevents;
+		thread_header.count = count;
+		ret = _starpu_recorder_write(fd, &thread_header, sizeof(thread_header));
+		if (!ret)
+			ret = _starpu_recorder_write(fd, &buffer->events[first], n1 * sizeof(buffer->events[0]));
+		if (!ret && count > n1)
+			ret = _starpu_recorder_write(fd, &buffer->events[0], (count - n1) * sizeof(buffer->events[0]));
+	}
+
+	if (!ret)
+	{
+		memset(&thread_header, 0, sizeof(thread_header));
+		ret = _starpu_recorder_write(fd, &thread_header, sizeof(thread_header));
+	}
+
+	if (close(fd) < 0 && !ret)
+		ret = -errno;
+	return ret;
+}
+
+static void _starpu_recorder_crash(void)
+{
+	if (starpu_flight_recorder_dump(NULL) == 0)
+		_STARPU_MSG("Flight recorder dumped to %s\n", recorder_path);
+}
+
+static void _starpu_recorder_handler(int sig)
+{
+	int saved_errno = errno;
+	(void) sig;
+	starpu_flight_recorder_dump(NULL);
+	errno = saved_errno;
+}
+
+void _starpu_recorder_init(void)
+{
+	int size = starpu_getenv_number_default("STARPU_FLIGHT_RECORDER", 4096);
+	char *path;
+
+	if (size <= 0)
+		return;
+
+	recorder_size = 1;
+	while (recorder_size < (unsigned) size)
+		recorder_size *= 2;
+
+	path = starpu_getenv("STARPU_FLIGHT_RECORDER_FILE");
+	if (path)
+		snprintf(recorder_path, sizeof(recorder_path), "%s", path);
+	else
+	{
+		char *prefix = starpu_getenv("STARPU_FXT_PREFIX");
+		char *user = starpu_getenv("USER");
+		if (!prefix)
+			prefix = "/tmp";
+		if (!user)
+			user = "";
+		snprintf(recorder_path, sizeof(recorder_path), "%s/starpu_flight_recorder_%s_%d", prefix, user, (int) getpid());
+	}
+
+	STARPU_PTHREAD_KEY_CREATE(&recorder_key, _starpu_recorder_thread_exit);
+	_starpu_crash_add_hook(&_starpu_recorder_crash);
+
+	recorder_signal = starpu_getenv_number_default("STARPU_FLIGHT_RECORDER_SIGNAL", 0);
+	if (recorder_signal > 0)
+		recorder_old_handler = signal(recorder_signal, _starpu_recorder_handler);
+
+	_starpu_recorder_enabled = 1;
+}
+
+void _starpu_recorder_shutdown(void)
+{
+	struct _starpu_recorder_buffer *buffer, *next;
+
+	if (!_starpu_recorder_enabled)
+		return;
+	_starpu_recorder_enabled = 0;
+
+	if (recorder_signal > 0)
+		signal(recorder_signal, recorder_old_handler == SIG_ERR ? SIG_DFL : recorder_old_handler);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&recorder_mutex);
+	for (buffer = recorder_buffers; buffer; buffer = next)
+	{
+		next = buffer->next;
+		free(buffer);
+	}
+	recorder_buffers = NULL;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&recorder_mutex);
+
+	STARPU_PTHREAD_KEY_DELETE(recorder_key);
+}
@@ -0,0 +1,65 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __FLIGHT_RECORDER_H__
+#define __FLIGHT_RECORDER_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+/** Codes of the events recorded by the flight recorder. They are part of the
+ * dump format, see tools/starpu_flight_recorder.py */
+enum _starpu_recorder_code
+{
+	/** param0: task, param1: job id, or 0 if not allocated, param2: first
+	 * characters of the task name */
+	_STARPU_RECORDER_TASK_PUSH = 1,
+	_STARPU_RECORDER_TASK_POP = 2,
+	_STARPU_RECORDER_TASK_START = 3,
+	_STARPU_RECORDER_TASK_END = 4,
+	/** param0: source node << 32 | destination node, param1: size,
+	 * param2: handle */
+	_STARPU_RECORDER_TRANSFER_START = 5,
+	_STARPU_RECORDER_TRANSFER_END = 6,
+};
+
+/** Whether the flight recorder is recording, see STARPU_FLIGHT_RECORDER */
+extern int _starpu_recorder_enabled;
+
+void _starpu_recorder_init(void);
+void _starpu_recorder_shutdown(void);
+
+/** Record an event in the ring buffer of the current thread */
+void __starpu_recorder_record(uint32_t code, int workerid, uint64_t param0, uint64_t param1, uint64_t param2);
+void __starpu_recorder_record_task(uint32_t code, int workerid, struct starpu_task *task);
+
+#define _STARPU_RECORD_TASK(code, workerid, task) do { \
+	if (_starpu_recorder_enabled) \
+		__starpu_recorder_record_task((code), (workerid), (task)); \
+} while (0)
+
+#define _STARPU_RECORD_TRANSFER(code, src_node, dst_node, size, handle) do { \
+	if (_starpu_recorder_enabled) \
+		__starpu_recorder_record((code), -1, ((uint64_t) (src_node) << 32) | (dst_node), (size), (uintptr_t) (handle)); \
+} while (0)
+
+#pragma GCC visibility pop
+
+#endif // __FLIGHT_RECORDER_H__
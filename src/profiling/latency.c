@@ -0,0 +1,451 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Latency histograms: each worker records the submission-to-start latency and
+ * the execution time of the tasks it runs in per-codelet histograms, which
+ * only it writes to, so that recording does not need any lock or atomic
+ * operation. The histograms of the different workers are merged when
+ * percentiles are requested.
+ *
+ * The histograms use a log-linear bucketing, as in HDR histograms: the
+ * latencies are counted in nanoseconds, the values below 2^LINEAR_BITS have
+ * one bucket each, and each further power of two is split into 2^SUB_BITS
+ * buckets, so the relative error is below 2^-SUB_BITS.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <common/uthash.h>
+#include <common/starpu_spinlock.h>
+#include <core/jobs.h>
+#include <core/workers.h>
+#include <common/knobs.h>
+#include <profiling/latency.h>
+#include <math.h>
+
+#define SUB_BITS 4
+#define LINEAR_BITS (SUB_BITS + 1)
+/* Latencies above 2^MAX_BITS ns (73 minutes) are counted in the last bucket */
+#define MAX_BITS 42
+#define NBUCKETS (((MAX_BITS - SUB_BITS) << SUB_BITS) + (1 << SUB_BITS))
+
+#define NPERCENTILES 3
+static const double percentiles[NPERCENTILES] = { 50., 99., 99.9 };
+
+enum _starpu_latency_kind
+{
+	LATENCY_WAIT,
+	LATENCY_EXEC,
+	LATENCY_NKINDS
+};
+
+static const char *kind_names[LATENCY_NKINDS] = { "wait", "exec" };
+
+struct _starpu_latency_histograms
+{
+	UT_hash_handle hh;
+	struct starpu_codelet *cl;
+	char *name;
+	uint64_t buckets[LATENCY_NKINDS][NBUCKETS];
+};
+
+struct _starpu_latency_worker
+{
+	/** Histograms of each codelet executed by the worker. Only the
+	 * worker adds entries, under the lock so that readers can walk the
+	 * table meanwhile */
+	struct _starpu_latency_histograms *histograms;
+	struct _starpu_spinlock lock;
+	/** Histograms of the task being executed */
+	struct _starpu_latency_histograms *current;
+	double start;
+};
+
+int _starpu_latency_enabled;
+static struct _starpu_latency_worker latency_workers[STARPU_NMAXWORKERS];
+
+/* per-worker counters */
+static int __w_wait_p50;
+static int __w_wait_p99;
+static int __w_wait_p999;
+static int __w_exec_p50;
+static int __w_exec_p99;
+static int __w_exec_p999;
+
+/* per-codelet counters */
+static int __c_wait_p50;
+static int __c_wait_p99;
+static int __c_wait_p999;
+static int __c_exec_p50;
+static int __c_exec_p99;
+static int __c_exec_p999;
+
+static unsigned latency_bucket(uint64_t ns)
+{
+	unsigned msb, shift;
+
+	if (ns < (1ULL << LINEAR_BITS))
+		return ns;
+	if (ns >= (1ULL << MAX_BITS))
+		return NBUCKETS - 1;
+#ifdef __GNUC__
+	msb = 63 - __builtin_clzll(ns);
+#else
+	for (msb = LINEAR_BITS; ns >> (msb + 1); msb++)
+		;
+#endif
+	shift = msb - SUB_BITS;
+	return (shift << SUB_BITS) + (ns >> shift);
+}
+
+/* Upper bound of the bucket, in µs */
+static double latency_bucket_max(unsigned bucket)
+{
+	unsigned shift;
+	uint64_t mantissa;
+
+	if (bucket < (1U << LINEAR_BITS))
+		return (bucket + 1) / 1000.;
+	shift = (bucket >> SUB_BITS) - 1;
+	mantissa = (1U << SUB_BITS) + (bucket & ((1U << SUB_BITS) - 1));
+	return ((mantissa + 1) << shift) / 1000.;
+}
+
+static struct _starpu_latency_histograms *latency_get_histograms(int workerid, struct starpu_codelet *cl)
+{
+	struct _starpu_latency_worker *worker = &latency_workers[workerid];
+	struct _starpu_latency_histograms *histograms;
+
+	/* Only this worker modifies the table, no need to lock for looking up */
+	HASH_FIND_PTR(worker->histograms, &cl, histograms);
+	if (STARPU_LIKELY(histograms != NULL))
+		return histograms;
+
+	_STARPU_CALLOC(histograms, 1, sizeof(*histograms));
+	histograms->cl = cl;
+	histograms->name = strdup(_starpu_codelet_get_name(cl) ? _starpu_codelet_get_name(cl) : "unknown");
+	_starpu_spin_lock(&worker->lock);
+	HASH_ADD_PTR(worker->histograms, cl, histograms);
+	_starpu_spin_unlock(&worker->lock);
+	return histograms;
+}
+
+static void latency_record(uint64_t *buckets, double us)
+{
+	if (us < 0.)
+		us = 0.;
+	/* Only the worker writes to its histograms, readers may just miss the
+	 * last few updates */
+	buckets[latency_bucket((uint64_t) (us * 1000.))]++;
+}
+
+void _starpu_latency_task_submit(struct _starpu_job *j)
+{
+	j->submit_date = starpu_timing_now();
+}
+
+void _starpu_latency_task_start(int workerid, struct _starpu_job *j)
+{
+	struct _starpu_latency_worker *worker = &latency_workers[workerid];
+	struct starpu_codelet *cl = j->task->cl;
+
+	if (!cl || j->internal)
+	{
+		worker->current = NULL;
+		return;
+	}
+
+	worker->current = latency_get_histograms(workerid, cl);
+	worker->start = starpu_timing_now();
+	/* Tasks submitted before the recording started have no date */
+	if (j->submit_date)
+		latency_record(worker->current->buckets[LATENCY_WAIT], worker->start - j->submit_date);
+}
+
+void _starpu_latency_task_end(int workerid)
+{
+	struct _starpu_latency_worker *worker = &latency_workers[workerid];
+
+	if (!worker->current)
+		return;
+	latency_record(worker->current->buckets[LATENCY_EXEC], starpu_timing_now() - worker->start);
+	worker->current = NULL;
+}
+
+/* Add the histograms of the worker for the codelet, or all codelets if cl is NULL */
+static void latency_merge_worker(int workerid, struct starpu_codelet *cl, enum _starpu_latency_kind kind, uint64_t *buckets)
+{
+	struct _starpu_latency_worker *worker = &latency_workers[workerid];
+	struct _starpu_latency_histograms *histograms, *tmp;
+	unsigned i;
+
+	_starpu_spin_lock(&worker->lock);
+	HASH_ITER(hh, worker->histograms, histograms, tmp)
+	{
+		if (cl && histograms->cl != cl)
+			continue;
+		for (i = 0; i < NBUCKETS; i++)
+			buckets[i] += histograms->buckets[kind][i];
+	}
+	_starpu_spin_unlock(&worker->lock);
+}
+
+static void latency_merge(int workerid, struct starpu_codelet *cl, enum _starpu_latency_kind kind, uint64_t *buckets)
+{
+	memset(buckets, 0, NBUCKETS * sizeof(*buckets));
+	if (workerid >= 0)
+		latency_merge_worker(workerid, cl, kind, buckets);
+	else
+	{
+		unsigned worker, nworkers = starpu_worker_get_count();
+		for (worker = 0; worker < nworkers; worker++)
+			latency_merge_worker(worker, cl, kind, buckets);
+	}
+}
+
+/* Return the number of recorded latencies */
+static uint64_t latency_percentiles(const uint64_t *buckets, unsigned n, const double *ps, double *values)
+{
+	uint64_t total = 0, cumul = 0;
+	unsigned i, bucket = 0;
+
+	for (i = 0; i < NBUCKETS; i++)
+		total += buckets[i];
+
+	for (i = 0; i < n; i++)
+	{
+		uint64_t target = ceil(ps[i] * total / 100.);
+		if (!total)
+		{
+			values[i] = 0.;
+			continue;
+		}
+		if (target < 1)
+			target = 1;
+		/* The percentiles are not necessarily sorted */
+		if (cumul >= target)
+		{
+			cumul = 0;
+			bucket = 0;
+		}
+		while (cumul + buckets[bucket] < target)
+			cumul += buckets[bucket++];
+		values[i] = latency_bucket_max(bucket);
+	}
+	return total;
+}
+
+int starpu_codelet_get_latency_percentiles(struct starpu_codelet *cl, int workerid, int execution, unsigned n, const double *ps, double *latencies)
+{
+	uint64_t buckets[NBUCKETS];
+
+	if (!_starpu_latency_enabled)
+		return -ENODEV;
+	STARPU_ASSERT(workerid < (int) starpu_worker_get_count());
+	latency_merge(workerid, cl, execution ? LATENCY_EXEC : LATENCY_WAIT, buckets);
+	latency_percentiles(buckets, n, ps, latencies);
+	return 0;
+}
+
+static void latency_display(FILE *f, const char *name, const uint64_t *wait, const uint64_t *exec)
+{
+	double values[LATENCY_NKINDS][NPERCENTILES];
+	uint64_t n = latency_percentiles(wait, NPERCENTILES, percentiles, values[LATENCY_WAIT]);
+	latency_percentiles(exec, NPERCENTILES, percentiles, values[LATENCY_EXEC]);
+
+	fprintf(f, "\t%-20s %10lu tasks, wait p50 %10.2f p99 %10.2f p99.9 %10.2f, exec p50 %10.2f p99 %10.2f p99.9 %10.2f us\n",
+		name, (unsigned long) n,
+		values[LATENCY_WAIT][0], values[LATENCY_WAIT][1], values[LATENCY_WAIT][2],
+		values[LATENCY_EXEC][0], values[LATENCY_EXEC][1], values[LATENCY_EXEC][2]);
+}
+
+void starpu_codelet_display_latencies(struct starpu_codelet *cl)
+{
+	uint64_t wait[NBUCKETS], exec[NBUCKETS];
+	unsigned worker, nworkers = starpu_worker_get_count();
+
+	if (!_starpu_latency_enabled)
+	{
+		_STARPU_DISP("Warning: the latency histograms are not recorded, set STARPU_LATENCY_HISTOGRAMS to 1\n");
+		return;
+	}
+
+	fprintf(stderr, "Latencies for codelet %s\n", _starpu_codelet_get_name(cl) ? _starpu_codelet_get_name(cl) : "unknown");
+	for (worker = 0; worker < nworkers; worker++)
+	{
+		char name[32];
+		latency_merge(worker, cl, LATENCY_WAIT, wait);
+		latency_merge(worker, cl, LATENCY_EXEC, exec);
+		starpu_worker_get_name(worker, name, sizeof(name));
+		latency_display(stderr, name, wait, exec);
+	}
+	latency_merge(-1, cl, LATENCY_WAIT, wait);
+	latency_merge(-1, cl, LATENCY_EXEC, exec);
+	latency_display(stderr, "all workers", wait, exec);
+}
+
+/* The percentiles are only computed if the listener asked for them, since
+ * merging the histograms is not cheap */
+static int counter_enabled(struct starpu_perf_counter_sample *sample, int id)
+{
+	return sample->listener->set->index_array[_starpu_perf_counter_id_get_index(id)] > 0;
+}
+
+static void sample_percentiles(struct starpu_perf_counter_sample *sample, int workerid, struct starpu_codelet *cl, enum _starpu_latency_kind kind, const int ids[NPERCENTILES])
+{
+	uint64_t buckets[NBUCKETS];
+	double values[NPERCENTILES];
+	unsigned i;
+
+	if (!counter_enabled(sample, ids[0]) && !counter_enabled(sample, ids[1]) && !counter_enabled(sample, ids[2]))
+		return;
+	latency_merge(workerid, cl, kind, buckets);
+	latency_percentiles(buckets, NPERCENTILES, percentiles, values);
+	for (i = 0; i < NPERCENTILES; i++)
+		_starpu_perf_counter_sample_set_double_value(sample, ids[i], values[i]);
+}
+
+static void per_worker_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
+{
+	STARPU_ASSERT(context != NULL);
+	struct _starpu_worker *worker = context;
+	const int wait_ids[NPERCENTILES] = { __w_wait_p50, __w_wait_p99, __w_wait_p999 };
+	const int exec_ids[NPERCENTILES] = { __w_exec_p50, __w_exec_p99, __w_exec_p999 };
+
+	if (!_starpu_latency_enabled)
+		return;
+	sample_percentiles(sample, worker->workerid, NULL, LATENCY_WAIT, wait_ids);
+	sample_percentiles(sample, worker->workerid, NULL, LATENCY_EXEC, exec_ids);
+}
+
+static void per_codelet_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
+{
+	STARPU_ASSERT(context != NULL);
+	struct starpu_codelet *cl = context;
+	const int wait_ids[NPERCENTILES] = { __c_wait_p50, __c_wait_p99, __c_wait_p999 };
+	const int exec_ids[NPERCENTILES] = { __c_exec_p50, __c_exec_p99, __c_exec_p999 };
+
+	if (!_starpu_latency_enabled)
+		return;
+	sample_percentiles(sample, -1, cl, LATENCY_WAIT, wait_ids);
+	sample_percentiles(sample, -1, cl, LATENCY_EXEC, exec_ids);
+}
+
+void _starpu__latency_c__register_counters(void)
+{
+	{
+		const enum starpu_perf_counter_scope scope = starpu_perf_counter_scope_per_worker;
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, w_wait_p50, double, "median submission-to-start latency of tasks executed on this worker (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, w_wait_p99, double, "99th percentile of the submission-to-start latency of tasks executed on this worker (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, w_wait_p999, double, "99.9th percentile of the submission-to-start latency of tasks executed on this worker (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, w_exec_p50, double, "median execution time of tasks executed on this worker (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, w_exec_p99, double, "99th percentile of the execution time of tasks executed on this worker (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, w_exec_p999, double, "99.9th percentile of the execution time of tasks executed on this worker (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+
+		_starpu_perf_counter_register_updater(scope, per_worker_sample_updater);
+	}
+
+	{
+		const enum starpu_perf_counter_scope scope = starpu_perf_counter_scope_per_codelet;
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, c_wait_p50, double, "median submission-to-start latency of codelet's task instances (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, c_wait_p99, double, "99th percentile of the submission-to-start latency of codelet's task instances (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, c_wait_p999, double, "99.9th percentile of the submission-to-start latency of codelet's task instances (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, c_exec_p50, double, "median execution time of codelet's task instances (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, c_exec_p99, double, "99th percentile of the execution time of codelet's task instances (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, c_exec_p999, double, "99.9th percentile of the execution time of codelet's task instances (microseconds, needs STARPU_LATENCY_HISTOGRAMS)");
+
+		_starpu_perf_counter_register_updater(scope, per_codelet_sample_updater);
+	}
+}
+
+void _starpu_latency_init(void)
+{
+	unsigned worker;
+
+	_starpu_latency_enabled = starpu_getenv_number_default("STARPU_LATENCY_HISTOGRAMS", 0) > 0;
+	if (!_starpu_latency_enabled)
+		return;
+
+	for (worker = 0; worker < STARPU_NMAXWORKERS; worker++)
+	{
+		latency_workers[worker].histograms = NULL;
+		latency_workers[worker].current = NULL;
+		_starpu_spin_init(&latency_workers[worker].lock);
+	}
+}
+
+/* One line per worker, codelet and kind: the worker id, the kind, the codelet
+ * name, and the non-empty buckets as index:count, see
+ * tools/starpu_latency_stats.py */
+static void latency_dump(const char *path)
+{
+	unsigned worker, nworkers = starpu_worker_get_count();
+	FILE *f = fopen(path, "w");
+
+	if (!f)
+	{
+		_STARPU_DISP("Warning: could not open %s: %s, not dumping the latency histograms\n", path, strerror(errno));
+		return;
+	}
+
+	fprintf(f, "# StarPU latency histograms, version 1, %d sub-bucket bits\n", SUB_BITS);
+	fprintf(f, "# workerid\tkind\tcodelet\tbucket:count...\n");
+	for (worker = 0; worker < nworkers; worker++)
+	{
+		struct _starpu_latency_histograms *histograms, *tmp;
+		HASH_ITER(hh, latency_workers[worker].histograms, histograms, tmp)
+		{
+			unsigned kind, i;
+			for (kind = 0; kind < LATENCY_NKINDS; kind++)
+			{
+				fprintf(f, "%u\t%s\t%s", worker, kind_names[kind], histograms->name);
+				for (i = 0; i < NBUCKETS; i++)
+					if (histograms->buckets[kind][i])
+						fprintf(f, "\t%u:%lu", i, (unsigned long) histograms->buckets[kind][i]);
+				fprintf(f, "\n");
+			}
+		}
+	}
+	fclose(f);
+}
+
+void _starpu_latency_shutdown(void)
+{
+	unsigned worker;
+	char *path;
+
+	if (!_starpu_latency_enabled)
+		return;
+
+	path = starpu_getenv("STARPU_LATENCY_HISTOGRAMS_FILE");
+	if (path)
+		latency_dump(path);
+
+	for (worker = 0; worker < STARPU_NMAXWORKERS; worker++)
+	{
+		struct _starpu_latency_histograms *histograms, *tmp;
+		HASH_ITER(hh, latency_workers[worker].histograms, histograms, tmp)
+		{
+			HASH_DEL(latency_workers[worker].histograms, histograms);
+			free(histograms->name);
+			free(histograms);
+		}
+		_starpu_spin_destroy(&latency_workers[worker].lock);
+	}
+	_starpu_latency_enabled = 0;
+}
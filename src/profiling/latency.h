@@ -0,0 +1,48 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+struct _starpu_job;
+
+/** Whether the latency histograms are being recorded, see
+ * STARPU_LATENCY_HISTOGRAMS */
+extern int _starpu_latency_enabled;
+
+void _starpu_latency_init(void);
+/** Dump the histograms to STARPU_LATENCY_HISTOGRAMS_FILE if set, and free
+ * them. This is to be called once the workers are terminated. */
+void _starpu_latency_shutdown(void);
+
+/** Record the date of submission of the job */
+void _starpu_latency_task_submit(struct _starpu_job *j);
+/** Record the submission-to-start latency of the job on the worker, and the
+ * start of its execution */
+void _starpu_latency_task_start(int workerid, struct _starpu_job *j);
+/** Record the execution time of the job started on the worker */
+void _starpu_latency_task_end(int workerid);
+
+#pragma GCC visibility pop
+
+#endif // __LATENCY_H__
@@ -0,0 +1,386 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Hardware counters of the tasks through the Linux perf_event interface,
+ * without needing PAPI.
+ *
+ * Each CPU worker opens at startup a group of counters for its own thread:
+ * cycles, instructions, last level cache misses and backend stalled cycles.
+ * They keep counting, and the worker reads them before and after running the
+ * codelet function of a task. Since the counters are attached to the calling
+ * thread, they can be read from user space with the rdpmc instruction on x86,
+ * following the protocol described in the mmap page of the counters, which
+ * avoids a system call. Otherwise, or when the kernel does not allow it, the
+ * counters are read with a read() system call on the group.
+ *
+ * When there are more counters than the processor can count at the same
+ * time, e.g. because other tools are using them, the kernel multiplexes the
+ * groups. The time during which the group was enabled and the time during
+ * which it was actually counting are thus read along the values, and the
+ * differences are scaled up by their ratio. They are left to 0 if the group
+ * did not count at all during the task.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <core/workers.h>
+#include <common/knobs.h>
+#include <profiling/perf_event.h>
+
+#if defined(HAVE_LINUX_PERF_EVENT_H) && !defined(STARPU_SIMGRID)
+#define STARPU_PERF_EVENT
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum _starpu_perf_event_counter
+{
+	PERF_EVENT_CYCLES,
+	PERF_EVENT_INSTRUCTIONS,
+	PERF_EVENT_CACHE_MISSES,
+	PERF_EVENT_STALLED_CYCLES,
+	PERF_EVENT_NCOUNTERS
+};
+
+int _starpu_perf_event_enabled;
+
+/* per-codelet counters */
+static int __c_cumul_cycles;
+static int __c_cumul_instructions;
+static int __c_cumul_cache_misses;
+static int __c_cumul_stalled_cycles;
+
+static void per_codelet_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
+{
+	STARPU_ASSERT(context != NULL);
+	struct starpu_codelet *cl = context;
+
+	_starpu_perf_counter_sample_set_int64_value(sample, __c_cumul_cycles, cl->perf_counter_values->task.cumul_cycles);
+	_starpu_perf_counter_sample_set_int64_value(sample, __c_cumul_instructions, cl->perf_counter_values->task.cumul_instructions);
+	_starpu_perf_counter_sample_set_int64_value(sample, __c_cumul_cache_misses, cl->perf_counter_values->task.cumul_cache_misses);
+	_starpu_perf_counter_sample_set_int64_value(sample, __c_cumul_stalled_cycles, cl->perf_counter_values->task.cumul_stalled_cycles);
+}
+
+void _starpu__perf_event_c__register_counters(void)
+{
+	const enum starpu_perf_counter_scope scope = starpu_perf_counter_scope_per_codelet;
+	__STARPU_PERF_COUNTER_REG("starpu.task", scope, c_cumul_cycles, int64, "cumulated number of CPU cycles of codelet's task instances (since enabled, needs STARPU_PERF_EVENTS)");
+	__STARPU_PERF_COUNTER_REG("starpu.task", scope, c_cumul_instructions, int64, "cumulated number of instructions of codelet's task instances (since enabled, needs STARPU_PERF_EVENTS)");
+	__STARPU_PERF_COUNTER_REG("starpu.task", scope, c_cumul_cache_misses, int64, "cumulated number of last level cache misses of codelet's task instances (since enabled, needs STARPU_PERF_EVENTS)");
+	__STARPU_PERF_COUNTER_REG("starpu.task", scope, c_cumul_stalled_cycles, int64, "cumulated number of backend stalled CPU cycles of codelet's task instances (since enabled, needs STARPU_PERF_EVENTS)");
+
+	_starpu_perf_counter_register_updater(scope, per_codelet_sample_updater);
+}
+
+#ifdef STARPU_PERF_EVENT
+static const struct
+{
+	uint64_t config;
+	const char *name;
+} counters[PERF_EVENT_NCOUNTERS] =
+{
+	[PERF_EVENT_CYCLES] = { PERF_COUNT_HW_CPU_CYCLES, "cycles" },
+	[PERF_EVENT_INSTRUCTIONS] = { PERF_COUNT_HW_INSTRUCTIONS, "instructions" },
+	[PERF_EVENT_CACHE_MISSES] = { PERF_COUNT_HW_CACHE_MISSES, "cache misses" },
+	[PERF_EVENT_STALLED_CYCLES] = { PERF_COUNT_HW_STALLED_CYCLES_BACKEND, "stalled cycles" },
+};
+
+struct _starpu_perf_event_worker
+{
+	/** File descriptor of each counter, the first one is the group
+	 * leader. -1 if the counter is not available */
+	int fd[PERF_EVENT_NCOUNTERS];
+	/** Mapped page of each counter, to read it with rdpmc */
+	struct perf_event_mmap_page *page[PERF_EVENT_NCOUNTERS];
+	/** Position of each counter in the group, for read() */
+	unsigned position[PERF_EVENT_NCOUNTERS];
+	unsigned ncounters;
+	/** Values read at the start of the current task */
+	uint64_t start[PERF_EVENT_NCOUNTERS];
+	/** Time during which the group was enabled and running, in ns, at
+	 * the start of the current task */
+	uint64_t start_enabled;
+	uint64_t start_running;
+};
+
+static struct _starpu_perf_event_worker perf_event_workers[STARPU_NMAXWORKERS];
+static long page_size;
+static int warned;
+
+static int perf_event_open(struct perf_event_attr *attr, int group_fd)
+{
+	/* Count for the calling thread, on any CPU */
+	return syscall(__NR_perf_event_open, attr, 0, -1, group_fd, 0);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t rdpmc(uint32_t counter)
+{
+	uint32_t low, high;
+	__asm__ __volatile__("rdpmc" : "=a" (low), "=d" (high) : "c" (counter));
+	return low | ((uint64_t) high << 32);
+}
+
+static inline uint64_t rdtsc(void)
+{
+	uint32_t low, high;
+	__asm__ __volatile__("rdtsc" : "=a" (low), "=d" (high));
+	return low | ((uint64_t) high << 32);
+}
+
+/* Read the counter and its enabled and running times from user space, return
+ * 0 if the kernel does not allow it or the counter is not currently scheduled
+ * on the CPU */
+static int perf_event_rdpmc(struct perf_event_mmap_page *page, uint64_t *value, uint64_t *enabled, uint64_t *running)
+{
+	uint32_t seq, index;
+	uint64_t count, cyc, quot, rem, delta;
+
+	do
+	{
+		seq = page->lock;
+		STARPU_SYNCHRONIZE();
+		index = page->index;
+		if (!page->cap_user_rdpmc || !page->cap_user_time || !index)
+			return 0;
+		count = page->offset;
+		int64_t pmc = rdpmc(index - 1);
+		/* Sign-extend the width of the hardware counter */
+		pmc <<= 64 - page->pmc_width;
+		pmc >>= 64 - page->pmc_width;
+		count += pmc;
+
+		/* The times were updated when the counter was scheduled on
+		 * the CPU, add the time elapsed since then */
+		cyc = rdtsc();
+		quot = cyc >> page->time_shift;
+		rem = cyc & (((uint64_t) 1 << page->time_shift) - 1);
+		delta = page->time_offset + quot * page->time_mult + ((rem * page->time_mult) >> page->time_shift);
+		*enabled = page->time_enabled + delta;
+		*running = page->time_running + delta;
+		STARPU_SYNCHRONIZE();
+	}
+	while (page->lock != seq);
+
+	*value = count;
+	return 1;
+}
+#endif
+
+/* Read the values of the counters, and the times during which the group was
+ * enabled and running */
+static void perf_event_read(struct _starpu_perf_event_worker *worker, uint64_t *values, uint64_t *enabled, uint64_t *running)
+{
+	unsigned i;
+	uint64_t buffer[3 + PERF_EVENT_NCOUNTERS];
+
+#if defined(__x86_64__) || defined(__i386__)
+	for (i = 0; i < PERF_EVENT_NCOUNTERS; i++)
+	{
+		uint64_t counter_enabled, counter_running;
+		if (worker->fd[i] == -1)
+			continue;
+		if (!worker->page[i] || !perf_event_rdpmc(worker->page[i], &values[i], &counter_enabled, &counter_running))
+			break;
+		/* The members of the group are scheduled together */
+		if (i == 0)
+		{
+			*enabled = counter_enabled;
+			*running = counter_running;
+		}
+	}
+	if (i == PERF_EVENT_NCOUNTERS)
+		return;
+#endif
+
+	/* Read the whole group at once: number of counters, times, values */
+	if (read(worker->fd[0], buffer, sizeof(buffer)) < (ssize_t) ((3 + worker->ncounters) * sizeof(buffer[0])))
+	{
+		memset(values, 0, PERF_EVENT_NCOUNTERS * sizeof(*values));
+		*enabled = *running = 0;
+		return;
+	}
+	*enabled = buffer[1];
+	*running = buffer[2];
+	for (i = 0; i < PERF_EVENT_NCOUNTERS; i++)
+		if (worker->fd[i] != -1)
+			values[i] = buffer[3 + worker->position[i]];
+}
+#endif /* STARPU_PERF_EVENT */
+
+void _starpu_perf_event_init(void)
+{
+	_starpu_perf_event_enabled = 0;
+	if (starpu_getenv_number_default("STARPU_PERF_EVENTS", 0) <= 0)
+		return;
+
+#ifdef STARPU_PERF_EVENT
+	page_size = sysconf(_SC_PAGESIZE);
+	_starpu_perf_event_enabled = 1;
+#else
+	_STARPU_DISP("Warning: STARPU_PERF_EVENTS is only supported on Linux\n");
+#endif
+}
+
+void _starpu_perf_event_worker_init(int workerid)
+{
+#ifdef STARPU_PERF_EVENT
+	struct _starpu_perf_event_worker *worker = &perf_event_workers[workerid];
+	unsigned i;
+
+	worker->ncounters = 0;
+	for (i = 0; i < PERF_EVENT_NCOUNTERS; i++)
+	{
+		struct perf_event_attr attr;
+
+		worker->page[i] = NULL;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = counters[i].config;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		/* Only the leader controls the group */
+		attr.disabled = i == 0;
+		/* Allowed with the default perf_event_paranoid setting */
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		worker->fd[i] = perf_event_open(&attr, i == 0 ? -1 : worker->fd[0]);
+		if (worker->fd[i] == -1)
+		{
+			if (i == 0)
+			{
+				if (!warned)
+				{
+					_STARPU_DISP("Warning: could not open the %s counter: %s, hardware counters disabled. Perhaps /proc/sys/kernel/perf_event_paranoid needs to be lowered?\n", counters[i].name, strerror(errno));
+					warned = 1;
+				}
+				return;
+			}
+			/* e.g. the stalled cycles are not available on all processors */
+			_STARPU_DEBUG("could not open the %s counter of worker %d: %s\n", counters[i].name, workerid, strerror(errno));
+			continue;
+		}
+		worker->position[i] = worker->ncounters++;
+
+		worker->page[i] = mmap(NULL, page_size, PROT_READ, MAP_SHARED, worker->fd[i], 0);
+		if (worker->page[i] == MAP_FAILED)
+			worker->page[i] = NULL;
+	}
+
+	ioctl(worker->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(worker->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+	(void)workerid;
+#endif
+}
+
+void _starpu_perf_event_worker_deinit(int workerid)
+{
+#ifdef STARPU_PERF_EVENT
+	struct _starpu_perf_event_worker *worker = &perf_event_workers[workerid];
+	unsigned i;
+
+	if (worker->fd[0] == -1)
+		return;
+
+	ioctl(worker->fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	for (i = 0; i < PERF_EVENT_NCOUNTERS; i++)
+	{
+		if (worker->page[i])
+			munmap(worker->page[i], page_size);
+		worker->page[i] = NULL;
+	}
+	/* Close the leader last */
+	for (i = PERF_EVENT_NCOUNTERS; i > 0; i--)
+	{
+		if (worker->fd[i-1] != -1)
+			close(worker->fd[i-1]);
+		worker->fd[i-1] = -1;
+	}
+#else
+	(void)workerid;
+#endif
+}
+
+void _starpu_perf_event_task_start(int workerid)
+{
+#ifdef STARPU_PERF_EVENT
+	struct _starpu_perf_event_worker *worker = &perf_event_workers[workerid];
+
+	if (worker->fd[0] == -1)
+		return;
+	perf_event_read(worker, worker->start, &worker->start_enabled, &worker->start_running);
+#else
+	(void)workerid;
+#endif
+}
+
+void _starpu_perf_event_task_stop(int workerid, struct starpu_task *task)
+{
+#ifdef STARPU_PERF_EVENT
+	struct _starpu_perf_event_worker *worker = &perf_event_workers[workerid];
+	struct starpu_profiling_task_info *profiling_info = task->profiling_info;
+	struct starpu_codelet *cl = task->cl;
+	uint64_t values[PERF_EVENT_NCOUNTERS];
+	uint64_t enabled, running;
+	unsigned i;
+
+	if (worker->fd[0] == -1)
+		return;
+	perf_event_read(worker, values, &enabled, &running);
+	enabled -= worker->start_enabled;
+	running -= worker->start_running;
+	for (i = 0; i < PERF_EVENT_NCOUNTERS; i++)
+	{
+		if (worker->fd[i] == -1 || running == 0)
+			/* Not available, or not counted during the task */
+			values[i] = 0;
+		else
+		{
+			values[i] -= worker->start[i];
+			if (running < enabled)
+				/* Multiplexed, extrapolate to the whole task */
+				values[i] = (uint64_t) ((double) values[i] * enabled / running);
+		}
+	}
+
+	if (profiling_info)
+	{
+		profiling_info->used_cycles = values[PERF_EVENT_CYCLES];
+		profiling_info->stall_cycles = values[PERF_EVENT_STALLED_CYCLES];
+		profiling_info->instructions = values[PERF_EVENT_INSTRUCTIONS];
+		profiling_info->cache_misses = values[PERF_EVENT_CACHE_MISSES];
+	}
+
+	if (!_starpu_perf_counter_paused() && cl->perf_counter_values)
+	{
+		struct starpu_perf_counter_sample_cl_values * const pcv = cl->perf_counter_values;
+		(void)STARPU_ATOMIC_ADD64(&pcv->task.cumul_cycles, values[PERF_EVENT_CYCLES]);
+		(void)STARPU_ATOMIC_ADD64(&pcv->task.cumul_instructions, values[PERF_EVENT_INSTRUCTIONS]);
+		(void)STARPU_ATOMIC_ADD64(&pcv->task.cumul_cache_misses, values[PERF_EVENT_CACHE_MISSES]);
+		(void)STARPU_ATOMIC_ADD64(&pcv->task.cumul_stalled_cycles, values[PERF_EVENT_STALLED_CYCLES]);
+	}
+#else
+	(void)workerid;
+	(void)task;
+#endif
+}
@@ -0,0 +1,46 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __PERF_EVENT_H__
+#define __PERF_EVENT_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+/** Whether the hardware counters of the tasks are being read, see
+ * STARPU_PERF_EVENTS */
+extern int _starpu_perf_event_enabled;
+
+void _starpu_perf_event_init(void);
+
+/** Open the counters of the calling CPU worker thread. This is to be called
+ * from the worker thread itself. */
+void _starpu_perf_event_worker_init(int workerid);
+void _starpu_perf_event_worker_deinit(int workerid);
+
+/** Read the counters of the worker around the execution of the codelet
+ * function of the task, and record the differences in the profiling
+ * information of the task and in the counters of its codelet. */
+void _starpu_perf_event_task_start(int workerid);
+void _starpu_perf_event_task_stop(int workerid, struct starpu_task *task);
+
+#pragma GCC visibility pop
+
+#endif // __PERF_EVENT_H__
@@ -0,0 +1,721 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Performance counters exporter: a thread periodically samples all the
+ * registered performance counters, formats them in the Prometheus text
+ * exposition format, and publishes the result:
+ * - over HTTP on a localhost TCP port (STARPU_PERF_EXPORTER_PORT),
+ * - over HTTP on a UNIX socket (STARPU_PERF_EXPORTER_SOCKET), the text is
+ *   sent without HTTP headers if the client does not send a request. Such a
+ *   client is served as soon as it shuts down its writing side, or else
+ *   after the 100ms receive timeout,
+ * - in a shared file (STARPU_PERF_EXPORTER_SHM), which monitoring tools can
+ *   mmap to read the last sample without any system call. The file starts
+ *   with struct _starpu_perf_exporter_shm, whose sequence number is odd
+ *   while the sample is being updated, followed by the text.
+ *
+ * The counters are read through private samples, so that the listeners of
+ * the application are not disturbed.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <core/workers.h>
+#include <common/knobs.h>
+#include <profiling/perf_exporter.h>
+
+#if !defined(STARPU_HAVE_WINDOWS) && !defined(STARPU_SIMGRID)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#ifndef MSG_NOSIGNAL
+/* SO_NOSIGPIPE is set on the sockets instead */
+#define MSG_NOSIGNAL 0
+#endif
+
+#define SHM_MAGIC "STPUMET1"
+
+struct _starpu_perf_exporter_shm
+{
+	char magic[8];
+	/** 0x01020304 in the host byte order */
+	uint32_t mark;
+	uint32_t pid;
+	/** Size of the file, which is increased when the text does not fit
+	 * any more, the readers then have to map it again */
+	uint64_t size;
+	/** Odd while the sample is being updated */
+	uint64_t sequence;
+	/** Length of the text */
+	uint64_t length;
+	/** Date of the sample, as returned by starpu_timing_now() */
+	double date;
+	char text[];
+};
+
+/* Growable text buffer */
+struct text
+{
+	char *buf;
+	size_t len;
+	size_t size;
+};
+
+/* Values of the per-codelet counters, copied while the codelet cannot be
+ * unregistered */
+struct codelet_values
+{
+	char *name;
+	uintptr_t id;
+	union starpu_perf_counter_value *values;
+};
+
+static int exporter_enabled;
+static starpu_pthread_t exporter_thread;
+static int exporter_wakeup[2] = { -1, -1 };
+static int exporter_tcp_fd = -1;
+static int exporter_unix_fd = -1;
+static char *exporter_unix_path;
+static int exporter_shm_fd = -1;
+static char *exporter_shm_path;
+static struct _starpu_perf_exporter_shm *exporter_shm;
+static double exporter_period;
+
+#define NSCOPES 3
+static const enum starpu_perf_counter_scope exporter_scopes[NSCOPES] =
+{
+	starpu_perf_counter_scope_global,
+	starpu_perf_counter_scope_per_worker,
+	starpu_perf_counter_scope_per_codelet,
+};
+static struct starpu_perf_counter_listener *exporter_listeners[NSCOPES];
+static struct starpu_perf_counter_sample exporter_global_sample;
+static struct starpu_perf_counter_sample *exporter_worker_samples;
+static unsigned exporter_nworkers;
+static struct starpu_perf_counter_sample exporter_codelet_sample;
+static struct codelet_values *exporter_codelets;
+static unsigned exporter_ncodelets;
+static unsigned exporter_codelets_size;
+
+/* Last sample */
+static struct text exporter_text;
+
+static void text_printf(struct text *text, const char *fmt, ...) STARPU_ATTRIBUTE_FORMAT(printf, 2, 3);
+static void text_printf(struct text *text, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	while (1)
+	{
+		va_start(ap, fmt);
+		n = vsnprintf(text->buf + text->len, text->size - text->len, fmt, ap);
+		va_end(ap);
+		STARPU_ASSERT(n >= 0);
+		if (text->len + n < text->size)
+			break;
+		text->size = text->size ? 2 * text->size : 4096;
+		while (text->len + n >= text->size)
+			text->size *= 2;
+		_STARPU_REALLOC(text->buf, text->size);
+	}
+	text->len += n;
+}
+
+/* Label values have to escape backslashes, double quotes and newlines */
+static void text_label(struct text *text, const char *value)
+{
+	for ( ; *value; value++)
+	{
+		if (*value == '\\' || *value == '"')
+			text_printf(text, "\\%c", *value);
+		else if (*value == '\n')
+			text_printf(text, "\\n");
+		else
+			text_printf(text, "%c", *value);
+	}
+}
+
+/* Metric names can only contain [a-zA-Z0-9_:] */
+static void text_metric(struct text *text, const char *name)
+{
+	for ( ; *name; name++)
+	{
+		if ((*name >= 'a' && *name <= 'z') || (*name >= 'A' && *name <= 'Z')
+		    || (*name >= '0' && *name <= '9') || *name == '_' || *name == ':')
+			text_printf(text, "%c", *name);
+		else
+			text_printf(text, "_");
+	}
+}
+
+static void text_value(struct text *text, enum starpu_perf_counter_type type, const union starpu_perf_counter_value *value)
+{
+	switch (type)
+	{
+		case starpu_perf_counter_type_int32:
+			text_printf(text, " %d\n", value->int32_val);
+			break;
+		case starpu_perf_counter_type_int64:
+			text_printf(text, " %lld\n", (long long) value->int64_val);
+			break;
+		case starpu_perf_counter_type_float:
+			text_printf(text, " %.9g\n", value->float_val);
+			break;
+		case starpu_perf_counter_type_double:
+			text_printf(text, " %.17g\n", value->double_val);
+			break;
+		default:
+			STARPU_ABORT();
+	}
+}
+
+/* Prints the HELP and TYPE lines of a counter. The counters do not tell
+ * whether they are monotonic, so they are left untyped */
+static void text_header(struct text *text, int id)
+{
+	text_printf(text, "# HELP ");
+	text_metric(text, starpu_perf_counter_id_to_name(id));
+	text_printf(text, " %s\n", starpu_perf_counter_get_help_string(id));
+	text_printf(text, "# TYPE ");
+	text_metric(text, starpu_perf_counter_id_to_name(id));
+	text_printf(text, " untyped\n");
+}
+
+static void exporter_listener_callback(struct starpu_perf_counter_listener *listener, struct starpu_perf_counter_sample *sample, void *context)
+{
+	/* Never called, the private samples are only fetched */
+	(void) listener;
+	(void) sample;
+	(void) context;
+}
+
+static void exporter_fetch_codelet(struct starpu_codelet *cl, void *arg)
+{
+	unsigned size = starpu_perf_counter_nb(starpu_perf_counter_scope_per_codelet);
+	struct codelet_values *codelet;
+	(void) arg;
+
+	_starpu_perf_counter_sample_fetch(&exporter_codelet_sample, cl);
+
+	if (exporter_ncodelets == exporter_codelets_size)
+	{
+		exporter_codelets_size = exporter_codelets_size ? 2 * exporter_codelets_size : 16;
+		_STARPU_REALLOC(exporter_codelets, exporter_codelets_size * sizeof(*exporter_codelets));
+	}
+	codelet = &exporter_codelets[exporter_ncodelets++];
+	codelet->name = strdup(_starpu_codelet_get_name(cl) ? _starpu_codelet_get_name(cl) : "unknown");
+	codelet->id = (uintptr_t) cl;
+	_STARPU_MALLOC(codelet->values, size * sizeof(*codelet->values));
+	memcpy(codelet->values, exporter_codelet_sample.value_array, size * sizeof(*codelet->values));
+}
+
+static void exporter_sample(struct text *text)
+{
+	int nb, n;
+	unsigned i;
+
+	text->len = 0;
+
+	nb = starpu_perf_counter_nb(starpu_perf_counter_scope_global);
+	_starpu_perf_counter_sample_fetch(&exporter_global_sample, NULL);
+	for (n = 0; n < nb; n++)
+	{
+		int id = starpu_perf_counter_nth_to_id(starpu_perf_counter_scope_global, n);
+		text_header(text, id);
+		text_metric(text, starpu_perf_counter_id_to_name(id));
+		text_value(text, starpu_perf_counter_get_type_id(id), &exporter_global_sample.value_array[n]);
+	}
+
+	nb = starpu_perf_counter_nb(starpu_perf_counter_scope_per_worker);
+	for (i = 0; i < exporter_nworkers; i++)
+		_starpu_perf_counter_sample_fetch(&exporter_worker_samples[i], _starpu_get_worker_struct(i));
+	for (n = 0; n < nb; n++)
+	{
+		int id = starpu_perf_counter_nth_to_id(starpu_perf_counter_scope_per_worker, n);
+		text_header(text, id);
+		for (i = 0; i < exporter_nworkers; i++)
+		{
+			char name[64];
+			starpu_worker_get_name(i, name, sizeof(name));
+			text_metric(text, starpu_perf_counter_id_to_name(id));
+			text_printf(text, "{worker=\"%u\",type=\"%s\",name=\"", i, starpu_worker_get_type_as_string(starpu_worker_get_type(i)));
+			text_label(text, name);
+			text_printf(text, "\"}");
+			text_value(text, starpu_perf_counter_get_type_id(id), &exporter_worker_samples[i].value_array[n]);
+		}
+	}
+
+	exporter_ncodelets = 0;
+	_starpu_perf_counter_foreach_codelet(exporter_fetch_codelet, NULL);
+	if (exporter_ncodelets)
+	{
+		nb = starpu_perf_counter_nb(starpu_perf_counter_scope_per_codelet);
+		for (n = 0; n < nb; n++)
+		{
+			int id = starpu_perf_counter_nth_to_id(starpu_perf_counter_scope_per_codelet, n);
+			text_header(text, id);
+			for (i = 0; i < exporter_ncodelets; i++)
+			{
+				text_metric(text, starpu_perf_counter_id_to_name(id));
+				text_printf(text, "{codelet=\"");
+				text_label(text, exporter_codelets[i].name);
+				/* Several codelets can have the same name */
+				text_printf(text, "\",id=\"%#lx\"}", (unsigned long) exporter_codelets[i].id);
+				text_value(text, starpu_perf_counter_get_type_id(id), &exporter_codelets[i].values[n]);
+			}
+		}
+		for (i = 0; i < exporter_ncodelets; i++)
+		{
+			free(exporter_codelets[i].name);
+			free(exporter_codelets[i].values);
+		}
+	}
+}
+
+static void exporter_publish_shm(const struct text *text, double date)
+{
+	size_t needed = sizeof(*exporter_shm) + text->len;
+
+	if (needed > exporter_shm->size)
+	{
+		size_t old_size = exporter_shm->size, size = old_size;
+		while (size < needed)
+			size *= 2;
+		if (ftruncate(exporter_shm_fd, size) < 0)
+		{
+			_STARPU_DISP("Warning: could not extend %s: %s\n", exporter_shm_path, strerror(errno));
+			return;
+		}
+		/* Tell the readers of the old mapping that they have to map the
+		 * file again */
+		exporter_shm->sequence++;
+		STARPU_WMB();
+		exporter_shm->size = size;
+		STARPU_WMB();
+		exporter_shm->sequence++;
+		munmap(exporter_shm, old_size);
+		exporter_shm = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, exporter_shm_fd, 0);
+		STARPU_ASSERT_MSG(exporter_shm != MAP_FAILED, "could not map %s again: %s", exporter_shm_path, strerror(errno));
+	}
+
+	exporter_shm->sequence++;
+	STARPU_WMB();
+	memcpy(exporter_shm->text, text->buf, text->len);
+	exporter_shm->length = text->len;
+	exporter_shm->date = date;
+	STARPU_WMB();
+	exporter_shm->sequence++;
+}
+
+/* Write to a file descriptor, or send to a socket. A client which closes its
+ * connection before getting its reply must not raise SIGPIPE, which would
+ * kill the application, so replies are sent with MSG_NOSIGNAL, or on
+ * sockets with SO_NOSIGPIPE set where MSG_NOSIGNAL does not exist */
+static int exporter_write_flags(int fd, const char *buf, size_t len, int sock)
+{
+	while (len)
+	{
+		ssize_t ret;
+		if (sock)
+			ret = send(fd, buf, len, MSG_NOSIGNAL);
+		else
+			ret = write(fd, buf, len);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+static int exporter_write(int fd, const char *buf, size_t len)
+{
+	return exporter_write_flags(fd, buf, len, 0);
+}
+
+static int exporter_send(int fd, const char *buf, size_t len)
+{
+	return exporter_write_flags(fd, buf, len, 1);
+}
+
+/* Serve the last sample to a client. The socket has timeouts, so that a
+ * stuck client does not prevent from sampling. A client which does not send
+ * any request is thus only served after the receive timeout, unless it shuts
+ * down its writing side, which we see as the end of the request. */
+static void exporter_serve(int listen_fd)
+{
+	struct timeval timeout = { .tv_sec = 0, .tv_usec = 100000 };
+	char request[1024];
+	size_t len = 0;
+	int fd;
+
+	fd = accept(listen_fd, NULL, NULL);
+	if (fd < 0)
+		return;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+	{
+		int one = 1;
+		setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+	}
+#endif
+
+	/* Read the request headers, we do not care about their content */
+	while (len < sizeof(request) - 1)
+	{
+		ssize_t ret = read(fd, request + len, sizeof(request) - 1 - len);
+		if (ret <= 0)
+			break;
+		len += ret;
+		request[len] = 0;
+		if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+			break;
+	}
+
+	if (len)
+	{
+		char header[256];
+		snprintf(header, sizeof(header),
+			 "HTTP/1.0 200 OK\r\n"
+			 "Content-Type: text/plain; version=0.0.4\r\n"
+			 "Content-Length: %lu\r\n"
+			 "Connection: close\r\n"
+			 "\r\n", (unsigned long) exporter_text.len);
+		if (exporter_send(fd, header, strlen(header)) == 0 && strncmp(request, "HEAD ", 5))
+			exporter_send(fd, exporter_text.buf, exporter_text.len);
+	}
+	else
+		/* Raw client */
+		exporter_send(fd, exporter_text.buf, exporter_text.len);
+	close(fd);
+}
+
+static void *exporter_func(void *arg)
+{
+	struct text text = { .buf = NULL, .len = 0, .size = 0 };
+	double next = starpu_timing_now();
+	(void) arg;
+
+	starpu_pthread_setname("perf_exporter");
+
+	while (1)
+	{
+		struct pollfd fds[3];
+		nfds_t nfds = 0;
+		double now = starpu_timing_now();
+		int ret;
+		nfds_t i;
+
+		if (now >= next)
+		{
+			struct text tmp;
+			exporter_sample(&text);
+			if (exporter_shm)
+				exporter_publish_shm(&text, now);
+			/* Keep the published one aside */
+			tmp = exporter_text;
+			exporter_text = text;
+			text = tmp;
+			next += exporter_period;
+			if (next < now)
+				next = now + exporter_period;
+		}
+
+		fds[nfds].fd = exporter_wakeup[0];
+		fds[nfds++].events = POLLIN;
+		if (exporter_tcp_fd >= 0)
+		{
+			fds[nfds].fd = exporter_tcp_fd;
+			fds[nfds++].events = POLLIN;
+		}
+		if (exporter_unix_fd >= 0)
+		{
+			fds[nfds].fd = exporter_unix_fd;
+			fds[nfds++].events = POLLIN;
+		}
+
+		ret = poll(fds, nfds, (int) ((next - now) / 1000.) + 1);
+		if (ret < 0 && errno != EINTR)
+		{
+			_STARPU_DISP("Warning: the performance counters exporter failed to poll: %s\n", strerror(errno));
+			break;
+		}
+		if (ret <= 0)
+			continue;
+		if (fds[0].revents)
+			/* Shutting down */
+			break;
+		for (i = 1; i < nfds; i++)
+			if (fds[i].revents & POLLIN)
+				exporter_serve(fds[i].fd);
+	}
+
+	free(text.buf);
+	return NULL;
+}
+
+static int exporter_open_tcp(int port)
+{
+	struct sockaddr_in addr;
+	int one = 1;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	/* Only expose the counters to the local node */
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(port);
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 16) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int exporter_open_unix(const char *path)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	/* Remove the socket of a previous run */
+	unlink(path);
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 16) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int exporter_open_shm(const char *path)
+{
+	size_t size = 65536;
+	int fd = open(path, O_RDWR|O_CREAT|O_TRUNC, 0644);
+	if (fd < 0)
+		return -1;
+	if (ftruncate(fd, size) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+	exporter_shm = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	if (exporter_shm == MAP_FAILED)
+	{
+		exporter_shm = NULL;
+		close(fd);
+		return -1;
+	}
+	exporter_shm->mark = 0x01020304;
+	exporter_shm->pid = getpid();
+	exporter_shm->size = size;
+	exporter_shm->sequence = 0;
+	exporter_shm->length = 0;
+	exporter_shm->date = 0.;
+	STARPU_WMB();
+	/* Write the magic last, for the readers to know that the header is complete */
+	memcpy(exporter_shm->magic, SHM_MAGIC, sizeof(exporter_shm->magic));
+	return fd;
+}
+
+static void exporter_init_sample(struct starpu_perf_counter_sample *sample, unsigned scope_index)
+{
+	_starpu_perf_counter_sample_init(sample, exporter_scopes[scope_index]);
+	_starpu_perf_counter_sample_set_listener(sample, exporter_listeners[scope_index]);
+}
+
+static void exporter_exit_sample(struct starpu_perf_counter_sample *sample)
+{
+	_starpu_perf_counter_sample_unset_listener(sample);
+	_starpu_perf_counter_sample_exit(sample);
+}
+
+void _starpu_perf_exporter_init(void)
+{
+	int port = starpu_getenv_number_default("STARPU_PERF_EXPORTER_PORT", 0);
+	char *unix_path = starpu_getenv("STARPU_PERF_EXPORTER_SOCKET");
+	char *shm_path = starpu_getenv("STARPU_PERF_EXPORTER_SHM");
+	unsigned i, s;
+
+	if (port <= 0 && !unix_path && !shm_path)
+		return;
+
+	if (port > 0)
+	{
+		exporter_tcp_fd = exporter_open_tcp(port);
+		if (exporter_tcp_fd < 0)
+			_STARPU_DISP("Warning: could not listen on localhost port %d: %s, not exporting performance counters there\n", port, strerror(errno));
+	}
+	if (unix_path)
+	{
+		exporter_unix_fd = exporter_open_unix(unix_path);
+		if (exporter_unix_fd < 0)
+			_STARPU_DISP("Warning: could not listen on %s: %s, not exporting performance counters there\n", unix_path, strerror(errno));
+		else
+			exporter_unix_path = strdup(unix_path);
+	}
+	if (shm_path)
+	{
+		exporter_shm_fd = exporter_open_shm(shm_path);
+		if (exporter_shm_fd < 0)
+			_STARPU_DISP("Warning: could not map %s: %s, not exporting performance counters there\n", shm_path, strerror(errno));
+		else
+			exporter_shm_path = strdup(shm_path);
+	}
+	if (exporter_tcp_fd < 0 && exporter_unix_fd < 0 && exporter_shm_fd < 0)
+		return;
+
+	if (pipe(exporter_wakeup) < 0)
+	{
+		_STARPU_DISP("Warning: could not create a pipe: %s, not exporting performance counters\n", strerror(errno));
+		exporter_enabled = 1;
+		_starpu_perf_exporter_shutdown();
+		return;
+	}
+
+	exporter_period = starpu_getenv_number_default("STARPU_PERF_EXPORTER_PERIOD", 1000) * 1000.;
+	if (exporter_period <= 0.)
+		exporter_period = 1000000.;
+
+	/* Enable all counters in our private samples */
+	for (s = 0; s < NSCOPES; s++)
+	{
+		int n, nb = starpu_perf_counter_nb(exporter_scopes[s]);
+		struct starpu_perf_counter_set *set = starpu_perf_counter_set_alloc(exporter_scopes[s]);
+		for (n = 0; n < nb; n++)
+			starpu_perf_counter_set_enable_id(set, starpu_perf_counter_nth_to_id(exporter_scopes[s], n));
+		exporter_listeners[s] = starpu_perf_counter_listener_init(set, exporter_listener_callback, NULL);
+	}
+	exporter_init_sample(&exporter_global_sample, 0);
+	exporter_nworkers = starpu_worker_get_count();
+	_STARPU_MALLOC(exporter_worker_samples, exporter_nworkers * sizeof(*exporter_worker_samples));
+	for (i = 0; i < exporter_nworkers; i++)
+		exporter_init_sample(&exporter_worker_samples[i], 1);
+	exporter_init_sample(&exporter_codelet_sample, 2);
+
+	/* The counters are only maintained while collection is enabled */
+	starpu_perf_counter_collection_start();
+
+	exporter_enabled = 1;
+	STARPU_PTHREAD_CREATE(&exporter_thread, NULL, exporter_func, NULL);
+}
+
+void _starpu_perf_exporter_shutdown(void)
+{
+	unsigned i, s;
+
+	if (!exporter_enabled)
+		return;
+
+	if (exporter_wakeup[1] >= 0)
+	{
+		char c = 0;
+		if (exporter_write(exporter_wakeup[1], &c, 1) == 0)
+			STARPU_PTHREAD_JOIN(exporter_thread, NULL);
+		starpu_perf_counter_collection_stop();
+
+		exporter_exit_sample(&exporter_global_sample);
+		for (i = 0; i < exporter_nworkers; i++)
+			exporter_exit_sample(&exporter_worker_samples[i]);
+		free(exporter_worker_samples);
+		exporter_worker_samples = NULL;
+		exporter_exit_sample(&exporter_codelet_sample);
+		for (s = 0; s < NSCOPES; s++)
+		{
+			starpu_perf_counter_set_free(exporter_listeners[s]->set);
+			starpu_perf_counter_listener_exit(exporter_listeners[s]);
+		}
+		free(exporter_codelets);
+		exporter_codelets = NULL;
+		exporter_codelets_size = 0;
+		free(exporter_text.buf);
+		memset(&exporter_text, 0, sizeof(exporter_text));
+
+		close(exporter_wakeup[0]);
+		close(exporter_wakeup[1]);
+		exporter_wakeup[0] = exporter_wakeup[1] = -1;
+	}
+
+	if (exporter_tcp_fd >= 0)
+	{
+		close(exporter_tcp_fd);
+		exporter_tcp_fd = -1;
+	}
+	if (exporter_unix_fd >= 0)
+	{
+		close(exporter_unix_fd);
+		exporter_unix_fd = -1;
+		unlink(exporter_unix_path);
+		free(exporter_unix_path);
+		exporter_unix_path = NULL;
+	}
+	if (exporter_shm_fd >= 0)
+	{
+		munmap(exporter_shm, exporter_shm->size);
+		exporter_shm = NULL;
+		close(exporter_shm_fd);
+		exporter_shm_fd = -1;
+		/* The counters are not live any more */
+		unlink(exporter_shm_path);
+		free(exporter_shm_path);
+		exporter_shm_path = NULL;
+	}
+
+	exporter_enabled = 0;
+}
+
+#else /* STARPU_HAVE_WINDOWS || STARPU_SIMGRID */
+
+void _starpu_perf_exporter_init(void)
+{
+	if (starpu_getenv_number_default("STARPU_PERF_EXPORTER_PORT", 0) > 0
+	    || starpu_getenv("STARPU_PERF_EXPORTER_SOCKET")
+	    || starpu_getenv("STARPU_PERF_EXPORTER_SHM"))
+		_STARPU_DISP("Warning: the performance counters exporter is not supported on this platform\n");
+}
+
+void _starpu_perf_exporter_shutdown(void)
+{
+}
+
+#endif
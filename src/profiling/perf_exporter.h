@@ -0,0 +1,36 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __PERF_EXPORTER_H__
+#define __PERF_EXPORTER_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+/** Start the thread which periodically samples the performance counters and
+ * exports them, if any of STARPU_PERF_EXPORTER_PORT,
+ * STARPU_PERF_EXPORTER_SOCKET or STARPU_PERF_EXPORTER_SHM is set. This is
+ * to be called once the workers are initialized. */
+void _starpu_perf_exporter_init(void);
+void _starpu_perf_exporter_shutdown(void);
+
+#pragma GCC visibility pop
+
+#endif // __PERF_EXPORTER_H__
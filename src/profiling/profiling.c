@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2010-2022  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2010-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  * Copyright (C) 2020       Federal University of Rio Grande do Sul (UFRGS)
  *
  * StarPU is free software; you can redistribute it and/or modify
@@ -18,6 +18,7 @@
 #include <starpu.h>
 #include <starpu_profiling.h>
 #include <profiling/profiling.h>
+#include <profiling/sched_overhead.h>
 #include <core/workers.h>
 #include <common/config.h>
 #include <common/utils.h>
@@ -140,6 +141,8 @@ void _starpu_profiling_init(void)
 
 		memset(&worker->profiling_info, 0, sizeof(worker->profiling_info));
 		STARPU_PTHREAD_MUTEX_INIT(&worker->profiling_info_mutex, NULL);
+		worker->cumulated_executing_time = 0.;
+		worker->cumulated_executed_tasks = 0;
 
 		for (i = 0; i< STATUS_INDEX_NR; i++)
 			worker->profiling_registered_start[i] = 0;
@@ -469,13 +472,14 @@ void _starpu_worker_stop_state(int workerid, enum _starpu_worker_status_index in
 	}
 }
 
-void _starpu_worker_update_profiling_info_executing(int workerid, int executed_tasks, uint64_t used_cycles, uint64_t stall_cycles, double energy_consumed, double flops)
+void _starpu_worker_update_profiling_info_executing(int workerid, int executed_tasks, double executing_time, uint64_t used_cycles, uint64_t stall_cycles, double energy_consumed, double flops)
 {
-	struct starpu_profiling_worker_info *worker_info = &_starpu_get_worker_struct(workerid)->profiling_info;
+	struct _starpu_worker *worker = _starpu_get_worker_struct(workerid);
+	struct starpu_profiling_worker_info *worker_info = &worker->profiling_info;
 
 	if (starpu_profiling_status_get())
 	{
-		STARPU_PTHREAD_MUTEX_LOCK(&_starpu_get_worker_struct(workerid)->profiling_info_mutex);
+		STARPU_PTHREAD_MUTEX_LOCK(&worker->profiling_info_mutex);
 
 		worker_info->used_cycles += used_cycles;
 		worker_info->stall_cycles += stall_cycles;
@@ -483,12 +487,25 @@ void _starpu_worker_update_profiling_info_executing(int workerid, int executed_t
 		worker_info->executed_tasks += executed_tasks;
 		worker_info->flops += flops;
 
-		STARPU_PTHREAD_MUTEX_UNLOCK(&_starpu_get_worker_struct(workerid)->profiling_info_mutex);
+		worker->cumulated_executing_time += executing_time;
+		worker->cumulated_executed_tasks += executed_tasks;
+
+		STARPU_PTHREAD_MUTEX_UNLOCK(&worker->profiling_info_mutex);
 	}
 	else /* Not thread safe, shouldn't be too much a problem */
 		worker_info->executed_tasks += executed_tasks;
 }
 
+void _starpu_profiling_worker_get_cumulated_executing(int workerid, double *executing_time, unsigned long *executed_tasks)
+{
+	struct _starpu_worker *worker = _starpu_get_worker_struct(workerid);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&worker->profiling_info_mutex);
+	*executing_time = worker->cumulated_executing_time;
+	*executed_tasks = worker->cumulated_executed_tasks;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&worker->profiling_info_mutex);
+}
+
 int starpu_profiling_worker_get_info(int workerid, struct starpu_profiling_worker_info *info)
 {
 	struct _starpu_worker *worker = _starpu_get_worker_struct(workerid);
@@ -534,6 +551,7 @@ int starpu_profiling_worker_get_info(int workerid, struct starpu_profiling_worke
 					&worker_info->total_time);
 
 		*info = *worker_info;
+		_starpu_sched_overhead_worker_get_info(workerid, info);
 	}
 
 	_starpu_worker_reset_profiling_info_with_lock(workerid);
@@ -35,7 +35,15 @@ struct starpu_profiling_task_info *_starpu_allocate_profiling_info_if_needed(str
 
 /** Update the per-worker profiling info after a task (or more) was executed.
  * This tells StarPU how much time was spent doing computation. */
-void _starpu_worker_update_profiling_info_executing(int workerid, int executed_tasks, uint64_t used_cycles, uint64_t stall_cycles, double consumed_energy, double flops);
+void _starpu_worker_update_profiling_info_executing(int workerid, int executed_tasks, double executing_time, uint64_t used_cycles, uint64_t stall_cycles, double consumed_energy, double flops);
+
+/** Get the time spent by the worker executing tasks, in us, and the number of
+ * these tasks, since the initialization of StarPU. Only the tasks executed
+ * while the profiling is enabled are accounted. Contrary to
+ * starpu_profiling_worker_get_info(), this does not reset anything, and can
+ * thus be used internally, e.g. by the MPI load balancers, without
+ * interfering with the application. */
+void _starpu_profiling_worker_get_cumulated_executing(int workerid, double *executing_time, unsigned long *executed_tasks) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
 /** Record the date when the worker entered this state. This permits to measure
  * how much time was spent in this state.
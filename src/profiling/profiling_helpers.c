@@ -1,6 +1,6 @@
 /* StarPU --- Runtime system for heterogeneous multicore architectures.
  *
- * Copyright (C) 2010-2021  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ * Copyright (C) 2010-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
  *
  * StarPU is free software; you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as published by
@@ -156,6 +156,22 @@ void _starpu_profiling_worker_helper_display_summary(FILE *stream)
 					"scheduling: %.2lf ms\n",
 				total_time, executing_time, callback_time, waiting_time, sleeping_time, scheduling_time, overhead_time,
 				all_executing_time, all_callback_time, all_waiting_time, all_sleeping_time, all_scheduling_time);
+			if (info.push_time.tv_sec || info.push_time.tv_nsec
+			    || info.pop_time.tv_sec || info.pop_time.tv_nsec
+			    || info.dependencies_time.tv_sec || info.dependencies_time.tv_nsec
+			    || info.fetch_time.tv_sec || info.fetch_time.tv_nsec
+			    || info.termination_time.tv_sec || info.termination_time.tv_nsec)
+				fprintf(stream, "\truntime operations: "
+						"push: %.2lf ms "
+						"pop: %.2lf ms "
+						"dependencies: %.2lf ms "
+						"fetch: %.2lf ms "
+						"termination: %.2lf ms\n",
+					starpu_timing_timespec_to_us(&info.push_time) / 1000.,
+					starpu_timing_timespec_to_us(&info.pop_time) / 1000.,
+					starpu_timing_timespec_to_us(&info.dependencies_time) / 1000.,
+					starpu_timing_timespec_to_us(&info.fetch_time) / 1000.,
+					starpu_timing_timespec_to_us(&info.termination_time) / 1000.);
 			if (info.used_cycles || info.stall_cycles)
 				fprintf(stream, "\t%llu Mcy %llu Mcy stall\n", (unsigned long long)info.used_cycles/1000000, (unsigned long long)info.stall_cycles/1000000);
 			if (info.energy_consumed)
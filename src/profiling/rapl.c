@@ -0,0 +1,361 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Per-socket energy measurement through the RAPL package domains exposed by
+ * the Linux powercap interface, i.e. /sys/class/powercap/intel-rapl:N/energy_uj
+ *
+ * The counters can not tell which core consumed what, so the energy consumed
+ * by a socket during some time is shared evenly between the tasks which were
+ * running on it during that time. The energy consumed while no task was
+ * running gives an estimation of the idle power of the socket.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <core/workers.h>
+#include <profiling/rapl.h>
+#ifdef STARPU_HAVE_HWLOC
+#include <hwloc.h>
+#endif
+#ifndef STARPU_HAVE_WINDOWS
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define RAPL_DEFAULT_PATH "/sys/class/powercap"
+#define RAPL_MAX_SOCKETS 64
+
+struct _starpu_rapl_socket
+{
+	starpu_pthread_mutex_t mutex;
+	/* Physical package id, as found in the domain name */
+	unsigned package;
+	/* energy_uj file of the domain */
+	int fd;
+	/* The counter wraps around at this value */
+	unsigned long long max_range;
+	/* Last raw value read, and its date in us */
+	unsigned long long last_raw;
+	double last_date;
+	/* Number of tasks currently running on the socket */
+	unsigned nrunning;
+	/* Energy consumed so far divided by the number of tasks running
+	 * meanwhile, i.e. what a task running all along would be charged, in J */
+	double shared_energy;
+	/* Energy consumed and time spent while no task was running, in J and us */
+	double idle_energy;
+	double idle_time;
+};
+
+int _starpu_rapl_enabled;
+static unsigned nsockets;
+static struct _starpu_rapl_socket sockets[RAPL_MAX_SOCKETS];
+static int worker_socket[STARPU_NMAXWORKERS];
+static double worker_start_energy[STARPU_NMAXWORKERS];
+static double worker_task_energy[STARPU_NMAXWORKERS];
+
+#ifndef STARPU_HAVE_WINDOWS
+static int read_ull(int fd, unsigned long long *val)
+{
+	char buf[32];
+	ssize_t n = pread(fd, buf, sizeof(buf)-1, 0);
+	if (n <= 0)
+		return -1;
+	buf[n] = 0;
+	*val = strtoull(buf, NULL, 10);
+	return 0;
+}
+
+static int read_file_ull(const char *path, unsigned long long *val)
+{
+	int fd = open(path, O_RDONLY);
+	int ret;
+	if (fd < 0)
+		return -1;
+	ret = read_ull(fd, val);
+	close(fd);
+	return ret;
+}
+
+/* Account the energy consumed by the socket since the last read, must be
+ * called with the socket mutex held */
+static void update_socket(struct _starpu_rapl_socket *socket)
+{
+	unsigned long long raw, delta;
+	double now = starpu_timing_now();
+
+	if (read_ull(socket->fd, &raw))
+		return;
+
+	if (raw >= socket->last_raw)
+		delta = raw - socket->last_raw;
+	else if (socket->max_range && socket->max_range >= socket->last_raw)
+		delta = raw + socket->max_range - socket->last_raw;
+	else
+	{
+		/* Wrapped around an unknown range, we can not tell how much
+		 * was consumed, drop this sample */
+		socket->last_raw = raw;
+		socket->last_date = now;
+		return;
+	}
+
+	if (socket->nrunning)
+		socket->shared_energy += delta / 1000000. / socket->nrunning;
+	else
+	{
+		socket->idle_energy += delta / 1000000.;
+		socket->idle_time += now - socket->last_date;
+	}
+	socket->last_raw = raw;
+	socket->last_date = now;
+}
+
+/* Open the package domain found in directory path, if any */
+static void add_domain(const char *path)
+{
+	char file[1024];
+	char name[64];
+	unsigned package;
+	FILE *f;
+
+	snprintf(file, sizeof(file), "%s/name", path);
+	f = fopen(file, "r");
+	if (!f)
+		return;
+	if (fscanf(f, "%63s", name) != 1 || sscanf(name, "package-%u", &package) != 1)
+	{
+		/* Not a package domain (e.g. psys) */
+		fclose(f);
+		return;
+	}
+	fclose(f);
+
+	if (nsockets == RAPL_MAX_SOCKETS)
+	{
+		_STARPU_DISP("Warning: more than %d RAPL package domains, ignoring %s\n", RAPL_MAX_SOCKETS, path);
+		return;
+	}
+
+	struct _starpu_rapl_socket *socket = &sockets[nsockets];
+	snprintf(file, sizeof(file), "%s/energy_uj", path);
+	socket->fd = open(file, O_RDONLY);
+	if (socket->fd < 0 || read_ull(socket->fd, &socket->last_raw))
+	{
+		_STARPU_DISP("Warning: could not read %s: %s. Perhaps your system requires to run measurements as root?\n", file, strerror(errno));
+		if (socket->fd >= 0)
+			close(socket->fd);
+		return;
+	}
+	snprintf(file, sizeof(file), "%s/max_energy_range_uj", path);
+	if (read_file_ull(file, &socket->max_range))
+		socket->max_range = 0;
+
+	STARPU_PTHREAD_MUTEX_INIT(&socket->mutex, NULL);
+	socket->package = package;
+	socket->last_date = starpu_timing_now();
+	socket->nrunning = 0;
+	socket->shared_energy = 0.;
+	socket->idle_energy = 0.;
+	socket->idle_time = 0.;
+	nsockets++;
+}
+#endif
+
+void _starpu_rapl_init(struct _starpu_machine_config *config)
+{
+	unsigned workerid;
+
+	for (workerid = 0; workerid < STARPU_NMAXWORKERS; workerid++)
+		worker_socket[workerid] = -1;
+	nsockets = 0;
+	_starpu_rapl_enabled = 0;
+
+	if (!starpu_getenv_number_default("STARPU_RAPL", 0))
+		return;
+
+#ifdef STARPU_HAVE_WINDOWS
+	_STARPU_DISP("Warning: STARPU_RAPL is only supported on Linux\n");
+	(void) config;
+#else
+	const char *path = starpu_getenv("STARPU_RAPL_PATH");
+	if (!path)
+		path = RAPL_DEFAULT_PATH;
+
+	DIR *dir = opendir(path);
+	if (!dir)
+	{
+		_STARPU_DISP("Warning: could not open %s: %s, RAPL energy measurement disabled\n", path, strerror(errno));
+		return;
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)))
+	{
+		unsigned n;
+		char c;
+		char domain[512];
+
+		/* Only the top-level domains, not their subzones intel-rapl:N:M */
+		if (sscanf(entry->d_name, "intel-rapl:%u%c", &n, &c) != 1)
+			continue;
+		snprintf(domain, sizeof(domain), "%s/%s", path, entry->d_name);
+		add_domain(domain);
+	}
+	closedir(dir);
+
+	if (!nsockets)
+	{
+		_STARPU_DISP("Warning: no RAPL package domain found in %s, RAPL energy measurement disabled\n", path);
+		return;
+	}
+
+	for (workerid = 0; workerid < config->topology.nworkers; workerid++)
+	{
+		struct _starpu_worker *worker = &config->workers[workerid];
+		unsigned socket;
+
+		if (worker->arch != STARPU_CPU_WORKER)
+			continue;
+
+		if (nsockets == 1)
+		{
+			worker_socket[workerid] = 0;
+			continue;
+		}
+
+#ifdef STARPU_HAVE_HWLOC
+		hwloc_topology_t topology = config->topology.hwtopology;
+		hwloc_obj_t pu = hwloc_get_obj_by_type(topology, HWLOC_OBJ_PU, worker->bindid);
+		hwloc_obj_t package = pu ? hwloc_get_ancestor_obj_by_type(topology, HWLOC_OBJ_PACKAGE, pu) : NULL;
+		if (!package)
+			continue;
+		for (socket = 0; socket < nsockets; socket++)
+			if (sockets[socket].package == package->os_index)
+			{
+				worker_socket[workerid] = socket;
+				break;
+			}
+#else
+		(void) socket;
+#endif
+	}
+
+	_STARPU_DEBUG("Measuring energy of %u sockets through RAPL\n", nsockets);
+	_starpu_rapl_enabled = 1;
+#endif
+}
+
+void _starpu_rapl_deinit(void)
+{
+#ifndef STARPU_HAVE_WINDOWS
+	unsigned socket;
+	for (socket = 0; socket < nsockets; socket++)
+	{
+		if (starpu_getenv_number_default("STARPU_RAPL_STATS", 0))
+		{
+			STARPU_PTHREAD_MUTEX_LOCK(&sockets[socket].mutex);
+			update_socket(&sockets[socket]);
+			STARPU_PTHREAD_MUTEX_UNLOCK(&sockets[socket].mutex);
+			_STARPU_DISP("RAPL package %u: %f J while idle, idle power %f W\n",
+				     sockets[socket].package,
+				     sockets[socket].idle_energy,
+				     _starpu_rapl_socket_get_idle_power(socket));
+		}
+		close(sockets[socket].fd);
+		STARPU_PTHREAD_MUTEX_DESTROY(&sockets[socket].mutex);
+	}
+#endif
+	nsockets = 0;
+	_starpu_rapl_enabled = 0;
+}
+
+unsigned _starpu_rapl_get_nsockets(void)
+{
+	return nsockets;
+}
+
+int _starpu_rapl_worker_get_socket(int workerid)
+{
+	return worker_socket[workerid];
+}
+
+unsigned _starpu_rapl_socket_get_nrunning(int socket)
+{
+	unsigned nrunning;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&sockets[socket].mutex);
+	nrunning = sockets[socket].nrunning;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&sockets[socket].mutex);
+	return nrunning;
+}
+
+double _starpu_rapl_socket_get_idle_power(int socket)
+{
+	double power = 0.;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&sockets[socket].mutex);
+	if (sockets[socket].idle_time > 0.)
+		/* J per us to W */
+		power = sockets[socket].idle_energy / sockets[socket].idle_time * 1000000.;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&sockets[socket].mutex);
+	return power;
+}
+
+void _starpu_rapl_task_start(int workerid)
+{
+#ifndef STARPU_HAVE_WINDOWS
+	int socket = worker_socket[workerid];
+	if (socket < 0)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&sockets[socket].mutex);
+	update_socket(&sockets[socket]);
+	sockets[socket].nrunning++;
+	worker_start_energy[workerid] = sockets[socket].shared_energy;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&sockets[socket].mutex);
+#else
+	(void) workerid;
+#endif
+}
+
+void _starpu_rapl_task_end(int workerid)
+{
+#ifndef STARPU_HAVE_WINDOWS
+	int socket = worker_socket[workerid];
+	if (socket < 0)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&sockets[socket].mutex);
+	update_socket(&sockets[socket]);
+	STARPU_ASSERT(sockets[socket].nrunning > 0);
+	sockets[socket].nrunning--;
+	worker_task_energy[workerid] = sockets[socket].shared_energy - worker_start_energy[workerid];
+	STARPU_PTHREAD_MUTEX_UNLOCK(&sockets[socket].mutex);
+#else
+	(void) workerid;
+#endif
+}
+
+double _starpu_rapl_worker_get_task_energy(int workerid)
+{
+	if (worker_socket[workerid] < 0)
+		return 0.;
+	return worker_task_energy[workerid];
+}
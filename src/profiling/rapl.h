@@ -0,0 +1,60 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __RAPL_H__
+#define __RAPL_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+struct _starpu_machine_config;
+
+/** Whether the per-socket RAPL energy counters are being read, see STARPU_RAPL */
+extern int _starpu_rapl_enabled;
+
+/** Find the package domains of the powercap interface, and the package of
+ * each CPU worker */
+void _starpu_rapl_init(struct _starpu_machine_config *config);
+void _starpu_rapl_deinit(void);
+
+/** Number of sockets whose energy is measured */
+unsigned _starpu_rapl_get_nsockets(void);
+
+/** Socket of the CPU worker, or -1 if its energy is not measured */
+int _starpu_rapl_worker_get_socket(int workerid);
+
+/** Number of tasks currently running on the socket */
+unsigned _starpu_rapl_socket_get_nrunning(int socket);
+
+/** Power consumed by the socket while it was not running any task, in Watt,
+ * or 0. if it was never observed yet */
+double _starpu_rapl_socket_get_idle_power(int socket);
+
+/** Record the start and end of a task on a CPU worker. The energy consumed
+ * by the socket meanwhile is shared between the tasks running on it. */
+void _starpu_rapl_task_start(int workerid);
+void _starpu_rapl_task_end(int workerid);
+
+/** Energy in Joules attributed to the last task ended on the worker */
+double _starpu_rapl_worker_get_task_energy(int workerid);
+
+#pragma GCC visibility pop
+
+#endif // __RAPL_H__
@@ -0,0 +1,318 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Breakdown of the runtime overhead: time spent pushing and popping tasks,
+ * resolving dependencies, fetching data, and terminating tasks.
+ *
+ * Every operation is counted, but only one out of STARPU_SCHED_OVERHEAD_SAMPLING
+ * outermost operations of each thread is timed, along with the operations
+ * nested in it, e.g. the push done while resolving the dependencies of a task.
+ * The time of the nested operations is subtracted from the time of the
+ * enclosing one, so that the categories can be added up. The total time of
+ * each operation is then estimated from the ratio between the number of
+ * operations and the number of timed operations.
+ *
+ * The time is measured with the time stamp counter on x86, which is converted
+ * to nanoseconds according to the elapsed time measured since the
+ * initialization.
+ *
+ * The operations of the workers are accounted to the worker, the operations
+ * of the other threads, e.g. the submissions from the application, are
+ * accounted together.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <core/workers.h>
+#include <profiling/sched_overhead.h>
+
+/* Maximum nesting of the timed operations */
+#define MAX_DEPTH 16
+
+/* The operations of non-worker threads */
+#define OTHER_THREADS STARPU_NMAXWORKERS
+
+static const char *kind_names[_STARPU_SCHED_OVERHEAD_NKINDS] =
+{
+	[_STARPU_SCHED_OVERHEAD_PUSH] = "push",
+	[_STARPU_SCHED_OVERHEAD_POP] = "pop",
+	[_STARPU_SCHED_OVERHEAD_DEPS] = "dependencies",
+	[_STARPU_SCHED_OVERHEAD_FETCH] = "fetch",
+	[_STARPU_SCHED_OVERHEAD_TERMINATION] = "termination",
+	[_STARPU_SCHED_OVERHEAD_CALLBACK] = "callback",
+};
+
+struct _starpu_sched_overhead_slot
+{
+	/** Number of operations */
+	uint64_t calls[_STARPU_SCHED_OVERHEAD_NKINDS];
+	/** Number of timed operations */
+	uint64_t sampled[_STARPU_SCHED_OVERHEAD_NKINDS];
+	/** Cumulated exclusive time of the timed operations, in ticks */
+	uint64_t ticks[_STARPU_SCHED_OVERHEAD_NKINDS];
+	/** Estimated time already given by starpu_profiling_worker_get_info(), in ns */
+	uint64_t reported[_STARPU_SCHED_OVERHEAD_NKINDS];
+};
+
+struct _starpu_sched_overhead_thread
+{
+	struct _starpu_sched_overhead_thread *next;
+	struct _starpu_sched_overhead_slot *slot;
+	/** The slot is shared with other threads */
+	int shared;
+	/** The owner thread has exited, a new thread can take the state */
+	int exited;
+	/** Number of outermost operations, to choose the sampled ones */
+	unsigned counter;
+	/** Whether the current outermost operation is timed */
+	int sampled;
+	unsigned depth;
+	uint64_t start[MAX_DEPTH];
+	/** Time of the operations nested in the operation */
+	uint64_t nested[MAX_DEPTH];
+};
+
+int _starpu_sched_overhead_enabled;
+static unsigned sampling;
+static struct _starpu_sched_overhead_slot slots[STARPU_NMAXWORKERS + 1];
+static struct _starpu_sched_overhead_thread *threads;
+static starpu_pthread_key_t thread_key;
+static starpu_pthread_mutex_t thread_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+static uint64_t reference_ticks;
+static double reference_date;
+
+static inline uint64_t get_ticks(void)
+{
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(STARPU_SIMGRID)
+	uint32_t low, high;
+	__asm__ __volatile__("rdtsc" : "=a" (low), "=d" (high));
+	return low | ((uint64_t) high << 32);
+#else
+	return starpu_timing_now() * 1000.;
+#endif
+}
+
+/* Nanoseconds per tick, measured over the time elapsed since the
+ * initialization */
+static double get_tick_duration(void)
+{
+	uint64_t ticks = get_ticks() - reference_ticks;
+	double elapsed = starpu_timing_now() - reference_date;
+
+	if (!ticks)
+		return 0.;
+	return elapsed * 1000. / ticks;
+}
+
+static void _starpu_sched_overhead_thread_exit(void *arg)
+{
+	struct _starpu_sched_overhead_thread *thread = arg;
+	thread->exited = 1;
+}
+
+static struct _starpu_sched_overhead_thread *get_thread(void)
+{
+	struct _starpu_sched_overhead_thread *thread = STARPU_PTHREAD_GETSPECIFIC(thread_key);
+	if (STARPU_LIKELY(thread != NULL))
+		return thread;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&thread_mutex);
+	/* Take the state of a thread which has exited, if any */
+	for (thread = threads; thread; thread = thread->next)
+		if (thread->exited)
+			break;
+	if (!thread)
+	{
+		_STARPU_CALLOC(thread, 1, sizeof(*thread));
+		thread->next = threads;
+		threads = thread;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&thread_mutex);
+
+	int workerid = starpu_worker_get_id();
+	thread->slot = &slots[workerid >= 0 ? workerid : OTHER_THREADS];
+	thread->shared = workerid < 0;
+	thread->exited = 0;
+	thread->counter = 0;
+	thread->sampled = 0;
+	thread->depth = 0;
+	STARPU_PTHREAD_SETSPECIFIC(thread_key, thread);
+	return thread;
+}
+
+struct _starpu_sched_overhead_thread *_starpu_sched_overhead_start(enum _starpu_sched_overhead_kind kind)
+{
+	struct _starpu_sched_overhead_thread *thread = get_thread();
+	unsigned depth = thread->depth++;
+
+	if (thread->shared)
+		(void)STARPU_ATOMIC_ADD64(&thread->slot->calls[kind], 1);
+	else
+		thread->slot->calls[kind]++;
+
+	if (depth == 0)
+		thread->sampled = ++thread->counter % sampling == 0;
+	if (thread->sampled && depth < MAX_DEPTH)
+	{
+		thread->nested[depth] = 0;
+		thread->start[depth] = get_ticks();
+	}
+	return thread;
+}
+
+void _starpu_sched_overhead_end(struct _starpu_sched_overhead_thread *thread, enum _starpu_sched_overhead_kind kind)
+{
+	unsigned depth = --thread->depth;
+	uint64_t elapsed;
+
+	if (!thread->sampled || depth >= MAX_DEPTH)
+		return;
+
+	elapsed = get_ticks() - thread->start[depth];
+	if (depth > 0)
+		thread->nested[depth-1] += elapsed;
+	/* Only keep the time spent in this very operation */
+	elapsed -= thread->nested[depth];
+
+	if (thread->shared)
+	{
+		(void)STARPU_ATOMIC_ADD64(&thread->slot->sampled[kind], 1);
+		(void)STARPU_ATOMIC_ADD64(&thread->slot->ticks[kind], elapsed);
+	}
+	else
+	{
+		thread->slot->sampled[kind]++;
+		thread->slot->ticks[kind] += elapsed;
+	}
+}
+
+/* Estimated total time of the operations, in ns */
+static uint64_t estimate(struct _starpu_sched_overhead_slot *slot, enum _starpu_sched_overhead_kind kind, double tick_duration)
+{
+	uint64_t sampled = slot->sampled[kind];
+
+	if (!sampled)
+		return 0;
+	return (double) slot->ticks[kind] * slot->calls[kind] / sampled * tick_duration;
+}
+
+/* The counters of a worker are updated by the worker without atomic
+ * operations or locking, to keep the measurement cheap. They are thus read
+ * here while they may be updated: an operation which is being accounted may be
+ * counted but not yet timed, and on 32bit systems a 64bit counter may even be
+ * read half-updated. The estimate is thus approximate, only the time reported
+ * since the previous call is given, and a total which went down because of
+ * such a read is ignored until it goes over the reported time again. The
+ * reported times are only accessed with the profiling_info_mutex of the
+ * worker held. */
+void _starpu_sched_overhead_worker_get_info(int workerid, struct starpu_profiling_worker_info *info)
+{
+	struct _starpu_sched_overhead_slot *slot = &slots[workerid];
+	struct timespec *times[_STARPU_SCHED_OVERHEAD_NKINDS] =
+	{
+		[_STARPU_SCHED_OVERHEAD_PUSH] = &info->push_time,
+		[_STARPU_SCHED_OVERHEAD_POP] = &info->pop_time,
+		[_STARPU_SCHED_OVERHEAD_DEPS] = &info->dependencies_time,
+		[_STARPU_SCHED_OVERHEAD_FETCH] = &info->fetch_time,
+		[_STARPU_SCHED_OVERHEAD_TERMINATION] = &info->termination_time,
+		/* Already in callback_time */
+		[_STARPU_SCHED_OVERHEAD_CALLBACK] = NULL,
+	};
+	double tick_duration = get_tick_duration();
+	unsigned kind;
+
+	for (kind = 0; kind < _STARPU_SCHED_OVERHEAD_NKINDS; kind++)
+	{
+		uint64_t total, delta;
+
+		if (!times[kind])
+			continue;
+		total = estimate(slot, kind, tick_duration);
+		delta = total > slot->reported[kind] ? total - slot->reported[kind] : 0;
+		slot->reported[kind] += delta;
+		times[kind]->tv_sec = delta / 1000000000;
+		times[kind]->tv_nsec = delta % 1000000000;
+	}
+}
+
+void _starpu_sched_overhead_init(void)
+{
+	int sampling_env = starpu_getenv_number_default("STARPU_SCHED_OVERHEAD_SAMPLING", 16);
+
+	sampling = sampling_env > 0 ? sampling_env : 1;
+	memset(slots, 0, sizeof(slots));
+	reference_ticks = get_ticks();
+	reference_date = starpu_timing_now();
+	STARPU_PTHREAD_KEY_CREATE(&thread_key, _starpu_sched_overhead_thread_exit);
+	/* Can also be switched with the starpu.global.g_sched_overhead_knob knob */
+	_starpu_sched_overhead_enabled = starpu_getenv_number_default("STARPU_SCHED_OVERHEAD", 0) > 0;
+}
+
+static void display_slot(FILE *f, const char *name, struct _starpu_sched_overhead_slot *slot, double tick_duration)
+{
+	unsigned kind;
+
+	fprintf(f, "%-20s", name);
+	for (kind = 0; kind < _STARPU_SCHED_OVERHEAD_NKINDS; kind++)
+		fprintf(f, " %10lu %10.2f", (unsigned long) slot->calls[kind], estimate(slot, kind, tick_duration) / 1000000.);
+	fprintf(f, "\n");
+}
+
+void _starpu_sched_overhead_shutdown(void)
+{
+	struct _starpu_sched_overhead_thread *thread, *next;
+	unsigned worker, nworkers = starpu_worker_get_count(), kind;
+	double tick_duration = get_tick_duration();
+	int measured = 0;
+
+	_starpu_sched_overhead_enabled = 0;
+
+	for (worker = 0; worker <= OTHER_THREADS; worker++)
+		for (kind = 0; kind < _STARPU_SCHED_OVERHEAD_NKINDS; kind++)
+			if (slots[worker].sampled[kind])
+				measured = 1;
+
+	if (measured)
+	{
+		fprintf(stderr, "\n#---------------------\n");
+		fprintf(stderr, "Runtime overhead (number of operations and estimated time in ms, sampling 1/%u):\n", sampling);
+		fprintf(stderr, "%-20s", "");
+		for (kind = 0; kind < _STARPU_SCHED_OVERHEAD_NKINDS; kind++)
+			fprintf(stderr, " %21s", kind_names[kind]);
+		fprintf(stderr, "\n");
+		for (worker = 0; worker < nworkers; worker++)
+		{
+			char name[32];
+			starpu_worker_get_name(worker, name, sizeof(name));
+			display_slot(stderr, name, &slots[worker], tick_duration);
+		}
+		display_slot(stderr, "other threads", &slots[OTHER_THREADS], tick_duration);
+		fprintf(stderr, "#---------------------\n");
+	}
+
+	STARPU_PTHREAD_MUTEX_LOCK(&thread_mutex);
+	for (thread = threads; thread; thread = next)
+	{
+		next = thread->next;
+		free(thread);
+	}
+	threads = NULL;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&thread_mutex);
+
+	STARPU_PTHREAD_KEY_DELETE(thread_key);
+}
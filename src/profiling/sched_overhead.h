@@ -0,0 +1,75 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __SCHED_OVERHEAD_H__
+#define __SCHED_OVERHEAD_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <common/config.h>
+
+#pragma GCC visibility push(hidden)
+
+/** The runtime operations whose duration is measured */
+enum _starpu_sched_overhead_kind
+{
+	_STARPU_SCHED_OVERHEAD_PUSH,
+	_STARPU_SCHED_OVERHEAD_POP,
+	_STARPU_SCHED_OVERHEAD_DEPS,
+	_STARPU_SCHED_OVERHEAD_FETCH,
+	_STARPU_SCHED_OVERHEAD_TERMINATION,
+	_STARPU_SCHED_OVERHEAD_CALLBACK,
+	_STARPU_SCHED_OVERHEAD_NKINDS
+};
+
+struct _starpu_sched_overhead_thread;
+
+/** Whether the overhead is being measured, see STARPU_SCHED_OVERHEAD and the
+ * starpu.global.g_sched_overhead_knob performance knob */
+extern int _starpu_sched_overhead_enabled;
+
+void _starpu_sched_overhead_init(void);
+/** Display the measured overhead, if any, and free the per-thread states.
+ * This is to be called once the workers are terminated. */
+void _starpu_sched_overhead_shutdown(void);
+
+/** Count an operation of the calling thread, and start measuring its
+ * duration if it is sampled. */
+struct _starpu_sched_overhead_thread *_starpu_sched_overhead_start(enum _starpu_sched_overhead_kind kind);
+void _starpu_sched_overhead_end(struct _starpu_sched_overhead_thread *thread, enum _starpu_sched_overhead_kind kind);
+
+/** Fill the overhead fields of \p info with the estimated time spent by the
+ * worker in each operation since the previous call. The counters of the
+ * worker are read while it keeps updating them, so that the estimate is
+ * approximate. This is to be called with the profiling_info_mutex of the
+ * worker held. */
+void _starpu_sched_overhead_worker_get_info(int workerid, struct starpu_profiling_worker_info *info);
+
+/** Measure the code between these two macros, which have to be in the same
+ * block */
+#define _STARPU_SCHED_OVERHEAD_START(kind) \
+	struct _starpu_sched_overhead_thread *_overhead_thread = \
+		STARPU_UNLIKELY(_starpu_sched_overhead_enabled) ? _starpu_sched_overhead_start(kind) : NULL
+
+#define _STARPU_SCHED_OVERHEAD_END(kind) do { \
+	if (STARPU_UNLIKELY(_overhead_thread != NULL)) \
+		_starpu_sched_overhead_end(_overhead_thread, kind); \
+} while (0)
+
+#pragma GCC visibility pop
+
+#endif // __SCHED_OVERHEAD_H__
@@ -33,6 +33,7 @@
 #include <core/debug.h>
 #ifdef BUILDING_STARPU
 #include <datawizard/memory_nodes.h>
+#include <profiling/rapl.h>
 #endif
 #include <sched_policies/fifo_queues.h>
 
@@ -56,6 +57,7 @@ struct _starpu_dmda_data
 	double beta;
 	double _gamma;
 	double idle_power;
+	int energy_packing;
 
 	struct starpu_st_fifo_taskq queue_array[STARPU_NMAXWORKERS];
 
@@ -651,6 +653,30 @@ static double _dmda_push_task(struct starpu_task *task, unsigned prio, unsigned
 
 	double fitness[nworkers_ctx][STARPU_MAXIMPLEMENTATIONS];
 
+	/* Non-critical tasks should rather not wake idle sockets up, so they
+	 * can stay in deep C-states. This is the idle power of each socket in
+	 * J/us, or 0 if it is already busy anyway */
+	int pack = da && dt->energy_packing && task->priority <= STARPU_DEFAULT_PRIO;
+	unsigned nsockets = _starpu_rapl_get_nsockets();
+	double socket_wakeup[STARPU_MAX(nsockets, 1)];
+	if (pack)
+	{
+		unsigned socket, worker_ctx = 0;
+		struct starpu_sched_ctx_iterator it;
+
+		for (socket = 0; socket < nsockets; socket++)
+			socket_wakeup[socket] = _starpu_rapl_socket_get_nrunning(socket) ? 0. : _starpu_rapl_socket_get_idle_power(socket) / 1000000.0;
+
+		workers->init_iterator(workers, &it);
+		while(worker_ctx < nworkers_ctx && workers->has_next(workers, &it))
+		{
+			unsigned worker = workers->get_next(workers, &it);
+			int worker_socket = _starpu_rapl_worker_get_socket(worker);
+			if (worker_socket >= 0 && dt->queue_array[worker].ntasks)
+				socket_wakeup[worker_socket] = 0.;
+			worker_ctx++;
+		}
+	}
 
 	compute_all_performance_predictions(task,
 					    nworkers_ctx,
@@ -703,6 +729,14 @@ static double _dmda_push_task(struct starpu_task *task, unsigned prio, unsigned
 																									  must be in Joules, thus the / 1000000.0 */
 				}
 
+				if (pack)
+				{
+					int worker_socket = _starpu_rapl_worker_get_socket(worker);
+					if (worker_socket >= 0)
+						/* Keeping the socket awake while running the task */
+						fitness[worker_ctx][nimpl] += dt->_gamma * __s_gamma__value * socket_wakeup[worker_socket] * local_task_length[worker_ctx][nimpl];
+				}
+
 				if (best == -1 || fitness[worker_ctx][nimpl] < best_fitness)
 				{
 					/* we found a better solution */
@@ -881,6 +915,13 @@ static void initialize_dmda_policy(unsigned sched_ctx_id)
 	dt->_gamma = starpu_getenv_float_default("STARPU_SCHED_GAMMA", _STARPU_SCHED_GAMMA_DEFAULT);
 	/* data->idle_power: Idle power of the whole machine in Watt */
 	dt->idle_power = starpu_getenv_float_default("STARPU_IDLE_POWER", 0.0);
+	/* data->energy_packing: keep non-critical tasks on the sockets which are already busy */
+	dt->energy_packing = starpu_getenv_number_default("STARPU_SCHED_ENERGY_PACKING", 0);
+	if (dt->energy_packing && !_starpu_rapl_enabled)
+	{
+		_STARPU_DISP("Warning: STARPU_SCHED_ENERGY_PACKING needs the RAPL measurements enabled with STARPU_RAPL=1, ignoring it\n");
+		dt->energy_packing = 0;
+	}
 
 	if(starpu_sched_ctx_min_priority_is_set(sched_ctx_id) != 0 && starpu_sched_ctx_max_priority_is_set(sched_ctx_id) != 0)
 		dt->num_priorities = starpu_sched_ctx_get_max_priority(sched_ctx_id) - starpu_sched_ctx_get_min_priority(sched_ctx_id) + 1;
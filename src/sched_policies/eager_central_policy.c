@@ -19,6 +19,10 @@
 /*
  *	This is just the trivial policy where every worker use the same
  *	JOB QUEUE.
+ *
+ *	The leager variant looks, at pop time, at the first few tasks of the
+ *	queue, and picks the one which has most of its data already valid on the
+ *	memory node of the worker.
  */
 
 #include <starpu_scheduler.h>
@@ -33,12 +37,21 @@ struct _starpu_eager_center_policy_data
 	struct starpu_st_fifo_taskq fifo;
 	starpu_pthread_mutex_t policy_mutex;
 	struct starpu_bitmap waiters;
+
+	/* leager: number of queued tasks to consider at pop time, 0 for eager */
+	unsigned window;
+	/* leager: bytes that eager would have had to fetch for the popped
+	 * tasks, and bytes actually needed by the tasks that we picked */
+	unsigned long eager_bytes;
+	unsigned long fetched_bytes;
+	unsigned long ntasks_popped;
+	unsigned long ntasks_reordered;
 };
 
 static void initialize_eager_center_policy(unsigned sched_ctx_id)
 {
 	struct _starpu_eager_center_policy_data *data;
-	_STARPU_MALLOC(data, sizeof(struct _starpu_eager_center_policy_data));
+	_STARPU_CALLOC(data, 1, sizeof(struct _starpu_eager_center_policy_data));
 
 	/* there is only a single queue in that trivial design */
 	starpu_st_fifo_taskq_init(&data->fifo);
@@ -48,6 +61,15 @@ static void initialize_eager_center_policy(unsigned sched_ctx_id)
 	STARPU_PTHREAD_MUTEX_INIT(&data->policy_mutex, NULL);
 }
 
+static void initialize_leager_policy(unsigned sched_ctx_id)
+{
+	initialize_eager_center_policy(sched_ctx_id);
+
+	struct _starpu_eager_center_policy_data *data = (struct _starpu_eager_center_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	int window = starpu_getenv_number_default("STARPU_SCHED_LEAGER_WINDOW", 8);
+	data->window = window < 1 ? 1 : window;
+}
+
 static void deinitialize_eager_center_policy(unsigned sched_ctx_id)
 {
 	struct _starpu_eager_center_policy_data *data = (struct _starpu_eager_center_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
@@ -55,6 +77,18 @@ static void deinitialize_eager_center_policy(unsigned sched_ctx_id)
 
 	STARPU_ASSERT(starpu_task_list_empty(&fifo->taskq));
 
+	if (data->window && starpu_getenv_number_default("STARPU_SCHED_LEAGER_STATS", 0))
+	{
+		_STARPU_DISP("leager (sched_ctx %u): %lu tasks, %lu (%.1f%%) not taken in queue order, %lu bytes to fetch instead of %lu with eager (%lu bytes avoided)\n",
+			     sched_ctx_id,
+			     data->ntasks_popped,
+			     data->ntasks_reordered,
+			     data->ntasks_popped ? (100.0*data->ntasks_reordered)/data->ntasks_popped : 0.,
+			     data->fetched_bytes,
+			     data->eager_bytes,
+			     data->eager_bytes - data->fetched_bytes);
+	}
+
 	STARPU_PTHREAD_MUTEX_DESTROY(&data->policy_mutex);
 	free(data);
 }
@@ -133,6 +167,56 @@ static int push_task_eager_policy(struct starpu_task *task)
 	return 0;
 }
 
+/* Pick, among the first data->window tasks that workerid can execute, the
+ * one which has the fewest bytes to fetch to the memory node of workerid.
+ * Must be called with the policy mutex held. */
+static struct starpu_task *pop_task_locality(struct _starpu_eager_center_policy_data *data, unsigned workerid)
+{
+	struct starpu_st_fifo_taskq *fifo = &data->fifo;
+	struct starpu_task *task, *best = NULL;
+	unsigned nimpl, best_nimpl = 0;
+	size_t best_non_ready = SIZE_MAX, first_non_ready = 0;
+	unsigned n = 0;
+
+	for (task  = starpu_task_list_begin(&fifo->taskq);
+	     task != starpu_task_list_end(&fifo->taskq) && n < data->window;
+	     task  = starpu_task_list_next(task))
+	{
+		if (!starpu_worker_can_execute_task_first_impl(workerid, task, &nimpl))
+			continue;
+
+		size_t non_ready, non_loading, non_allocated;
+		starpu_st_non_ready_buffers_size(task, workerid, &non_ready, &non_loading, &non_allocated);
+		if (n++ == 0)
+			first_non_ready = non_ready;
+
+		if (non_ready < best_non_ready)
+		{
+			best = task;
+			best_nimpl = nimpl;
+			best_non_ready = non_ready;
+			if (non_ready == 0)
+				/* Can not do better */
+				break;
+		}
+	}
+
+	if (!best)
+		return NULL;
+
+	starpu_task_set_implementation(best, best_nimpl);
+	starpu_task_list_erase(&fifo->taskq, best);
+	fifo->ntasks--;
+
+	data->ntasks_popped++;
+	if (best_non_ready != first_non_ready)
+		data->ntasks_reordered++;
+	data->eager_bytes += first_non_ready;
+	data->fetched_bytes += best_non_ready;
+
+	return best;
+}
+
 static struct starpu_task *pop_task_eager_policy(unsigned sched_ctx_id)
 {
 	struct starpu_task *chosen_task = NULL;
@@ -159,7 +243,10 @@ static struct starpu_task *pop_task_eager_policy(unsigned sched_ctx_id)
 	STARPU_PTHREAD_MUTEX_LOCK(&data->policy_mutex);
 	starpu_worker_relax_off();
 
-	chosen_task = starpu_st_fifo_taskq_pop_task(&data->fifo, workerid);
+	if (data->window)
+		chosen_task = pop_task_locality(data, workerid);
+	else
+		chosen_task = starpu_st_fifo_taskq_pop_task(&data->fifo, workerid);
 	if (!chosen_task)
 		/* Tell pushers that we are waiting for tasks for us */
 		starpu_bitmap_set(&data->waiters, workerid);
@@ -208,3 +295,18 @@ struct starpu_sched_policy _starpu_sched_eager_policy =
 	.policy_description = "eager policy with a central queue",
 	.worker_type = STARPU_WORKER_LIST,
 };
+
+struct starpu_sched_policy _starpu_sched_leager_policy =
+{
+	.init_sched = initialize_leager_policy,
+	.deinit_sched = deinitialize_eager_center_policy,
+	.add_workers = eager_add_workers,
+	.remove_workers = NULL,
+	.push_task = push_task_eager_policy,
+	.pop_task = pop_task_eager_policy,
+	.pre_exec_hook = NULL,
+	.post_exec_hook = NULL,
+	.policy_name = "leager",
+	.policy_description = "eager policy with a central queue, favouring tasks whose data is local",
+	.worker_type = STARPU_WORKER_LIST,
+};
@@ -38,6 +38,7 @@
 #include <sched_policies/prio_deque.h>
 #include <limits.h>
 #include <errno.h>
+#include <math.h>
 
 #ifndef DBL_MIN
 #define DBL_MIN __DBL_MIN__
@@ -374,6 +375,12 @@ struct _starpu_heteroprio_data
 	// 1 = if a task has no implementation on arch, expected time will be the shortest time among all archs
 	unsigned autoheteroprio_time_estimation_policy;
 
+	// if set to 1: use the codelets' performance models to estimate execution times until
+	// enough executions have been measured
+	unsigned autoheteroprio_use_perfmodels;
+	// a worker of each arch in the context, used to query performance models, -1 if none
+	int arch_worker[STARPU_NB_TYPES];
+
 
 	// environment hyperparameters
 
@@ -435,6 +442,11 @@ struct _starpu_heteroprio_data
 	// true if we have at least one sample to compute the average execution time
 	unsigned prio_arch_has_time_info[STARPU_NB_TYPES][HETEROPRIO_MAX_PRIO];
 
+	// average execution time for each arch, as predicted by the performance models
+	double prio_model_time_arch[STARPU_NB_TYPES][HETEROPRIO_MAX_PRIO];
+	// sample size of predicted execution times
+	unsigned prio_model_time_arch_count[STARPU_NB_TYPES][HETEROPRIO_MAX_PRIO];
+
 	// proportion of each task during execution (sum of each prio should equal 1)
 	double prio_overall_proportion[HETEROPRIO_MAX_PRIO];
 	// sample size (number of added tasks of a type)
@@ -1414,6 +1426,9 @@ static void initialize_heteroprio_policy(unsigned sched_ctx_id)
 	struct _starpu_heteroprio_data *hp;
 	_STARPU_MALLOC(hp, sizeof(struct _starpu_heteroprio_data));
 	memset(hp, 0, sizeof(*hp));
+	unsigned arch_type;
+	for(arch_type = 0; arch_type < STARPU_NB_TYPES; ++arch_type)
+		hp->arch_worker[arch_type] = -1;
 
 	hp->use_locality = use_la_mode = starpu_getenv_number_default("STARPU_HETEROPRIO_USE_LA", 0);
 	_STARPU_MSG("[HETEROPRIO] Data locality : %s\n", hp->use_locality?"ENABLED":"DISABLED");
@@ -1456,6 +1471,9 @@ static void initialize_heteroprio_policy(unsigned sched_ctx_id)
 		_STARPU_MSG("[AUTOHETEROPRIO] Print on update : %s\n", hp->autoheteroprio_print_data_on_update?"ENABLED":"DISABLED");
 
 		hp->autoheteroprio_time_estimation_policy = starpu_getenv_number_default("STARPU_AUTOHETEROPRIO_TIME_ESTIMATION_POLICY", 0);
+
+		hp->autoheteroprio_use_perfmodels = starpu_getenv_number_default("STARPU_AUTOHETEROPRIO_USE_PERFMODELS", 1);
+		_STARPU_MSG("[AUTOHETEROPRIO] Use performance models : %s\n", hp->autoheteroprio_use_perfmodels?"ENABLED":"DISABLED");
 	}
 
 	starpu_bitmap_init(&hp->waiters);
@@ -1856,6 +1874,8 @@ static void add_workers_heteroprio_policy(unsigned sched_ctx_id, int *workerids,
 		hp->workers_heteroprio[workerid].arch_index = arch_index;
 		hp->workers_heteroprio[workerid].arch_type = starpu_heteroprio_types_to_arch(arch_index);
 		hp->nb_workers_per_arch_index[hp->workers_heteroprio[workerid].arch_index]++;
+		if(hp->arch_worker[arch_index] < 0)
+			hp->arch_worker[arch_index] = workerid;
 
 		hp->last_hook_exec_time[workerid] = now;
 	}
@@ -1864,17 +1884,44 @@ static void add_workers_heteroprio_policy(unsigned sched_ctx_id, int *workerids,
 static void remove_workers_heteroprio_policy(unsigned sched_ctx_id, int *workerids, unsigned nworkers)
 {
 	struct _starpu_heteroprio_data *hp = (struct _starpu_heteroprio_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	unsigned i;
 
 	if(!hp->use_locality)
 	{
-		unsigned i;
-
 		for (i = 0; i < nworkers; i++)
 		{
 			int workerid = workerids[i];
 			starpu_st_prio_deque_destroy(&hp->workers_heteroprio[workerid].tasks_queue);
 		}
 	}
+
+	// forget the removed workers used to query the performance models
+	for (i = 0; i < nworkers; i++)
+	{
+		int workerid = workerids[i];
+		unsigned arch_index = hp->workers_heteroprio[workerid].arch_index;
+		if(hp->arch_worker[arch_index] == workerid)
+			hp->arch_worker[arch_index] = -1;
+	}
+
+	// pick other workers of the archs which lost theirs
+	int workerid;
+	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
+	struct starpu_sched_ctx_iterator it;
+	workers->init_iterator(workers, &it);
+	while(workers->has_next(workers, &it))
+	{
+		workerid = workers->get_next(workers, &it);
+		unsigned j, removed = 0;
+		for (j = 0; j < nworkers; j++)
+			if (workerids[j] == workerid)
+				removed = 1;
+		if(removed)
+			continue;
+		unsigned arch_index = hp->workers_heteroprio[workerid].arch_index;
+		if(hp->arch_worker[arch_index] < 0)
+			hp->arch_worker[arch_index] = workerid;
+	}
 }
 
 static unsigned get_best_mem_node(struct starpu_task *task, struct _starpu_heteroprio_data *hp, const enum laheteroprio_push_strategy pushStrategy)
@@ -2212,6 +2259,12 @@ static double get_autoheteroprio_arch_busy_proportion(struct _starpu_heteroprio_
 
 static double get_autoheteroprio_estimated_time(struct _starpu_heteroprio_data *hp, unsigned priority, unsigned arch)
 {
+	if(hp->prio_model_time_arch_count[arch][priority] > 0
+	   && hp->prio_average_time_arch_count[arch][priority] < AUTOHETEROPRIO_RELEVANT_SAMPLE_SIZE)
+	{ // not enough measurements yet, trust the performance model instead
+		return hp->prio_model_time_arch[arch][priority];
+	}
+
 	if(hp->prio_arch_has_time_info[arch][priority])
 	{
 		return hp->prio_average_time_arch[arch][priority];
@@ -2604,9 +2657,11 @@ static void order_priorities(struct _starpu_heteroprio_data *hp)
 					prio_arch[a][prio].score = 0;
 				}
 
-				if(!hp->freeze_data_gathering && hp->prio_average_time_arch_count[a][p] < AUTOHETEROPRIO_RELEVANT_SAMPLE_SIZE)
+				if(!hp->freeze_data_gathering && hp->prio_average_time_arch_count[a][p] < AUTOHETEROPRIO_RELEVANT_SAMPLE_SIZE
+				   && hp->prio_model_time_arch_count[a][p] == 0)
 				{
-					// if we dont have enough data on execution time, we push execution on it by increasing the score
+					// if we dont have enough data on execution time, and no estimation from the
+					// performance model either, we push execution on it by increasing the score
 					prio_arch[a][prio].score += 99999999.;
 				}
 			}
@@ -2988,6 +3043,50 @@ static void register_execution_time(struct _starpu_heteroprio_data *hp, unsigned
 	hp->prio_arch_has_time_info[arch][task_priority] = 1;
 }
 
+// record the execution time predicted by the performance model of the task, for each arch
+// which does not have enough measured execution times yet
+static void register_model_times(struct _starpu_heteroprio_data *hp, struct starpu_task *task, unsigned task_priority, unsigned sched_ctx_id)
+{
+	STARPU_ASSERT(!hp->freeze_data_gathering);
+
+	if(!task->cl->model)
+		return;
+
+	unsigned arch;
+	for(arch = 0; arch < STARPU_NB_TYPES; ++arch)
+	{
+		if(hp->arch_worker[arch] < 0
+		   || !arch_can_execute_prio(hp, arch, task_priority)
+		   || hp->prio_average_time_arch_count[arch][task_priority] >= AUTOHETEROPRIO_RELEVANT_SAMPLE_SIZE)
+			continue;
+
+		// take the best implementation for this arch
+		double best_length = DBL_MAX;
+		unsigned nimpl;
+		for(nimpl = 0; nimpl < STARPU_MAXIMPLEMENTATIONS; nimpl++)
+		{
+			if(!starpu_worker_can_execute_task(hp->arch_worker[arch], task, nimpl))
+				continue;
+			double length = starpu_task_worker_expected_length(task, hp->arch_worker[arch], sched_ctx_id, nimpl);
+			if(!isnan(length) && length > 0. && length < best_length)
+				best_length = length;
+		}
+		if(best_length == DBL_MAX)
+			// model not calibrated yet
+			continue;
+
+		if(hp->prio_model_time_arch_count[arch][task_priority] < AUTOHETEROPRIO_RELEVANT_TASK_LIFE)
+		{
+			++hp->prio_model_time_arch_count[arch][task_priority];
+		}
+
+		const unsigned count = hp->prio_model_time_arch_count[arch][task_priority];
+
+		hp->prio_model_time_arch[arch][task_priority] = hp->prio_model_time_arch[arch][task_priority] * (double)(count - 1) / (double)count
+						+ best_length / (double)count;
+	}
+}
+
 static inline unsigned get_total_submitted_task_num(struct _starpu_heteroprio_data *hp)
 {
 	unsigned total = 0;
@@ -3255,6 +3354,9 @@ the HETEROPRIO_USE_LA variable to 0, or calling starpu_laheteroprio_map_wgroup_m
 				// register that the task has been submitted
 				add_submitted_task_to_data(hp, task_priority);
 
+				if(hp->autoheteroprio_use_perfmodels)
+					register_model_times(hp, task, task_priority, sched_ctx_id);
+
 				double NOD = get_job_NOD(hp, job);
 				add_NOD_to_data(hp, task_priority, NOD);
 
@@ -0,0 +1,375 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ *	MultiQueue policy: a relaxed concurrent priority queue.
+ *
+ *	Instead of a single central priority queue, we use factor*nworkers
+ *	sequential priority queues. A task is pushed to a random queue, and a
+ *	worker pops from the best of the heads of two random queues. This
+ *	trades strict priority order for scalability.
+ *
+ *	Each queue is attached to the memory node of a worker, and both push and
+ *	pop are biased towards the queues attached to the memory node of the
+ *	calling worker, to keep data on the same NUMA node.
+ */
+
+#include <starpu.h>
+#include <starpu_scheduler.h>
+#include <schedulers/starpu_scheduler_toolbox.h>
+#include <starpu_rand.h>
+
+#include <limits.h>
+#include <time.h>
+
+#include <core/workers.h>
+#include <sched_policies/prio_deque.h>
+
+/* Number of random two-choice attempts before scanning all queues */
+#define MULTIQUEUE_POP_TRIES 4
+
+struct _starpu_multiqueue_queue
+{
+	char fill1[STARPU_CACHELINE_SIZE];
+	starpu_pthread_mutex_t mutex;
+	struct starpu_st_prio_deque taskq;
+	/* Priority of the first task of taskq, only meaningful when
+	 * taskq.ntasks is not 0. This is read without the mutex to choose
+	 * between two queues */
+	int top_priority;
+	/* Memory node of the worker this queue is attached to */
+	unsigned memory_node;
+	char fill2[STARPU_CACHELINE_SIZE];
+};
+
+struct _starpu_multiqueue_per_worker
+{
+	char fill1[STARPU_CACHELINE_SIZE];
+	unsigned short xsubi[3];
+	starpu_drand48_data randbuffer;
+	char fill2[STARPU_CACHELINE_SIZE];
+};
+
+struct _starpu_multiqueue_data
+{
+	unsigned nqueues;
+	struct _starpu_multiqueue_queue *queues;
+	/* Total number of queued tasks, to avoid scanning empty queues */
+	unsigned ntasks;
+
+	/* Indexes of all queues, and of the queues attached to each memory node */
+	unsigned *all_queues;
+	unsigned *node_queues[STARPU_MAXNODES];
+	unsigned node_nqueues[STARPU_MAXNODES];
+
+	/* Percentage of operations restricted to the queues of the memory
+	 * node of the calling worker */
+	unsigned locality;
+
+	struct _starpu_multiqueue_per_worker *per_worker;
+};
+
+static unsigned multiqueue_random(struct _starpu_multiqueue_data *data, int workerid, unsigned n)
+{
+	double r;
+	if (workerid < 0)
+		r = starpu_drand48();
+	else
+	{
+		struct _starpu_multiqueue_per_worker *w = &data->per_worker[workerid];
+		starpu_erand48_r(w->xsubi, &w->randbuffer, &r);
+	}
+	unsigned ret = r * n;
+	return ret < n ? ret : n - 1;
+}
+
+/* Return the set of queues the calling worker should pick from */
+static unsigned multiqueue_candidates(struct _starpu_multiqueue_data *data, int workerid, unsigned **candidates)
+{
+	if (workerid >= 0 && data->locality && multiqueue_random(data, workerid, 100) < data->locality)
+	{
+		unsigned node = starpu_worker_get_memory_node(workerid);
+		if (data->node_nqueues[node])
+		{
+			*candidates = data->node_queues[node];
+			return data->node_nqueues[node];
+		}
+	}
+	*candidates = data->all_queues;
+	return data->nqueues;
+}
+
+/* Must be called with the queue mutex held */
+static void multiqueue_update_top(struct _starpu_multiqueue_queue *queue)
+{
+	struct starpu_task *top = starpu_st_prio_deque_highest_task(&queue->taskq);
+	if (top)
+		queue->top_priority = top->priority;
+}
+
+/* Must be called with the queue mutex held */
+static struct starpu_task *multiqueue_pop_locked(struct _starpu_multiqueue_data *data, struct _starpu_multiqueue_queue *queue, unsigned workerid)
+{
+	struct starpu_task *skipped;
+	struct starpu_task *task = starpu_st_prio_deque_pop_task_for_worker(&queue->taskq, workerid, &skipped);
+	if (task)
+	{
+		(void) STARPU_ATOMIC_ADD(&data->ntasks, -1);
+		multiqueue_update_top(queue);
+	}
+	return task;
+}
+
+static void initialize_multiqueue_policy(unsigned sched_ctx_id)
+{
+	struct _starpu_multiqueue_data *data;
+	_STARPU_CALLOC(data, 1, sizeof(struct _starpu_multiqueue_data));
+
+	unsigned nw = starpu_worker_get_count();
+	int factor = starpu_getenv_number_default("STARPU_SCHED_MULTIQUEUE_FACTOR", 2);
+	if (factor < 1)
+		factor = 1;
+	int locality = starpu_getenv_number_default("STARPU_SCHED_MULTIQUEUE_LOCALITY", 75);
+	if (locality < 0)
+		locality = 0;
+	if (locality > 100)
+		locality = 100;
+	data->locality = locality;
+
+	data->nqueues = factor * nw;
+	_STARPU_CALLOC(data->queues, data->nqueues, sizeof(struct _starpu_multiqueue_queue));
+	_STARPU_MALLOC(data->all_queues, data->nqueues * sizeof(unsigned));
+
+	unsigned i;
+	for (i = 0; i < data->nqueues; i++)
+	{
+		struct _starpu_multiqueue_queue *queue = &data->queues[i];
+		STARPU_PTHREAD_MUTEX_INIT(&queue->mutex, NULL);
+		starpu_st_prio_deque_init(&queue->taskq);
+		/* Tell helgrind that it's fine to check for empty queue and
+		 * head priority without actual mutex, this is just a hint */
+		STARPU_HG_DISABLE_CHECKING(queue->taskq.ntasks);
+		STARPU_HG_DISABLE_CHECKING(queue->top_priority);
+		queue->memory_node = starpu_worker_get_memory_node(i % nw);
+		data->all_queues[i] = i;
+		data->node_nqueues[queue->memory_node]++;
+	}
+	STARPU_HG_DISABLE_CHECKING(data->ntasks);
+
+	unsigned node;
+	for (node = 0; node < STARPU_MAXNODES; node++)
+	{
+		if (!data->node_nqueues[node])
+			continue;
+		_STARPU_MALLOC(data->node_queues[node], data->node_nqueues[node] * sizeof(unsigned));
+		data->node_nqueues[node] = 0;
+	}
+	for (i = 0; i < data->nqueues; i++)
+	{
+		node = data->queues[i].memory_node;
+		data->node_queues[node][data->node_nqueues[node]++] = i;
+	}
+
+	_STARPU_CALLOC(data->per_worker, nw, sizeof(struct _starpu_multiqueue_per_worker));
+	long seed = time(NULL);
+	for (i = 0; i < nw; i++)
+	{
+		struct _starpu_multiqueue_per_worker *w = &data->per_worker[i];
+		starpu_srand48_r(seed, &w->randbuffer);
+		w->xsubi[0] = starpu_seed(seed) & 0xffff;
+		w->xsubi[1] = (starpu_seed(seed) >> 16) & 0xffff;
+		w->xsubi[2] = i;
+	}
+
+	starpu_sched_ctx_set_policy_data(sched_ctx_id, (void*)data);
+
+	/* The application may use any integer */
+	if (starpu_sched_ctx_min_priority_is_set(sched_ctx_id) == 0)
+		starpu_sched_ctx_set_min_priority(sched_ctx_id, INT_MIN);
+	if (starpu_sched_ctx_max_priority_is_set(sched_ctx_id) == 0)
+		starpu_sched_ctx_set_max_priority(sched_ctx_id, INT_MAX);
+}
+
+static void deinitialize_multiqueue_policy(unsigned sched_ctx_id)
+{
+	struct _starpu_multiqueue_data *data = (struct _starpu_multiqueue_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	unsigned i;
+
+	for (i = 0; i < data->nqueues; i++)
+	{
+		starpu_st_prio_deque_destroy(&data->queues[i].taskq);
+		STARPU_PTHREAD_MUTEX_DESTROY(&data->queues[i].mutex);
+	}
+	for (i = 0; i < STARPU_MAXNODES; i++)
+		free(data->node_queues[i]);
+	free(data->all_queues);
+	free(data->queues);
+	free(data->per_worker);
+	free(data);
+}
+
+static int multiqueue_push_task(struct starpu_task *task)
+{
+	unsigned sched_ctx_id = task->sched_ctx;
+	struct _starpu_multiqueue_data *data = (struct _starpu_multiqueue_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	int workerid = starpu_worker_get_id();
+	unsigned *candidates;
+	unsigned ncandidates = multiqueue_candidates(data, workerid, &candidates);
+	struct _starpu_multiqueue_queue *queue = &data->queues[candidates[multiqueue_random(data, workerid, ncandidates)]];
+
+	starpu_worker_relax_on();
+	STARPU_PTHREAD_MUTEX_LOCK(&queue->mutex);
+	starpu_worker_relax_off();
+	starpu_st_prio_deque_push_back_task(&queue->taskq, task);
+	multiqueue_update_top(queue);
+	(void) STARPU_ATOMIC_ADD(&data->ntasks, 1);
+
+	if (_starpu_get_nsched_ctxs() > 1)
+	{
+		starpu_worker_relax_on();
+		_starpu_sched_ctx_lock_write(sched_ctx_id);
+		starpu_worker_relax_off();
+		starpu_sched_ctx_list_task_counters_increment_all_ctx_locked(task, sched_ctx_id);
+		_starpu_sched_ctx_unlock_write(sched_ctx_id);
+	}
+
+	starpu_push_task_end(task);
+
+#if !defined(STARPU_NON_BLOCKING_DRIVERS) || defined(STARPU_SIMGRID)
+	/* Record which workers can run it while we still hold the task */
+	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
+	struct starpu_sched_ctx_iterator it;
+	char dowake[STARPU_NMAXWORKERS] = { 0 };
+
+	workers->init_iterator_for_parallel_tasks(workers, &it, task);
+	while(workers->has_next(workers, &it))
+	{
+		unsigned worker = workers->get_next(workers, &it);
+		if (starpu_worker_can_execute_task_first_impl(worker, task, NULL))
+			dowake[worker] = 1;
+	}
+#endif
+	/* Let the task free */
+	STARPU_PTHREAD_MUTEX_UNLOCK(&queue->mutex);
+
+#if !defined(STARPU_NON_BLOCKING_DRIVERS) || defined(STARPU_SIMGRID)
+	/* Any woken worker scans all queues before sleeping again, so
+	 * waking a single one is enough */
+	workers->init_iterator(workers, &it);
+	while(workers->has_next(workers, &it))
+	{
+		unsigned worker = workers->get_next(workers, &it);
+		if (dowake[worker])
+			if (starpu_wake_worker_relax_light(worker))
+				break;
+	}
+#endif
+
+	return 0;
+}
+
+static struct starpu_task *multiqueue_pop_task(unsigned sched_ctx_id)
+{
+	struct _starpu_multiqueue_data *data = (struct _starpu_multiqueue_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	unsigned workerid = starpu_worker_get_id_check();
+	struct starpu_task *task = NULL;
+	unsigned try;
+
+	if (!STARPU_RUNNING_ON_VALGRIND && data->ntasks == 0)
+		return NULL;
+
+	for (try = 0; try < MULTIQUEUE_POP_TRIES && !task; try++)
+	{
+		unsigned *candidates;
+		unsigned ncandidates = multiqueue_candidates(data, workerid, &candidates);
+		struct _starpu_multiqueue_queue *queue = &data->queues[candidates[multiqueue_random(data, workerid, ncandidates)]];
+		struct _starpu_multiqueue_queue *other = &data->queues[candidates[multiqueue_random(data, workerid, ncandidates)]];
+
+		/* Pick the queue with the best head, without locking */
+		if (other->taskq.ntasks && (!queue->taskq.ntasks || other->top_priority > queue->top_priority))
+			queue = other;
+		if (!queue->taskq.ntasks)
+			continue;
+
+		if (STARPU_PTHREAD_MUTEX_TRYLOCK(&queue->mutex))
+			/* Somebody else is working on it, rather try other queues */
+			continue;
+		task = multiqueue_pop_locked(data, queue, workerid);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&queue->mutex);
+	}
+
+	if (!task)
+	{
+		/* Random tries failed, scan all queues to make sure not to
+		 * leave a task behind before going to sleep */
+		unsigned start = multiqueue_random(data, workerid, data->nqueues);
+		unsigned i;
+		for (i = 0; i < data->nqueues && !task; i++)
+		{
+			struct _starpu_multiqueue_queue *queue = &data->queues[(start + i) % data->nqueues];
+			if (!STARPU_RUNNING_ON_VALGRIND && !queue->taskq.ntasks)
+				continue;
+			starpu_worker_relax_on();
+			STARPU_PTHREAD_MUTEX_LOCK(&queue->mutex);
+			starpu_worker_relax_off();
+			task = multiqueue_pop_locked(data, queue, workerid);
+			STARPU_PTHREAD_MUTEX_UNLOCK(&queue->mutex);
+		}
+	}
+
+	if (task && _starpu_get_nsched_ctxs() > 1)
+	{
+		starpu_worker_relax_on();
+		_starpu_sched_ctx_lock_write(sched_ctx_id);
+		starpu_worker_relax_off();
+		starpu_sched_ctx_list_task_counters_decrement_all_ctx_locked(task, sched_ctx_id);
+
+		if (_starpu_sched_ctx_worker_is_master_for_child_ctx(sched_ctx_id, workerid, task))
+			task = NULL;
+
+		_starpu_sched_ctx_unlock_write(sched_ctx_id);
+	}
+
+	return task;
+}
+
+static void multiqueue_add_workers(unsigned sched_ctx_id, int *workerids, unsigned nworkers)
+{
+	unsigned i;
+	for (i = 0; i < nworkers; i++)
+	{
+		int workerid = workerids[i];
+		int curr_workerid = _starpu_worker_get_id();
+		if(workerid != curr_workerid)
+			starpu_wake_worker_locked(workerid);
+
+		starpu_sched_ctx_worker_shares_tasks_lists(workerid, sched_ctx_id);
+	}
+}
+
+struct starpu_sched_policy _starpu_sched_multiqueue_policy =
+{
+	.add_workers = multiqueue_add_workers,
+	.init_sched = initialize_multiqueue_policy,
+	.deinit_sched = deinitialize_multiqueue_policy,
+	.push_task = multiqueue_push_task,
+	.pop_task = multiqueue_pop_task,
+	.pre_exec_hook = NULL,
+	.post_exec_hook = NULL,
+	.policy_name = "multiqueue",
+	.policy_description = "relaxed priority queues, pops the best of two random queues",
+	.worker_type = STARPU_WORKER_LIST,
+};
@@ -0,0 +1,171 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <math.h>
+#include "../helper.h"
+
+/*
+ * Point STARPU_RAPL_PATH at a fake powercap tree with a single package
+ * domain, whose energy counter is advanced by the tasks themselves, and check
+ * the energy charged to them, including when the counter wraps around.
+ */
+
+#if !defined(STARPU_HAVE_SETENV) || defined(STARPU_HAVE_WINDOWS) || !defined(STARPU_USE_CPU)
+#warning setenv is not defined or no cpu are available. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static char domain[256];
+
+static void write_file(const char *name, unsigned long long value)
+{
+	char path[512];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/%s", domain, name);
+	f = fopen(path, "w");
+	STARPU_ASSERT_MSG(f, "cannot create %s\n", path);
+	fprintf(f, "%llu\n", value);
+	fclose(f);
+}
+
+/* Move the energy counter to the value given as argument */
+static void func(void *buffers[], void *args)
+{
+	(void) buffers;
+	write_file("energy_uj", (unsigned long long)(uintptr_t) args);
+}
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = {func},
+	.nbuffers = 0,
+};
+
+/* Run a task which moves the counter to value, and return the energy it was
+ * charged */
+static double run_task(unsigned long long value)
+{
+	struct starpu_task *task = starpu_task_create();
+	double energy;
+	int ret;
+
+	task->cl = &cl;
+	task->cl_arg = (void*)(uintptr_t) value;
+	task->synchronous = 1;
+	task->destroy = 0;
+	ret = starpu_task_submit(task);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+
+	energy = task->profiling_info->energy_consumed;
+	starpu_task_destroy(task);
+	return energy;
+}
+
+/* Start the counter at start, run a first task which consumes 2J, and a
+ * second one which makes the counter wrap around to 1J. Return -1 if StarPU
+ * could not be initialized */
+static int run(unsigned long long start, double *before_wrap, double *after_wrap)
+{
+	int ret;
+
+	write_file("energy_uj", start);
+
+	ret = starpu_initialize(NULL, NULL, NULL);
+	if (ret == -ENODEV)
+		return -1;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+	if (starpu_cpu_worker_get_count() != 1)
+	{
+		starpu_shutdown();
+		return -1;
+	}
+	starpu_profiling_status_set(STARPU_PROFILING_ENABLE);
+
+	*before_wrap = run_task(start + 2000000);
+	*after_wrap = run_task(1000000);
+
+	starpu_shutdown();
+	return 0;
+}
+
+int main(void)
+{
+	char s[128];
+	char path[512];
+	double before_wrap, after_wrap;
+	int ret = EXIT_SUCCESS;
+
+	snprintf(s, sizeof(s), "/tmp/%s-rapl-XXXXXX", getenv("USER"));
+	if (!_starpu_mkdtemp(s))
+	{
+		FPRINTF(stderr, "Cannot make directory '%s'\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+	snprintf(domain, sizeof(domain), "%s/intel-rapl:0", s);
+	mkdir(domain, 0755);
+	snprintf(path, sizeof(path), "%s/name", domain);
+	FILE *f = fopen(path, "w");
+	STARPU_ASSERT(f);
+	fprintf(f, "package-0\n");
+	fclose(f);
+
+	setenv("STARPU_RAPL", "1", 1);
+	setenv("STARPU_RAPL_PATH", s, 1);
+	setenv("STARPU_NCPU", "1", 1);
+
+	/* Unknown range: the wrap can not be accounted for */
+	if (run(8000000, &before_wrap, &after_wrap))
+	{
+		ret = STARPU_TEST_SKIPPED;
+		goto out;
+	}
+	FPRINTF(stderr, "unknown range: %f J, %f J after the wrap\n", before_wrap, after_wrap);
+	if (fabs(before_wrap - 2.) > 0.001 || after_wrap != 0.)
+		ret = EXIT_FAILURE;
+
+	/* Known range of 10J: the counter wraps from 10J to 1J */
+	write_file("max_energy_range_uj", 10000000);
+	if (run(8000000, &before_wrap, &after_wrap))
+	{
+		ret = STARPU_TEST_SKIPPED;
+		goto out;
+	}
+	FPRINTF(stderr, "known range: %f J, %f J after the wrap\n", before_wrap, after_wrap);
+	if (fabs(before_wrap - 2.) > 0.001 || fabs(after_wrap - 1.) > 0.001)
+		ret = EXIT_FAILURE;
+
+out:
+	snprintf(path, sizeof(path), "%s/max_energy_range_uj", domain);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/energy_uj", domain);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/name", domain);
+	unlink(path);
+	rmdir(domain);
+	rmdir(s);
+	return ret;
+}
+
+#endif
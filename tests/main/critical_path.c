@@ -0,0 +1,193 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Run a chain of tasks with task dependencies, and then a fork-join with tag
+ * dependencies, with STARPU_CRITICAL_PATH set. The tasks last a known
+ * duration, so that the critical path reported at shutdown has to be at
+ * least the length of the longest chain of tasks, and the efficiency can not
+ * be above 100%.
+ */
+
+#if !defined(STARPU_HAVE_SETENV) || defined(STARPU_HAVE_WINDOWS)
+#warning setenv is not defined or the standard error can not be redirected. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NCHAIN 10
+#define NFORK 4
+/* In us */
+#define DURATION 2000
+
+void func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+	starpu_usleep(DURATION);
+}
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = {func},
+	.nbuffers = 0,
+};
+
+static int submit_chain(void)
+{
+	struct starpu_task *tasks[NCHAIN];
+	unsigned i;
+	int ret;
+
+	/* The dependencies have to be declared before submitting the
+	 * previous task */
+	for (i = 0; i < NCHAIN; i++)
+	{
+		tasks[i] = starpu_task_create();
+		tasks[i]->cl = &cl;
+		if (i > 0)
+			starpu_task_declare_deps(tasks[i], 1, tasks[i-1]);
+	}
+	for (i = 0; i < NCHAIN; i++)
+	{
+		ret = starpu_task_submit(tasks[i]);
+		if (ret)
+		{
+			/* Submitting the following ones would fail the same way */
+			for ( ; i < NCHAIN; i++)
+				starpu_task_destroy(tasks[i]);
+			return ret;
+		}
+	}
+	return 0;
+}
+
+static int submit_fork_join(void)
+{
+	starpu_tag_t fork_tags[NFORK];
+	unsigned i;
+	int ret;
+
+	/* The fork task is tag 0, the forked tasks 1 to NFORK, the join
+	 * task NFORK+1 */
+	for (i = 0; i < NFORK; i++)
+	{
+		fork_tags[i] = i + 1;
+		starpu_tag_declare_deps(fork_tags[i], 1, (starpu_tag_t) 0);
+	}
+	starpu_tag_declare_deps_array(NFORK + 1, NFORK, fork_tags);
+
+	for (i = 0; i <= NFORK + 1; i++)
+	{
+		struct starpu_task *task = starpu_task_create();
+		task->cl = &cl;
+		task->use_tag = 1;
+		task->tag_id = i;
+		ret = starpu_task_submit(task);
+		if (ret)
+		{
+			starpu_task_destroy(task);
+			return ret;
+		}
+	}
+	return 0;
+}
+
+/* Run the tasks, and get the critical path and the efficiency displayed at
+ * shutdown */
+static int run(int (*submit)(void), double *critical_path, double *efficiency)
+{
+	FILE *output = tmpfile();
+	char line[256];
+	int ret, saved_stderr;
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV || !output)
+	{
+		if (output)
+			fclose(output);
+		return -ENODEV;
+	}
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	ret = submit();
+	if (ret != -ENODEV)
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	starpu_task_wait_for_all();
+
+	/* Catch the report of the shutdown */
+	fflush(stderr);
+	saved_stderr = dup(STDERR_FILENO);
+	dup2(fileno(output), STDERR_FILENO);
+	starpu_shutdown();
+	fflush(stderr);
+	dup2(saved_stderr, STDERR_FILENO);
+	close(saved_stderr);
+
+	if (ret == -ENODEV)
+	{
+		fclose(output);
+		return ret;
+	}
+
+	*critical_path = -1.;
+	*efficiency = -1.;
+	rewind(output);
+	while (fgets(line, sizeof(line), output))
+	{
+		fputs(line, stderr);
+		sscanf(line, "\tcritical path: %lf ms", critical_path);
+		sscanf(line, "\tefficiency: %lf%%", efficiency);
+	}
+	fclose(output);
+	return 0;
+}
+
+static int check(const char *name, int (*submit)(void), unsigned length)
+{
+	double critical_path, efficiency;
+	int ret = run(submit, &critical_path, &efficiency);
+
+	if (ret)
+		return ret;
+	FPRINTF(stderr, "%s: critical path %.2f ms, at least %.2f ms, efficiency %.2f%%\n", name, critical_path, length * DURATION / 1000., efficiency);
+	if (critical_path < length * DURATION / 1000. || efficiency <= 0. || efficiency > 100.)
+		return 1;
+	return 0;
+}
+
+int main(void)
+{
+	int ret;
+
+	setenv("STARPU_CRITICAL_PATH", "1", 1);
+
+	ret = check("chain", submit_chain, NCHAIN);
+	if (ret == 0)
+		ret = check("fork-join", submit_fork_join, 3);
+
+	if (ret == -ENODEV)
+		return STARPU_TEST_SKIPPED;
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
@@ -0,0 +1,167 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Record more events than the flight recorder can keep, dump it, and check
+ * that the dump contains the last events of the threads, in order.
+ */
+
+#define NTASKS 200
+#define RING_SIZE 64
+
+#define TASK_START 3
+#define TASK_END 4
+
+struct event
+{
+	double date;
+	uint32_t code;
+	int32_t workerid;
+	uint64_t params[3];
+};
+
+void dummy_func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static struct starpu_codelet flight_cl =
+{
+	.cpu_funcs = {dummy_func},
+	.cuda_funcs = {dummy_func},
+	.opencl_funcs = {dummy_func},
+	.nbuffers = 0,
+	.name = "flight",
+};
+
+static int check_dump(const char *path, unsigned *nstarts)
+{
+	FILE *f = fopen(path, "r");
+	char magic[8];
+	uint32_t mark, event_size;
+	double date;
+	uint64_t header[3];
+	struct event event;
+
+	*nstarts = 0;
+	if (!f)
+	{
+		FPRINTF(stderr, "cannot open %s\n", path);
+		return 1;
+	}
+	if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, "STPUFLR1", sizeof(magic))
+	    || fread(&mark, sizeof(mark), 1, f) != 1 || mark != 0x01020304
+	    || fread(&event_size, sizeof(event_size), 1, f) != 1 || event_size != sizeof(event)
+	    || fread(&date, sizeof(date), 1, f) != 1)
+	{
+		FPRINTF(stderr, "bogus header\n");
+		fclose(f);
+		return 1;
+	}
+
+	while (fread(header, sizeof(header), 1, f) == 1 && header[2] != 0)
+	{
+		uint64_t i, count = header[2];
+		double last = 0.;
+
+		if (count > RING_SIZE || count > header[1])
+		{
+			FPRINTF(stderr, "%lu events for %lu recorded ones\n", (unsigned long) count, (unsigned long) header[1]);
+			fclose(f);
+			return 1;
+		}
+		for (i = 0; i < count; i++)
+		{
+			if (fread(&event, sizeof(event), 1, f) != 1)
+			{
+				FPRINTF(stderr, "truncated dump\n");
+				fclose(f);
+				return 1;
+			}
+			if (event.date < last || event.date > date)
+			{
+				FPRINTF(stderr, "events out of order\n");
+				fclose(f);
+				return 1;
+			}
+			last = event.date;
+			if (event.code == TASK_START && !memcmp(&event.params[2], "flight", 6))
+				(*nstarts)++;
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
+int main(void)
+{
+	int ret, fd;
+	unsigned i, nstarts;
+	char path[] = "/tmp/starpu_flight_recorder_XXXXXX";
+
+	setenv("STARPU_FLIGHT_RECORDER", "64", 1);
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	fd = mkstemp(path);
+	if (fd < 0)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+	close(fd);
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		ret = starpu_task_insert(&flight_cl, 0);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_task_wait_for_all();
+
+	ret = starpu_flight_recorder_dump(path);
+	if (ret == -ENODEV) goto enodev;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_flight_recorder_dump");
+
+	starpu_shutdown();
+
+	ret = check_dump(path, &nstarts);
+	unlink(path);
+	if (ret)
+		return EXIT_FAILURE;
+	if (nstarts == 0)
+	{
+		FPRINTF(stderr, "no task start was recorded\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+
+enodev:
+	starpu_shutdown();
+	unlink(path);
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	return STARPU_TEST_SKIPPED;
+}
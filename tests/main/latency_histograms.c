@@ -0,0 +1,94 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdio.h>
+#include "../helper.h"
+
+/*
+ * Run tasks which sleep for a known time, and check that the percentiles of
+ * their execution time given by the latency histograms are consistent.
+ */
+
+#define NTASKS 100
+#define SLEEP_US 1000
+
+void sleep_func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+	starpu_usleep(SLEEP_US);
+}
+
+static struct starpu_codelet latency_cl =
+{
+	.cpu_funcs = {sleep_func},
+	.nbuffers = 0,
+	.name = "latency",
+};
+
+int main(void)
+{
+	int ret, execution;
+	unsigned i;
+	const double ps[3] = { 50., 99., 99.9 };
+	double latencies[3];
+
+	setenv("STARPU_LATENCY_HISTOGRAMS", "1", 1);
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		ret = starpu_task_insert(&latency_cl, 0);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_task_wait_for_all();
+
+	for (execution = 0; execution <= 1; execution++)
+	{
+		ret = starpu_codelet_get_latency_percentiles(&latency_cl, -1, execution, 3, ps, latencies);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_codelet_get_latency_percentiles");
+		FPRINTF(stderr, "%s: p50 %f p99 %f p99.9 %f us\n", execution ? "exec" : "wait", latencies[0], latencies[1], latencies[2]);
+		if (latencies[0] > latencies[1] || latencies[1] > latencies[2])
+		{
+			FPRINTF(stderr, "percentiles are not sorted\n");
+			goto err;
+		}
+	}
+
+	/* The values are upper bounds of the buckets, and the tasks sleep at least SLEEP_US */
+	if (latencies[0] < SLEEP_US)
+	{
+		FPRINTF(stderr, "median execution time %f is below %d\n", latencies[0], SLEEP_US);
+		goto err;
+	}
+
+	starpu_shutdown();
+	return EXIT_SUCCESS;
+
+err:
+	starpu_shutdown();
+	return EXIT_FAILURE;
+
+enodev:
+	starpu_shutdown();
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	return STARPU_TEST_SKIPPED;
+}
@@ -0,0 +1,147 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Let StarPU allocate vectors in main memory, keep them all allocated, and
+ * check that the high-water mark written in the memory timeline covers them.
+ */
+
+#define NDATA 16
+#define NX 1024
+
+void write_func(void *descr[], void *arg)
+{
+	(void)arg;
+	float *v = (float *) STARPU_VECTOR_GET_PTR(descr[0]);
+	v[0] = 1.f;
+}
+
+static struct starpu_codelet timeline_cl =
+{
+	.cpu_funcs = {write_func},
+	.nbuffers = 1,
+	.modes = {STARPU_W},
+	.name = "timeline",
+};
+
+/* Return the high-water mark of the main memory node written in the file */
+static int read_high_water_mark(const char *path, unsigned long *mark)
+{
+	char line[1024];
+	FILE *f = fopen(path, "r");
+	int found = 0;
+
+	if (!f)
+	{
+		FPRINTF(stderr, "could not open %s\n", path);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), f))
+	{
+		unsigned node;
+		char name[32];
+		long limit;
+
+		if (sscanf(line, "N %u %31s %ld %lu", &node, name, &limit, mark) == 4 && node == STARPU_MAIN_RAM)
+		{
+			found = 1;
+			break;
+		}
+	}
+	fclose(f);
+	if (!found)
+	{
+		FPRINTF(stderr, "no high-water mark for the main memory in %s\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+int main(void)
+{
+	int ret, fd;
+	unsigned i;
+	unsigned long mark;
+	starpu_data_handle_t handles[NDATA];
+	char path[] = "/tmp/starpu_memory_timeline_XXXXXX";
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		return STARPU_TEST_SKIPPED;
+	close(fd);
+
+	setenv("STARPU_MEMORY_TIMELINE", "1", 1);
+	setenv("STARPU_MEMORY_TIMELINE_FILE", path, 1);
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV)
+	{
+		unlink(path);
+		return STARPU_TEST_SKIPPED;
+	}
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	for (i = 0; i < NDATA; i++)
+	{
+		starpu_vector_data_register(&handles[i], -1, 0, NX, sizeof(float));
+		ret = starpu_task_insert(&timeline_cl, STARPU_W, handles[i], 0);
+		if (ret == -ENODEV)
+		{
+			i++;
+			goto enodev;
+		}
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_task_wait_for_all();
+	/* Bring them all back to main memory */
+	for (i = 0; i < NDATA; i++)
+	{
+		ret = starpu_data_acquire(handles[i], STARPU_R);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		starpu_data_release(handles[i]);
+	}
+	for (i = 0; i < NDATA; i++)
+		starpu_data_unregister(handles[i]);
+
+	starpu_shutdown();
+
+	ret = read_high_water_mark(path, &mark);
+	unlink(path);
+	if (ret)
+		return EXIT_FAILURE;
+	FPRINTF(stderr, "high-water mark %lu bytes\n", mark);
+	if (mark < NDATA * NX * sizeof(float))
+	{
+		FPRINTF(stderr, "high-water mark %lu is below %lu\n", mark, (unsigned long) (NDATA * NX * sizeof(float)));
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+
+enodev:
+	while (i > 0)
+		starpu_data_unregister(handles[--i]);
+	starpu_shutdown();
+	unlink(path);
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	return STARPU_TEST_SKIPPED;
+}
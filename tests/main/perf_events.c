@@ -0,0 +1,140 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdio.h>
+#include "../helper.h"
+
+/*
+ * Run some computing tasks with STARPU_PERF_EVENTS set, and check that the
+ * cycles and the instructions read from the hardware counters are recorded
+ * in their profiling information.
+ */
+
+#if !defined(STARPU_HAVE_SETENV) || !defined(HAVE_LINUX_PERF_EVENT_H) || defined(STARPU_SIMGRID)
+#warning setenv or perf_event are not available. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define NTASKS 4
+#define NITER 1000000
+
+void func(void *descr[], void *arg)
+{
+	volatile double x = 1.;
+	unsigned i;
+	(void)descr;
+	(void)arg;
+
+	for (i = 0; i < NITER; i++)
+		x = x * 1.000001 + 0.000001;
+}
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = {func},
+	.nbuffers = 0,
+};
+
+/* Whether the cycles of the calling thread can be counted, like StarPU does */
+static int perf_event_available(void)
+{
+	struct perf_event_attr attr;
+	int fd;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	if (fd == -1)
+		return 0;
+	close(fd);
+	return 1;
+}
+
+int main(void)
+{
+	struct starpu_task *tasks[NTASKS];
+	int ret, err = 0;
+	unsigned i;
+
+	if (!perf_event_available())
+	{
+		FPRINTF(stderr, "could not open the hardware counters: %s\n", strerror(errno));
+		return STARPU_TEST_SKIPPED;
+	}
+
+	setenv("STARPU_PERF_EVENTS", "1", 1);
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV)
+		return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	starpu_profiling_status_set(STARPU_PROFILING_ENABLE);
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		tasks[i] = starpu_task_create();
+		tasks[i]->cl = &cl;
+		tasks[i]->destroy = 0;
+		ret = starpu_task_submit(tasks[i]);
+		if (ret == -ENODEV)
+		{
+			starpu_task_destroy(tasks[i]);
+			goto enodev;
+		}
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	}
+	starpu_task_wait_for_all();
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		struct starpu_profiling_task_info *info = tasks[i]->profiling_info;
+		FPRINTF(stderr, "task %u: %llu cycles, %llu instructions, %llu cache misses, %llu stalled cycles\n", i,
+			(unsigned long long) info->used_cycles, (unsigned long long) info->instructions,
+			(unsigned long long) info->cache_misses, (unsigned long long) info->stall_cycles);
+		/* Each iteration needs at least a few instructions */
+		if (info->used_cycles == 0 || info->instructions < NITER)
+			err = 1;
+		starpu_task_destroy(tasks[i]);
+	}
+
+	starpu_shutdown();
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+
+enodev:
+	starpu_shutdown();
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	return STARPU_TEST_SKIPPED;
+}
+#endif
@@ -0,0 +1,365 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdio.h>
+#include "../helper.h"
+
+/*
+ * Export the performance counters on a localhost TCP port, on a UNIX socket
+ * and in a shared file, run some tasks, and check that the number of
+ * submitted tasks can be read from each of them, over HTTP or not. Also
+ * check that clients which close their connection before getting the reply
+ * do not disturb the application.
+ */
+
+#if !defined(STARPU_HAVE_SETENV) || defined(STARPU_HAVE_WINDOWS) || defined(STARPU_SIMGRID)
+#warning setenv is not defined or the exporter is not supported. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define NTASKS 10
+#define METRIC "starpu_task_g_total_submitted "
+/* In ms */
+#define TIMEOUT 5000
+
+enum endpoint
+{
+	ENDPOINT_TCP,
+	ENDPOINT_UNIX,
+	ENDPOINT_UNIX_RAW,
+	ENDPOINT_SHM,
+	NENDPOINTS
+};
+
+static const char *endpoint_names[NENDPOINTS] = { "TCP port", "UNIX socket", "UNIX socket without HTTP", "shared file" };
+
+/* Layout of the beginning of the shared file */
+struct shm_header
+{
+	char magic[8];
+	uint32_t mark;
+	uint32_t pid;
+	uint64_t size;
+	uint64_t sequence;
+	uint64_t length;
+	double date;
+};
+
+static int port;
+static char socket_path[128];
+static char shm_path[128];
+
+void func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = {func},
+	.nbuffers = 0,
+};
+
+/* Find a free port on the localhost interface */
+static int find_port(void)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0)
+		return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || getsockname(fd, (struct sockaddr *) &addr, &len) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	return ntohs(addr.sin_port);
+}
+
+static int connect_endpoint(enum endpoint endpoint)
+{
+	int fd;
+
+	if (endpoint == ENDPOINT_TCP)
+	{
+		struct sockaddr_in addr;
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons(port);
+		if (fd >= 0 && connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0)
+			return fd;
+	}
+	else
+	{
+		struct sockaddr_un addr;
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, socket_path);
+		if (fd >= 0 && connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0)
+			return fd;
+	}
+	if (fd >= 0)
+		close(fd);
+	return -1;
+}
+
+/* Get the text from a socket, with or without sending an HTTP request */
+static char *fetch_socket(enum endpoint endpoint)
+{
+	static const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+	char *text = NULL;
+	size_t len = 0, size = 0;
+	int fd = connect_endpoint(endpoint);
+
+	if (fd < 0)
+		return NULL;
+	if (endpoint == ENDPOINT_UNIX_RAW)
+		/* Tell that we will not send any request */
+		shutdown(fd, SHUT_WR);
+	else if (write(fd, request, strlen(request)) != (ssize_t) strlen(request))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	while (1)
+	{
+		ssize_t ret;
+		if (size - len < 4096)
+		{
+			size = size ? 2 * size : 16384;
+			text = realloc(text, size);
+		}
+		ret = read(fd, text + len, size - len - 1);
+		if (ret <= 0)
+			break;
+		len += ret;
+	}
+	close(fd);
+	text[len] = 0;
+
+	if (endpoint == ENDPOINT_UNIX_RAW)
+		return text;
+
+	/* Check the HTTP header and skip it */
+	char *body = strstr(text, "\r\n\r\n");
+	if (strncmp(text, "HTTP/1.0 200 OK\r\n", 17) || !body)
+	{
+		FPRINTF(stderr, "bad HTTP answer from the %s: %.64s\n", endpoint_names[endpoint], text);
+		free(text);
+		return NULL;
+	}
+	memmove(text, body + 4, strlen(body + 4) + 1);
+	return text;
+}
+
+/* Connect to a socket, send the request if any, and close right away, so
+ * that the reply is sent to a closed connection */
+static int close_early(enum endpoint endpoint)
+{
+	static const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+	int fd = connect_endpoint(endpoint);
+
+	if (fd < 0)
+		return -1;
+	if (endpoint == ENDPOINT_UNIX_RAW)
+		shutdown(fd, SHUT_WR);
+	else if (write(fd, request, strlen(request)) != (ssize_t) strlen(request))
+	{
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	return 0;
+}
+
+/* Copy the text of the last sample from the shared file */
+static char *fetch_shm(void)
+{
+	struct shm_header *header;
+	char *text = NULL;
+	uint64_t sequence, size;
+	int fd = open(shm_path, O_RDONLY);
+
+	if (fd < 0)
+		return NULL;
+	header = mmap(NULL, sizeof(*header), PROT_READ, MAP_SHARED, fd, 0);
+	if (header == MAP_FAILED)
+	{
+		close(fd);
+		return NULL;
+	}
+	if (memcmp(header->magic, "STPUMET1", 8) || header->mark != 0x01020304 || header->pid != (uint32_t) getpid())
+	{
+		FPRINTF(stderr, "bad header in the shared file\n");
+		munmap(header, sizeof(*header));
+		close(fd);
+		return NULL;
+	}
+	size = header->size;
+	munmap(header, sizeof(*header));
+
+	header = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (header == MAP_FAILED)
+		return NULL;
+	while (1)
+	{
+		sequence = header->sequence;
+		STARPU_RMB();
+		if (header->size != size)
+			/* The file was extended, the caller will retry */
+			break;
+		if (sequence % 2 == 0)
+		{
+			text = malloc(header->length + 1);
+			memcpy(text, (char *) (header + 1), header->length);
+			text[header->length] = 0;
+			STARPU_RMB();
+			if (header->sequence == sequence)
+				break;
+			free(text);
+			text = NULL;
+		}
+	}
+	munmap(header, size);
+	return text;
+}
+
+/* Return the number of submitted tasks published by the endpoint, -1 if it
+ * could not be read */
+static long get_submitted(enum endpoint endpoint)
+{
+	char *text = endpoint == ENDPOINT_SHM ? fetch_shm() : fetch_socket(endpoint);
+	char *line = NULL;
+	long value = -1;
+
+	if (!text)
+		return -1;
+	if (!strncmp(text, METRIC, strlen(METRIC)))
+		line = text;
+	else if ((line = strstr(text, "\n" METRIC)))
+		line++;
+	if (line)
+		value = atol(line + strlen(METRIC));
+	free(text);
+	return value;
+}
+
+int main(void)
+{
+	char dir[] = "/tmp/starpu_perf_exporter_XXXXXX";
+	char value[16];
+	int ret, endpoint, err = 0;
+	unsigned i;
+
+	port = find_port();
+	if (port < 0 || !_starpu_mkdtemp(dir))
+		return STARPU_TEST_SKIPPED;
+	snprintf(socket_path, sizeof(socket_path), "%s/socket", dir);
+	snprintf(shm_path, sizeof(shm_path), "%s/shm", dir);
+	snprintf(value, sizeof(value), "%d", port);
+	setenv("STARPU_PERF_EXPORTER_PORT", value, 1);
+	setenv("STARPU_PERF_EXPORTER_SOCKET", socket_path, 1);
+	setenv("STARPU_PERF_EXPORTER_SHM", shm_path, 1);
+	setenv("STARPU_PERF_EXPORTER_PERIOD", "10", 1);
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV)
+	{
+		rmdir(dir);
+		return STARPU_TEST_SKIPPED;
+	}
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		ret = starpu_task_insert(&cl, 0);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_task_wait_for_all();
+
+	for (endpoint = 0; endpoint < NENDPOINTS; endpoint++)
+	{
+		long submitted;
+		int waited = 0;
+
+		/* Wait for a sample taken after the submissions */
+		while ((submitted = get_submitted(endpoint)) < NTASKS && waited++ < TIMEOUT / 10)
+			starpu_usleep(10000);
+		FPRINTF(stderr, "%s: %ld submitted tasks\n", endpoint_names[endpoint], submitted);
+		if (submitted != NTASKS)
+			err = 1;
+	}
+
+	/* A client closing early must not raise SIGPIPE, and the next ones
+	 * have to be served */
+	for (endpoint = 0; endpoint < ENDPOINT_SHM; endpoint++)
+	{
+		long submitted;
+		for (i = 0; i < 10; i++)
+			if (close_early(endpoint))
+				err = 1;
+		submitted = get_submitted(endpoint);
+		FPRINTF(stderr, "%s after early closes: %ld submitted tasks\n", endpoint_names[endpoint], submitted);
+		if (submitted != NTASKS)
+			err = 1;
+	}
+
+	starpu_shutdown();
+
+	/* Both are removed at shutdown */
+	if (access(socket_path, F_OK) == 0 || access(shm_path, F_OK) == 0)
+	{
+		FPRINTF(stderr, "the socket or the shared file was not removed\n");
+		err = 1;
+	}
+	unlink(socket_path);
+	unlink(shm_path);
+	rmdir(dir);
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+
+enodev:
+	starpu_shutdown();
+	unlink(socket_path);
+	unlink(shm_path);
+	rmdir(dir);
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	return STARPU_TEST_SKIPPED;
+}
+#endif
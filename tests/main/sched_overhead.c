@@ -0,0 +1,148 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdio.h>
+#include "../helper.h"
+
+/*
+ * Switch the measurement of the runtime overhead with the
+ * starpu.global.g_sched_overhead_knob knob, and check that the push and pop
+ * times of the workers are only reported while it is enabled.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NTASKS 100
+
+void func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static struct starpu_codelet cl =
+{
+	.cpu_funcs = {func},
+	.cuda_funcs = {func},
+	.opencl_funcs = {func},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+	.model = &starpu_perfmodel_nop,
+};
+
+/* Run a chain of tasks, so that the workers push the tasks they release */
+static int run_tasks(starpu_data_handle_t handle)
+{
+	unsigned i;
+	int ret;
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		ret = starpu_task_insert(&cl, STARPU_RW, handle, 0);
+		if (ret == -ENODEV)
+			return ret;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_task_wait_for_all();
+	return 0;
+}
+
+/* Get the push and pop times of all the workers since the previous call, in us */
+static void get_times(double *push, double *pop)
+{
+	unsigned worker;
+
+	*push = 0.;
+	*pop = 0.;
+	for (worker = 0; worker < starpu_worker_get_count(); worker++)
+	{
+		struct starpu_profiling_worker_info info;
+		int ret = starpu_profiling_worker_get_info(worker, &info);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_profiling_worker_get_info");
+		*push += starpu_timing_timespec_to_us(&info.push_time);
+		*pop += starpu_timing_timespec_to_us(&info.pop_time);
+	}
+}
+
+int main(void)
+{
+	starpu_data_handle_t handle;
+	unsigned value = 0;
+	double push, pop;
+	int ret, knob, err = 0;
+
+	/* Start disabled, time all the operations once enabled */
+	unsetenv("STARPU_SCHED_OVERHEAD");
+	setenv("STARPU_SCHED_OVERHEAD_SAMPLING", "1", 1);
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV)
+		return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	starpu_profiling_status_set(STARPU_PROFILING_ENABLE);
+	knob = starpu_perf_knob_name_to_id(starpu_perf_knob_scope_global, "starpu.global.g_sched_overhead_knob");
+	STARPU_ASSERT(starpu_perf_knob_get_global_int32_value(knob) == 0);
+
+	starpu_variable_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t)&value, sizeof(value));
+
+	ret = run_tasks(handle);
+	if (ret == -ENODEV) goto enodev;
+	get_times(&push, &pop);
+	FPRINTF(stderr, "disabled: push %f us, pop %f us\n", push, pop);
+	if (push != 0. || pop != 0.)
+		err = 1;
+
+	starpu_perf_knob_set_global_int32_value(knob, 1);
+	STARPU_ASSERT(starpu_perf_knob_get_global_int32_value(knob) == 1);
+	ret = run_tasks(handle);
+	if (ret == -ENODEV) goto enodev;
+	get_times(&push, &pop);
+	FPRINTF(stderr, "enabled: push %f us, pop %f us\n", push, pop);
+	if (push == 0. || pop == 0.)
+		err = 1;
+
+	starpu_perf_knob_set_global_int32_value(knob, 0);
+	STARPU_ASSERT(starpu_perf_knob_get_global_int32_value(knob) == 0);
+	ret = run_tasks(handle);
+	if (ret == -ENODEV) goto enodev;
+	/* The workers may still be finishing an operation which was started
+	 * while enabled */
+	starpu_sleep(0.01);
+	get_times(&push, &pop);
+	get_times(&push, &pop);
+	FPRINTF(stderr, "disabled again: push %f us, pop %f us\n", push, pop);
+	if (push != 0. || pop != 0.)
+		err = 1;
+
+	starpu_data_unregister(handle);
+	starpu_shutdown();
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+
+enodev:
+	starpu_data_unregister(handle);
+	starpu_shutdown();
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	return STARPU_TEST_SKIPPED;
+}
+#endif
@@ -37,7 +37,38 @@ then
 	[ -f $STARPU_FXT_PREFIX/starpu_overlap_sleep_1024_24.gp -a -f $STARPU_FXT_PREFIX/starpu_overlap_sleep_1024_24.data -a -f $STARPU_FXT_PREFIX/starpu_overlap_sleep_1024_24_avg.data ]
 
 	# Generate paje, dag, data, etc.
-	$STARPU_LAUNCH $PREFIX/../../tools/starpu_fxt_tool -d $STARPU_FXT_PREFIX -memory-states -label-deps -i $STARPU_FXT_PREFIX/prof_file_${USER}_0
+	$STARPU_LAUNCH $PREFIX/../../tools/starpu_fxt_tool -d $STARPU_FXT_PREFIX -memory-states -label-deps -columnar -i $STARPU_FXT_PREFIX/prof_file_${USER}_0
+
+	# Read back the columnar files, they have to contain the same states and tasks as trace.rec and tasks.rec
+	python3 - $PREFIX/../../tools $STARPU_FXT_PREFIX <<'EOF'
+import sys
+sys.path.insert(0, sys.argv[1])
+from starpu_fxt_columns import read_columns
+
+def records(path):
+    with open(path) as f:
+        for record in f.read().split("\n\n"):
+            fields = dict(line.split(": ", 1) for line in record.splitlines() if ": " in line)
+            if fields:
+                yield fields
+
+table, states = read_columns(sys.argv[2] + "/trace.col")
+assert table == "states"
+events = [(r["E"], float(r["S"])) for r in records(sys.argv[2] + "/trace.rec")]
+assert len(events) == len(states["Event"]), "%d states instead of %d" % (len(states["Event"]), len(events))
+for (event, time), col_event, col_time in zip(events, states["Event"], states["Time"]):
+    assert event == col_event and abs(time - col_time) < 0.001, "%s at %f instead of %s at %f" % (col_event, col_time, event, time)
+
+table, tasks = read_columns(sys.argv[2] + "/tasks.col")
+assert table == "tasks"
+jobs = dict((int(r["JobId"]), r.get("Name", "")) for r in records(sys.argv[2] + "/tasks.rec") if "Control" not in r)
+assert len(jobs) > 0 and sorted(jobs) == sorted(tasks["JobId"]), "tasks %s instead of %s" % (sorted(tasks["JobId"]), sorted(jobs))
+for job_id, name in zip(tasks["JobId"], tasks["Name"]):
+    assert jobs[int(job_id)] == name, "task %d named %s instead of %s" % (job_id, name, jobs[int(job_id)])
+
+table, transfers = read_columns(sys.argv[2] + "/transfers.col")
+assert table == "transfers"
+EOF
 
 	$PREFIX/../../tools/starpu_paje_sort $STARPU_FXT_PREFIX/paje.trace
 	! type pj_dump || pj_dump -e 0 < $STARPU_FXT_PREFIX/paje.trace
@@ -0,0 +1,158 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <unistd.h>
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Without any previous measurement, auto-heteroprio has to order its
+ * buckets from the performance model estimations: with a single CPU
+ * worker, the tasks of the short codelet must be executed before the tasks
+ * of the long one, even if they are submitted last. A task is put in a
+ * bucket with the ordering computed when it is pushed, so we only check that
+ * most short tasks are executed first.
+ */
+
+#if !defined(STARPU_HAVE_SETENV) || !defined(STARPU_USE_CPU)
+#warning setenv is not defined or no cpu are available. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NTASKS 20
+
+static int executed[2*NTASKS];
+static unsigned nexecuted;
+
+static void func(void *buffers[], void *args)
+{
+	(void) buffers;
+	/* There is only one worker, no need to protect the counter */
+	executed[nexecuted++] = (int)(uintptr_t) args;
+}
+
+static double long_cost(struct starpu_task *task, unsigned nimpl)
+{
+	(void) task;
+	(void) nimpl;
+	return 10000.;
+}
+
+static double short_cost(struct starpu_task *task, unsigned nimpl)
+{
+	(void) task;
+	(void) nimpl;
+	return 10.;
+}
+
+static struct starpu_perfmodel long_model =
+{
+	.type = STARPU_COMMON,
+	.cost_function = long_cost,
+	.symbol = "heteroprio_seeded_long",
+};
+
+static struct starpu_perfmodel short_model =
+{
+	.type = STARPU_COMMON,
+	.cost_function = short_cost,
+	.symbol = "heteroprio_seeded_short",
+};
+
+static struct starpu_codelet long_cl =
+{
+	.cpu_funcs = {func},
+	.nbuffers = 0,
+	.model = &long_model,
+	.name = "heteroprio_seeded_long",
+};
+
+static struct starpu_codelet short_cl =
+{
+	.cpu_funcs = {func},
+	.nbuffers = 0,
+	.model = &short_model,
+	.name = "heteroprio_seeded_short",
+};
+
+int main(void)
+{
+	char data_file[64];
+	int ret, i;
+
+	/* Start without any measurement saved by a previous run */
+	snprintf(data_file, sizeof(data_file), "/tmp/starpu_heteroprio_seeded_%d.data", (int) getpid());
+	unlink(data_file);
+	setenv("STARPU_HETEROPRIO_DATA_FILE", data_file, 1);
+	setenv("STARPU_SCHED", "heteroprio", 1);
+	setenv("STARPU_HETEROPRIO_USE_AUTO_CALIBRATION", "1", 1);
+	setenv("STARPU_AUTOHETEROPRIO_ORDERING_INTERVAL", "1", 1);
+	setenv("STARPU_NCPU", "1", 1);
+
+	ret = starpu_initialize(NULL, NULL, NULL);
+	if (ret == -ENODEV) goto enodev;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	if (starpu_cpu_worker_get_count() != 1 || starpu_worker_get_count() != 1)
+	{
+		starpu_shutdown();
+		goto enodev;
+	}
+
+	starpu_pause();
+	for (i = 0; i < NTASKS; i++)
+	{
+		ret = starpu_task_insert(&long_cl, STARPU_CL_ARGS_NFREE, (void*)(uintptr_t) 1, 0, 0);
+		if (ret == -ENODEV) goto enodev_paused;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	for (i = 0; i < NTASKS; i++)
+	{
+		ret = starpu_task_insert(&short_cl, STARPU_CL_ARGS_NFREE, (void*)(uintptr_t) 0, 0, 0);
+		if (ret == -ENODEV) goto enodev_paused;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_resume();
+
+	starpu_task_wait_for_all();
+	starpu_shutdown();
+	unlink(data_file);
+
+	STARPU_ASSERT(nexecuted == 2*NTASKS);
+	for (i = 0; i < 2*NTASKS; i++)
+		if (executed[i] != 0)
+			break;
+	if (i < NTASKS/2)
+	{
+		FPRINTF(stderr, "only %d short tasks were executed before the first long one, the performance model estimations were not used\n", i);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+
+enodev_paused:
+	starpu_resume();
+	starpu_task_wait_for_all();
+	starpu_shutdown();
+enodev:
+	unlink(data_file);
+	return STARPU_TEST_SKIPPED;
+}
+
+#endif
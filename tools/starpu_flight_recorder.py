@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+# coding=utf-8
+#
+# StarPU --- Runtime system for heterogeneous multicore architectures.
+#
+# Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+#
+# StarPU is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or (at
+# your option) any later version.
+#
+# StarPU is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU Lesser General Public License in COPYING.LGPL for more details.
+#
+
+"""
+This script reads a dump of the StarPU flight recorder (see
+STARPU_FLIGHT_RECORDER), and prints its events sorted by date, in the recutils
+format of the trace.rec file generated by starpu_fxt_tool. With the -s option,
+only the task executions are printed, as PushState/PopState events, so that
+the output can be given to starpu_trace_state_stats.py.
+"""
+
+import getopt
+import struct
+import sys
+
+EVENT_NAMES = {
+    1: "TaskPush",
+    2: "TaskPop",
+    3: "TaskStart",
+    4: "TaskEnd",
+    5: "TransferStart",
+    6: "TransferEnd",
+}
+
+class Event(object):
+    def __init__(self, threadid, date, code, workerid, params):
+        self.threadid = threadid
+        self.date = date
+        self.code = code
+        self.workerid = workerid
+        self.params = params
+
+def read_dump(filename):
+    """ Return the date of the dump and the list of its events, sorted by date """
+    events = []
+    with open(filename, "rb") as f:
+        if f.read(8) != b"STPUFLR1":
+            raise ValueError("not a StarPU flight recorder dump")
+        mark = f.read(4)
+        if struct.unpack("<I", mark)[0] == 0x01020304:
+            order = "<"
+        elif struct.unpack(">I", mark)[0] == 0x01020304:
+            order = ">"
+        else:
+            raise ValueError("unknown byte order")
+        event_size, date = struct.unpack(order + "Id", f.read(12))
+        event_format = order + "dIiQQQ"
+        if struct.calcsize(event_format) > event_size:
+            raise ValueError("unknown event size %d" % event_size)
+
+        while True:
+            header = f.read(24)
+            if len(header) != 24:
+                raise ValueError("truncated dump")
+            threadid, nevents, count = struct.unpack(order + "QQQ", header)
+            if count == 0:
+                break
+            for i in range(count):
+                data = f.read(event_size)
+                if len(data) != event_size:
+                    raise ValueError("truncated dump")
+                edate, code, workerid, p0, p1, p2 = struct.unpack_from(event_format, data)
+                events.append(Event(threadid, edate, code, workerid, (p0, p1, p2)))
+
+    events.sort(key=lambda event: event.date)
+    return date, events
+
+def task_name(event):
+    name = struct.pack("<Q", event.params[2]).rstrip(b"\0").decode(errors="replace")
+    return name if name else "unknown"
+
+def print_event(event, states):
+    lines = []
+    if states:
+        if event.code == 3:
+            lines.append("E: PushState")
+        elif event.code == 4:
+            lines.append("E: PopState")
+        else:
+            return
+        lines.append("N: " + task_name(event))
+        lines.append("C: Task")
+    else:
+        lines.append("E: " + EVENT_NAMES.get(event.code, "Unknown%d" % event.code))
+        if event.code <= 4:
+            lines.append("N: " + task_name(event))
+            lines.append("P: %#x" % event.params[0])
+            if event.params[1]:
+                lines.append("J: %d" % event.params[1])
+        else:
+            lines.append("Src: %d" % (event.params[0] >> 32))
+            lines.append("Dst: %d" % (event.params[0] & 0xffffffff))
+            lines.append("Size: %d" % event.params[1])
+            lines.append("Handle: %#x" % event.params[2])
+    lines.append("W: %d" % event.workerid)
+    lines.append("T: %#x" % event.threadid)
+    # The recorder dates are in µs, trace.rec ones are in ms
+    lines.append("S: %f" % (event.date / 1000.))
+    print("\n".join(lines) + "\n")
+
+def usage():
+    print("USAGE:")
+    print("starpu_flight_recorder.py [ -s ] <dump>")
+    print("")
+    print("OPTIONS:")
+    print(" -s or --states          Only print the task executions, as states")
+    print("")
+    print(" -h or --help            Display this help and exit")
+    print("")
+    print("EXAMPLES:")
+    print("# Print the events recorded before a crash:")
+    print("starpu_flight_recorder.py /tmp/starpu_flight_recorder_user_1234")
+    print("")
+    print("# Compute statistics on the recorded task executions:")
+    print("starpu_flight_recorder.py -s /tmp/starpu_flight_recorder_user_1234 > flight.rec")
+    print("starpu_trace_state_stats.py flight.rec")
+
+def main():
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], "hs", ["help", "states"])
+    except getopt.GetoptError as err:
+        print(str(err))
+        usage()
+        sys.exit(1)
+
+    states = False
+    for o, a in opts:
+        if o in ("-h", "--help"):
+            usage()
+            sys.exit()
+        elif o in ("-s", "--states"):
+            states = True
+
+    if len(args) != 1:
+        usage()
+        sys.exit(1)
+
+    date, events = read_dump(args[0])
+    for event in events:
+        print_event(event, states)
+
+if __name__ == "__main__":
+    main()
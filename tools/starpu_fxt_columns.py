@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+# coding=utf-8
+#
+# StarPU --- Runtime system for heterogeneous multicore architectures.
+#
+# Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+#
+# StarPU is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or (at
+# your option) any later version.
+#
+# StarPU is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU Lesser General Public License in COPYING.LGPL for more details.
+#
+
+"""
+This script reads the trace.col, tasks.col and transfers.col files generated
+by starpu_fxt_tool -columnar, and prints them in the CSV format. It can also be
+imported from python: read_columns() returns the name of the table and a
+dictionary of its columns. The numerical columns are numpy arrays when numpy
+is available, and python arrays otherwise, the string columns are lists.
+"""
+
+import array
+import getopt
+import struct
+import sys
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+INT64 = 0
+DOUBLE = 1
+STRING = 2
+
+class ColumnsReader(object):
+    def __init__(self, f):
+        self._f = f
+        if self._read(8) != b"STPUCOL1":
+            raise ValueError("not a StarPU columnar trace file")
+        mark = self._read(4)
+        if struct.unpack("<I", mark)[0] == 0x01020304:
+            self._order = "<"
+        elif struct.unpack(">I", mark)[0] == 0x01020304:
+            self._order = ">"
+        else:
+            raise ValueError("unknown byte order")
+        self.table = self._read_string()
+        ncolumns = self._read_u32()
+        self.names = []
+        self.types = []
+        for i in range(ncolumns):
+            self.types.append(self._read_u32())
+            self.names.append(self._read_string())
+
+    def _read(self, size):
+        data = self._f.read(size)
+        if len(data) != size:
+            raise ValueError("truncated file")
+        return data
+
+    def _read_u32(self):
+        return struct.unpack(self._order + "I", self._read(4))[0]
+
+    def _read_string(self):
+        return self._read(self._read_u32()).decode()
+
+    def _read_array(self, typecode, size, nrows):
+        values = array.array(typecode)
+        values.frombytes(self._read(size * nrows))
+        if (self._order == "<") != (sys.byteorder == "little"):
+            values.byteswap()
+        return values
+
+    def read(self):
+        columns = [[] for name in self.names]
+        dictionaries = [[] for name in self.names]
+        while True:
+            nrows = self._read_u32()
+            if nrows == 0:
+                break
+            for i, type in enumerate(self.types):
+                if type == INT64:
+                    columns[i].append(self._read_array("q", 8, nrows))
+                elif type == DOUBLE:
+                    columns[i].append(self._read_array("d", 8, nrows))
+                elif type == STRING:
+                    for j in range(self._read_u32()):
+                        dictionaries[i].append(self._read_string())
+                    indexes = self._read_array("I", 4, nrows)
+                    columns[i].append([dictionaries[i][index] for index in indexes])
+                else:
+                    raise ValueError("unknown column type %d" % type)
+
+        result = {}
+        for i, type in enumerate(self.types):
+            if type == STRING:
+                result[self.names[i]] = [value for chunk in columns[i] for value in chunk]
+            elif numpy is not None:
+                dtype = numpy.int64 if type == INT64 else numpy.float64
+                result[self.names[i]] = numpy.concatenate([numpy.frombuffer(chunk, dtype=dtype) for chunk in columns[i]]) if columns[i] else numpy.array([], dtype=dtype)
+            else:
+                values = array.array("q" if type == INT64 else "d")
+                for chunk in columns[i]:
+                    values.extend(chunk)
+                result[self.names[i]] = values
+        return result
+
+def read_columns(filename):
+    with open(filename, "rb") as f:
+        reader = ColumnsReader(f)
+        return reader.table, reader.read()
+
+def usage():
+    print("USAGE:")
+    print("starpu_fxt_columns.py <file.col>")
+    print("")
+    print("OPTIONS:")
+    print(" -h or --help            Display this help and exit")
+    print("")
+    print("EXAMPLES:")
+    print("# Print the tasks in the CSV format:")
+    print("starpu_fxt_columns.py tasks.col")
+
+def main():
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], "h", ["help"])
+    except getopt.GetoptError as err:
+        print(str(err))
+        usage()
+        sys.exit(1)
+
+    for o, a in opts:
+        if o in ("-h", "--help"):
+            usage()
+            sys.exit()
+
+    if len(args) != 1:
+        usage()
+        sys.exit(1)
+
+    with open(args[0], "rb") as f:
+        reader = ColumnsReader(f)
+        columns = reader.read()
+
+    names = reader.names
+    print(",".join(names))
+    nrows = len(columns[names[0]]) if names else 0
+    for row in range(nrows):
+        values = []
+        for i, name in enumerate(names):
+            value = columns[name][row]
+            if reader.types[i] == STRING:
+                values.append("\"" + value + "\"")
+            else:
+                values.append(str(value))
+        print(",".join(values))
+
+if __name__ == "__main__":
+    main()
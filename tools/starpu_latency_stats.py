@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+# coding=utf-8
+#
+# StarPU --- Runtime system for heterogeneous multicore architectures.
+#
+# Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+#
+# StarPU is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or (at
+# your option) any later version.
+#
+# StarPU is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU Lesser General Public License in COPYING.LGPL for more details.
+#
+
+"""
+This script reads the latency histograms dumped by StarPU (see
+STARPU_LATENCY_HISTOGRAMS_FILE), and prints for each codelet the median, 99th
+and 99.9th percentiles of the submission-to-start latency and of the execution
+time of its tasks, in microseconds.
+"""
+
+import getopt
+import math
+import sys
+
+PERCENTILES = [50., 99., 99.9]
+KINDS = ["wait", "exec"]
+
+def bucket_max(bucket, sub_bits):
+    """ Upper bound of the bucket, in µs """
+    if bucket < (1 << (sub_bits + 1)):
+        return (bucket + 1) / 1000.
+    shift = (bucket >> sub_bits) - 1
+    mantissa = (1 << sub_bits) + (bucket & ((1 << sub_bits) - 1))
+    return ((mantissa + 1) << shift) / 1000.
+
+def read_histograms(filename):
+    """ Return the number of sub-bucket bits, and a dictionary of the
+    histograms, indexed by (workerid, kind, codelet) """
+    histograms = {}
+    sub_bits = None
+    with open(filename, "r") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if line.startswith("#"):
+                fields = line.split()
+                if "sub-bucket" in fields:
+                    sub_bits = int(fields[fields.index("sub-bucket") - 1])
+                continue
+            fields = line.split("\t")
+            if len(fields) < 3:
+                continue
+            buckets = {}
+            for field in fields[3:]:
+                bucket, count = field.split(":")
+                buckets[int(bucket)] = int(count)
+            histograms[(int(fields[0]), fields[1], fields[2])] = buckets
+    if sub_bits is None:
+        raise ValueError("not a StarPU latency histograms dump")
+    return sub_bits, histograms
+
+def merge(histograms, keys):
+    merged = {}
+    for key in keys:
+        for bucket, count in histograms[key].items():
+            merged[bucket] = merged.get(bucket, 0) + count
+    return merged
+
+def percentiles(buckets, sub_bits):
+    """ Return the number of values and their percentiles """
+    total = sum(buckets.values())
+    values = []
+    for p in PERCENTILES:
+        if not total:
+            values.append(0.)
+            continue
+        target = max(1, math.ceil(p * total / 100.))
+        cumul = 0
+        for bucket in sorted(buckets):
+            cumul += buckets[bucket]
+            if cumul >= target:
+                values.append(bucket_max(bucket, sub_bits))
+                break
+    return total, values
+
+def print_stats(name, histograms, keys, sub_bits):
+    total, waits = percentiles(merge(histograms, [key for key in keys if key[1] == "wait"]), sub_bits)
+    total, execs = percentiles(merge(histograms, [key for key in keys if key[1] == "exec"]), sub_bits)
+    print("%-30s %10d %12.2f %12.2f %12.2f %12.2f %12.2f %12.2f" % ((name, total) + tuple(waits) + tuple(execs)))
+
+def usage():
+    print("USAGE:")
+    print("starpu_latency_stats.py [ -w ] <histograms file>")
+    print("")
+    print("OPTIONS:")
+    print(" -w or --workers         Also print the percentiles per worker")
+    print("")
+    print(" -h or --help            Display this help and exit")
+    print("")
+    print("EXAMPLE:")
+    print("STARPU_LATENCY_HISTOGRAMS=1 STARPU_LATENCY_HISTOGRAMS_FILE=latencies.txt ./application")
+    print("starpu_latency_stats.py latencies.txt")
+
+def main():
+    try:
+        opts, args = getopt.getopt(sys.argv[1:], "hw", ["help", "workers"])
+    except getopt.GetoptError as err:
+        print(str(err))
+        usage()
+        sys.exit(1)
+
+    workers = False
+    for o, a in opts:
+        if o in ("-h", "--help"):
+            usage()
+            sys.exit()
+        elif o in ("-w", "--workers"):
+            workers = True
+
+    if len(args) != 1:
+        usage()
+        sys.exit(1)
+
+    sub_bits, histograms = read_histograms(args[0])
+
+    print("%-30s %10s %12s %12s %12s %12s %12s %12s" % ("codelet", "tasks",
+          "wait p50", "wait p99", "wait p99.9", "exec p50", "exec p99", "exec p99.9"))
+    codelets = sorted(set([key[2] for key in histograms]))
+    for codelet in codelets:
+        keys = [key for key in histograms if key[2] == codelet]
+        print_stats(codelet, histograms, keys, sub_bits)
+        if workers:
+            for workerid in sorted(set([key[0] for key in keys])):
+                print_stats("  worker %d" % workerid, histograms,
+                            [key for key in keys if key[0] == workerid], sub_bits)
+
+if __name__ == "__main__":
+    main()
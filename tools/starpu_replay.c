@@ -17,7 +17,10 @@
 
 /*
  * This reads a tasks.rec file and replays the recorded task graph.
- * Currently, this version is done to run with simgrid.
+ * It is mostly meant to run with simgrid, but without simgrid the kernels
+ * just sleep for the expected duration. To compare scheduling policies on the
+ * same task graph (see --bench), the kernels do not sleep, and the execution
+ * is instead simulated on a virtual clock.
  *
  * For further information, contact erwan.leria@inria.fr
  */
@@ -45,6 +48,8 @@
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 static int static_workerid;
+static int bench;
+static double time_scale = 1.;
 
 /* TODO: move to core header while moving starpu_replay_sched to core */
 extern void schedRecInit(const char * filename);
@@ -101,6 +106,8 @@ static struct task
 	long submit_order;
 	jobid_t *deps;
 	size_t ndependson;
+	/** [BENCH] Virtual date at which the task ended */
+	double virtual_end;
 	struct starpu_task task;
 	enum task_type type;
 	int reg_signal;
@@ -333,15 +340,17 @@ double arch_cost_function(struct starpu_task *task, struct starpu_perfmodel_arch
 
 /* End of settings */
 
+static void bench_execute(struct starpu_task *task, unsigned worker, double length);
+
 static unsigned long nexecuted_tasks;
 void dumb_kernel(void *buffers[], void *args)
 {
 	(void) buffers;
 	(void) args;
-	nexecuted_tasks++;
-	if (!(nexecuted_tasks % 1000))
+	unsigned long executed = STARPU_ATOMIC_ADDL(&nexecuted_tasks, 1);
+	if (!(executed % 1000))
 	{
-		fprintf(stderr, "\rExecuted task %lu...", nexecuted_tasks);
+		fprintf(stderr, "\rExecuted task %lu...", executed);
 		fflush(stdout);
 	}
 
@@ -357,7 +366,10 @@ void dumb_kernel(void *buffers[], void *args)
 			"Codelet %s does not have a perfmodel, or is not calibrated enough, please re-run in non-simgrid mode until it is calibrated",
 		starpu_task_get_name(task));
 
-	starpu_sleep(length / 1000000);
+	if (bench)
+		bench_execute(task, this_worker, length);
+	else
+		starpu_sleep(length * time_scale / 1000000);
 }
 
 /* [CODELET] Initialization of an unique codelet for all the tasks*/
@@ -402,6 +414,160 @@ static struct starpu_codelet cl =
 	.flags = STARPU_CODELET_SIMGRID_EXECUTE,
 };
 
+/* [BENCH] Wrap the push and pop methods of the benchmarked policy, to
+ * measure the time spent taking scheduling decisions.
+ *
+ * The kernels do not actually last for their predicted duration, which would
+ * make the measured makespan depend on the precision of sleeping and on the
+ * scheduling of the system threads. The tasks are rather executed on a
+ * virtual clock: a task starts when its worker has finished the previous one
+ * and when the tasks it depends on have ended, and lasts for its predicted
+ * duration. The makespan and the idle ratio are thus only given by the
+ * decisions of the scheduling policy, i.e. which task runs on which worker,
+ * and in which order. */
+
+struct bench_counters
+{
+	char fill1[STARPU_CACHELINE_SIZE];
+	double push_time;
+	unsigned long npush;
+	double pop_time;
+	unsigned long npop;
+	/** Virtual date at which the worker ended its last task */
+	double virtual_date;
+	/** Virtual time spent executing tasks */
+	double virtual_busy;
+	char fill2[STARPU_CACHELINE_SIZE];
+};
+
+/* One slot per worker, the last one is for the other threads, and protected by bench_mutex */
+static struct bench_counters bench_counters[STARPU_NMAXWORKERS+1];
+static starpu_pthread_mutex_t bench_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+static struct starpu_sched_policy *bench_policy;
+static struct starpu_sched_policy bench_wrapper;
+
+static int bench_push_task(struct starpu_task *task)
+{
+	int worker = starpu_worker_get_id();
+	double start = starpu_timing_now();
+	int ret = bench_policy->push_task(task);
+	double delay = starpu_timing_now() - start;
+
+	if (worker < 0)
+	{
+		STARPU_PTHREAD_MUTEX_LOCK(&bench_mutex);
+		bench_counters[STARPU_NMAXWORKERS].push_time += delay;
+		bench_counters[STARPU_NMAXWORKERS].npush++;
+		STARPU_PTHREAD_MUTEX_UNLOCK(&bench_mutex);
+	}
+	else
+	{
+		bench_counters[worker].push_time += delay;
+		bench_counters[worker].npush++;
+	}
+	return ret;
+}
+
+static struct starpu_task *bench_pop_task(unsigned sched_ctx_id)
+{
+	int worker = starpu_worker_get_id_check();
+	double start = starpu_timing_now();
+	struct starpu_task *task = bench_policy->pop_task(sched_ctx_id);
+
+	/* Only account decisions, not polling an empty scheduler */
+	if (task)
+	{
+		bench_counters[worker].pop_time += starpu_timing_now() - start;
+		bench_counters[worker].npop++;
+	}
+	return task;
+}
+
+/* Called by the worker executing the task instead of sleeping. The tasks it
+ * depends on have ended, so their virtual end date is known. */
+static void bench_execute(struct starpu_task *task, unsigned worker, double length)
+{
+	struct task *replayed = (struct task *) ((char *) task - offsetof(struct task, task));
+	double start = bench_counters[worker].virtual_date;
+	size_t i;
+
+	for (i = 0; i < replayed->ndependson; i++)
+	{
+		struct task *dep;
+		/* The hash is not modified while the tasks are executed */
+		HASH_FIND(hh, tasks, &replayed->deps[i], sizeof(jobid_t), dep);
+		if (dep && dep->virtual_end > start)
+			start = dep->virtual_end;
+	}
+
+	replayed->virtual_end = start + length;
+	bench_counters[worker].virtual_date = replayed->virtual_end;
+	bench_counters[worker].virtual_busy += length;
+}
+
+static void bench_wrap_policy(struct starpu_sched_policy *policy)
+{
+	bench_policy = policy;
+	bench_wrapper = *policy;
+	bench_wrapper.push_task = bench_push_task;
+	if (policy->pop_task)
+		bench_wrapper.pop_task = bench_pop_task;
+}
+
+/* Called just before submitting the tasks, to only measure their execution */
+static void bench_reset(void)
+{
+	int busid;
+
+	memset(bench_counters, 0, sizeof(bench_counters));
+	for (busid = 0; busid < starpu_bus_get_count(); busid++)
+	{
+		struct starpu_profiling_bus_info bus_info;
+		starpu_bus_get_profiling_info(busid, &bus_info);
+	}
+}
+
+static void bench_print(void)
+{
+	double makespan = 0., busy = 0.;
+	double push_time = 0., pop_time = 0.;
+	unsigned long npush = 0, npop = 0;
+	long long transferred_bytes = 0;
+	unsigned worker, nworkers = starpu_worker_get_count();
+	int busid;
+
+	for (worker = 0; worker < nworkers; worker++)
+	{
+		if (bench_counters[worker].virtual_date > makespan)
+			makespan = bench_counters[worker].virtual_date;
+		busy += bench_counters[worker].virtual_busy;
+	}
+	for (busid = 0; busid < starpu_bus_get_count(); busid++)
+	{
+		struct starpu_profiling_bus_info bus_info;
+		starpu_bus_get_profiling_info(busid, &bus_info);
+		transferred_bytes += bus_info.transferred_bytes;
+	}
+	for (worker = 0; worker < STARPU_NMAXWORKERS+1; worker++)
+	{
+		push_time += bench_counters[worker].push_time;
+		npush += bench_counters[worker].npush;
+		pop_time += bench_counters[worker].pop_time;
+		npop += bench_counters[worker].npop;
+	}
+
+	/* Name the policy which was actually run by the context */
+	printf("%s,%lu,%f,%f,%lld,%f,%f\n",
+	       starpu_sched_get_sched_policy()->policy_name,
+	       nexecuted_tasks,
+	       makespan / 1000.,
+	       makespan > 0. ? 1. - busy / (makespan * nworkers) : 0.,
+	       transferred_bytes,
+	       npush ? push_time / npush : 0.,
+	       npop ? pop_time / npop : 0.);
+	fflush(stdout);
+}
+
 
 /* * * * * * * * * * * * * *
 * * * * * Functions * * * * *
@@ -569,6 +735,9 @@ int submit_tasks(void)
 	struct starpu_rbtree_node * currentNode = starpu_rbtree_first(tmptree);
 	long last_submitorder = 0;
 
+	if (bench)
+		bench_reset();
+
 	while (currentNode != NULL)
 	{
 		struct task * currentTask = (struct task *) currentNode;
@@ -664,16 +833,23 @@ int submit_tasks(void)
 
 static void usage(const char *program)
 {
-	fprintf(stderr,"Usage: %s [--static-workerid] tasks.rec [sched.rec]\n", program);
+	fprintf(stderr,"Usage: %s [--static-workerid] [--time-scale factor] [--bench [--sched policy]...] tasks.rec [sched.rec]\n", program);
+	fprintf(stderr,"\n");
+	fprintf(stderr,"   --static-workerid    execute tasks on the worker they were recorded on\n");
+	fprintf(stderr,"   --time-scale factor  multiply the duration of the fake kernels by factor,\n");
+	fprintf(stderr,"                        without --bench\n");
+	fprintf(stderr,"   --bench              replay the graph with each scheduling policy on a virtual\n");
+	fprintf(stderr,"                        clock, and print makespan, idle ratio, transferred bytes\n");
+	fprintf(stderr,"                        and push/pop durations as CSV\n");
+	fprintf(stderr,"   --sched policy       only replay with this policy in --bench mode (can be repeated)\n");
 	exit(EXIT_FAILURE);
 }
 
-int main(int argc, char **argv)
+/* Replay the whole tasks.rec file once, with the given configuration */
+static int replay(const char *tasks_rec, struct starpu_conf *conf)
 {
 	FILE *rec;
 	char *s;
-	const char *tasks_rec = NULL;
-	const char *sched_rec = NULL;
 	unsigned i;
 	size_t s_allocated = 128;
 
@@ -681,47 +857,33 @@ int main(int argc, char **argv)
 
 	/* FIXME: we do not support data with sequential consistency disabled */
 
+	rec = fopen(tasks_rec, "r");
+	if (!rec)
+	{
+		fprintf(stderr,"unable to open file %s: %s\n", tasks_rec, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
 	_STARPU_MALLOC(s, s_allocated);
 	dependson_size = REPLAY_NMAX_DEPENDENCIES; /* Change the value of REPLAY_NMAX_DEPENCIES to modify the number of dependencies */
 	_STARPU_MALLOC(dependson, dependson_size * sizeof (* dependson));
 	alloc_mode = 1;
+	priority = 0;
+	nexecuted_tasks = 0;
+	total_flops = 0.;
 
-	for (i = 1; i < (unsigned) argc; i++)
+	int ret = starpu_init(conf);
+	if (ret == -ENODEV)
 	{
-		if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
-		{
-			usage(argv[0]);
-		}
-		else if (!strcmp(argv[i], "--static-workerid"))
-		{
-			static_workerid = 1;
-		}
-		else
-		{
-			if (!tasks_rec)
-				tasks_rec = argv[i];
-			else if (!sched_rec)
-				sched_rec = argv[i];
-			else
-				usage(argv[0]);
-		}
+		fclose(rec);
+		free(dependson);
+		free(s);
+		return 77;
 	}
 
-	if (!tasks_rec)
-		usage(argv[0]);
-
-	if (sched_rec)
-		schedRecInit(sched_rec);
-
-	rec = fopen(tasks_rec, "r");
-	if (!rec)
-	{
-		fprintf(stderr,"unable to open file %s: %s\n", tasks_rec, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
-	int ret = starpu_init(NULL);
-	if (ret == -ENODEV) goto enodev;
+	if (bench)
+		/* To measure the transfers */
+		starpu_profiling_status_set(STARPU_PROFILING_ENABLE);
 
 	/* Read line by line, and on empty line submit the task with the accumulated information */
 	reset();
@@ -1135,13 +1297,19 @@ eof:
 	starpu_task_wait_for_all();
 	fprintf(stderr, " done.\n");
 
-	printf("%g ms", (starpu_timing_now() - start) / 1000.);
-	if (total_flops != 0.)
-		printf("\t%g GF/s", (total_flops / (starpu_timing_now() - start)) / 1000.);
-	printf("\n");
+	if (bench)
+		bench_print();
+	else
+	{
+		printf("%g ms", (starpu_timing_now() - start) / 1000.);
+		if (total_flops != 0.)
+			printf("\t%g GF/s", (total_flops / (starpu_timing_now() - start)) / 1000.);
+		printf("\n");
+	}
 
 	/* FREE allocated memory */
 
+	fclose(rec);
 	free(dependson);
 	free(s);
 
@@ -1190,3 +1358,108 @@ enodev:
 	starpu_shutdown();
 	return 77;
 }
+
+int main(int argc, char **argv)
+{
+	const char *tasks_rec = NULL;
+	const char *sched_rec = NULL;
+	const char *scheds[argc];
+	unsigned nscheds = 0;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
+		{
+			usage(argv[0]);
+		}
+		else if (!strcmp(argv[i], "--static-workerid"))
+		{
+			static_workerid = 1;
+		}
+		else if (!strcmp(argv[i], "--time-scale"))
+		{
+			if (++i == argc)
+				usage(argv[0]);
+			time_scale = strtod(argv[i], NULL);
+		}
+		else if (!strcmp(argv[i], "--bench"))
+		{
+			bench = 1;
+		}
+		else if (!strcmp(argv[i], "--sched"))
+		{
+			if (++i == argc)
+				usage(argv[0]);
+			scheds[nscheds++] = argv[i];
+		}
+		else
+		{
+			if (!tasks_rec)
+				tasks_rec = argv[i];
+			else if (!sched_rec)
+				sched_rec = argv[i];
+			else
+				usage(argv[0]);
+		}
+	}
+
+	if (!tasks_rec)
+		usage(argv[0]);
+
+	if (!bench)
+	{
+		if (sched_rec)
+			schedRecInit(sched_rec);
+		return replay(tasks_rec, NULL);
+	}
+
+	if (sched_rec)
+	{
+		fprintf(stderr, "sched.rec forces scheduling decisions, it can not be used with --bench\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* The policy selected by STARPU_SCHED restricts the set like --sched,
+	 * but it would otherwise take precedence over the measuring wrapper */
+	if (!nscheds && starpu_getenv("STARPU_SCHED"))
+		scheds[nscheds++] = strdup(starpu_getenv("STARPU_SCHED"));
+#ifdef STARPU_HAVE_UNSETENV
+	unsetenv("STARPU_SCHED");
+#endif
+
+	/* Replay the graph with each policy in turn */
+	struct starpu_sched_policy **policy;
+	int ran = 0;
+
+	printf("policy,ntasks,makespan_ms,idle_ratio,transferred_bytes,push_us,pop_us\n");
+	for (policy = starpu_sched_get_predefined_policies(); *policy; policy++)
+	{
+		struct starpu_conf conf;
+		unsigned n;
+		int ret;
+
+		for (n = 0; n < nscheds; n++)
+			if (!strcmp(scheds[n], (*policy)->policy_name))
+				break;
+		if (nscheds && n == nscheds)
+			continue;
+
+		fprintf(stderr, "Replaying with policy %s\n", (*policy)->policy_name);
+		bench_wrap_policy(*policy);
+		starpu_conf_init(&conf);
+		conf.sched_policy = &bench_wrapper;
+		ret = replay(tasks_rec, &conf);
+		if (ret)
+			return ret;
+		ran++;
+	}
+
+	if (!ran)
+	{
+		fprintf(stderr, "No scheduling policy matched\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
@@ -0,0 +1,63 @@
+#!/bin/sh
+# StarPU --- Runtime system for heterogeneous multicore architectures.
+#
+# Copyright (C) 2023-2023  Université de Bordeaux, CNRS (LaBRI UMR 5800), Inria
+#
+# StarPU is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation; either version 2.1 of the License, or (at
+# your option) any later version.
+#
+# StarPU is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#
+# See the GNU Lesser General Public License in COPYING.LGPL for more details.
+#
+# Compare the scheduling policies on a recorded task graph, and check the
+# CSV produced by starpu_replay --bench.
+#
+# Usage: starpu_replay_bench.sh [tasks.rec [starpu_replay options]]
+#
+# Without tasks.rec, the 4x4 tiled Cholesky graph of replay/ is replayed
+# with the sampled performance models of attila.
+
+set -e
+
+SRCDIR=${top_srcdir:+$top_srcdir/tools}
+SRCDIR=${SRCDIR:-$(dirname $0)}
+BUILDDIR=${top_builddir:+$top_builddir/tools}
+BUILDDIR=${BUILDDIR:-.}
+REPLAY=$BUILDDIR/starpu_replay
+
+[ -x $REPLAY ] || exit 77
+
+TMPDIR_BENCH=$(mktemp -d)
+trap "rm -rf $TMPDIR_BENCH" EXIT
+CSV=$TMPDIR_BENCH/bench.csv
+
+if [ $# -gt 0 ]
+then
+	TASKS_REC=$1
+	shift
+else
+	TASKS_REC=$SRCDIR/replay/cholesky_4x4.rec
+	# Work on a copy of the codelet models, StarPU writes its bus
+	# calibration and scheduler data in the performance model directory
+	export STARPU_HOSTNAME=attila
+	export STARPU_PERF_MODEL_DIR=$TMPDIR_BENCH/sampling
+	mkdir -p $STARPU_PERF_MODEL_DIR/codelets/45
+	cp $SRCDIR/perfmodels/sampling/codelets/45/chol_model_*.attila $STARPU_PERF_MODEL_DIR/codelets/45
+fi
+
+$STARPU_LAUNCH $REPLAY --bench "$@" $TASKS_REC > $CSV
+cat $CSV
+
+# Only check the format: the figures depend on the policies and on the
+# machine. One header line, and one line of 7 fields per policy
+[ "$(head -n 1 $CSV)" = "policy,ntasks,makespan_ms,idle_ratio,transferred_bytes,push_us,pop_us" ]
+[ $(wc -l < $CSV) -gt 1 ]
+tail -n +2 $CSV | awk -F, '
+	NF != 7 { print "bad line: " $0; exit 1 }
+	{ for (i = 2; i <= 7; i++) if ($i !~ /^-?[0-9]+(\.[0-9]+)?([eE][-+]?[0-9]+)?$/) { print "bad field " i ": " $0; exit 1 } }
+' >&2